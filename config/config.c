@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include <sys/stat.h>
 
 #include "config/config.h"
+#include "config/config_cache.h"
 
 #include "parser/parser.h"
-#include "parser/file_parser.h"
+#include "parser/mapped_parser.h"
 
 #include "misc/geometry.h"
 
@@ -44,6 +46,43 @@ config_variable_type config_check_variable_type(char * type)
 
 }
 
+/**
+ *  Individua il tipo di un valore a partire dalle funzioni con le quali è stato inserito
+ *
+ *  @param functions Funzioni del valore
+ *
+ *  @return Tipo del valore
+ *  @retval CONFIG_VARTYPE_UNKNOWN Se il tipo non è tra quelli dei file di configurazione
+ */
+config_variable_type config_value_type(struct type_functions functions)
+{
+
+    if (functions.duplicate == long_functions.duplicate)
+        return CONFIG_VARTYPE_INT;
+
+    if (functions.duplicate == float_functions.duplicate)
+        return CONFIG_VARTYPE_FLOAT;
+
+    if (functions.duplicate == string_functions.duplicate)
+        return CONFIG_VARTYPE_STRING;
+
+    if (functions.duplicate == dimension_functions.duplicate)
+        return CONFIG_VARTYPE_SIZE;
+
+    if (functions.duplicate == rectangle_functions.duplicate)
+        return CONFIG_VARTYPE_RECTANGLE;
+
+    if (functions.duplicate == hashtable_functions.duplicate)
+        return CONFIG_VARTYPE_DICTIONARY;
+
+    //  le liste non hanno una funzione di copia
+    if (functions.delete == list_functions.delete)
+        return CONFIG_VARTYPE_LIST;
+
+    return CONFIG_VARTYPE_UNKNOWN;
+
+}
+
 /**
  *  Converte una dimensione da stringa ad un dimension_t
  *
@@ -237,6 +276,18 @@ list_t * config_read_list(parser_t * parser, config_variable_type contents_type)
 
 }
 
+hashtable_t * config_table_new(void)
+{
+
+    hashtable_t * table = hashtable_new(HASHTABLE_DEFAULT_SIZE, string_functions);
+
+    //  le chiavi sono stringhe, conviene una funzione che le elabori a parole
+    table->hash = wyhash;
+
+    return table;
+
+}
+
 /**
  *  Converte un dizionario da stringa ad una Hashtable
  *
@@ -260,7 +311,7 @@ hashtable_t * config_read_dictionary(parser_t * parser)
         return NULL;
 
     //  creazione nuova hashtable
-    hashtable_t * ht = hashtable_new(HASHTABLE_DEFAULT_SIZE, string_functions);
+    hashtable_t * ht = config_table_new();
 
     //  si cambia momentaneamente la destinazione del parsing
     //  con la hashtable appena allocata
@@ -483,23 +534,49 @@ int config_parse(parser_t * parser)
 
 }
 
-hashtable_t * config_open(char * file_path)
+/**
+ *  Legge un file di configurazione, utilizzando la cache solo se richiesto
+ *
+ *  @param file_path Percorso del file
+ *  @param use_cache Se true e il file non è cambiato si utilizza la cache del parsing precedente
+ *
+ *  @return Hashtable contenente le variabili del file di configurazione
+ *  @retval NULL in caso di errore
+ */
+static hashtable_t * config_load(char * file_path, bool use_cache)
 {
 
-    //  file di conf
-    FILE * config = fopen(file_path, "r");
+    struct stat source;
+
+    //  la cache è aggiornata dopo ogni parsing
+    char * cache_path = NULL;
+
+    if (stat(file_path, &source) == 0) {
+
+        cache_path = config_cache_path(file_path);
+
+        hashtable_t * cached = use_cache ? config_cache_load(cache_path, (int64_t)source.st_mtime, (uint64_t)source.st_size) : NULL;
+
+        if (cached) {
+            memfree(cache_path);
+            return cached;
+        }
+
+    }
+
+    hashtable_t * table = config_table_new();
+
+    //  creazione parser con il contenuto del file e la tabella
+    parser_t * parser = mapped_parser_new(file_path, false, table);
 
     //  ci sono problemi nella lettura del file
-    if (!config) {
+    if (!parser) {
         errorf("Errore in fase di lettura del file %s\n", file_path);
+        hashtable_delete(table);
+        memfree(cache_path);
         return NULL;
     }
 
-    hashtable_t * table = hashtable_new(HASHTABLE_DEFAULT_SIZE, string_functions);
-
-    //  creazione parser con il file e la tabella
-    parser_t * parser = parser_new(config, 0, table, file_parser_functions);
-
     int r;
 
     if ((r = config_parse(parser)) != 0) {
@@ -512,10 +589,29 @@ hashtable_t * config_open(char * file_path)
     }
 
     //  deallocazione parser
-    parser_delete(parser);
+    mapped_parser_delete(parser);
 
-    fclose(config);
+    //  salvataggio della cache, se non è possibile (es. cartella in sola lettura)
+    //  al prossimo avvio si ripete il parsing
+    if (table && cache_path)
+        config_cache_save(table, cache_path, (int64_t)source.st_mtime, (uint64_t)source.st_size);
+
+    memfree(cache_path);
 
     return table;
 
+}
+
+hashtable_t * config_open(char * file_path)
+{
+
+    return config_load(file_path, true);
+
+}
+
+hashtable_t * config_reload(char * file_path)
+{
+
+    return config_load(file_path, false);
+
 }
\ No newline at end of file
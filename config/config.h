@@ -91,6 +91,36 @@ typedef enum {
  */
 hashtable_t * config_open(char * path);
 
+/**
+ *  Rilegge un file di configurazione modificato: il parsing è sempre ripetuto,
+ *  senza consultare la cache (la data di modifica ha la risoluzione di un secondo
+ *  e non distingue due salvataggi ravvicinati), che viene poi aggiornata
+ *
+ *  @param path Percorso del file di configurazione
+ *
+ *  @return Hashtable contenente le variabili del file di configurazione
+ *  @retval NULL in caso di errore
+ */
+hashtable_t * config_reload(char * path);
+
+/**
+ *  Crea una nuova tabella per le variabili di un file di configurazione
+ *  (chiavi di tipo stringa, funzione di hashing wyhash)
+ *
+ *  @return Hashtable
+ */
+hashtable_t * config_table_new(void);
+
+/**
+ *  Individua il tipo di un valore a partire dalle funzioni con le quali è stato inserito
+ *
+ *  @param functions Funzioni del valore
+ *
+ *  @return Tipo del valore
+ *  @retval CONFIG_VARTYPE_UNKNOWN Se il tipo non è tra quelli dei file di configurazione
+ */
+config_variable_type config_value_type(struct type_functions functions);
+
 /**
  *  Converte la rappresentazione come stringa del valore di una variabile nella sua rappresentazione reale
  *
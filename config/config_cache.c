@@ -0,0 +1,561 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <unistd.h>
+#endif
+
+#include "config/config.h"
+#include "config/config_cache.h"
+
+#include "parser/parser.h"
+#include "parser/mapped_parser.h"
+
+#include "misc/geometry.h"
+
+/** Identificativo dei file di cache ("CFGC") */
+#define CONFIG_CACHE_MAGIC 0x43474643u
+
+/** Versione del formato, da incrementare ad ogni modifica della serializzazione */
+#define CONFIG_CACHE_VERSION 1u
+
+/**
+ *  Intestazione di un file di cache.
+ *  I campi sono allineati naturalmente, per cui la struttura non contiene padding.
+ *  I valori sono scritti nell'ordine dei bytes della macchina: una cache
+ *  scritta da un'architettura diversa non supera il controllo su magic.
+ */
+typedef struct config_cache_header_s {
+
+    /** CONFIG_CACHE_MAGIC */
+    uint32_t magic;
+
+    /** CONFIG_CACHE_VERSION */
+    uint32_t version;
+
+    /** Data di modifica del sorgente */
+    int64_t mtime;
+
+    /** Dimensione del sorgente */
+    uint64_t size;
+
+} config_cache_header_t;
+
+/**
+ *  Buffer nel quale è serializzata una tabella
+ */
+typedef struct config_cache_writer_s {
+
+    /** Dati */
+    char * data;
+
+    /** Bytes scritti */
+    size_t length;
+
+    /** Dimensione del buffer */
+    size_t capacity;
+
+    /** Se è stato incontrato un valore non serializzabile */
+    bool failed;
+
+} config_cache_writer_t;
+
+char * config_cache_path(const char * source_path)
+{
+
+    size_t length = strlen(source_path);
+
+    char * path = memalloc(char, length + sizeof(CONFIG_CACHE_SUFFIX));
+
+    memcpy(path, source_path, length);
+    memcpy(path + length, CONFIG_CACHE_SUFFIX, sizeof(CONFIG_CACHE_SUFFIX));
+
+    return path;
+
+}
+
+/**
+ *  Aggiunge dei bytes al buffer di serializzazione
+ *
+ *  @param writer Buffer
+ *  @param data Dati
+ *  @param length Numero di bytes
+ */
+void config_cache_write(config_cache_writer_t * writer, const void * data, size_t length)
+{
+
+    if (writer->length + length > writer->capacity) {
+
+        while (writer->length + length > writer->capacity)
+            writer->capacity *= 2;
+
+        writer->data = memrealloc(writer->data, char, writer->capacity);
+
+    }
+
+    memcpy(writer->data + writer->length, data, length);
+    writer->length += length;
+
+}
+
+/**
+ *  Serializza una stringa (lunghezza seguita dai caratteri)
+ *
+ *  @param writer Buffer
+ *  @param string Stringa
+ */
+void config_cache_write_string(config_cache_writer_t * writer, const char * string)
+{
+
+    uint32_t length = (uint32_t)strlen(string);
+
+    config_cache_write(writer, &length, sizeof(length));
+    config_cache_write(writer, string, length);
+
+}
+
+void config_cache_write_dictionary(config_cache_writer_t * writer, hashtable_t * table);
+
+/**
+ *  Serializza un valore
+ *
+ *  @param writer Buffer
+ *  @param type Tipo del valore
+ *  @param value Valore
+ */
+void config_cache_write_value(config_cache_writer_t * writer, config_variable_type type, void * value)
+{
+
+    if (type == CONFIG_VARTYPE_INT) {
+
+        //  dimensione fissa, indipendente da sizeof(long)
+        int64_t lv = long_value(value);
+        config_cache_write(writer, &lv, sizeof(lv));
+
+    } else if (type == CONFIG_VARTYPE_FLOAT) {
+
+        config_cache_write(writer, value, sizeof(float));
+
+    } else if (type == CONFIG_VARTYPE_STRING) {
+
+        config_cache_write_string(writer, value);
+
+    } else if (type == CONFIG_VARTYPE_SIZE) {
+
+        config_cache_write(writer, value, sizeof(dimension_t));
+
+    } else if (type == CONFIG_VARTYPE_RECTANGLE) {
+
+        config_cache_write(writer, value, sizeof(rectangle_t));
+
+    } else if (type == CONFIG_VARTYPE_DICTIONARY) {
+
+        config_cache_write_dictionary(writer, value);
+
+    } else if (type == CONFIG_VARTYPE_LIST) {
+
+        list_t * list = value;
+
+        //  tipo degli elementi e numero di elementi
+        uint8_t contents_type = (uint8_t)config_value_type(list->element_type);
+        uint32_t length = (uint32_t)list_length(list);
+
+        if (contents_type == CONFIG_VARTYPE_UNKNOWN || contents_type == CONFIG_VARTYPE_LIST || contents_type == CONFIG_VARTYPE_DICTIONARY) {
+            writer->failed = true;
+            return;
+        }
+
+        config_cache_write(writer, &contents_type, sizeof(contents_type));
+        config_cache_write(writer, &length, sizeof(length));
+
+        foreach(list, void *, element) {
+            config_cache_write_value(writer, contents_type, element);
+        }
+
+    } else {
+
+        writer->failed = true;
+
+    }
+
+}
+
+/**
+ *  Serializza una variabile di un dizionario (callback di hashtable_iterate)
+ *
+ *  @param table Dizionario
+ *  @param data Buffer
+ *  @param key Nome della variabile
+ *  @param value Valore
+ *  @param value_type Funzioni del valore
+ */
+void config_cache_write_variable(hashtable_t * table, void * data, void * key, void * value, struct type_functions value_type)
+{
+
+    unused(table);
+
+    config_cache_writer_t * writer = data;
+
+    uint8_t type = (uint8_t)config_value_type(value_type);
+
+    if (type == CONFIG_VARTYPE_UNKNOWN) {
+        writer->failed = true;
+        return;
+    }
+
+    config_cache_write(writer, &type, sizeof(type));
+    config_cache_write_string(writer, key);
+    config_cache_write_value(writer, type, value);
+
+}
+
+/**
+ *  Serializza un dizionario: le variabili (tipo, nome, valore) terminate da CONFIG_VARTYPE_UNKNOWN
+ *
+ *  @param writer Buffer
+ *  @param table Dizionario
+ */
+void config_cache_write_dictionary(config_cache_writer_t * writer, hashtable_t * table)
+{
+
+    //  le tabelle dei file di configurazione non hanno livelli sottostanti
+    if (table->parent) {
+        writer->failed = true;
+        return;
+    }
+
+    hashtable_iterate(table, writer, config_cache_write_variable);
+
+    uint8_t end = CONFIG_VARTYPE_UNKNOWN;
+    config_cache_write(writer, &end, sizeof(end));
+
+}
+
+bool config_cache_save(hashtable_t * table, const char * cache_path, int64_t mtime, uint64_t size)
+{
+
+    config_cache_writer_t writer = { NULL, 0, 4096, false };
+    writer.data = memalloc(char, writer.capacity);
+
+    config_cache_header_t header = { CONFIG_CACHE_MAGIC, CONFIG_CACHE_VERSION, mtime, size };
+
+    config_cache_write(&writer, &header, sizeof(header));
+    config_cache_write_dictionary(&writer, table);
+
+    if (writer.failed) {
+        memfree(writer.data);
+        return false;
+    }
+
+    //  la cache è scritta in un file temporaneo e poi rinominata,
+    //  così un'altra istanza non può leggerla a metà; il nome del file temporaneo
+    //  è diverso per ogni processo e ogni tabella (thread che salvano lo stesso file)
+    char * temporary_path = memalloc(char, strlen(cache_path) + 64);
+    sprintf(temporary_path, "%s.%ld.%p.tmp", cache_path, (long)getpid(), (void *)table);
+
+    FILE * file = fopen(temporary_path, "wb");
+
+    bool saved = false;
+
+    if (file) {
+
+        saved = fwrite(writer.data, 1, writer.length, file) == writer.length;
+        saved = (fclose(file) == 0) && saved;
+
+#ifdef _WIN32
+        //  rename non sovrascrive un file esistente
+        if (saved)
+            remove(cache_path);
+#endif
+
+        if (!saved || rename(temporary_path, cache_path) != 0) {
+            remove(temporary_path);
+            saved = false;
+        }
+
+    }
+
+    memfree(temporary_path);
+    memfree(writer.data);
+
+    return saved;
+
+}
+
+/**
+ *  Legge dei bytes dalla cache
+ *
+ *  @param parser Parser con il contenuto della cache
+ *  @param destination Destinazione
+ *  @param length Numero di bytes
+ *
+ *  @return false se la cache termina prima
+ */
+bool config_cache_read(parser_t * parser, void * destination, size_t length)
+{
+
+    if (parser->length - parser->position < length)
+        return false;
+
+    memcpy(destination, (char *)parser->buffer + parser->position, length);
+    parser->position += length;
+
+    return true;
+
+}
+
+/**
+ *  Legge una stringa dalla cache
+ *
+ *  @param parser Parser con il contenuto della cache
+ *
+ *  @return Stringa, da deallocare con memfree
+ *  @retval NULL Se la cache non è valida
+ */
+char * config_cache_read_string(parser_t * parser)
+{
+
+    uint32_t length;
+
+    if (!config_cache_read(parser, &length, sizeof(length)) || parser->length - parser->position < length)
+        return NULL;
+
+    char * string = memalloc(char, (size_t)length + 1);
+
+    config_cache_read(parser, string, length);
+    string[length] = '\0';
+
+    return string;
+
+}
+
+hashtable_t * config_cache_read_dictionary(parser_t * parser);
+
+/**
+ *  Funzioni per la gestione dei valori di un tipo
+ *
+ *  @param type Tipo
+ *
+ *  @return Funzioni
+ */
+struct type_functions config_cache_functions(config_variable_type type)
+{
+
+    if (type == CONFIG_VARTYPE_INT)
+        return long_functions;
+
+    if (type == CONFIG_VARTYPE_FLOAT)
+        return float_functions;
+
+    if (type == CONFIG_VARTYPE_STRING)
+        return string_functions;
+
+    if (type == CONFIG_VARTYPE_SIZE)
+        return dimension_functions;
+
+    if (type == CONFIG_VARTYPE_RECTANGLE)
+        return rectangle_functions;
+
+    if (type == CONFIG_VARTYPE_LIST)
+        return list_functions;
+
+    if (type == CONFIG_VARTYPE_DICTIONARY)
+        return hashtable_functions;
+
+    return no_functions;
+
+}
+
+/**
+ *  Legge un valore di dimensione fissa dalla cache
+ *
+ *  @param parser Parser con il contenuto della cache
+ *  @param size Dimensione del valore
+ *
+ *  @return Valore
+ *  @retval NULL Se la cache termina prima
+ */
+void * config_cache_read_fixed(parser_t * parser, size_t size)
+{
+
+    void * value = memalloc(char, size);
+
+    if (config_cache_read(parser, value, size))
+        return value;
+
+    memfree(value);
+
+    return NULL;
+
+}
+
+/**
+ *  Legge un valore dalla cache
+ *
+ *  @param parser Parser con il contenuto della cache
+ *  @param type Tipo del valore
+ *
+ *  @return Valore
+ *  @retval NULL Se la cache non è valida
+ */
+void * config_cache_read_value(parser_t * parser, config_variable_type type)
+{
+
+    if (type == CONFIG_VARTYPE_INT) {
+
+        int64_t lv;
+
+        if (!config_cache_read(parser, &lv, sizeof(lv)))
+            return NULL;
+
+        long * value = memalloc(long);
+        *value = (long)lv;
+
+        return value;
+
+    } else if (type == CONFIG_VARTYPE_FLOAT) {
+
+        return config_cache_read_fixed(parser, sizeof(float));
+
+    } else if (type == CONFIG_VARTYPE_STRING) {
+
+        return config_cache_read_string(parser);
+
+    } else if (type == CONFIG_VARTYPE_SIZE) {
+
+        return config_cache_read_fixed(parser, sizeof(dimension_t));
+
+    } else if (type == CONFIG_VARTYPE_RECTANGLE) {
+
+        return config_cache_read_fixed(parser, sizeof(rectangle_t));
+
+    } else if (type == CONFIG_VARTYPE_DICTIONARY) {
+
+        return config_cache_read_dictionary(parser);
+
+    } else if (type == CONFIG_VARTYPE_LIST) {
+
+        uint8_t contents_type;
+        uint32_t length;
+
+        if (!config_cache_read(parser, &contents_type, sizeof(contents_type)) ||
+            !config_cache_read(parser, &length, sizeof(length)))
+            return NULL;
+
+        //  per semplicità le liste di liste non sono supportate
+        if (contents_type == CONFIG_VARTYPE_UNKNOWN || contents_type == CONFIG_VARTYPE_LIST || contents_type >= CONFIG_VARTYPE_DICTIONARY)
+            return NULL;
+
+        list_t * list = list_new(config_cache_functions(contents_type));
+
+        uint32_t i;
+        for (i = 0; i < length; i++) {
+
+            void * element = config_cache_read_value(parser, contents_type);
+
+            if (!element) {
+                list_delete(list);
+                return NULL;
+            }
+
+            //  inserimento senza copia e con deallocazione
+            list_insert(list, element, INSERT_MODE_TAIL, false, true);
+
+        }
+
+        return list;
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ *  Legge un dizionario dalla cache
+ *
+ *  @param parser Parser con il contenuto della cache
+ *
+ *  @return Dizionario
+ *  @retval NULL Se la cache non è valida
+ */
+hashtable_t * config_cache_read_dictionary(parser_t * parser)
+{
+
+    hashtable_t * table = config_table_new();
+
+    while (1) {
+
+        uint8_t type;
+
+        if (!config_cache_read(parser, &type, sizeof(type)))
+            break;
+
+        //  fine del dizionario
+        if (type == CONFIG_VARTYPE_UNKNOWN)
+            return table;
+
+        if (type > CONFIG_VARTYPE_DICTIONARY)
+            break;
+
+        char * key = config_cache_read_string(parser);
+
+        if (!key)
+            break;
+
+        void * value = config_cache_read_value(parser, type);
+
+        if (!value) {
+            memfree(key);
+            break;
+        }
+
+        //  inserimento senza copia e con deallocazione
+        hashtable_insert(table, key, value, config_cache_functions(type), false, true);
+
+        memfree(key);
+
+    }
+
+    hashtable_delete(table);
+
+    return NULL;
+
+}
+
+hashtable_t * config_cache_load(const char * cache_path, int64_t mtime, uint64_t size)
+{
+
+    parser_t * parser = mapped_parser_new(cache_path, true, NULL);
+
+    if (!parser)
+        return NULL;
+
+    hashtable_t * table = NULL;
+    config_cache_header_t header;
+
+    //  la cache è valida solo se il sorgente non è cambiato dopo la sua creazione
+    if (config_cache_read(parser, &header, sizeof(header)) &&
+        header.magic == CONFIG_CACHE_MAGIC &&
+        header.version == CONFIG_CACHE_VERSION &&
+        header.mtime == mtime &&
+        header.size == size) {
+
+        table = config_cache_read_dictionary(parser);
+
+        //  dati in eccesso dopo il dizionario principale
+        if (table && parser->position != parser->length) {
+            hashtable_delete(table);
+            table = NULL;
+        }
+
+    }
+
+    mapped_parser_delete(parser);
+
+    return table;
+
+}
@@ -0,0 +1,53 @@
+#ifndef config_config_cache_h
+#define config_config_cache_h
+
+#include <stdint.h>
+
+#include "std/hashtable.h"
+
+/**
+ *  Cache binaria dei file di configurazione.
+ *
+ *  Il contenuto di un file .cfg già analizzato è salvato accanto al file
+ *  (config.cfg -> config.cfgc) insieme a data di modifica e dimensione del sorgente.
+ *  Ai successivi avvii, se il sorgente non è cambiato, le tabelle sono ricostruite
+ *  dalla cache con una sola lettura, senza ripetere il parsing.
+ */
+
+/** Suffisso aggiunto al percorso del sorgente per ottenere quello della cache */
+#define CONFIG_CACHE_SUFFIX "c"
+
+/**
+ *  Percorso della cache di un file di configurazione
+ *
+ *  @param source_path Percorso del file di configurazione
+ *
+ *  @return Percorso della cache, da deallocare con memfree
+ */
+char * config_cache_path(const char * source_path);
+
+/**
+ *  Carica le variabili di un file di configurazione dalla sua cache
+ *
+ *  @param cache_path Percorso della cache
+ *  @param mtime Data di modifica del sorgente
+ *  @param size Dimensione del sorgente
+ *
+ *  @return Hashtable contenente le variabili
+ *  @retval NULL Se la cache non esiste, non è valida o non corrisponde al sorgente
+ */
+hashtable_t * config_cache_load(const char * cache_path, int64_t mtime, uint64_t size);
+
+/**
+ *  Salva le variabili di un file di configurazione nella sua cache
+ *
+ *  @param table Hashtable restituita dal parsing del file
+ *  @param cache_path Percorso della cache
+ *  @param mtime Data di modifica del sorgente
+ *  @param size Dimensione del sorgente
+ *
+ *  @return Esito del salvataggio
+ */
+bool config_cache_save(hashtable_t * table, const char * cache_path, int64_t mtime, uint64_t size);
+
+#endif  // config_config_cache_h
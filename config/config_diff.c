@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "config/config_diff.h"
+
+#include "misc/geometry.h"
+
+/**
+ *  Stato del confronto di due dizionari
+ */
+typedef struct {
+
+    /** Dizionario con il quale confrontare quello visitato (NULL se assente) */
+    hashtable_t * other;
+
+    /** Se true si visita la versione precedente alla ricerca delle variabili rimosse */
+    bool removed;
+
+    /** Nomi dei dizionari che contengono quello visitato */
+    const char ** path;
+
+    /** Numero di dizionari in path */
+    size_t depth;
+
+    /** Dati dell'utente */
+    void * data;
+
+    /** Funzione chiamata per ogni variabile modificata */
+    config_diff_function function;
+
+    /** Numero di variabili modificate */
+    size_t count;
+
+} config_diff_state_t;
+
+static void config_diff_visit(hashtable_t * table, void * data, void * key, void * value, struct type_functions value_type);
+
+/**
+ *  Confronta due valori scalari dello stesso tipo
+ *
+ *  @param type Tipo dei valori
+ *  @param a Primo valore
+ *  @param b Secondo valore
+ *
+ *  @return true se i valori coincidono
+ */
+static bool config_diff_scalar_equal(config_variable_type type, void * a, void * b)
+{
+
+    switch (type) {
+
+    case CONFIG_VARTYPE_INT:
+        return *(long *)a == *(long *)b;
+
+    case CONFIG_VARTYPE_FLOAT:
+        return *(float *)a == *(float *)b;
+
+    case CONFIG_VARTYPE_STRING:
+        return !strcmp(a, b);
+
+    case CONFIG_VARTYPE_SIZE:
+        return !memcmp(a, b, sizeof(dimension_t));
+
+    case CONFIG_VARTYPE_RECTANGLE:
+        return !memcmp(a, b, sizeof(rectangle_t));
+
+    default:
+        return false;
+
+    }
+
+}
+
+/**
+ *  Confronta due liste, elemento per elemento
+ *
+ *  @param a Prima lista
+ *  @param b Seconda lista
+ *
+ *  @return true se le liste contengono gli stessi valori nello stesso ordine
+ */
+static bool config_diff_list_equal(list_t * a, list_t * b)
+{
+
+    config_variable_type type = config_value_type(a->element_type);
+
+    if (a->length != b->length || type != config_value_type(b->element_type))
+        return false;
+
+    list_node_t * node_a = a->head;
+    list_node_t * node_b = b->head;
+
+    while (node_a && node_b) {
+
+        if (!config_diff_scalar_equal(type, node_a->value, node_b->value))
+            return false;
+
+        node_a = node_a->next;
+        node_b = node_b->next;
+
+    }
+
+    return true;
+
+}
+
+/**
+ *  Confronta ricorsivamente un dizionario con la sua controparte
+ *
+ *  @param state Stato del dizionario che lo contiene
+ *  @param name Nome del dizionario
+ *  @param table Dizionario da visitare
+ *  @param other Controparte (NULL se assente)
+ */
+static void config_diff_dictionary(config_diff_state_t * state, const char * name, hashtable_t * table, hashtable_t * other)
+{
+
+    if (state->depth >= CONFIG_DIFF_DEPTH_MAX)
+        return;
+
+    state->path[state->depth] = name;
+
+    config_diff_state_t nested = *state;
+
+    nested.other = other;
+    nested.depth = state->depth + 1;
+    nested.count = 0;
+
+    hashtable_iterate(table, &nested, config_diff_visit);
+
+    state->count += nested.count;
+
+}
+
+/**
+ *  Confronta una variabile con quella omonima della controparte (callback di hashtable_iterate)
+ *
+ *  @param table Dizionario visitato
+ *  @param data Stato del confronto
+ *  @param key Nome della variabile
+ *  @param value Valore
+ *  @param value_type Funzioni del valore
+ */
+static void config_diff_visit(hashtable_t * table, void * data, void * key, void * value, struct type_functions value_type)
+{
+
+    unused(table);
+
+    config_diff_state_t * state = data;
+
+    config_variable_type type = config_value_type(value_type);
+
+    //  valore omonimo nella controparte e relativo tipo
+    hashtable_node_t * node = state->other ? hashtable_search_node_element(state->other, key) : NULL;
+
+    void * other = node ? node->value : NULL;
+    config_variable_type other_type = node ? config_value_type(node->value_type) : CONFIG_VARTYPE_UNKNOWN;
+
+    //  i dizionari sono confrontati ricorsivamente
+    if (type == CONFIG_VARTYPE_DICTIONARY) {
+
+        hashtable_t * counterpart = (other_type == CONFIG_VARTYPE_DICTIONARY) ? other : NULL;
+
+        //  se il tipo è cambiato la variabile è riportata nella visita della versione attuale
+        if (state->removed && node && !counterpart)
+            return;
+
+        config_diff_dictionary(state, key, value, counterpart);
+        return;
+
+    }
+
+    //  variabili presenti in entrambe le versioni: sono riportate solo nella visita della versione attuale
+    if (state->removed && node)
+        return;
+
+    if (other && other_type == type) {
+
+        bool equal = (type == CONFIG_VARTYPE_LIST) ? config_diff_list_equal(value, other) : config_diff_scalar_equal(type, value, other);
+
+        if (equal)
+            return;
+
+    }
+
+    state->function(state->data, state->path, state->depth, key, state->removed ? NULL : value, value_type);
+    state->count++;
+
+}
+
+size_t config_diff(hashtable_t * previous, hashtable_t * current, void * data, config_diff_function function)
+{
+
+    if (!previous || !current || !function)
+        return 0;
+
+    const char * path[CONFIG_DIFF_DEPTH_MAX];
+
+    //  1. variabili aggiunte o modificate
+    config_diff_state_t state = { previous, false, path, 0, data, function, 0 };
+    hashtable_iterate(current, &state, config_diff_visit);
+
+    //  2. variabili rimosse
+    config_diff_state_t removed = { current, true, path, 0, data, function, 0 };
+    hashtable_iterate(previous, &removed, config_diff_visit);
+
+    return state.count + removed.count;
+
+}
@@ -0,0 +1,37 @@
+#ifndef config_config_diff_h
+#define config_config_diff_h
+
+#include <stddef.h>
+
+#include "config/config.h"
+
+/** Profondità massima dei dizionari confrontati */
+#define CONFIG_DIFF_DEPTH_MAX 8
+
+/**
+ *  Funzione chiamata per ogni variabile modificata
+ *
+ *  @param data Dati dell'utente
+ *  @param path Nomi dei dizionari che contengono la variabile, dal più esterno
+ *  @param depth Numero di dizionari in path (0 per le variabili del file)
+ *  @param key Nome della variabile
+ *  @param value Nuovo valore (NULL se la variabile è stata rimossa)
+ *  @param value_type Funzioni del nuovo valore (di quello precedente se rimossa)
+ */
+typedef void (* config_diff_function)(void * data, const char ** path, size_t depth, const char * key, void * value, struct type_functions value_type);
+
+/**
+ *  Confronta due versioni di un file di configurazione e riporta le variabili
+ *  aggiunte, modificate o rimosse. I dizionari sono confrontati ricorsivamente e
+ *  sono riportate solo le variabili, non i dizionari che le contengono.
+ *
+ *  @param previous Versione precedente
+ *  @param current Versione attuale
+ *  @param data Dati passati a function
+ *  @param function Funzione chiamata per ogni variabile modificata
+ *
+ *  @return Numero di variabili modificate
+ */
+size_t config_diff(hashtable_t * previous, hashtable_t * current, void * data, config_diff_function function);
+
+#endif  // config_config_diff_h
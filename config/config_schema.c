@@ -0,0 +1,115 @@
+#include <stdio.h>
+
+#include "config/config_schema.h"
+
+#include "misc/geometry.h"
+
+/**
+ *  Dimensione, in bytes, del campo di destinazione di una variabile
+ *
+ *  @param type Tipo della variabile
+ *
+ *  @return Dimensione del campo
+ */
+static size_t config_schema_field_size(config_variable_type type)
+{
+
+    switch (type) {
+
+    case CONFIG_VARTYPE_INT:
+        return sizeof(long);
+
+    case CONFIG_VARTYPE_FLOAT:
+        return sizeof(float);
+
+    case CONFIG_VARTYPE_SIZE:
+        return sizeof(dimension_t);
+
+    case CONFIG_VARTYPE_RECTANGLE:
+        return sizeof(rectangle_t);
+
+    default:
+        return sizeof(void *);
+
+    }
+
+}
+
+/**
+ *  Controlla se una variabile è memorizzata per riferimento (stringhe, liste, dizionari)
+ *
+ *  @param type Tipo della variabile
+ */
+sinline bool config_schema_is_reference(config_variable_type type)
+{
+    return type == CONFIG_VARTYPE_STRING || type == CONFIG_VARTYPE_LIST || type == CONFIG_VARTYPE_DICTIONARY;
+}
+
+/**
+ *  Scrive un valore nel campo di destinazione
+ *
+ *  @param field Campo dello schema
+ *  @param destination Struttura di destinazione
+ *  @param value Valore (per riferimento o puntatore al valore)
+ */
+static void config_schema_store(const config_schema_field_t * field, unsigned char * destination, const void * value)
+{
+
+    void * target = destination + field->offset;
+
+    if (config_schema_is_reference(field->type))
+        memcpy(target, &value, sizeof(void *));
+    else if (value)
+        memcpy(target, value, config_schema_field_size(field->type));
+    else
+        memset(target, 0, config_schema_field_size(field->type));
+
+}
+
+bool config_schema_decode_fields(hashtable_t * table, const config_schema_field_t * schema, size_t count, void * destination, const char * name)
+{
+
+    if (!table || !destination)
+        return false;
+
+    if (!name)
+        name = "?";
+
+    int errors = 0;
+
+    //  una ricerca per campo, nei livelli del dizionario dal più alto:
+    //  il costo dipende dal numero di campi, non dalle variabili del dizionario
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        const config_schema_field_t * field = &schema[i];
+
+        hashtable_node_t * node = hashtable_search_node_element(table, (void *)field->key);
+
+        //  variabile assente: valore di default
+        if (!node) {
+
+            if (field->required) {
+                errorf("[Config] %s: variabile '%s' mancante\n", name, field->key);
+                errors++;
+            }
+
+            config_schema_store(field, destination, field->fallback);
+            continue;
+
+        }
+
+        if (config_value_type(node->value_type) != field->type) {
+            errorf("[Config] %s: tipo errato per la variabile '%s'\n", name, field->key);
+            config_schema_store(field, destination, field->fallback);
+            errors++;
+            continue;
+        }
+
+        config_schema_store(field, destination, node->value);
+
+    }
+
+    return errors == 0;
+
+}
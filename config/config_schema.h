@@ -0,0 +1,93 @@
+#ifndef config_config_schema_h
+#define config_config_schema_h
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "config/config.h"
+
+/**
+ *  Schema dei dizionari di configurazione.
+ *
+ *  Uno schema è una tabella statica di campi (nome, tipo, offset, default) con la quale
+ *  un dizionario viene decodificato in una struttura C con una ricerca per campo,
+ *  invece di una sequenza di hashtable_search con controlli e conversioni sparsi nel codice.
+ *
+ *  I campi della struttura di destinazione hanno il tipo corrispondente a quello della variabile:
+ *  - CONFIG_VARTYPE_INT: long
+ *  - CONFIG_VARTYPE_FLOAT: float
+ *  - CONFIG_VARTYPE_SIZE: dimension_t
+ *  - CONFIG_VARTYPE_RECTANGLE: rectangle_t
+ *  - CONFIG_VARTYPE_STRING: char *
+ *  - CONFIG_VARTYPE_LIST: list_t *
+ *  - CONFIG_VARTYPE_DICTIONARY: hashtable_t *
+ *
+ *  Stringhe, liste e dizionari non sono copiati: restano validi finché lo è il dizionario.
+ */
+
+/**
+ *  Campo di uno schema
+ */
+typedef struct {
+
+    /** Nome della variabile */
+    const char * key;
+
+    /** Tipo della variabile */
+    config_variable_type type;
+
+    /** Posizione del campo nella struttura di destinazione */
+    size_t offset;
+
+    /** Se true la variabile deve essere presente */
+    bool required;
+
+    /**
+     *  Valore di default se la variabile è assente:
+     *  puntatore ad un valore del tipo del campo, oppure il valore stesso per
+     *  stringhe, liste e dizionari. NULL equivale a zero.
+     */
+    const void * fallback;
+
+} config_schema_field_t;
+
+/**
+ *  Definisce un campo di uno schema
+ *
+ *  @param structure Tipo della struttura di destinazione
+ *  @param member Campo della struttura
+ *  @param key Nome della variabile
+ *  @param type Tipo della variabile
+ *  @param required Se la variabile deve essere presente
+ *  @param fallback Valore di default
+ */
+#define ConfigSchemaField(structure, member, key, type, required, fallback) \
+    { key, type, offsetof(structure, member), required, fallback }
+
+/**
+ *  Decodifica un dizionario in una struttura secondo uno schema.
+ *  Le variabili non presenti nello schema sono ignorate; gli errori (variabili
+ *  obbligatorie mancanti, tipi errati) sono riportati tutti insieme.
+ *
+ *  @param table Dizionario
+ *  @param schema Campi dello schema
+ *  @param count Numero di campi
+ *  @param destination Struttura di destinazione
+ *  @param name Nome del dizionario, usato nei messaggi di errore
+ *
+ *  @return true se il dizionario è conforme allo schema
+ */
+bool config_schema_decode_fields(hashtable_t * table, const config_schema_field_t * schema, size_t count, void * destination, const char * name);
+
+/**
+ *  Decodifica un dizionario secondo uno schema definito come array statico
+ *
+ *  @param table Dizionario
+ *  @param schema Array dei campi dello schema
+ *  @param destination Struttura di destinazione
+ *  @param name Nome del dizionario, usato nei messaggi di errore
+ */
+#define config_schema_decode(table, schema, destination, name) \
+    config_schema_decode_fields(table, schema, array_count(schema), destination, name)
+
+#endif  // config_config_schema_h
@@ -5,6 +5,7 @@
 #include "game/character.h"
 #include "game/map.h"
 
+#include "std/bag.h"
 #include "std/queue.h"
 
 #include "pathfinding/pathfinding.h"
@@ -204,19 +205,19 @@ point_t ai_find_nearest_path_location(game_t * game, character_t * character, po
     map_cell_t * cell = map_get_cell(character->map, source);
 
     //  se la cella da raggiungere non è un corridoio
-    if (!cell_is_path(cell)) {
+    if (!cell_is_path(character->map, cell)) {
 
         //  si cerca un corridoio nei dintorni della cella
-        list_t * Q = list_new(no_functions);
-        list_insert(Q, cell);
+        bag_t * Q = bag_new(no_functions);
+        bag_insert(Q, cell);
 
         //  finchè ci sono nodi
-        while (!list_empty(Q)) {
+        while (!bag_empty(Q)) {
 
-            //  estrazione di un elemento casuale dalla lista
-            cell = list_pop_random(Q);
+            //  estrazione di un elemento casuale
+            cell = bag_pop_random(Q);
 
-            if (cell_is_path(cell))
+            if (cell_is_path(character->map, cell))
                 break;
             
             //  se la cella non è calpestabile
@@ -236,15 +237,15 @@ point_t ai_find_nearest_path_location(game_t * game, character_t * character, po
 
                     map_cell_t * neighbor = map_get_cell(character->map, point);
 
-                    if (cell_is_path(neighbor))
-                        list_insert(Q, neighbor);
+                    if (cell_is_path(character->map, neighbor))
+                        bag_insert(Q, neighbor);
 
                 }
             }
 
         }
 
-        list_delete(Q);
+        bag_delete(Q);
 
         //  cella trovata
         if (cell)
@@ -3,6 +3,7 @@
 
 #include "main/color.h"
 
+#include "misc/fixed.h"
 #include "misc/geometry.h"
 #include "misc/range.h"
 
@@ -22,6 +23,37 @@ enum {
 
 };
 
+/**
+ *  Direzioni delle adiacenze di una cella, nell'ordine in cui sono visitate
+ */
+enum {
+
+    CELL_DIRECTION_NORTH,
+    CELL_DIRECTION_SOUTH,
+    CELL_DIRECTION_EAST,
+    CELL_DIRECTION_WEST,
+
+    CELL_DIRECTION_LAST
+
+};
+
+/**
+ *  Maschera delle adiacenze di una cella: un bit per direzione più
+ *  CELL_ADJACENCY_WRAP se almeno un'adiacenza attraversa il bordo della mappa
+ */
+enum {
+
+    CELL_ADJACENCY_NORTH    = 1 << CELL_DIRECTION_NORTH,
+    CELL_ADJACENCY_SOUTH    = 1 << CELL_DIRECTION_SOUTH,
+    CELL_ADJACENCY_EAST     = 1 << CELL_DIRECTION_EAST,
+    CELL_ADJACENCY_WEST     = 1 << CELL_DIRECTION_WEST,
+
+    CELL_ADJACENCY_DIRECTIONS = 0x0F,
+
+    CELL_ADJACENCY_WRAP     = 1 << CELL_DIRECTION_LAST
+
+};
+
 /**
  *  Definisce il colore assegnato alla cella quando si esplora il grafo 
  *  sottostante la mappa
@@ -36,34 +68,18 @@ enum {
 };
 
 /**
- *  Contiene le informazioni su una cella della mappa
+ *  Contiene le informazioni su una cella della mappa.
+ *  Tipo, peso e adiacenze, letti ad ogni visita e ad ogni disegno, sono memorizzati a parte
+ *  dalla mappa (map_t.types, map_t.values, map_t.adjacency) per poter essere scanditi in modo compatto
  */
 struct map_cell_s {
 
-    /**
-     *  Tipo di cella:
-     *  - CELL_TYPE_UNKNOWN
-     *  - CELL_TYPE_PATH
-     *  - CELL_TYPE_WALL
-     */
-    unsigned int type;
-
     /** Coordinate della cella nella mappa di appartenenza */
     point_t location;
 
     /** Bonus associato alla cella */
     powerup_location_t powerup;
 
-    /** Adiacenze della cella, celle a N/S/E/O */
-    struct {
-
-        struct map_cell_s * north;
-        struct map_cell_s * east;
-        struct map_cell_s * west;
-        struct map_cell_s * south;
-
-    } adjacency;
-
     /** Informazioni sulla cella vista come nodo del grafo */
     struct {
 
@@ -76,9 +92,6 @@ struct map_cell_s {
         /** Distanza dalla sorgente della visita */
         int distance;
 
-        /** Peso degli archi entranti */
-        int value;
-
     } node;
 
 };
@@ -101,12 +114,13 @@ struct map_cell_s {
 /**
  *  Verifica che una cella sia di tipo corridoio
  *
+ *  @param map Mappa che contiene la cella
  *  @param cell Cella da controllare
  *
  *  @retval true La cella è un corridoio
  *  @retval false La cella è di un tipo diverso da CELL_TYPE_PATH
  */
-#define cell_is_path(cell)     (cell->type == CELL_TYPE_PATH)
+#define cell_is_path(map, cell)     (map_cell_get_type(map, cell) == CELL_TYPE_PATH)
 
 /**
  *  Fornisce l'accesso al colore di una cella
@@ -160,74 +174,69 @@ int cell_get_distance(map_cell_t * cell);
 void cell_set_distance(map_cell_t * cell, int distance);
 
 /**
- *  Fornisce l'accesso al peso degli archi entranti in una cella
+ *  Rende una cella del tipo: corridoio
  *
+ *  @param map Mappa che contiene la cella
  *  @param cell Cella
- *
- *  @return Valore
  */
-int cell_get_value(map_cell_t * cell);
+#define cell_set_is_path(map, cell)  map_cell_set_type(map, cell, CELL_TYPE_PATH)
 
 /**
- *  Costruisce la lista di adiacenza di una cella
+ *  Rende una cella del tipo: mura
  *
+ *  @param map Mappa che contiene la cella
  *  @param cell Cella
- *  @param adjacency Destinazione della lista di adiacenza
- *
- *  @return Lunghezza della lista
  */
-unsigned int cell_get_adjacency(map_cell_t * cell, map_cell_t * adjacency[4]);
+#define cell_set_is_wall(map, cell)  map_cell_set_type(map, cell, CELL_TYPE_WALL)
 
 /**
- *  Imposta il valore di una cella
+ *  Converte le coordinate di una cella in coordinate assolute (in pixel)
  *
- *  @param cell Cella
- *  @param value Valore [1-9]
- */
-void cell_set_value(map_cell_t * cell, int value);
-
-/**
- *  Imposta il tipo di una cella
+ *  @param point Coordinate della cella
  *
- *  @param cell Cella
- *  @param type Tipo
+ *  @return Coordinate assolute
  */
-void cell_set_type(map_cell_t * cell, int type);
+point_t cell_location_to_position(point_t location);
 
 /**
- *  Rende una cella del tipo: corridoio
+ *  Converte le coordinate assolute (in pixel) di una cella in coordinate (in celle)
  *
- *  @param cell Cella
+ *  @param point Coordinate della cella
+ *
+ *  @return Coordinate in celle
  */
-#define cell_set_is_path(cell)  cell_set_type(cell, CELL_TYPE_PATH)
+point_t cell_position_to_location(point_t position);
 
 /**
- *  Rende una cella del tipo: mura
+ *  Converte le coordinate di una cella in coordinate a virgola fissa (in celle)
  *
- *  @param cell Cella
+ *  @param location Coordinate della cella
+ *
+ *  @return Coordinate a virgola fissa
  */
-#define cell_set_is_wall(cell)  cell_set_type(cell, CELL_TYPE_WALL)
+fixed_point_t cell_location_to_fixed(point_t location);
 
 /**
- *  Converte le coordinate di una cella in coordinate assolute (in pixel)
+ *  Cella che contiene un punto a virgola fissa
  *
- *  @param point Coordinate della cella
+ *  @param point Coordinate a virgola fissa
  *
- *  @return Coordinate assolute
+ *  @return Coordinate della cella
  */
-point_t cell_location_to_position(point_t location);
+point_t cell_fixed_to_location(fixed_point_t point);
 
 /**
- *  Converte le coordinate assolute (in pixel) di una cella in coordinate (in celle)
+ *  Converte coordinate a virgola fissa in coordinate assolute (in pixel)
  *
- *  @param point Coordinate della cella
+ *  @param point Coordinate a virgola fissa
  *
- *  @return Coordinate in celle
+ *  @return Coordinate assolute (PointNull se point è nullo)
  */
-point_t cell_position_to_location(point_t position);
+point_t cell_fixed_to_position(fixed_point_t point);
 
 /**
  *  Inizializza le proprietà di default di una cella di una mappa
+ *  (tipo, peso e adiacenze sono inizializzati dalla mappa)
  *
  *  @param cell Cella
  *  @param location Posizione della cella sulla mappa
@@ -6,6 +6,8 @@
 #include "game/map.h"
 #include "game/powerup.h"
 
+#include "config/config_schema.h"
+
 #include "main/audio.h"
 #include "main/drawing.h"
 #include "main/graphics.h"
@@ -16,6 +18,17 @@
 
 #include "misc/random.h"
 
+/** Chiavi con hash precalcolato per le proprietà lette ad ogni aggiornamento */
+static hashtable_key_t character_alpha_key                 = HashtableKey("alpha");
+static hashtable_key_t character_ignores_collisions_key    = HashtableKey("ignores_collisions");
+static hashtable_key_t character_speed_key                 = HashtableKey("speed");
+static hashtable_key_t character_breaks_walls_key          = HashtableKey("breaks_walls");
+static hashtable_key_t character_path_finding_method_key   = HashtableKey("path_finding_method");
+static hashtable_key_t character_exit_search_rect_size_key = HashtableKey("exit_search_rect_size");
+static hashtable_key_t character_chase_rect_size_key       = HashtableKey("chase_rect_size");
+static hashtable_key_t character_chase_user_key            = HashtableKey("chase_user");
+static hashtable_key_t character_chasing_method_key        = HashtableKey("chasing_method");
+
 void character_clear_path(character_t * character)
 {
 
@@ -39,9 +52,12 @@ void character_set_location(character_t * character, point_t point, bool clear_d
     character_clear_path(character);
 
     //  cambiamento di posizione
-    character->position = cell_location_to_position(point);
+    character_set_position(character, cell_location_to_fixed(point));
     character->location = point;
-    character->last_position = character->position;
+    character->last_position = character->fixed_position;
+
+    //  aggiornamento della griglia dei personaggi
+    map_characters_update(character);
 
     //  azzeramento della direzione
     if (clear_direction)
@@ -49,6 +65,14 @@ void character_set_location(character_t * character, point_t point, bool clear_d
 
 }
 
+void character_set_position(character_t * character, fixed_point_t position)
+{
+
+    character->fixed_position = position;
+    character->position = cell_fixed_to_position(position);
+
+}
+
 void character_set_random_position(character_t * character)
 {
 
@@ -56,7 +80,11 @@ void character_set_random_position(character_t * character)
 
     do {
         cell = map_random_cell_path(character->map);
-    } while (PointEqualToPoint(character->map->end, cell->location));  //  se non coincidone con qualche punto particolare (es. fine mappa)
+    } while (cell && PointEqualToPoint(character->map->end, cell->location));  //  se non coincidone con qualche punto particolare (es. fine mappa)
+
+    //  mappa senza corridoi
+    if (!cell)
+        return;
 
     character_set_location(character, cell->location, true);
 
@@ -70,7 +98,7 @@ void character_set_random_position(character_t * character)
 float character_get_alpha(character_t * character)
 {
     
-    float * alpha = hashtable_search(character->config, "alpha");
+    float * alpha = hashtable_search_key(character->config, &character_alpha_key);
     
     return *alpha ? *alpha : 0.;
     
@@ -79,10 +107,18 @@ float character_get_alpha(character_t * character)
 void character_set_alpha(character_t * character, float value)
 {
 
-    float * alpha = hashtable_search(character->config, "alpha");
+    hashtable_node_t * node = hashtable_search_node_key(character->config, &character_alpha_key);
+
+    //  valore già copiato nel livello più alto: è solo del personaggio e si modifica direttamente
+    //  (accade ad ogni aggiornamento della trasparenza, senza allocazioni né calcolo dell'hash)
+    if (node && node->table == character->config && node->free) {
+        *(float *)node->value = value;
+        return;
+    }
 
-    if (alpha)
-        *alpha = value;
+    //  il valore potrebbe essere condiviso con altri personaggi (o appartenere ad un bonus),
+    //  per cui si sostituisce (nel livello più alto) invece di modificarlo
+    hashtable_replace(character->config, character_alpha_key.key, &value, true);
 
 }
 
@@ -116,7 +152,7 @@ sinline void character_set_next_direction(character_t * character)
     character->direction      = character->next_direction;
     character->next_direction = DIRECTION_NONE;
 
-    character->last_position  = PointNull;
+    character->last_position  = FixedPointNull;
 }
 
 /**
@@ -233,18 +269,18 @@ void character_map_torus(character_t * character)
 
     map_t * map = character->map;
 
-    point_t location = cell_position_to_location(character->position);
+    point_t location = cell_fixed_to_location(character->fixed_position);
 
     if (!map_cell_is_path(character->map, location))
         return;
 
-    point_t candidate_position = character->position;
+    fixed_point_t candidate_position = character->fixed_position;
 
     //  la mappa è di tipo toroidale, quindi se si esce da un lato bisogna rientrare dal lato opposto
     if (!PointEqualToPoint(map->start, location) && !PointEqualToPoint(map->end, location)) {
 
-        int width = (int)((map->size.width - 1) * CellSize.width);
-        int height = (int)((map->size.height - 1) * CellSize.height);
+        fixed_t width = FixedFromInt(map->size.width - 1);
+        fixed_t height = FixedFromInt(map->size.height - 1);
 
         bool changed = false;
 
@@ -276,7 +312,7 @@ void character_map_torus(character_t * character)
         }
 
         //  la posizione è cambiata
-        point_t candidate_location = cell_position_to_location(candidate_position);
+        point_t candidate_location = cell_fixed_to_location(candidate_position);
 
         if (changed && (!map_cell_is_valid(map, candidate_location) || map_cell_is_path(map, candidate_location))) {
 
@@ -314,29 +350,30 @@ void character_collision_check(game_t * game, character_t * character_a)
 {
 
     //  il personaggio a ignora le collisioni?
-    bool ignores_collisions_a = bool_value_nocheck(hashtable_search(character_a->config, "ignores_collisions"));
+    bool ignores_collisions_a = bool_value_nocheck(hashtable_search_key(character_a->config, &character_ignores_collisions_key));
 
     //  riquadro nel quale è contenuto il personaggio a
     rectangle_t rect_a = RectMake(character_a->position.x, character_a->position.y, CellSize.width, CellSize.height);
 
-    //  livello corrente
-    level_t * level = game_get_current_level(game);
-    
-    foreach(level->enemies, character_t *, character_b) {
+    //  solo gli avversari nei riquadri della griglia vicini ad a possono entrare in collisione con a
+    size_t count;
+    character_t ** candidates = map_characters_query(character_a->map, rect_a, &count);
 
-        if (!character_b)
-            continue;
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        character_t * character_b = candidates[i];
 
         //  i personaggi devono trovarsi nella stessa mappa
         if (character_a->map != character_b->map)
             continue;
 
-        //  e devono essere diversi
-        if (character_a == character_b)
+        //  e devono essere diversi (le collisioni sono controllate solo con gli avversari)
+        if (character_a == character_b || character_b->is_user)
             continue;
 
         //  b ignora le collisioni? (per effetto di un bonus)
-        bool ignores_collisions_b = bool_value_nocheck(hashtable_search(character_b->config, "ignores_collisions"));
+        bool ignores_collisions_b = bool_value_nocheck(hashtable_search_key(character_b->config, &character_ignores_collisions_key));
 
         //  entrambi ignorano le collisioni, passiamo al prossimo
         if (ignores_collisions_a == ignores_collisions_b && ignores_collisions_a)
@@ -388,19 +425,11 @@ void character_collision_check(game_t * game, character_t * character_a)
 
 }
 
-/**
- *  Calcolo della velocità dei un personaggio in base alla cella in cui si trova
- *  se cell_value = 5 (default) -> velocità = character->speed
- *  se cell_value < 5           -> velocità = character->speed + (5 - cell_value) * 1.5
- *  se cell_value > 5           -> velocità = character->speed / ((cell_value - 5) * 1.5)
- *
- *  @param character Personaggio
- */
 float character_get_speed(character_t * character)
 {
     
-    float base_speed = hashtable_search(character->config, "speed", float);
-    int cell_value = cell_get_value(map_get_cell(character->map, character->location));
+    float base_speed = hashtable_search_key(character->config, &character_speed_key, float);
+    int cell_value = map_cell_get_value(character->map, map_get_cell(character->map, character->location));
     
     if (cell_value == CellDefaultValue)
         return base_speed;
@@ -412,14 +441,7 @@ float character_get_speed(character_t * character)
     
 }
 
-/**
- *  Sposta un personaggio nella prossima posizione a seconda della sua direzione
- *
- *  @param game Contesto di gioco
- *  @param character Personaggio da spostare
- *  @param last_position Ultima posizione del personaggio
- */
-void character_move(game_t * game, character_t * character, point_t last_position)
+void character_move(game_t * game, character_t * character, fixed_point_t last_position)
 {
 
     map_t * map = character->map;
@@ -430,8 +452,9 @@ void character_move(game_t * game, character_t * character, point_t last_positio
     //  controllo delle collisioni tra personaggi
     character_collision_check(game, character);
 
-    //  aggiornamento cella
-    character->location = cell_position_to_location(character->position);
+    //  aggiornamento cella (e del riquadro nella griglia dei personaggi)
+    character->location = cell_fixed_to_location(character->fixed_position);
+    map_characters_update(character);
 
     //  cella nella quale si trova il personaggio
     map_cell_t * cell = map_get_cell(map, character->location);
@@ -442,7 +465,7 @@ void character_move(game_t * game, character_t * character, point_t last_positio
         //  prova a raccogliere il bonus, se presente
         if (powerup_get(game, character, cell->powerup.powerup)) {
 
-            cell->powerup.powerup = NULL;
+            map_cell_set_powerup(map, cell, NULL);
 
         }
 
@@ -452,19 +475,15 @@ void character_move(game_t * game, character_t * character, point_t last_positio
     animation_t * animation = character_animation(character);
 
     if (animation) {
-        if (Manhattan(last_position, character->position) > 0.)
+        if (!FixedPointEqualToPoint(last_position, character->fixed_position))
             animation_start(game, animation);
         else
             animation_stop(animation);
     }
 
     //  è il punto di fine della mappa?
-    //  vale a dire il rettangolo che contiene il personaggio
-    //  è contenuto completamente nel rettangolo della cella di fine mappa?
-    rectangle_t r1 = RectMake(character->position.x, character->position.y, CellSize.width, CellSize.height);
-    rectangle_t r2 = RectMake(map->end.x * CellSize.width, map->end.y * CellSize.height, CellSize.width, CellSize.height);
-
-    if (RectEqualToRect(r1, r2)) {
+    //  vale a dire il personaggio occupa esattamente la cella di fine mappa?
+    if (FixedPointEqualToPoint(character->fixed_position, cell_location_to_fixed(map->end))) {
         //  ferma l'animazione
         if (animation)
             animation_stop(animation);
@@ -480,22 +499,17 @@ void character_move(game_t * game, character_t * character, point_t last_positio
  *  @param character Personaggio
  *  @param dest Destinazione
  */
-void character_move_to_cell(character_t * character, point_t dest) {
-    
-    #define lerp(a, b, t)      (a + ((b - a) * t))
+void character_move_to_cell(character_t * character, fixed_point_t dest) {
 
     //  punto di partenza
-    point_t src = character->last_position;
+    fixed_point_t src = character->last_position;
 
     //  % di avanzamento nel percorso tra i due punti
-    character->ratio += character_get_speed(character) * TIMER_FREQUENCY;
-    character->ratio = RangeNormalizedValue(RangeMake(0., 1.), character->ratio);
+    fixed_t ratio = character->ratio + FixedFromFloat(character_get_speed(character) * TIMER_FREQUENCY);
+    character->ratio = ratio < 0 ? 0 : (ratio > FIXED_ONE ? FIXED_ONE : ratio);
     
     //  posizione attuale
-    character->position.x = lerp(src.x, dest.x, character->ratio);
-    character->position.y = lerp(src.y, dest.y, character->ratio);
-    
-    #undef lerp
+    character_set_position(character, FixedPointMake(FixedLerp(src.x, dest.x, character->ratio), FixedLerp(src.y, dest.y, character->ratio)));
     
 }
 
@@ -522,7 +536,7 @@ void character_turn(character_t * character)
     //  se il personaggio si sposta in una direzione verso la quale "aumenta" il valore di una qualche coordinata
     //  si deve considerare la cella verso la quale si muove
     if (character->direction == DIRECTION_EAST || character->direction == DIRECTION_SOUTH)  {
-        new_point = cell_position_to_location(character->position);
+        new_point = cell_fixed_to_location(character->fixed_position);
     }
 
     //  cella sulla quale è diretto il personaggio
@@ -546,10 +560,10 @@ void character_turn(character_t * character)
 
     bool horizontal = (character->direction == DIRECTION_WEST || character->direction == DIRECTION_EAST);
 
-    if (( horizontal && character->location.x != floorf(character->position.x / CellSize.width)) ||
-        (!horizontal && character->location.y != floorf(character->position.y / CellSize.height))) {
+    if (( horizontal && character->location.x != FixedFloor(character->fixed_position.x)) ||
+        (!horizontal && character->location.y != FixedFloor(character->fixed_position.y))) {
 
-        bool breaks_walls  = bool_value_nocheck(hashtable_search(character->config, "breaks_walls"));
+        bool breaks_walls  = bool_value_nocheck(hashtable_search_key(character->config, &character_breaks_walls_key));
 
         //  la cella sulla quale il personaggio deve spostarsi è un percorso?
         //  o il personaggio è in grado di abbattere il muro?
@@ -557,32 +571,29 @@ void character_turn(character_t * character)
 
             character_set_next_direction(character);
 
-            character->position = cell_location_to_position(new_point);
+            fixed_point_t position = cell_location_to_fixed(new_point);
 
             if (character->next_direction == DIRECTION_NORTH)
-                character->position.y -= CellSize.height;
+                position.y -= FIXED_ONE;
             else if (character->next_direction == DIRECTION_SOUTH)
-                character->position.y += CellSize.height;
+                position.y += FIXED_ONE;
             else if (character->next_direction == DIRECTION_WEST)
-                character->position.x -= CellSize.width;
+                position.x -= FIXED_ONE;
             else if (character->next_direction == DIRECTION_EAST)
-                character->position.x += CellSize.width;
+                position.x += FIXED_ONE;
+
+            character_set_position(character, position);
 
         }
     }
 
 }
 
-/**
- *  Ferma l'avanzamento del personaggio quando questo incontra un muro
- *
- *  @param character Personaggio da fermare
- */
 void character_wall(game_t * game, character_t * character)
 {
 
     point_t location = character->location;
-    point_t point = cell_position_to_location(character->position);
+    point_t point = cell_fixed_to_location(character->fixed_position);
 
     if (character->direction == DIRECTION_EAST) {
         location.x = point.x++;
@@ -611,9 +622,9 @@ void character_wall(game_t * game, character_t * character)
             break;
     }
 
-    bool breaks_walls = bool_value_nocheck(hashtable_search(character->config, "breaks_walls"));
+    bool breaks_walls = bool_value_nocheck(hashtable_search_key(character->config, &character_breaks_walls_key));
 
-    if (map_cell_is_valid(character->map, point) && !cell_is_path(map_get_cell(character->map, point))) {
+    if (map_cell_is_valid(character->map, point) && !cell_is_path(character->map, map_get_cell(character->map, point))) {
 
         //  il personaggio puà abbattere le mura (purchè non siano quelle che fanno da confine)
         if (breaks_walls && !map_point_is_on_borders(character->map, point)) {
@@ -622,7 +633,7 @@ void character_wall(game_t * game, character_t * character)
             map_cell_t * cell = map_get_cell(character->map, point);
 
             //  muro -> corridoio
-            cell_set_is_path(cell);
+            cell_set_is_path(character->map, cell);
 
             //  effetto sonoro
             audio_sample_play_by_id(game, AUDIO_SAMPLE_WALL, false);
@@ -630,12 +641,15 @@ void character_wall(game_t * game, character_t * character)
             //  riconnessione delle adiacenze
             map_connect_cell(character->map, cell, 1);
 
+            //  tasselli della cella e delle vicine
+            map_tiling_update_cell(character->map, point);
+
         } else {
 
-            character->position = cell_location_to_position(location);
+            character_set_position(character, cell_location_to_fixed(location));
 
             if (character->is_user)
-                character->last_position = PointNull;
+                character->last_position = FixedPointNull;
 
             if (character->next_direction != DIRECTION_NONE &&
                (map_cell_is_path(character->map, cell_to_check) || breaks_walls)) {
@@ -646,10 +660,10 @@ void character_wall(game_t * game, character_t * character)
         
     } else if (!map_cell_is_valid(character->map, point)) {
 
-        character->position = map_cell_is_path(character->map, location) ? cell_location_to_position(location) : character->last_position;
+        character_set_position(character, map_cell_is_path(character->map, location) ? cell_location_to_fixed(location) : character->last_position);
 
         if (character->is_user)
-            character->last_position = PointNull;
+            character->last_position = FixedPointNull;
 
     }
 
@@ -661,7 +675,7 @@ void character_decide_direction_user(character_t * character) {
     
     //  si cerca l'unica adiacenza della cella di partenza
     map_cell_t * adjacency[4];
-    cell_get_adjacency(map_get_cell(map, map->start), adjacency);
+    cell_get_adjacency(map, map_get_cell(map, map->start), adjacency);
     
     //  la prossima direzione da seguire è quella che porta alla cella adiacenza a quella di partenza
     int direction = character_get_direction_relative_to_location(character, adjacency[0]->location);
@@ -696,7 +710,7 @@ void character_set_path_to(game_t * game, character_t * character, point_t point
     character_clear_path(character);
 
     //  e ne calcola uno nuovo
-    ai_path_fiding_function find_path = ai_get_path_function(hashtable_search(character->config, "path_finding_method"));
+    ai_path_fiding_function find_path = ai_get_path_function(hashtable_search_key(character->config, &character_path_finding_method_key));
     find_path(game, character, point);
 
     //  per poi cominciare a seguirlo
@@ -712,9 +726,9 @@ void character_update_direction_and_last_position(character_t * character) {
     else if (character->direction == DIRECTION_NONE)
         character->direction = character->next_direction;
     
-    if (PointIsNull(character->last_position)) {
-        character->last_position = character->position;
-        character->ratio = 0.;
+    if (FixedPointIsNull(character->last_position)) {
+        character->last_position = character->fixed_position;
+        character->ratio = 0;
     }
     
 }
@@ -734,14 +748,14 @@ bool character_rects_check(game_t * game, character_t * character)
 
     dimension_t map_size = SizeMultiplyBySize(character->map->size, CellSize);
 
-    dimension_t exit_search_rect_size = hashtable_search(character->config, "exit_search_rect_size", dimension);
-    dimension_t chase_rect_size = hashtable_search(character->config, "chase_rect_size", dimension);
+    dimension_t exit_search_rect_size = hashtable_search_key(character->config, &character_exit_search_rect_size_key, dimension);
+    dimension_t chase_rect_size = hashtable_search_key(character->config, &character_chase_rect_size_key, dimension);
 
     exit_search_rect_size = SizeMultiplyBySize(exit_search_rect_size, CellSize);
     chase_rect_size = SizeMultiplyBySize(chase_rect_size, CellSize);
 
     //  il personaggio preferisce inseguire l'utente?
-    bool chase_user = bool_value_nocheck(hashtable_search(character->config, "chase_user"));
+    bool chase_user = bool_value_nocheck(hashtable_search_key(character->config, &character_chase_user_key));
 
     //  spazio nel quale cercare l'uscita
     rectangle_t exit_search_rect = rectangle_centered_make(character->position, exit_search_rect_size, map_size);
@@ -752,7 +766,7 @@ bool character_rects_check(game_t * game, character_t * character)
     bool following = true;
 
     //  funzione di inseguimento
-    ai_chasing_function chase = ai_get_chasing_function(hashtable_search(character->config, "chasing_method"));
+    ai_chasing_function chase = ai_get_chasing_function(hashtable_search_key(character->config, &character_chasing_method_key));
 
     //  utente
     character_t * user = game_get_user(game);
@@ -796,18 +810,12 @@ bool character_rects_check(game_t * game, character_t * character)
 
 }
 
-/**
- *  Gestione dei movimenti di un personaggo avversario
- *
- *  @param game Contesto di gioco
- *  @param character Personaggio da gestire
- */
-void character_control_ai(game_t * game, character_t * character)
+map_cell_t * character_ai_prepare(game_t * game, character_t * character)
 {
     
     //  il personaggio non è stato posizionato sulla mappa
     if (PointIsNull(character->location)) {
-        return;
+        return NULL;
     }
     
     //  l'ultimo percorso è stato seguito fino all'ultima cella, si può deallocare
@@ -818,7 +826,7 @@ void character_control_ai(game_t * game, character_t * character)
     //  il personaggio non sta ancora seguendo percorsi
     if (!character->path && !character_rects_check(game, character)) {
         
-        dimension_t exit_search_rect_size = hashtable_search(character->config, "exit_search_rect_size", dimension);
+        dimension_t exit_search_rect_size = hashtable_search_key(character->config, &character_exit_search_rect_size_key, dimension);
         exit_search_rect_size = SizeMultiplyBySize(exit_search_rect_size, CellSize);
         
         dimension_t map_size = SizeMultiplyBySize(character->map->size, CellSize);
@@ -851,54 +859,79 @@ void character_control_ai(game_t * game, character_t * character)
         
         //  calcolo del percorso
         if (!PointIsNull(nearest_path) && !PointEqualToPoint(nearest_path, character->location)) {
-            ai_path_fiding_function find_path = ai_get_path_function(hashtable_search(character->config, "path_finding_method"));
+            ai_path_fiding_function find_path = ai_get_path_function(hashtable_search_key(character->config, &character_path_finding_method_key));
             find_path(game, character, nearest_path);
         }
         
         character_decide_direction_ai(character);
-        
-    } else {
 
-        //  prossima cella da raggiungere
-        map_cell_t * next = stack_head(character->path);
+        return NULL;
         
-        if (next) {
+    }
 
-            point_t last_position = character->position;
-            
-            //  controlli sulla direzione
-            character_update_direction_and_last_position(character);
-            
-            //  aggioramento posizione
-            character_move_to_cell(character, cell_location_to_position(next->location));
-            
-            //  controlla se il personaggio si è scontrato con un muro
-            character_wall(game, character);
-            
-            //  spostamento del personaggio
-            character_move(game, character, last_position);
-            
-            //  è stato raggiunto il prossimo punto del percorso, rimozione dallo stack
-            if (character->ratio >= 1.) {
-                
-                if (character->path)
-                    stack_pop(character->path);
-                
-                //  a questo punto si può valure se è il caso di cambiare percorso
-                //  ad esempio smettere di cercare l'uscita e inseguire l'avversario
-                if (!character_rects_check(game, character)) {
-                    //  prossima direzione
-                    character_decide_direction_ai(character);
-                    
-                    //  aggiornamento dell'ultima posizione nota
-                    character->last_position = PointNull;
-                }
-                
-            }
-            
-        }
+    //  prossima cella da raggiungere
+    map_cell_t * next = stack_head(character->path);
+
+    //  controlli sulla direzione
+    if (next)
+        character_update_direction_and_last_position(character);
+
+    return next;
+
+}
+
+void character_ai_arrive(game_t * game, character_t * character)
+{
+
+    //  il prossimo punto del percorso non è ancora stato raggiunto
+    if (character->ratio < FIXED_ONE)
+        return;
+
+    //  è stato raggiunto il prossimo punto del percorso, rimozione dallo stack
+    if (character->path)
+        stack_pop(character->path);
+    
+    //  a questo punto si può valure se è il caso di cambiare percorso
+    //  ad esempio smettere di cercare l'uscita e inseguire l'avversario
+    if (!character_rects_check(game, character)) {
+        //  prossima direzione
+        character_decide_direction_ai(character);
         
+        //  aggiornamento dell'ultima posizione nota
+        character->last_position = FixedPointNull;
     }
+
+}
+
+/**
+ *  Gestione dei movimenti di un personaggo avversario
+ *
+ *  @param game Contesto di gioco
+ *  @param character Personaggio da gestire
+ */
+void character_control_ai(game_t * game, character_t * character)
+{
+
+    //  prossima cella da raggiungere
+    map_cell_t * next = character_ai_prepare(game, character);
+
+    if (!next)
+        return;
+
+    fixed_point_t last_position = character->fixed_position;
+    
+    //  aggioramento posizione
+    character_move_to_cell(character, cell_location_to_fixed(next->location));
+    
+    //  controlla se il personaggio si è scontrato con un muro
+    character_wall(game, character);
+    
+    //  spostamento del personaggio
+    character_move(game, character, last_position);
+
+    //  eventuale passaggio al punto successivo del percorso
+    character_ai_arrive(game, character);
+
 }
 
 /**
@@ -910,7 +943,7 @@ void character_control_ai(game_t * game, character_t * character)
 void character_control_user(game_t * game, character_t * character)
 {
     
-    point_t last_position = character->position;
+    fixed_point_t last_position = character->fixed_position;
     
     //  aggiorna lo stato della tastiera
     keyboard_get_state();
@@ -953,16 +986,16 @@ void character_control_user(game_t * game, character_t * character)
     
     character_update_direction_and_last_position(character);
     
-    point_t next = character->last_position;
+    fixed_point_t next = character->last_position;
     
     if (character->direction == DIRECTION_NORTH)
-        next.y -= CellSize.height;
+        next.y -= FIXED_ONE;
     else if (character->direction == DIRECTION_SOUTH)
-        next.y += CellSize.height;
+        next.y += FIXED_ONE;
     else if (character->direction == DIRECTION_WEST)
-        next.x -= CellSize.width;
+        next.x -= FIXED_ONE;
     else if (character->direction == DIRECTION_EAST)
-        next.x += CellSize.width;
+        next.x += FIXED_ONE;
     
     //  aggioramento posizione
     character_move_to_cell(character, next);
@@ -975,8 +1008,8 @@ void character_control_user(game_t * game, character_t * character)
     //  per il prossimo aggiornamento dello schermo
     character_move(game, character, last_position);
 
-    if (PointEqualToPoint(character->position, next)) {
-        character->last_position = PointNull;
+    if (FixedPointEqualToPoint(character->fixed_position, next)) {
+        character->last_position = FixedPointNull;
     }
     
 }
@@ -989,17 +1022,25 @@ character_t * character_new(bool is_user, image_t * sprite, rectangle_t rect)
     //  il personaggio è dell'utente?
     character->is_user = is_user;
 
+    //  impostato da character_load
+    character->name = NULL;
+
     //  di default il personaggio è rivolto verso il basso
     character->direction = character->next_direction = DIRECTION_NONE;
 
     //  posizione sulla mappa, inizialmente una posizione fuori dalla mappa
-    character->location = character->position = character->last_position = PointNull;
+    character->location = character->position = PointNull;
+    character->fixed_position = character->last_position = FixedPointNull;
+    character->map = NULL;
+
+    //  registrato nella griglia di una mappa quando vi è posizionato
+    character->bucket_map = NULL;
 
     //  funzioni per controllare il personaggio (diverse a seconda del tipo utente/ai)
     character->methods.control = is_user ? character_control_user : character_control_ai;
 
     //  impostazioni di default
-    character->ratio = 0.;
+    character->ratio = 0;
 
     //  si inizializza la lista dei bonus posseduti
     character->powerups = list_new(powerup_status_functions);
@@ -1049,47 +1090,75 @@ void character_delete(character_t * character)
     //  4. percorsi
     character_clear_path(character);
 
-    //  5. configurazioni
+    //  5. griglia dei personaggi della mappa
+    map_characters_remove(character);
+
+    //  6. configurazioni
     hashtable_delete(character->config);
 
-    //  6. configurazioni di default
+    //  7. configurazioni di default
     hashtable_delete(character->default_config);
 
-    //  7. personaggio
+    //  8. nome
+    memfree(character->name);
+
+    //  9. personaggio
     memfree(character);
 
 }
 
-character_t * character_load(hashtable_t * character_config, bool is_user)
+/**
+ *  Variabili del dizionario di un personaggio necessarie al caricamento.
+ *  Le altre proprietà restano nel dizionario, modificabile dai bonus durante il gioco.
+ */
+typedef struct {
+
+    /** File contenente le immagini */
+    char * sprites;
+
+    /** Zona dell'immagine contenente il personaggio */
+    rectangle_t rect;
+
+} character_config_t;
+
+/**
+ *  Schema del dizionario di un personaggio
+ */
+static const config_schema_field_t character_config_schema[] = {
+    ConfigSchemaField(character_config_t, sprites, "sprites", CONFIG_VARTYPE_STRING, true, NULL),
+    ConfigSchemaField(character_config_t, rect, "rect", CONFIG_VARTYPE_RECTANGLE, true, NULL)
+};
+
+character_t * character_load(hashtable_t * character_config, char * name, bool is_user)
 {
 
-    //  path del file contenente le immagini
-    char * character_sprites_path = hashtable_search(character_config, "sprites");
-    //  zona dell'immagine contenente il personaggio
-    rectangle_t * character_rect = hashtable_search(character_config, "rect");
+    character_config_t settings;
 
     //  niente personaggi
-    if (!character_sprites_path) {
+    if (!config_schema_decode(character_config, character_config_schema, &settings, name))
         return NULL;
-    }
 
     //  caricamento textures dei personaggi
-    image_t * character_sprites = image_load_new(character_sprites_path, RectZero, true);
+    image_t * character_sprites = image_load_new(settings.sprites, RectZero, true);
 
     //  probabilmente il percorso dell'immagine è sbagliato
     if (!character_sprites)
         return NULL;
 
     //  creazione personaggio e inserimento nella lista dei personaggi
-    character_t * character = character_new(is_user, character_sprites, *character_rect);
+    character_t * character = character_new(is_user, character_sprites, settings.rect);
 
     image_delete(character_sprites);
 
     if (!character)
         return NULL;
 
-    //  proprietà dei personaggi
-    character->config = hashtable_duplicate(character_config);
+    //  nome del dizionario, per l'aggiornamento della configurazione durante il gioco
+    character->name = memstrdup(name);
+
+    //  proprietà di default: il dizionario è condiviso tra tutti i personaggi
+    //  caricati a partire da esso, i valori mancanti sono aggiunti in un livello superiore
+    character->config = hashtable_overlay_new(character_config);
 
     //  controlla che nella configurazione ci siano tutti i valori, altrimenti inserisce quelli di default
 
@@ -1166,8 +1235,10 @@ character_t * character_load(hashtable_t * character_config, bool is_user)
         
     }
 
-    //  proprietà di default
-    character->default_config = hashtable_duplicate(character->config);
+    //  le proprietà modificate dai bonus sono inserite in un livello superiore
+    //  a quello delle proprietà di default
+    character->default_config = character->config;
+    character->config = hashtable_overlay_new(character->default_config);
 
     debugf("[Personaggio] %s caricato\n", is_user ? "dell'utente" : "avversario");
 
@@ -1175,6 +1246,32 @@ character_t * character_load(hashtable_t * character_config, bool is_user)
 
 }
 
+void character_config_update(character_t * character, char * key, void * value, struct type_functions value_type)
+{
+
+    //  il nuovo valore è inserito nel livello delle proprietà di default:
+    //  le proprietà modificate da un bonus attivo continuano a prevalere finché non è disattivato
+    hashtable_node_t * node = hashtable_search_node_element(character->default_config, key);
+
+    //  stesso tipo, si sostituisce il valore
+    if (node && node->value_type.duplicate == value_type.duplicate && hashtable_replace(character->default_config, key, value, true))
+        return;
+
+    //  tipo diverso o proprietà nuova
+    hashtable_remove(character->default_config, key);
+    hashtable_insert(character->default_config, key, value, value_type, true);
+
+}
+
+void character_upload(character_t * character)
+{
+
+    int i;
+    for (i = 0; i < CHARACTER_TILES_COUNT; i++)
+        image_upload(character->tiles[i]);
+
+}
+
 //  Carica tutti i personaggi specificati nella variabile di tipo lista "name" del file di configurazione del livello
 list_t * characters_load(hashtable_t * config, char * name)
 {
@@ -1191,7 +1288,7 @@ list_t * characters_load(hashtable_t * config, char * name)
         hashtable_t * character_config = hashtable_search(config, character_name);
 
         //  inizializzazione del personaggio
-        character_t * character = character_load(character_config, 0);
+        character_t * character = character_load(character_config, character_name, 0);
 
         if (character)
             list_insert(characters, character);
@@ -4,6 +4,7 @@
 #include "std/hashtable.h"
 #include "std/stack.h"
 
+#include "misc/fixed.h"
 #include "misc/geometry.h"
 #include "misc/directions.h"
 
@@ -38,11 +39,14 @@ struct character_s {
     /** Specifica se il personaggio è controllato dall'utente */
     bool is_user;
 
+    /** Nome del dizionario di configurazione del personaggio */
+    char * name;
+
     /** Bitmap del personaggio (memorizzate a seconda dei movimenti) */
     image_t * tiles[CHARACTER_TILES_COUNT];
 
-    /** Posizione nel corso del movimento tra due celle (0., 1.) */
-    float ratio;
+    /** Posizione nel corso del movimento tra due celle, in [0, FIXED_ONE] */
+    fixed_t ratio;
 
     /** Animazioni che consentono l'alternarsi dei frame che simulano il movimento del personaggio */
     animation_t * animations[CHARACTER_ANIMATION_LAST];
@@ -50,15 +54,27 @@ struct character_s {
     /** Posizione del personaggio sulla mappa in relazione alla griglia */
     point_t location;
 
-    /** Posizione assoluta del personaggio sulla mappa in relazione allo schermo */
+    /** Posizione del personaggio sulla mappa, in celle a virgola fissa (vedi character_set_position) */
+    fixed_point_t fixed_position;
+
+    /** Posizione assoluta del personaggio sulla mappa in relazione allo schermo, ricavata da fixed_position */
     point_t position;
 
-    /** Ultima posizione assoluta del personaggio */
-    point_t last_position;
+    /** Ultima posizione del personaggio, in celle a virgola fissa (punto di partenza del movimento) */
+    fixed_point_t last_position;
 
     /** Mappa nella quale si trova il personaggio */
     map_t * map;
 
+    /** Mappa nella cui griglia dei personaggi è registrato (NULL se in nessuna, vedi map_characters_update) */
+    map_t * bucket_map;
+
+    /** Riquadro della griglia di bucket_map */
+    size_t bucket;
+
+    /** Posizione nel riquadro */
+    unsigned int bucket_slot;
+
     /** Direzione che il personaggio sta tenendo */
     int direction;
 
@@ -109,13 +125,31 @@ list_t * characters_load(hashtable_t * config, char * name);
  *  Caricamento del personaggio definito nella hashtable _character_config_
  *
  *  @param character_config Hashtable contenente la configurazione del personaggio
+ *  @param name Nome del dizionario di configurazione del personaggio
  *  @param is_user Indica se il personaggio è controllato dall'utente
  *
  *  @return Personaggio caricato
  *
  *  @retval NULL In caso di errori
  */
-character_t * character_load(hashtable_t * character_config, bool is_user);
+character_t * character_load(hashtable_t * character_config, char * name, bool is_user);
+
+/**
+ *  Aggiorna una proprietà del personaggio modificata nel file di configurazione
+ *
+ *  @param character Personaggio
+ *  @param key Nome della proprietà
+ *  @param value Nuovo valore (copiato)
+ *  @param value_type Funzioni del valore
+ */
+void character_config_update(character_t * character, char * key, void * value, struct type_functions value_type);
+
+/**
+ *  Trasferisce sulla scheda video le immagini di un personaggio caricato da un thread secondario
+ *
+ *  @param character Personaggio
+ */
+void character_upload(character_t * character);
 
 /**
  *  Creazione di un nuovo personaggio
@@ -208,6 +242,14 @@ int character_direction_relative_to_location(character_t * character, point_t lo
  */
 void character_set_location(character_t * character, point_t point, bool clear_direction);
 
+/**
+ *  Cambia la posizione di un personaggio all'interno della mappa (aggiorna anche la posizione in pixel)
+ *
+ *  @param character Personaggio
+ *  @param position Nuova posizione, in celle a virgola fissa
+ */
+void character_set_position(character_t * character, fixed_point_t position);
+
 /**
  *  Sposta due personaggi in due celle random ad una certa distanza l'una dall'altra
  *
@@ -224,6 +266,56 @@ void characters_set_random_position(character_t * character_a, character_t * cha
  */
 void character_set_random_position(character_t * character);
 
+/**
+ *  Calcolo della velocità dei un personaggio in base alla cella in cui si trova
+ *  se cell_value = 5 (default) -> velocità = character->speed
+ *  se cell_value < 5           -> velocità = character->speed + (5 - cell_value) * 1.5
+ *  se cell_value > 5           -> velocità = character->speed / ((cell_value - 5) * 1.5)
+ *
+ *  @param character Personaggio
+ *
+ *  @return Velocità
+ */
+float character_get_speed(character_t * character);
+
+/**
+ *  Sposta un personaggio nella prossima posizione a seconda della sua direzione
+ *
+ *  @param game Contesto di gioco
+ *  @param character Personaggio da spostare
+ *  @param last_position Ultima posizione del personaggio
+ */
+void character_move(game_t * game, character_t * character, fixed_point_t last_position);
+
+/**
+ *  Ferma l'avanzamento del personaggio quando questo incontra un muro
+ *
+ *  @param game Contesto di gioco
+ *  @param character Personaggio da fermare
+ */
+void character_wall(game_t * game, character_t * character);
+
+/**
+ *  Prima fase della gestione di un avversario: se non segue un percorso ne sceglie uno,
+ *  altrimenti ne aggiorna direzione e ultima posizione per lo spostamento verso la prossima cella
+ *
+ *  @param game Contesto di gioco
+ *  @param character Personaggio
+ *
+ *  @return Prossima cella del percorso
+ *  @retval NULL Se il personaggio non si sposta in questo aggiornamento
+ */
+map_cell_t * character_ai_prepare(game_t * game, character_t * character);
+
+/**
+ *  Ultima fase della gestione di un avversario, dopo lo spostamento: raggiunta la prossima
+ *  cella del percorso la rimuove e valuta se cambiare percorso
+ *
+ *  @param game Contesto di gioco
+ *  @param character Personaggio
+ */
+void character_ai_arrive(game_t * game, character_t * character);
+
 /**
  *  Calcola il percorso fino ad un punto e lo associa al personaggio
  *
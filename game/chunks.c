@@ -0,0 +1,961 @@
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#include "utils.h"
+
+#include "game/chunks.h"
+#include "game/cell.h"
+
+/**
+ *  Byte occupati da un chunk: tipi seguiti dai pesi
+ */
+#define CHUNK_BYTES         (2 * CHUNK_CELLS)
+
+/**
+ *  Identificativo dei file di chunk
+ */
+#define CHUNKS_MAGIC        "CHNK"
+
+/**
+ *  Versione del formato dei file di chunk
+ */
+#define CHUNKS_VERSION      1
+
+/**
+ *  Nessun chunk (nella tabella e come ultimo chunk acceduto)
+ */
+#define CHUNKS_NONE         ((size_t)-1)
+
+/**
+ *  Intestazione dei file di chunk.
+ *  Occupa i primi CHUNK_BYTES del file, seguita dai chunk per righe:
+ *  il chunk i è all'offset CHUNK_BYTES * (i + 1), allineato alle pagine per la mappatura.
+ */
+typedef struct {
+
+    /** Identificativo (CHUNKS_MAGIC) */
+    char magic[4];
+
+    /** Versione del formato */
+    unsigned int version;
+
+    /** Larghezza del mondo, in caselle */
+    unsigned int width;
+
+    /** Altezza del mondo, in caselle */
+    unsigned int height;
+
+} chunks_header_t;
+
+/**
+ *  Posto per un chunk residente
+ */
+typedef struct {
+
+    /** Indice del chunk (CHUNKS_NONE se il posto è libero) */
+    size_t index;
+
+    /** Tipi e pesi delle caselle del chunk */
+    unsigned char * data;
+
+    /** Se true data è una mappatura del file, altrimenti è un buffer del posto */
+    bool mapped;
+
+    /** Se true il chunk è stato modificato dall'ultima scrittura */
+    bool dirty;
+
+    /** Istante dell'ultimo accesso (contatore di accessi) */
+    unsigned long used;
+
+} chunks_slot_t;
+
+struct chunks_s {
+
+    /** Dimensione del mondo, in caselle */
+    size_t width;
+    size_t height;
+
+    /** Numero di chunk per riga e per colonna */
+    size_t columns;
+    size_t rows;
+
+    /** Posti per i chunk residenti */
+    chunks_slot_t * slots;
+
+    /** Numero massimo di chunk residenti */
+    size_t limit;
+
+    /** Numero di posti occupati */
+    size_t count;
+
+    /** Tabella dei chunk residenti: indice del chunk -> posto (+ 1, 0 se vuoto), indirizzamento aperto */
+    size_t * table;
+
+    /** Dimensione della tabella - 1 (potenza di 2) */
+    size_t mask;
+
+    /** Contatore degli accessi */
+    unsigned long clock;
+
+    /** Posto dell'ultimo chunk acceduto (accessi consecutivi allo stesso chunk) */
+    size_t last;
+
+    /** File di appoggio (NULL se i chunk sono generati) */
+    FILE * file;
+
+    /** Se true i chunk del file sono mappati in memoria */
+    bool mapped;
+
+    /** Funzione di generazione dei chunk */
+    chunks_generate_function generate;
+
+    /** Dati passati a generate */
+    void * data;
+
+    /** Chunk dei punti di interesse */
+    size_t * focus;
+
+    /** Numero di punti di interesse */
+    size_t focus_count;
+
+    /** Distanza, in chunk, entro la quale un chunk è vicino ad un punto di interesse */
+    size_t radius;
+
+    /** Chunk caricati e rilasciati, per le statistiche */
+    size_t loads;
+    size_t evictions;
+
+};
+
+/**
+ *  Posizione nella tabella dei chunk residenti
+ *
+ *  @param chunks Archivio
+ *  @param index Indice del chunk
+ *
+ *  @return Posizione iniziale della ricerca
+ */
+sinline size_t chunks_hash(chunks_t * chunks, size_t index)
+{
+
+    //  hash moltiplicativo, i chunk vicini non finiscono in posizioni consecutive
+    return (size_t)(((unsigned long long)index * 0x9E3779B97F4A7C15ULL) >> 17) & chunks->mask;
+
+}
+
+/**
+ *  Ricerca di un chunk residente
+ *
+ *  @param chunks Archivio
+ *  @param index Indice del chunk
+ *
+ *  @return Posto del chunk
+ *  @retval CHUNKS_NONE Se il chunk non è residente
+ */
+static size_t chunks_find(chunks_t * chunks, size_t index)
+{
+
+    size_t position = chunks_hash(chunks, index);
+
+    while (chunks->table[position]) {
+
+        size_t slot = chunks->table[position] - 1;
+
+        if (chunks->slots[slot].index == index)
+            return slot;
+
+        position = (position + 1) & chunks->mask;
+
+    }
+
+    return CHUNKS_NONE;
+
+}
+
+/**
+ *  Inserimento di un chunk nella tabella
+ *
+ *  @param chunks Archivio
+ *  @param index Indice del chunk
+ *  @param slot Posto del chunk
+ */
+static void chunks_table_insert(chunks_t * chunks, size_t index, size_t slot)
+{
+
+    size_t position = chunks_hash(chunks, index);
+
+    while (chunks->table[position])
+        position = (position + 1) & chunks->mask;
+
+    chunks->table[position] = slot + 1;
+
+}
+
+/**
+ *  Rimozione di un chunk dalla tabella: gli elementi successivi della stessa sequenza
+ *  sono spostati indietro, senza lasciare segnaposto
+ *
+ *  @param chunks Archivio
+ *  @param index Indice del chunk
+ */
+static void chunks_table_remove(chunks_t * chunks, size_t index)
+{
+
+    size_t position = chunks_hash(chunks, index);
+
+    while (chunks->table[position] && chunks->slots[chunks->table[position] - 1].index != index)
+        position = (position + 1) & chunks->mask;
+
+    if (!chunks->table[position])
+        return;
+
+    size_t next = position;
+
+    for (;;) {
+
+        chunks->table[position] = 0;
+
+        //  primo elemento successivo che può occupare la posizione liberata
+        for (;;) {
+
+            next = (next + 1) & chunks->mask;
+
+            if (!chunks->table[next])
+                return;
+
+            size_t home = chunks_hash(chunks, chunks->slots[chunks->table[next] - 1].index);
+
+            //  home non è nell'intervallo circolare (position, next]
+            if ((next > position) ? (home <= position || home > next) : (home <= position && home > next))
+                break;
+
+        }
+
+        chunks->table[position] = chunks->table[next];
+        position = next;
+
+    }
+
+}
+
+/**
+ *  Posizione di un chunk nel file
+ *
+ *  @param index Indice del chunk
+ *
+ *  @return Offset in byte
+ */
+sinline long long chunks_offset(size_t index)
+{
+
+    return (long long)CHUNK_BYTES * (long long)(index + 1);
+
+}
+
+/**
+ *  Posizionamento nel file, anche oltre i 2 GB
+ *
+ *  @param file File
+ *  @param offset Offset in byte
+ *
+ *  @return false in caso di errore
+ */
+static bool chunks_seek(FILE * file, long long offset)
+{
+
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+
+}
+
+/**
+ *  Scrive sul file un chunk modificato non mappato
+ *
+ *  @param chunks Archivio
+ *  @param slot Posto del chunk
+ *
+ *  @return false in caso di errore di scrittura
+ */
+static bool chunks_write_slot(chunks_t * chunks, chunks_slot_t * slot)
+{
+
+    if (!slot->dirty || !chunks->file || slot->mapped)
+        return true;
+
+    if (!chunks_seek(chunks->file, chunks_offset(slot->index)) || fwrite(slot->data, 1, CHUNK_BYTES, chunks->file) != CHUNK_BYTES) {
+        errorf("[Chunks] Impossibile scrivere il chunk %zu\n", slot->index);
+        return false;
+    }
+
+    slot->dirty = false;
+
+    return true;
+
+}
+
+/**
+ *  Rilascia il chunk di un posto (scrivendolo sul file se modificato)
+ *
+ *  @param chunks Archivio
+ *  @param slot Posto
+ */
+static void chunks_release(chunks_t * chunks, chunks_slot_t * slot)
+{
+
+    if (slot->index == CHUNKS_NONE)
+        return;
+
+    chunks_write_slot(chunks, slot);
+    chunks_table_remove(chunks, slot->index);
+
+#ifndef _WIN32
+    //  le modifiche di una mappatura condivisa sono già nel file
+    if (slot->mapped) {
+        munmap(slot->data, CHUNK_BYTES);
+        slot->data = NULL;
+        slot->mapped = false;
+    }
+#endif
+
+    slot->index = CHUNKS_NONE;
+    slot->dirty = false;
+
+    chunks->count--;
+    chunks->evictions++;
+
+}
+
+/**
+ *  Verifica se un chunk è vicino ad un punto di interesse
+ *
+ *  @param chunks Archivio
+ *  @param index Indice del chunk
+ *
+ *  @return true se il chunk è entro radius chunk da almeno un punto di interesse
+ */
+static bool chunks_is_focused(chunks_t * chunks, size_t index)
+{
+
+    size_t x = index % chunks->columns;
+    size_t y = index / chunks->columns;
+
+    size_t i;
+    for (i = 0; i < chunks->focus_count; i++) {
+
+        size_t fx = chunks->focus[i] % chunks->columns;
+        size_t fy = chunks->focus[i] / chunks->columns;
+
+        if ((x > fx ? x - fx : fx - x) <= chunks->radius && (y > fy ? y - fy : fy - y) <= chunks->radius)
+            return true;
+
+    }
+
+    return false;
+
+}
+
+/**
+ *  Sceglie il posto per un nuovo chunk: un posto libero o, se non ce ne sono, quello
+ *  del chunk utilizzato meno di recente tra quelli lontani dai punti di interesse
+ *  (tra tutti se sono tutti vicini)
+ *
+ *  @param chunks Archivio
+ *
+ *  @return Posto libero
+ */
+static chunks_slot_t * chunks_evict(chunks_t * chunks)
+{
+
+    chunks_slot_t * victim = NULL;
+    chunks_slot_t * focused = NULL;
+
+    size_t i;
+    for (i = 0; i < chunks->limit; i++) {
+
+        chunks_slot_t * slot = &chunks->slots[i];
+
+        if (slot->index == CHUNKS_NONE)
+            return slot;
+
+        if (chunks->focus_count && chunks_is_focused(chunks, slot->index)) {
+
+            if (!focused || slot->used < focused->used)
+                focused = slot;
+
+        } else if (!victim || slot->used < victim->used) {
+            victim = slot;
+        }
+
+    }
+
+    if (!victim)
+        victim = focused;
+
+    chunks_release(chunks, victim);
+
+    return victim;
+
+}
+
+/**
+ *  Genera un chunk letto dal file se non è mai stato scritto (solo CELL_TYPE_UNKNOWN)
+ *  e l'archivio ha una funzione di generazione
+ *
+ *  @param chunks Archivio
+ *  @param slot Posto del chunk, già letto
+ *  @param index Indice del chunk
+ */
+static void chunks_load_generate(chunks_t * chunks, chunks_slot_t * slot, size_t index)
+{
+
+    if (!chunks->generate)
+        return;
+
+    size_t i;
+    for (i = 0; i < CHUNK_CELLS; i++) {
+
+        if (slot->data[i] != CELL_TYPE_UNKNOWN)
+            return;
+
+    }
+
+    chunks->generate(chunks->data, index % chunks->columns, index / chunks->columns, slot->data, slot->data + CHUNK_CELLS);
+
+    //  va scritto: rigenerarlo ad ogni caricamento costerebbe più della lettura
+    slot->dirty = true;
+
+}
+
+/**
+ *  Carica un chunk in un posto libero
+ *
+ *  @param chunks Archivio
+ *  @param slot Posto
+ *  @param index Indice del chunk
+ *
+ *  @return false se il chunk non può essere caricato
+ */
+static bool chunks_load(chunks_t * chunks, chunks_slot_t * slot, size_t index)
+{
+
+    if (!chunks->file) {
+        chunks->generate(chunks->data, index % chunks->columns, index / chunks->columns, slot->data, slot->data + CHUNK_CELLS);
+        return true;
+    }
+
+#ifndef _WIN32
+    if (chunks->mapped) {
+
+        void * data = mmap(NULL, CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(chunks->file), (off_t)chunks_offset(index));
+
+        if (data != MAP_FAILED) {
+
+            //  il buffer del posto non serve più, il chunk è nella mappatura
+            memfree(slot->data);
+
+            slot->data = data;
+            slot->mapped = true;
+
+            chunks_load_generate(chunks, slot, index);
+
+            return true;
+
+        }
+
+        //  mappatura non riuscita (es. limite di mappature), si prosegue leggendo il file
+        chunks->mapped = false;
+
+    }
+#endif
+
+    if (!slot->data)
+        slot->data = memalloc(unsigned char, CHUNK_BYTES);
+
+    //  i chunk mai scritti possono essere oltre la fine del file
+    size_t length = 0;
+
+    if (chunks_seek(chunks->file, chunks_offset(index)))
+        length = fread(slot->data, 1, CHUNK_BYTES, chunks->file);
+
+    if (ferror(chunks->file)) {
+        errorf("[Chunks] Impossibile leggere il chunk %zu\n", index);
+        clearerr(chunks->file);
+        return false;
+    }
+
+    memset(slot->data + length, 0, CHUNK_BYTES - length);
+
+    chunks_load_generate(chunks, slot, index);
+
+    return true;
+
+}
+
+/**
+ *  Creazione di un archivio vuoto
+ *
+ *  @param width Larghezza del mondo, in caselle
+ *  @param height Altezza del mondo, in caselle
+ *  @param limit Numero massimo di chunk residenti
+ *
+ *  @return Archivio
+ */
+static chunks_t * chunks_allocate(size_t width, size_t height, size_t limit)
+{
+
+    chunks_t * chunks = memalloc(chunks_t, 1, true);
+
+    chunks->width = width;
+    chunks->height = height;
+    chunks->columns = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks->rows = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    chunks->limit = limit ? limit : 1;
+    chunks->last = CHUNKS_NONE;
+
+    chunks->slots = memalloc(chunks_slot_t, chunks->limit, true);
+
+    size_t i;
+    for (i = 0; i < chunks->limit; i++)
+        chunks->slots[i].index = CHUNKS_NONE;
+
+    //  tabella con un fattore di carico di al più 1/2
+    size_t capacity = 1;
+
+    while (capacity < 2 * chunks->limit)
+        capacity <<= 1;
+
+    chunks->table = memalloc(size_t, capacity, true);
+    chunks->mask = capacity - 1;
+
+    return chunks;
+
+}
+
+chunks_t * chunks_new(size_t width, size_t height, size_t limit, chunks_generate_function generate, void * data)
+{
+
+    if (!width || !height || !generate)
+        return NULL;
+
+    chunks_t * chunks = chunks_allocate(width, height, limit);
+
+    chunks->generate = generate;
+    chunks->data = data;
+
+    return chunks;
+
+}
+
+chunks_t * chunks_open(const char * path, size_t width, size_t height, size_t limit, bool create)
+{
+
+    //  file temporaneo anonimo: esiste solo in creazione
+    if (!path)
+        create = true;
+
+    FILE * file = path ? fopen(path, create ? "w+b" : "r+b") : tmpfile();
+
+    if (!path)
+        path = "(temporaneo)";
+
+    if (!file) {
+        errorf("[Chunks] Impossibile aprire %s\n", path);
+        return NULL;
+    }
+
+    chunks_header_t header;
+
+    if (create) {
+
+        if (!width || !height || width > 0xFFFFFFFFUL || height > 0xFFFFFFFFUL) {
+            fclose(file);
+            return NULL;
+        }
+
+        memcpy(header.magic, CHUNKS_MAGIC, sizeof(header.magic));
+        header.version = CHUNKS_VERSION;
+        header.width = (unsigned int)width;
+        header.height = (unsigned int)height;
+
+        if (fwrite(&header, sizeof(header), 1, file) != 1) {
+            errorf("[Chunks] Impossibile scrivere %s\n", path);
+            fclose(file);
+            return NULL;
+        }
+
+    } else {
+
+        if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, CHUNKS_MAGIC, sizeof(header.magic)) ||
+            header.version != CHUNKS_VERSION || !header.width || !header.height) {
+
+            errorf("[Chunks] %s non è un file di chunk valido\n", path);
+            fclose(file);
+            return NULL;
+
+        }
+
+    }
+
+    chunks_t * chunks = chunks_allocate(header.width, header.height, limit);
+
+    chunks->file = file;
+
+#ifndef _WIN32
+    //  ogni chunk è mappato singolarmente: il suo offset deve essere un multiplo della pagina.
+    //  Il file è esteso alla dimensione completa senza occupare spazio su disco (file sparso)
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (page > 0 && CHUNK_BYTES % page == 0 && fflush(file) == 0) {
+
+        off_t length = (off_t)chunks_offset(chunks->columns * chunks->rows);
+        struct stat info;
+
+        chunks->mapped = (fstat(fileno(file), &info) == 0) && (info.st_size >= length || ftruncate(fileno(file), length) == 0);
+
+    }
+#endif
+
+    debugf("[Chunks] %s: %zux%zu caselle, %zu chunk (%s)\n", path, chunks->width, chunks->height,
+           chunks->columns * chunks->rows, chunks->mapped ? "mappati" : "letti dal file");
+
+    return chunks;
+
+}
+
+void chunks_set_generator(chunks_t * chunks, chunks_generate_function generate, void * data)
+{
+
+    if (!chunks || !chunks->file)
+        return;
+
+    chunks->generate = generate;
+    chunks->data = data;
+
+}
+
+dimension_t chunks_get_size(chunks_t * chunks)
+{
+
+    return SizeMake(chunks->width, chunks->height);
+
+}
+
+unsigned char * chunks_get_chunk(chunks_t * chunks, size_t chunk_x, size_t chunk_y, bool modify)
+{
+
+    if (!chunks || chunk_x >= chunks->columns || chunk_y >= chunks->rows)
+        return NULL;
+
+    size_t index = chunk_y * chunks->columns + chunk_x;
+
+    chunks->clock++;
+
+    //  accessi consecutivi alla stessa zona
+    size_t position = chunks->last;
+
+    if (position == CHUNKS_NONE || chunks->slots[position].index != index)
+        position = chunks_find(chunks, index);
+
+    chunks_slot_t * slot;
+
+    if (position != CHUNKS_NONE) {
+
+        slot = &chunks->slots[position];
+
+    } else {
+
+        slot = chunks_evict(chunks);
+
+        if (!chunks_load(chunks, slot, index))
+            return NULL;
+
+        position = (size_t)(slot - chunks->slots);
+
+        slot->index = index;
+        chunks_table_insert(chunks, index, position);
+
+        chunks->count++;
+        chunks->loads++;
+
+    }
+
+    chunks->last = position;
+
+    slot->used = chunks->clock;
+    slot->dirty |= modify;
+
+    return slot->data;
+
+}
+
+bool chunks_get_cell(chunks_t * chunks, size_t x, size_t y, unsigned char * type, unsigned char * value)
+{
+
+    if (!chunks || x >= chunks->width || y >= chunks->height)
+        return false;
+
+    unsigned char * data = chunks_get_chunk(chunks, x / CHUNK_SIZE, y / CHUNK_SIZE, false);
+
+    if (!data)
+        return false;
+
+    size_t offset = (y % CHUNK_SIZE) * CHUNK_SIZE + (x % CHUNK_SIZE);
+
+    if (type)
+        *type = data[offset];
+
+    if (value)
+        *value = data[CHUNK_CELLS + offset];
+
+    return true;
+
+}
+
+bool chunks_set_cell(chunks_t * chunks, size_t x, size_t y, unsigned char type, unsigned char value)
+{
+
+    if (!chunks || x >= chunks->width || y >= chunks->height)
+        return false;
+
+    unsigned char * data = chunks_get_chunk(chunks, x / CHUNK_SIZE, y / CHUNK_SIZE, true);
+
+    if (!data)
+        return false;
+
+    size_t offset = (y % CHUNK_SIZE) * CHUNK_SIZE + (x % CHUNK_SIZE);
+
+    data[offset] = type;
+    data[CHUNK_CELLS + offset] = value;
+
+    return true;
+
+}
+
+void chunks_set_focus(chunks_t * chunks, const point_t * points, size_t count, size_t radius)
+{
+
+    if (!chunks)
+        return;
+
+    chunks->focus = memrealloc(chunks->focus, size_t, count ? count : 1);
+    chunks->focus_count = 0;
+    chunks->radius = radius;
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        //  i punti fuori dal mondo non trattengono nessun chunk
+        if (points[i].x < 0 || points[i].y < 0 || points[i].x >= chunks->width || points[i].y >= chunks->height)
+            continue;
+
+        size_t x = (size_t)points[i].x / CHUNK_SIZE;
+        size_t y = (size_t)points[i].y / CHUNK_SIZE;
+
+        chunks->focus[chunks->focus_count++] = y * chunks->columns + x;
+
+    }
+
+}
+
+/**
+ *  Copia una porzione rettangolare del mondo da o verso due griglie (tipi e pesi, per righe)
+ *
+ *  @param chunks Archivio
+ *  @param origin Casella del mondo corrispondente all'angolo in alto a sinistra della porzione
+ *  @param size Dimensione della porzione, in caselle
+ *  @param types Tipi (size.width * size.height)
+ *  @param values Pesi (size.width * size.height)
+ *  @param write true per copiare dalle griglie al mondo
+ *
+ *  @return false se la porzione non è interamente contenuta nel mondo
+ */
+static bool chunks_copy(chunks_t * chunks, point_t origin, dimension_t size, unsigned char * types, unsigned char * values, bool write)
+{
+
+    if (!chunks || origin.x < 0 || origin.y < 0 || size.width < 0 || size.height < 0)
+        return false;
+
+    size_t left = (size_t)origin.x;
+    size_t top = (size_t)origin.y;
+    size_t width = (size_t)size.width;
+    size_t height = (size_t)size.height;
+
+    if (left + width > chunks->width || top + height > chunks->height)
+        return false;
+
+    //  per chunk: ogni chunk è caricato una sola volta e copiato a tratti di riga
+    size_t cy;
+    for (cy = top / CHUNK_SIZE; cy * CHUNK_SIZE < top + height; cy++) {
+
+        size_t y_begin = (cy * CHUNK_SIZE > top) ? cy * CHUNK_SIZE : top;
+        size_t y_end = ((cy + 1) * CHUNK_SIZE < top + height) ? (cy + 1) * CHUNK_SIZE : top + height;
+
+        size_t cx;
+        for (cx = left / CHUNK_SIZE; cx * CHUNK_SIZE < left + width; cx++) {
+
+            size_t x_begin = (cx * CHUNK_SIZE > left) ? cx * CHUNK_SIZE : left;
+            size_t x_end = ((cx + 1) * CHUNK_SIZE < left + width) ? (cx + 1) * CHUNK_SIZE : left + width;
+
+            unsigned char * data = chunks_get_chunk(chunks, cx, cy, write);
+
+            if (!data)
+                return false;
+
+            size_t y;
+            for (y = y_begin; y < y_end; y++) {
+
+                size_t source = (y % CHUNK_SIZE) * CHUNK_SIZE + (x_begin % CHUNK_SIZE);
+                size_t grid = (y - top) * width + (x_begin - left);
+
+                if (write) {
+                    memcpy(&data[source], &types[grid], x_end - x_begin);
+                    memcpy(&data[CHUNK_CELLS + source], &values[grid], x_end - x_begin);
+                } else {
+                    memcpy(&types[grid], &data[source], x_end - x_begin);
+                    memcpy(&values[grid], &data[CHUNK_CELLS + source], x_end - x_begin);
+                }
+
+            }
+
+        }
+
+    }
+
+    return true;
+
+}
+
+bool chunks_read(chunks_t * chunks, point_t origin, dimension_t size, unsigned char * types, unsigned char * values)
+{
+
+    return chunks_copy(chunks, origin, size, types, values, false);
+
+}
+
+bool chunks_write(chunks_t * chunks, point_t origin, dimension_t size, const unsigned char * types, const unsigned char * values)
+{
+
+    //  in scrittura le griglie sono solo lette
+    return chunks_copy(chunks, origin, size, (unsigned char *)types, (unsigned char *)values, true);
+
+}
+
+bool chunks_sink(void * chunks, size_t y, const unsigned char * row, size_t width)
+{
+
+    chunks_t * destination = chunks;
+
+    if (width != destination->width || y >= destination->height)
+        return false;
+
+    size_t cy = y / CHUNK_SIZE;
+    size_t offset = (y % CHUNK_SIZE) * CHUNK_SIZE;
+
+    size_t cx;
+    for (cx = 0; cx < destination->columns; cx++) {
+
+        unsigned char * data = chunks_get_chunk(destination, cx, cy, true);
+
+        if (!data)
+            return false;
+
+        size_t length = width - cx * CHUNK_SIZE;
+
+        if (length > CHUNK_SIZE)
+            length = CHUNK_SIZE;
+
+        memcpy(&data[offset], &row[cx * CHUNK_SIZE], length);
+        memset(&data[CHUNK_CELLS + offset], CellDefaultValue, length);
+
+    }
+
+    return true;
+
+}
+
+void chunks_get_stats(chunks_t * chunks, size_t * resident, size_t * loads, size_t * evictions)
+{
+
+    if (resident)
+        *resident = chunks ? chunks->count : 0;
+
+    if (loads)
+        *loads = chunks ? chunks->loads : 0;
+
+    if (evictions)
+        *evictions = chunks ? chunks->evictions : 0;
+
+}
+
+bool chunks_flush(chunks_t * chunks)
+{
+
+    if (!chunks || !chunks->file)
+        return true;
+
+    bool result = true;
+
+    size_t i;
+    for (i = 0; i < chunks->limit; i++) {
+
+        chunks_slot_t * slot = &chunks->slots[i];
+
+        if (slot->index == CHUNKS_NONE)
+            continue;
+
+#ifndef _WIN32
+        if (slot->mapped) {
+
+            if (slot->dirty && msync(slot->data, CHUNK_BYTES, MS_SYNC) == 0)
+                slot->dirty = false;
+
+            result &= !slot->dirty;
+
+            continue;
+
+        }
+#endif
+
+        result &= chunks_write_slot(chunks, slot);
+
+    }
+
+    return (fflush(chunks->file) == 0) && result;
+
+}
+
+void chunks_delete(chunks_t * chunks)
+{
+
+    if (!chunks)
+        return;
+
+    debugf("[Chunks] %zu chunk caricati, %zu rilasciati\n", chunks->loads, chunks->evictions);
+
+    size_t i;
+    for (i = 0; i < chunks->limit; i++) {
+
+        chunks_release(chunks, &chunks->slots[i]);
+        memfree(chunks->slots[i].data);
+
+    }
+
+    if (chunks->file)
+        fclose(chunks->file);
+
+    memfree(chunks->focus);
+    memfree(chunks->table);
+    memfree(chunks->slots);
+    memfree(chunks);
+
+}
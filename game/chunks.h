@@ -0,0 +1,218 @@
+#ifndef game_chunks_h
+#define game_chunks_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc/geometry.h"
+
+#include "game/structs.h"
+
+/**
+ *  Archivio a blocchi (chunk) per mappe più grandi della memoria.
+ *
+ *  Il mondo è diviso in chunk di CHUNK_SIZE x CHUNK_SIZE caselle, ciascuno con tipi e pesi
+ *  delle proprie caselle. Solo un numero limitato di chunk è residente: gli altri sono
+ *  caricati al primo accesso da un file (mappato in memoria dove possibile) o generati
+ *  da una funzione, e i chunk meno utilizzati di recente sono rilasciati, preferendo
+ *  quelli lontani da tutti i punti di interesse (es. i personaggi, vedi chunks_set_focus).
+ *
+ *  La mappa di gioco (map_t) resta una finestra completamente residente del mondo:
+ *  chunks_read vi copia una porzione dell'archivio, sulla quale funzionano
+ *  senza modifiche ricerca dei percorsi e disegno (vedi game/world.h).
+ */
+typedef struct chunks_s chunks_t;
+
+/**
+ *  Lato di un chunk, in caselle
+ */
+#define CHUNK_SIZE      64
+
+/**
+ *  Numero di caselle di un chunk
+ */
+#define CHUNK_CELLS     (CHUNK_SIZE * CHUNK_SIZE)
+
+/**
+ *  Funzione che genera il contenuto di un chunk non presente nell'archivio.
+ *  Il risultato deve dipendere solo dalle coordinate del chunk: un chunk rilasciato
+ *  è generato di nuovo al successivo accesso.
+ *
+ *  @param data Dati dell'utente
+ *  @param chunk_x Colonna del chunk
+ *  @param chunk_y Riga del chunk
+ *  @param types Tipi delle caselle (CHUNK_CELLS, per righe)
+ *  @param values Pesi delle caselle (CHUNK_CELLS, per righe)
+ */
+typedef void (* chunks_generate_function)(void * data, size_t chunk_x, size_t chunk_y, unsigned char * types, unsigned char * values);
+
+/**
+ *  Creazione di un archivio i cui chunk sono generati su richiesta.
+ *  Le modifiche ad un chunk sono perse quando il chunk viene rilasciato.
+ *
+ *  @param width Larghezza del mondo, in caselle
+ *  @param height Altezza del mondo, in caselle
+ *  @param limit Numero massimo di chunk residenti
+ *  @param generate Funzione di generazione dei chunk
+ *  @param data Dati passati a generate
+ *
+ *  @return Archivio
+ */
+chunks_t * chunks_new(size_t width, size_t height, size_t limit, chunks_generate_function generate, void * data);
+
+/**
+ *  Apertura (o creazione) di un archivio su file.
+ *  Le modifiche sono scritte sul file quando un chunk viene rilasciato o con chunks_flush.
+ *  In creazione il file non occupa spazio su disco per i chunk mai scritti.
+ *
+ *  @param path Percorso del file (NULL per un file temporaneo, sempre creato e rimosso alla chiusura)
+ *  @param width Larghezza del mondo, in caselle (solo in creazione)
+ *  @param height Altezza del mondo, in caselle (solo in creazione)
+ *  @param limit Numero massimo di chunk residenti
+ *  @param create Se true il file è creato (o svuotato)
+ *
+ *  @return Archivio
+ *  @retval NULL Se il file non esiste, non è valido o non può essere creato
+ */
+chunks_t * chunks_open(const char * path, size_t width, size_t height, size_t limit, bool create);
+
+/**
+ *  Imposta la funzione di generazione dei chunk di un archivio su file non ancora scritti
+ *  (composti solo da CELL_TYPE_UNKNOWN): sono generati al primo accesso e, una volta
+ *  modificati, salvati sul file come gli altri
+ *
+ *  @param chunks Archivio (creato con chunks_open)
+ *  @param generate Funzione di generazione dei chunk
+ *  @param data Dati passati a generate
+ */
+void chunks_set_generator(chunks_t * chunks, chunks_generate_function generate, void * data);
+
+/**
+ *  Dimensione del mondo, in caselle
+ *
+ *  @param chunks Archivio
+ *
+ *  @return Dimensione
+ */
+dimension_t chunks_get_size(chunks_t * chunks);
+
+/**
+ *  Accesso ad un chunk, caricato se non residente.
+ *  Il puntatore resta valido fino al prossimo accesso ad un chunk non residente.
+ *
+ *  @param chunks Archivio
+ *  @param chunk_x Colonna del chunk
+ *  @param chunk_y Riga del chunk
+ *  @param modify Se true il chunk sarà modificato (e va salvato al rilascio)
+ *
+ *  @return Tipi delle caselle del chunk (CHUNK_CELLS), seguiti dai relativi pesi
+ *  @retval NULL Se il chunk è fuori dal mondo o non può essere caricato
+ */
+unsigned char * chunks_get_chunk(chunks_t * chunks, size_t chunk_x, size_t chunk_y, bool modify);
+
+/**
+ *  Legge tipo e peso di una casella
+ *
+ *  @param chunks Archivio
+ *  @param x Colonna della casella
+ *  @param y Riga della casella
+ *  @param type Destinazione del tipo (CELL_TYPE_*)
+ *  @param value Destinazione del peso (può essere NULL)
+ *
+ *  @return false se la casella è fuori dal mondo
+ */
+bool chunks_get_cell(chunks_t * chunks, size_t x, size_t y, unsigned char * type, unsigned char * value);
+
+/**
+ *  Imposta tipo e peso di una casella
+ *
+ *  @param chunks Archivio
+ *  @param x Colonna della casella
+ *  @param y Riga della casella
+ *  @param type Tipo (CELL_TYPE_*)
+ *  @param value Peso
+ *
+ *  @return false se la casella è fuori dal mondo
+ */
+bool chunks_set_cell(chunks_t * chunks, size_t x, size_t y, unsigned char type, unsigned char value);
+
+/**
+ *  Imposta i punti di interesse (es. le posizioni dei personaggi, in caselle):
+ *  i chunk entro radius chunk da uno di essi sono rilasciati solo se non ce ne sono altri
+ *
+ *  @param chunks Archivio
+ *  @param points Punti di interesse
+ *  @param count Numero di punti
+ *  @param radius Distanza, in chunk, entro la quale un chunk è vicino ad un punto
+ */
+void chunks_set_focus(chunks_t * chunks, const point_t * points, size_t count, size_t radius);
+
+/**
+ *  Copia una porzione rettangolare del mondo (tipi e pesi, per righe), ad esempio
+ *  nella griglia di una mappa (le adiacenze vanno poi ricalcolate, vedi map_grid_reload)
+ *
+ *  @param chunks Archivio
+ *  @param origin Casella del mondo corrispondente all'angolo in alto a sinistra della porzione
+ *  @param size Dimensione della porzione, in caselle
+ *  @param types Destinazione dei tipi (size.width * size.height)
+ *  @param values Destinazione dei pesi (size.width * size.height)
+ *
+ *  @return false se la porzione non è interamente contenuta nel mondo
+ */
+bool chunks_read(chunks_t * chunks, point_t origin, dimension_t size, unsigned char * types, unsigned char * values);
+
+/**
+ *  Scrive nel mondo una porzione rettangolare (tipi e pesi, per righe), ad esempio
+ *  la griglia di una mappa letta con chunks_read e poi modificata
+ *
+ *  @param chunks Archivio
+ *  @param origin Casella del mondo corrispondente all'angolo in alto a sinistra della porzione
+ *  @param size Dimensione della porzione, in caselle
+ *  @param types Tipi (size.width * size.height)
+ *  @param values Pesi (size.width * size.height)
+ *
+ *  @return false se la porzione non è interamente contenuta nel mondo
+ */
+bool chunks_write(chunks_t * chunks, point_t origin, dimension_t size, const unsigned char * types, const unsigned char * values);
+
+/**
+ *  Sink di maze_generate: scrive le righe di un labirinto nell'archivio (peso di default).
+ *  Per non rilasciare chunk ancora incompleti il limite di chunk residenti deve essere
+ *  almeno pari ad una riga di chunk (larghezza / CHUNK_SIZE, per eccesso).
+ *
+ *  @param chunks Archivio (chunks_t *)
+ *  @param y Indice della riga
+ *  @param row Tipi delle caselle della riga
+ *  @param width Numero di caselle della riga
+ *
+ *  @return false se la riga non è contenuta nel mondo
+ */
+bool chunks_sink(void * chunks, size_t y, const unsigned char * row, size_t width);
+
+/**
+ *  Statistiche di utilizzo dell'archivio
+ *
+ *  @param chunks Archivio
+ *  @param resident Destinazione del numero di chunk residenti (può essere NULL)
+ *  @param loads Destinazione del numero di chunk caricati (può essere NULL)
+ *  @param evictions Destinazione del numero di chunk rilasciati (può essere NULL)
+ */
+void chunks_get_stats(chunks_t * chunks, size_t * resident, size_t * loads, size_t * evictions);
+
+/**
+ *  Scrive sul file i chunk modificati
+ *
+ *  @param chunks Archivio
+ *
+ *  @return false in caso di errore di scrittura
+ */
+bool chunks_flush(chunks_t * chunks);
+
+/**
+ *  Chiusura di un archivio (i chunk modificati sono scritti sul file)
+ *
+ *  @param chunks Archivio
+ */
+void chunks_delete(chunks_t * chunks);
+
+#endif  // game_chunks_h
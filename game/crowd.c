@@ -0,0 +1,469 @@
+#include <string.h>
+
+//  kernel vettoriali scelti in compilazione (es. -mavx2, vedi l'opzione AVX2 di CMake),
+//  altrimenti i cicli scalari
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "utils.h"
+
+#include "game/crowd.h"
+#include "game/character.h"
+#include "game/game.h"
+#include "game/map.h"
+
+crowd_t * crowd_new(void)
+{
+
+    return memalloc(crowd_t, 1, true);
+
+}
+
+/**
+ *  Garantisce agli array del gruppo la capacità per almeno count avversari
+ *
+ *  @param crowd Gruppo
+ *  @param count Numero di avversari
+ */
+static void crowd_reserve(crowd_t * crowd, size_t count)
+{
+
+    if (count <= crowd->capacity)
+        return;
+
+    size_t capacity = crowd->capacity ? crowd->capacity : 16;
+
+    while (capacity < count)
+        capacity *= 2;
+
+    crowd->characters = memrealloc(crowd->characters, character_t *, capacity);
+    crowd->maps = memrealloc(crowd->maps, map_t *, capacity);
+
+    fixed_t ** planes[] = {
+        &crowd->x, &crowd->y, &crowd->previous_x, &crowd->previous_y,
+        &crowd->from_x, &crowd->from_y, &crowd->to_x, &crowd->to_y,
+        &crowd->ratio, &crowd->step, &crowd->lead_x, &crowd->lead_y
+    };
+
+    size_t i;
+    for (i = 0; i < array_count(planes); i++)
+        *planes[i] = memrealloc(*planes[i], fixed_t, capacity);
+
+    crowd->blocked = memrealloc(crowd->blocked, bool, capacity);
+
+    crowd->capacity = capacity;
+
+}
+
+/**
+ *  Aggiunge al gruppo un avversario che si sposta verso la prossima cella del percorso
+ *
+ *  @param crowd Gruppo
+ *  @param character Avversario
+ *  @param next Prossima cella del percorso
+ */
+static void crowd_add(crowd_t * crowd, character_t * character, map_cell_t * next)
+{
+
+    crowd_reserve(crowd, crowd->count + 1);
+
+    size_t i = crowd->count++;
+
+    fixed_point_t to = cell_location_to_fixed(next->location);
+
+    crowd->characters[i] = character;
+    crowd->maps[i] = character->map;
+
+    crowd->x[i] = crowd->previous_x[i] = character->fixed_position.x;
+    crowd->y[i] = crowd->previous_y[i] = character->fixed_position.y;
+
+    crowd->from_x[i] = character->last_position.x;
+    crowd->from_y[i] = character->last_position.y;
+
+    crowd->to_x[i] = to.x;
+    crowd->to_y[i] = to.y;
+
+    crowd->ratio[i] = character->ratio;
+    crowd->step[i] = FixedFromFloat(character_get_speed(character) * TIMER_FREQUENCY);
+
+    //  character_wall controlla la cella successiva a quella della posizione verso est e sud
+    crowd->lead_x[i] = character->direction == DIRECTION_EAST ? FIXED_ONE : 0;
+    crowd->lead_y[i] = character->direction == DIRECTION_SOUTH ? FIXED_ONE : 0;
+
+}
+
+#if defined(__AVX2__)
+
+/**
+ *  FixedLerp su 8 valori: i prodotti sono calcolati a 64 bit, separatamente per le
+ *  corsie pari e dispari. Lo scorrimento logico dà gli stessi 32 bit meno significativi
+ *  di quello aritmetico, per cui il risultato è identico a quello scalare
+ *
+ *  @param a Primi valori
+ *  @param b Secondi valori
+ *  @param t Avanzamenti, in [0, FIXED_ONE]
+ *
+ *  @return Valori interpolati
+ */
+sinline __m256i crowd_lerp(__m256i a, __m256i b, __m256i t)
+{
+
+    __m256i difference = _mm256_sub_epi32(b, a);
+
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(difference, t), FIXED_SHIFT);
+    __m256i odd = _mm256_srli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(difference, 32), _mm256_srli_epi64(t, 32)), FIXED_SHIFT);
+
+    return _mm256_add_epi32(a, _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA));
+
+}
+
+#elif defined(__SSE2__)
+
+/**
+ *  FixedLerp su 4 valori. SSE2 ha solo il prodotto senza segno: per le differenze
+ *  negative (in complemento a 2) il prodotto eccede di t * 2^32, cioè di t << 16
+ *  dopo lo scorrimento, che va sottratto
+ *
+ *  @param a Primi valori
+ *  @param b Secondi valori
+ *  @param t Avanzamenti, in [0, FIXED_ONE]
+ *
+ *  @return Valori interpolati
+ */
+sinline __m128i crowd_lerp(__m128i a, __m128i b, __m128i t)
+{
+
+    __m128i difference = _mm_sub_epi32(b, a);
+
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(difference, t), FIXED_SHIFT);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(difference, 32), _mm_srli_epi64(t, 32)), FIXED_SHIFT);
+
+    __m128i product = _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(odd, 32));
+
+    __m128i correction = _mm_and_si128(_mm_srai_epi32(difference, 31), _mm_slli_epi32(t, FIXED_SHIFT));
+
+    return _mm_add_epi32(a, _mm_sub_epi32(product, correction));
+
+}
+
+#endif
+
+/**
+ *  Avanzamento di tutti gli avversari verso la prossima cella (vedi character_move_to_cell),
+ *  8 (AVX2) o 4 (SSE2) alla volta
+ *
+ *  @param crowd Gruppo
+ */
+static void crowd_advance(crowd_t * crowd)
+{
+
+    //  copie locali: gli array non si sovrappongono
+    fixed_t * restrict x = crowd->x;
+    fixed_t * restrict y = crowd->y;
+    fixed_t * restrict ratio = crowd->ratio;
+    const fixed_t * restrict step = crowd->step;
+    const fixed_t * restrict from_x = crowd->from_x;
+    const fixed_t * restrict from_y = crowd->from_y;
+    const fixed_t * restrict to_x = crowd->to_x;
+    const fixed_t * restrict to_y = crowd->to_y;
+
+    size_t count = crowd->count;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(FIXED_ONE);
+
+    for (; i + 8 <= count; i += 8) {
+
+        __m256i value = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(ratio + i)), _mm256_loadu_si256((const __m256i *)(step + i)));
+        value = _mm256_min_epi32(_mm256_max_epi32(value, zero), one);
+
+        _mm256_storeu_si256((__m256i *)(ratio + i), value);
+        _mm256_storeu_si256((__m256i *)(x + i), crowd_lerp(_mm256_loadu_si256((const __m256i *)(from_x + i)), _mm256_loadu_si256((const __m256i *)(to_x + i)), value));
+        _mm256_storeu_si256((__m256i *)(y + i), crowd_lerp(_mm256_loadu_si256((const __m256i *)(from_y + i)), _mm256_loadu_si256((const __m256i *)(to_y + i)), value));
+
+    }
+
+#elif defined(__SSE2__)
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(FIXED_ONE);
+
+    for (; i + 4 <= count; i += 4) {
+
+        __m128i value = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(ratio + i)), _mm_loadu_si128((const __m128i *)(step + i)));
+
+        //  senza min/max sugli interi (SSE4.1): confronti e maschere
+        value = _mm_and_si128(value, _mm_cmpgt_epi32(value, zero));
+
+        __m128i over = _mm_cmpgt_epi32(value, one);
+        value = _mm_or_si128(_mm_andnot_si128(over, value), _mm_and_si128(over, one));
+
+        _mm_storeu_si128((__m128i *)(ratio + i), value);
+        _mm_storeu_si128((__m128i *)(x + i), crowd_lerp(_mm_loadu_si128((const __m128i *)(from_x + i)), _mm_loadu_si128((const __m128i *)(to_x + i)), value));
+        _mm_storeu_si128((__m128i *)(y + i), crowd_lerp(_mm_loadu_si128((const __m128i *)(from_y + i)), _mm_loadu_si128((const __m128i *)(to_y + i)), value));
+
+    }
+
+#endif
+
+    //  avversari rimanenti (o tutti, senza istruzioni vettoriali)
+    for (; i < count; i++) {
+
+        fixed_t value = ratio[i] + step[i];
+
+        value = value < 0 ? 0 : value;
+        value = value > FIXED_ONE ? FIXED_ONE : value;
+
+        ratio[i] = value;
+        x[i] = FixedLerp(from_x[i], to_x[i], value);
+        y[i] = FixedLerp(from_y[i], to_y[i], value);
+
+    }
+
+}
+
+/**
+ *  Controllo delle mura per gli avversari in [from, to), uno alla volta
+ *
+ *  @param crowd Gruppo
+ *  @param from Primo avversario
+ *  @param to Avversario successivo all'ultimo
+ */
+static void crowd_walls_range(crowd_t * crowd, size_t from, size_t to)
+{
+
+    size_t i;
+    for (i = from; i < to; i++) {
+
+        map_t * map = crowd->maps[i];
+
+        int32_t column = FixedFloor(crowd->x[i] + crowd->lead_x[i]);
+        int32_t row = FixedFloor(crowd->y[i] + crowd->lead_y[i]);
+
+        bool valid = column >= 0 && row >= 0 && column < (int32_t)map->size.width && row < (int32_t)map->size.height;
+
+        crowd->blocked[i] = !valid || map->types[(size_t)row * (size_t)map->size.width + (size_t)column] != CELL_TYPE_PATH;
+
+    }
+
+}
+
+#if defined(__AVX2__) || defined(__SSE2__)
+
+/**
+ *  Controlla se un gruppo di avversari consecutivi si trova nella stessa mappa
+ *
+ *  @param maps Mappe degli avversari
+ *  @param count Numero di avversari
+ *
+ *  @return true se la mappa è la stessa per tutti
+ */
+static bool crowd_same_map(map_t ** maps, size_t count)
+{
+
+    size_t i;
+    for (i = 1; i < count; i++) {
+
+        if (maps[i] != maps[0])
+            return false;
+
+    }
+
+    return true;
+
+}
+
+#endif
+
+/**
+ *  Individua gli avversari per i quali la cella controllata da character_wall (quella della
+ *  posizione, o la successiva verso est e sud) non è un corridoio: solo per questi va eseguito
+ *  character_wall, per gli altri non avrebbe effetti.
+ *  Celle e appartenenza alla mappa sono calcolate 8 (AVX2) o 4 (SSE2) avversari alla volta,
+ *  con AVX2 anche la lettura dei tipi (gather)
+ *
+ *  @param crowd Gruppo
+ */
+static void crowd_walls(crowd_t * crowd)
+{
+
+    size_t count = crowd->count;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+
+    const __m256i outside = _mm256_set1_epi32(-1);
+    const __m256i type_mask = _mm256_set1_epi32(0xFF);
+    const __m256i path = _mm256_set1_epi32(CELL_TYPE_PATH);
+
+    for (; i + 8 <= count; i += 8) {
+
+        //  avversari in mappe diverse: controllo scalare
+        if (!crowd_same_map(crowd->maps + i, 8)) {
+            crowd_walls_range(crowd, i, i + 8);
+            continue;
+        }
+
+        map_t * map = crowd->maps[i];
+
+        __m256i width = _mm256_set1_epi32((int)map->size.width);
+        __m256i height = _mm256_set1_epi32((int)map->size.height);
+
+        //  celle: parte intera delle coordinate, spostate sulla cella controllata da character_wall
+        __m256i column = _mm256_srai_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(crowd->x + i)),
+                                                            _mm256_loadu_si256((const __m256i *)(crowd->lead_x + i))), FIXED_SHIFT);
+        __m256i row = _mm256_srai_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(crowd->y + i)),
+                                                         _mm256_loadu_si256((const __m256i *)(crowd->lead_y + i))), FIXED_SHIFT);
+
+        __m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(column, outside), _mm256_cmpgt_epi32(row, outside)),
+                                          _mm256_and_si256(_mm256_cmpgt_epi32(width, column), _mm256_cmpgt_epi32(height, row)));
+
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(row, width), column);
+
+        //  lettura di 4 byte per tipo, solo per le celle nella mappa: oltre l'ultimo tipo
+        //  ci sono pesi e adiacenze, nello stesso blocco (vedi map_grid_allocate)
+        __m256i types = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)map->types, index, inside, 1);
+
+        __m256i is_path = _mm256_cmpeq_epi32(_mm256_and_si256(types, type_mask), path);
+
+        int open = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(inside, is_path)));
+
+        size_t k;
+        for (k = 0; k < 8; k++)
+            crowd->blocked[i + k] = !(open & (1 << k));
+
+    }
+
+#elif defined(__SSE2__)
+
+    const __m128i outside = _mm_set1_epi32(-1);
+
+    for (; i + 4 <= count; i += 4) {
+
+        if (!crowd_same_map(crowd->maps + i, 4)) {
+            crowd_walls_range(crowd, i, i + 4);
+            continue;
+        }
+
+        map_t * map = crowd->maps[i];
+
+        __m128i width = _mm_set1_epi32((int)map->size.width);
+        __m128i height = _mm_set1_epi32((int)map->size.height);
+
+        __m128i column = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(crowd->x + i)),
+                                                      _mm_loadu_si128((const __m128i *)(crowd->lead_x + i))), FIXED_SHIFT);
+        __m128i row = _mm_srai_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(crowd->y + i)),
+                                                   _mm_loadu_si128((const __m128i *)(crowd->lead_y + i))), FIXED_SHIFT);
+
+        __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(column, outside), _mm_cmpgt_epi32(row, outside)),
+                                       _mm_and_si128(_mm_cmpgt_epi32(width, column), _mm_cmpgt_epi32(height, row)));
+
+        int valid = _mm_movemask_ps(_mm_castsi128_ps(inside));
+
+        //  senza gather (e prodotto tra interi a 32 bit): tipi letti uno alla volta
+        int32_t columns[4], rows[4];
+        _mm_storeu_si128((__m128i *)columns, column);
+        _mm_storeu_si128((__m128i *)rows, row);
+
+        size_t k;
+        for (k = 0; k < 4; k++) {
+            crowd->blocked[i + k] = !(valid & (1 << k)) ||
+                                    map->types[(size_t)rows[k] * (size_t)map->size.width + (size_t)columns[k]] != CELL_TYPE_PATH;
+        }
+
+    }
+
+#endif
+
+    //  avversari rimanenti (o tutti, senza istruzioni vettoriali)
+    crowd_walls_range(crowd, i, count);
+
+}
+
+void crowd_update(game_t * game, crowd_t * crowd, list_t * characters)
+{
+
+    crowd->count = 0;
+
+    //  1. decisioni (per personaggio) e raccolta dello stato di chi si sposta, copiato mentre
+    //  il personaggio è già in cache per le decisioni (non è un passaggio in più sugli avversari)
+    foreach(characters, character_t *, character) {
+
+        if (!character || character->is_user)
+            continue;
+
+        map_cell_t * next = character_ai_prepare(game, character);
+
+        if (next)
+            crowd_add(crowd, character, next);
+
+    }
+
+    //  2. avanzamento e controllo delle mura, in blocco: dipendono solo dallo stato di ogni
+    //  avversario e dalla mappa (le mura abbattute nel passo 3 sono ricontrollate da character_wall)
+    crowd_advance(crowd);
+    crowd_walls(crowd);
+
+    //  3. per ogni avversario, nell'ordine di character_control_ai: nuova posizione (scritta nel
+    //  personaggio solo ora, insieme agli accessi di character_move), mura solo per chi ne ha
+    //  incontrata una, collisioni, cella, bonus e fine della mappa. Le collisioni vedono gli
+    //  avversari successivi ancora nella posizione precedente, come se si spostassero uno alla volta.
+    //  L'unica differenza è che le decisioni del passo 1 precedono tutti gli spostamenti: un
+    //  avversario riposizionato dalla collisione con uno precedente non si sposta e sceglie il
+    //  nuovo percorso all'aggiornamento successivo (con character_control_ai lo sceglierebbe subito,
+    //  senza comunque spostarsi)
+    size_t i;
+    for (i = 0; i < crowd->count; i++) {
+
+        character_t * character = crowd->characters[i];
+
+        fixed_point_t last_position = FixedPointMake(crowd->previous_x[i], crowd->previous_y[i]);
+
+        //  riposizionato dalla collisione con un avversario precedente: l'avanzamento è
+        //  stato calcolato da una posizione che non è più la sua
+        if (!character->path || !FixedPointEqualToPoint(character->fixed_position, last_position))
+            continue;
+
+        character->ratio = crowd->ratio[i];
+        character_set_position(character, FixedPointMake(crowd->x[i], crowd->y[i]));
+
+        if (crowd->blocked[i])
+            character_wall(game, character);
+
+        character_move(game, character, last_position);
+        character_ai_arrive(game, character);
+
+    }
+
+}
+
+void crowd_delete(crowd_t * crowd)
+{
+
+    if (!crowd)
+        return;
+
+    memfree(crowd->characters);
+    memfree(crowd->maps);
+    memfree(crowd->x);
+    memfree(crowd->y);
+    memfree(crowd->previous_x);
+    memfree(crowd->previous_y);
+    memfree(crowd->from_x);
+    memfree(crowd->from_y);
+    memfree(crowd->to_x);
+    memfree(crowd->to_y);
+    memfree(crowd->ratio);
+    memfree(crowd->step);
+    memfree(crowd->lead_x);
+    memfree(crowd->lead_y);
+    memfree(crowd->blocked);
+    memfree(crowd);
+
+}
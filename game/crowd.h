@@ -0,0 +1,105 @@
+#ifndef game_crowd_h
+#define game_crowd_h
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "std/list.h"
+
+#include "misc/fixed.h"
+
+#include "game/structs.h"
+
+/**
+ *  Spostamento in blocco degli avversari di un livello.
+ *
+ *  Lo stato usato ad ogni aggiornamento (posizioni, avanzamento, velocità, prossima cella
+ *  del percorso) è copiato in array distinti, uno per componente: avanzamento e controllo
+ *  delle mura sono cicli stretti su questi array. Decisioni, collisioni e tutto ciò che
+ *  ha effetti collaterali restano per personaggio, solo per chi ne ha bisogno.
+ *
+ *  character_t resta il proprietario dello stato (letto da disegno, bonus, percorsi e
+ *  collisioni), per cui gli array sono ricostruiti ad ogni aggiornamento: la copia avviene
+ *  durante le decisioni e la scrittura dei risultati durante lo spostamento di ogni avversario,
+ *  che accedono comunque al personaggio.
+ */
+struct crowd_s {
+
+    /** Numero di avversari che si spostano nell'aggiornamento corrente */
+    size_t count;
+
+    /** Capacità degli array */
+    size_t capacity;
+
+    /** Avversari */
+    character_t ** characters;
+
+    /** Mappa di ogni avversario */
+    map_t ** maps;
+
+    /** Posizione, in celle a virgola fissa (x) */
+    fixed_t * x;
+
+    /** Posizione, in celle a virgola fissa (y) */
+    fixed_t * y;
+
+    /** Posizione prima dello spostamento (x) */
+    fixed_t * previous_x;
+
+    /** Posizione prima dello spostamento (y) */
+    fixed_t * previous_y;
+
+    /** Punto di partenza verso la prossima cella (x) */
+    fixed_t * from_x;
+
+    /** Punto di partenza verso la prossima cella (y) */
+    fixed_t * from_y;
+
+    /** Posizione della prossima cella del percorso (x) */
+    fixed_t * to_x;
+
+    /** Posizione della prossima cella del percorso (y) */
+    fixed_t * to_y;
+
+    /** Avanzamento verso la prossima cella, in [0, FIXED_ONE] */
+    fixed_t * ratio;
+
+    /** Incremento dell'avanzamento ad ogni aggiornamento */
+    fixed_t * step;
+
+    /** Scostamento della cella controllata da character_wall (x): FIXED_ONE verso est, altrimenti 0 */
+    fixed_t * lead_x;
+
+    /** Scostamento della cella controllata da character_wall (y): FIXED_ONE verso sud, altrimenti 0 */
+    fixed_t * lead_y;
+
+    /** Se true la cella controllata da character_wall non è un corridoio o è fuori dalla mappa */
+    bool * blocked;
+
+};
+
+/**
+ *  Creazione di un gruppo, vuoto
+ *
+ *  @return Gruppo
+ */
+crowd_t * crowd_new(void);
+
+/**
+ *  Aggiornamento degli avversari di un livello, equivalente alla gestione di ognuno con
+ *  character_control_ai ma con avanzamento e controllo delle mura eseguiti in blocco
+ *
+ *  @param game Contesto di gioco
+ *  @param crowd Gruppo
+ *  @param characters Avversari (character_t *)
+ */
+void crowd_update(game_t * game, crowd_t * crowd, list_t * characters);
+
+/**
+ *  Deallocazione di un gruppo
+ *
+ *  @param crowd Gruppo
+ */
+void crowd_delete(crowd_t * crowd);
+
+#endif  // game_crowd_h
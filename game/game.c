@@ -7,7 +7,9 @@
 #include "game/game.h"
 #include "game/level.h"
 #include "game/map.h"
+#include "game/crowd.h"
 #include "game/powerup.h"
+#include "game/world.h"
 
 #include "config/config.h"
 
@@ -20,13 +22,12 @@
  */
 void game_perform_level_transition(game_t * game) {
     
-    //  si estrae il livello attuale dalla coda
-    level_t * level = queue_pop(game->levels);
+    //  livello attuale, deallocato da levels_next
+    level_t * level = game_get_current_level(game);
     level_uninstall(game, level);
-    level_delete(level);
-    
+
     //  nuovo livello corrente
-    level = game_get_current_level(game);
+    level = levels_next(game, game->levels);
     level_setup(game, level);
     
     character_decide_direction_user(game_get_user(game));
@@ -68,7 +69,7 @@ void game_handle_next_level(game_t * game, event_t evt)
     if (character->is_user) {
 
         //  se c'è un livello dopo quello attuale, si avanza
-        if (list_length(game->levels) > 1) {
+        if (levels_has_next(game, game->levels)) {
 
             game_set_paused(game);
 
@@ -207,6 +208,13 @@ void game_handle_key_down(game_t * game, event_t evt)
         case KYB_KEY_1:
             audio_toggle_mute(game);
             break;
+
+#ifdef MEMORY_ACCOUNTING
+        //  report sull'utilizzo della memoria
+        case KYB_KEY_2:
+            memory_report(stdout);
+            break;
+#endif
         
         //  riavvio il gioco in caso di game over
         case KYB_KEY_ENTER:
@@ -282,6 +290,9 @@ void game_handle_redraw(game_t * game, event_t e)
 
     character_t * user = game_get_user(game);
 
+    //  la finestra di un mondo segue l'utente
+    world_update(game, user->map);
+
     //  ridisegna la mappa
     map_update(game, user->map);
 
@@ -295,13 +306,12 @@ void game_handle_redraw(game_t * game, event_t e)
     //  livello corrente
     level_t * level = game_get_current_level(game);
     
-    foreach(level->enemies, character_t *, character) {
-
-        if (game_is_running(game))
-            character->methods.control(game, character);
+    //  spostamento degli avversari, in blocco
+    if (game_is_running(game))
+        crowd_update(game, level->crowd, level->enemies);
 
+    foreach(level->enemies, character_t *, character) {
         character_redraw(game, character);
-
     }
 
     //  area visibile
@@ -347,7 +357,7 @@ void game_handle_redraw(game_t * game, event_t e)
 level_t * game_get_current_level(game_t * game)
 {
     
-    return queue_head(game->levels);
+    return levels_current(game->levels);
     
 }
 
@@ -369,12 +379,10 @@ game_t * game_initialize(hashtable_t * config)
     game->mute = false;
     
     //  caricamento delle configurazioni
-    list_t * levels = levels_load(game, config);
+    levels_t * levels = levels_load(game, config);
 
     //  nessun livello caricato
-    if (!levels || !list_length(levels)) {
-        
-        list_delete(levels);
+    if (!levels) {
         
         game_destroy(game);
         
@@ -394,7 +402,7 @@ game_t * game_initialize(hashtable_t * config)
     }
 
     //  personaggio dell'utente (primo della lista dei personaggi caricati)
-    game->user = character_load(user_character_config, 1);
+    game->user = character_load(user_character_config, "user", 1);
 
     if (!game->user) {
         game_destroy(game);
@@ -483,18 +491,7 @@ void game_destroy(game_t * game)
         return;
 
     //  1. deallocazione livelli
-    if (game->levels) {
-        
-        while (!queue_empty(game->levels)) {
-            
-            level_t * level = queue_pop(game->levels);
-
-            level_delete(level);
-        }
-        
-        queue_delete(game->levels);
-        
-    }
+    levels_delete(game->levels);
 
     //  2. deallocazione personaggio dell'utente
     character_delete(game->user);
@@ -571,7 +568,7 @@ void game_set_over(game_t * game, bool won)
 void game_set_started(game_t * game) {
     
     //  primo livello
-    level_setup(game, list_head(game->levels));
+    level_setup(game, levels_current(game->levels));
     
     //  flags di avvio
     game_set_state(game, GAME_STATE_STARTED | GAME_STATE_RUNNING);
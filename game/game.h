@@ -54,8 +54,8 @@ struct game_s {
     /** Stato del gioco: in pausa/in gioco */
     int state;
 
-    /** Lista dei livelli caricati nella fase iniziale */
-    queue_t * levels;
+    /** Livelli (è residente solo il livello corrente) */
+    levels_t * levels;
 
     /** Personaggio controllato dall'utente */
     character_t * user;
@@ -89,6 +89,9 @@ struct game_s {
     
     /** Muto */
     bool mute;
+
+    /** Aggiornamento della configurazione durante il gioco (NULL se non attivo) */
+    reload_t * reload;
     
 };
 
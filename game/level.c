@@ -1,13 +1,18 @@
 #include "game/level.h"
 #include "game/map.h"
+#include "game/crowd.h"
 #include "game/game.h"
+#include "game/reload.h"
+#include "game/world.h"
 
 #include "config/config.h"
+#include "config/config_schema.h"
 
 #include "main/audio.h"
 #include "main/drawing.h"
 #include "main/fs.h"
 #include "main/graphics.h"
+#include "main/thread.h"
 
 #include "misc/random.h"
 
@@ -67,6 +72,10 @@ void level_handle_animation_event(game_t * game, event_t evt)
         character_t * user = game_get_user(game);
         
         character_clear_path(user);
+
+        //  la mappa lasciata non è più disegnata: la sua immagine di sfondo e mura
+        //  (grande quanto la mappa) non resta in memoria fino alla fine del livello
+        map_layer_release(user->map);
         
         //character_goto_next_map(game, user);
         character_set_map(user, user->map->next);
@@ -115,7 +124,15 @@ void level_setup(game_t * game, level_t * level)
     
     //  posizionamento
     map_place_enemies(level, first);
+
+    //  spostamento in blocco degli avversari
+    if (!level->crowd)
+        level->crowd = crowd_new();
     
+    //  caricamento musica
+    if (level->audio && !hashtable_search(game->audio_samples, level->name))
+        audio_sample_load(level->audio, game->audio_samples, level->name);
+
     //  avvio musica
     audio_sample_t * audio = hashtable_search(game->audio_samples, level->name);
 
@@ -136,137 +153,162 @@ void level_uninstall(game_t * game, level_t * level)
     //  stop musica
     audio_sample_t * audio = hashtable_search(game->audio_samples, level->name);
 
-    if (audio)
+    if (audio) {
+
         audio_sample_stop(audio);
 
+        //  la traccia sarà ricaricata solo se si torna al livello
+        hashtable_remove(game->audio_samples, level->name);
+
+    }
+
 }
 
 /**
- *  Creazione di un nuovo livello caricando il file di configurazione _config_file_path_
- *  presente nella cartella _level_dir_.
- *
- *  @param game Contesto di gioco
- *  @param level_dir Cartella contenente il file di configurazione del livello
- *  @param config_file_path File di configurazione del livello
- *
- *  @return Livello
+ *  Caricamento di un livello.
+ *  La parte che impegna la CPU (configurazione, immagini in memoria, personaggi, mappe)
+ *  è eseguita da level_load, anche in un thread secondario; la parte che utilizza
+ *  la scheda video o lo stato del gioco da level_finalize, nel thread principale.
+ */
+typedef struct level_job_s {
+
+    /** Cartella contenente il file di configurazione del livello */
+    char * level_dir;
+
+    /** File di configurazione del livello */
+    char * config_file_path;
+
+    /** Generatore di numeri casuali del caricamento, lo rende riproducibile */
+    random_t random;
+
+    /** Configurazione del livello, deallocata da level_finalize */
+    hashtable_t * config;
+
+    /** Immagine dello sfondo, tinteggiata da level_finalize */
+    image_t * background;
+
+    /** Livello caricato (NULL in caso di errore) */
+    level_t * level;
+
+} level_job_t;
+
+/**
+ *  Variabili del file di configurazione di un livello
+ */
+typedef struct {
+
+    /** Nomi dei file delle mappe (o RANDOM) */
+    list_t * maps;
+
+    /** Nome del livello */
+    char * name;
+
+    /** File della traccia audio */
+    char * audio;
+
+    /** Bitmap delle mura */
+    char * wall_texture;
+
+    /** Posizione delle mura nella bitmap */
+    rectangle_t wall;
+
+    /** Bitmap dello sfondo */
+    char * background_texture;
+
+    /** Posizione dello sfondo nella bitmap */
+    rectangle_t background;
+
+    /** Complessità delle mappe casuali */
+    float complexity;
+
+} level_config_t;
+
+/**
+ *  Schema del file di configurazione di un livello
+ */
+static const config_schema_field_t level_config_schema[] = {
+    ConfigSchemaField(level_config_t, maps, "maps", CONFIG_VARTYPE_LIST, true, NULL),
+    ConfigSchemaField(level_config_t, name, "name", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(level_config_t, audio, "audio", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(level_config_t, wall_texture, "wall_texture", CONFIG_VARTYPE_STRING, true, NULL),
+    ConfigSchemaField(level_config_t, wall, "wall", CONFIG_VARTYPE_RECTANGLE, true, NULL),
+    ConfigSchemaField(level_config_t, background_texture, "background_texture", CONFIG_VARTYPE_STRING, true, NULL),
+    ConfigSchemaField(level_config_t, background, "background", CONFIG_VARTYPE_RECTANGLE, true, NULL),
+    ConfigSchemaField(level_config_t, complexity, "complexity", CONFIG_VARTYPE_FLOAT, false, NULL)
+};
+
+/**
+ *  Prima fase del caricamento di un livello: caricamento del file di configurazione
+ *  _config_file_path_ presente nella cartella _level_dir_.
+ *  Non utilizza il contesto di gioco nè la scheda video, per cui può essere eseguita
+ *  da un thread secondario (le immagini sono create in memoria).
  *
- *  @retval NULL In caso di errore
+ *  @param job Caricamento
  */
-level_t * level_new(game_t * game, char * level_dir, char * config_file_path)
+void level_load(level_job_t * job)
 {
 
-    hashtable_t * config = config_open(config_file_path);
+    //  i numeri casuali estratti dipendono solo dal generatore del livello
+    *random_thread() = job->random;
 
-    //  se non c'è il file di conf è come se il livello non esistesse
-    if (!config)
-        return NULL;
+    job->level = NULL;
+    job->background = NULL;
 
-    //  caricamento mappe
-    list_t * maps_list = hashtable_search(config, "maps");
+    //  la configurazione resta a disposizione di level_finalize, che la dealloca
+    hashtable_t * config = job->config = config_open(job->config_file_path);
 
-    //  niente mappe
-    if (!maps_list) {
+    //  se non c'è il file di conf è come se il livello non esistesse
+    if (!config)
+        return;
 
-        hashtable_delete(config);
-        return NULL;
+    level_config_t settings;
 
-    }
+    //  niente mappe, mura o sfondo: è come se il livello non esistesse
+    if (!config_schema_decode(config, level_config_schema, &settings, job->config_file_path))
+        return;
 
     level_t * level = memalloc(level_t, 1, true);
 
+    //  file sorgente, per l'aggiornamento della configurazione durante il gioco
+    level->config_path = memstrdup(job->config_file_path);
+
     //  nome del livello
-    char * name = hashtable_search(config, "name");
-    level->name = name ? strdup(name) : random_string(8);
+    level->name = settings.name ? memstrdup(settings.name) : random_string(8);
 
-    //  audio file
-    char * audio = hashtable_search(config, "audio");
+    //  audio file, caricato solo quando il livello diventa quello corrente
+    level->audio = settings.audio ? memstrdup(settings.audio) : NULL;
 
-    if (audio)
-        audio_sample_load(audio, game->audio_samples, level->name);
-    
     //  caricamento delle texture per l'ambiente (terreno, mura)
-    //  path della bitmap delle mura
-    char * wall_bmp_path = hashtable_search(config, "wall_texture");
-
-    //  niente mura
-    if (!wall_bmp_path) {
-
-        level_delete(level);
-        hashtable_delete(config);
-        return NULL;
-        
-    }
-
-    //  posizione delle mura nella bitmap
-    rectangle_t * rect = hashtable_search(config, "wall");
+    level->textures[LEVEL_TEXTURE_WALL] = image_load_new(settings.wall_texture, settings.wall, true);
 
-    //  caricamento bitmap delle mura
-    level->textures[LEVEL_TEXTURE_WALL] = image_load_new(wall_bmp_path, *rect, true);
-   
     //  impossibile caricare
     if (!level->textures[LEVEL_TEXTURE_WALL]) {
-        
-        level_delete(level);
-        hashtable_delete(config);
-        return NULL;
-        
-    }
-    
-    //  path della bitmap dello sfondo
-    char * background_bmp_path = hashtable_search(config, "background_texture");
-
-    //  niente bmp dei percorsi
-    if (!background_bmp_path) {
-
         level_delete(level);
-        hashtable_delete(config);
-        return NULL;
-        
+        return;
     }
 
-    //  posizione dello sfondo nella bitmap
-    rect = hashtable_search(config, "background");
-
-    //  immagine
-    image_t * background_image = image_load_new(background_bmp_path, *rect, true);
+    //  immagine dello sfondo
+    job->background = image_load_new(settings.background_texture, settings.background, true);
 
     //  le immagini per i percorsi sono necessarie
-    if (!background_image) {
-        
+    if (!job->background) {
         level_delete(level);
-        hashtable_delete(config);
-        return NULL;
-        
-    }
-
-    //  texture per una cella di tipo sconosciuto, colore nero
-    level->textures[CELL_TYPE_UNKNOWN] = image_create_new(ColorMakeRGB(0, 0, 0), CellSize);
-
-    //  crea una versione delle celle per ogni valore nel range [1-9] dei valori delle celle
-    //  per motivi prestazionali è più conveniente creare copie a priori che ri-tinteggiare tutto quando si disegna la mappa
-    int i = 0;
-    for (i = 0; i <= LEVEL_TEXTURE_PATH_DARKEST - LEVEL_TEXTURE_PATH_LIGHTEST; i++) {
-        if (i == CellDefaultValue - 1)
-            level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + i] = background_image;
-        else
-            level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + i] = image_duplicate_tinted(background_image, cell_tint(i + 1));
+        return;
     }
 
     //  caricamento degli avversari
     level->enemies = characters_load(config, "enemies");
 
     //  complessità
-    float complexity = float_value(hashtable_search(config, "complexity"));
+    float complexity = settings.complexity;
     level->complexity = RangeContainsValue(RangeMake(0., 1.), complexity) ? complexity : 0.1;
 
     //  costruzione lista delle mappe
     level->maps = list_new(map_functions);
 
     if (!level->maps) {
-        hashtable_delete(config);
         level_delete(level);
-        return NULL;
+        return;
     }
 
     //  posizione delle celle di entrata/uscita (asse x/y)
@@ -276,7 +318,7 @@ level_t * level_new(game_t * game, char * level_dir, char * config_file_path)
     map_t * last_map = NULL;
 
     //  caricamento mappe
-    foreach(maps_list, char *, map_config_file) {
+    foreach(settings.maps, char *, map_config_file) {
 
         map_t * map = NULL;
 
@@ -290,15 +332,28 @@ level_t * level_new(game_t * game, char * level_dir, char * config_file_path)
             int max_width = screen.width / (CellSize.width * 2) - 3;
             int max_height = screen.height / (CellSize.height * 2) - 3;
 
-            dimension_t map_size = SizeMake(random_int(9, max_width), random_int(9, max_height));
+            if (!strncasecmp(map_config_file, "RANDOM WORLD", 12)) {
+
+                //  finestra grande quanto lo schermo su un mondo di WORLD_WINDOWS x WORLD_WINDOWS finestre
+                dimension_t window = SizeMake(max_width, max_height);
+
+                map = world_map_new(level, window, SizeMultiplyBySize(window, SizeMake(WORLD_WINDOWS, WORLD_WINDOWS)));
+
+            } else {
+
+                dimension_t map_size = SizeMake(random_int(9, max_width), random_int(9, max_height));
 
-            map = map_generate(level, map_size, special_cells, random_bool(0.5), map_config_file);
-            map->next = NULL;
+                map = map_generate(level, map_size, special_cells, random_bool(0.5), map_config_file);
+
+                if (map)
+                    map->next = NULL;
+
+            }
 
         } else {
-            
+
             //  percorso del file di configurazione
-            char * map_config_file_path = fs_construct_path(level_dir, map_config_file);
+            char * map_config_file_path = fs_construct_path(job->level_dir, map_config_file);
 
             //  caricamento mappa
             map = map_load_new(level, map_config_file_path);
@@ -319,13 +374,68 @@ level_t * level_new(game_t * game, char * level_dir, char * config_file_path)
 
     }
 
-    //  deallocazione configurazione
-    hashtable_delete(config);
-    
-    //  se non è stata caricata alcuna mappa ritorna null
+    //  se non è stata caricata alcuna mappa il livello non è valido
     if (!list_length(level->maps)) {
         level_delete(level);
-        level = NULL;
+        return;
+    }
+
+    job->level = level;
+
+}
+
+/**
+ *  Seconda fase del caricamento di un livello, nel thread principale:
+ *  trasferimento delle immagini sulla scheda video, creazione delle texture
+ *  tinteggiate e caricamento dell'audio.
+ *
+ *  @param game Contesto di gioco
+ *  @param job Caricamento completato da level_load
+ *
+ *  @return Livello
+ *
+ *  @retval NULL In caso di errore
+ */
+level_t * level_finalize(game_t * game, level_job_t * job)
+{
+
+    unused(game);
+
+    level_t * level = job->level;
+    image_t * background = job->background;
+
+    //  la configurazione serve solo al caricamento
+    hashtable_delete(job->config);
+
+    //  level e background passano al chiamante
+    job->level = NULL;
+    job->background = NULL;
+    job->config = NULL;
+
+    if (!level) {
+        image_delete(background);
+        return NULL;
+    }
+
+    //  immagini create in memoria da level_load
+    image_upload(level->textures[LEVEL_TEXTURE_WALL]);
+    image_upload(background);
+
+    foreach(level->enemies, character_t *, enemy) {
+        character_upload(enemy);
+    }
+
+    //  texture per una cella di tipo sconosciuto, colore nero
+    level->textures[CELL_TYPE_UNKNOWN] = image_create_new(ColorMakeRGB(0, 0, 0), CellSize);
+
+    //  crea una versione delle celle per ogni valore nel range [1-9] dei valori delle celle
+    //  per motivi prestazionali è più conveniente creare copie a priori che ri-tinteggiare tutto quando si disegna la mappa
+    int i = 0;
+    for (i = 0; i <= LEVEL_TEXTURE_PATH_DARKEST - LEVEL_TEXTURE_PATH_LIGHTEST; i++) {
+        if (i == CellDefaultValue - 1)
+            level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + i] = background;
+        else
+            level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + i] = image_duplicate_tinted(background, cell_tint(i + 1));
     }
 
     debugf("[Livello] %s caricato (%zu mappe)\n", level->name, list_length(level->maps));
@@ -334,7 +444,101 @@ level_t * level_new(game_t * game, char * level_dir, char * config_file_path)
 
 }
 
-queue_t * levels_load(game_t * game, hashtable_t * config)
+/**
+ *  Livelli del gioco.
+ *  È residente solo il livello corrente: il successivo è caricato in background
+ *  (level_load in un thread secondario) mentre si gioca quello corrente.
+ *  Sostituisce il caricamento di tutti i livelli in parallelo all'avvio (thread_parallel_for):
+ *  con un solo livello residente il caricamento dei successivi non è più sul percorso
+ *  critico, e il thread pool resta a disposizione della generazione delle mappe.
+ */
+struct levels_s {
+
+    /** Caricamenti dei livelli, nell'ordine del file di configurazione */
+    level_job_t * jobs;
+
+    /** Numero di livelli */
+    size_t count;
+
+    /** Indice del prossimo caricamento da completare */
+    size_t pending;
+
+    /** Livello corrente */
+    level_t * level;
+
+    /** Livello successivo, già completato da levels_has_next (NULL se non ancora completato) */
+    level_t * next;
+
+    /** Thread che carica in background il caricamento jobs[pending] (NULL se nessuno) */
+    thread_t * prefetch;
+
+};
+
+/**
+ *  Funzione eseguita dal thread di caricamento
+ *
+ *  @param data Caricamento (level_job_t)
+ */
+void level_load_thread(void * data)
+{
+
+    //  se il thread non può essere creato thread_start esegue il caricamento nel thread chiamante,
+    //  il cui generatore di numeri casuali (sostituito da level_load) va ripristinato
+    random_t caller = *random_thread();
+
+    level_load(data);
+
+    *random_thread() = caller;
+
+}
+
+/**
+ *  Avvia in background il prossimo caricamento da completare
+ *
+ *  @param levels Livelli
+ */
+void levels_prefetch(levels_t * levels)
+{
+
+    if (levels->prefetch || levels->pending >= levels->count)
+        return;
+
+    levels->prefetch = thread_start(level_load_thread, &levels->jobs[levels->pending]);
+
+}
+
+/**
+ *  Completa il prossimo caricamento, saltando i livelli che non è possibile caricare
+ *
+ *  @param game Contesto di gioco
+ *  @param levels Livelli
+ *
+ *  @return Livello caricato
+ *  @retval NULL Se non ci sono altri livelli validi
+ */
+level_t * levels_fetch(game_t * game, levels_t * levels)
+{
+
+    while (levels->pending < levels->count) {
+
+        //  attende il caricamento in background (o lo avvia se non è in corso)
+        levels_prefetch(levels);
+
+        thread_join(levels->prefetch);
+        levels->prefetch = NULL;
+
+        level_t * level = level_finalize(game, &levels->jobs[levels->pending++]);
+
+        if (level)
+            return level;
+
+    }
+
+    return NULL;
+
+}
+
+levels_t * levels_load(game_t * game, hashtable_t * config)
 {
 
     //  percorso dei file di configurazione dei livelli
@@ -346,45 +550,119 @@ queue_t * levels_load(game_t * game, hashtable_t * config)
     //  nomi dei livelli
     list_t * levels_names = hashtable_search(config, "levels");
 
-    if (!levels_names)
+    if (!levels_names || list_empty(levels_names))
         return NULL;
 
-    //  lista delle configurazioni (level_t)
-    queue_t * levels = queue_new();
+    levels_t * levels = memalloc(levels_t, 1, true);
 
-    if (!levels)
-        return NULL;
+    levels->count = list_length(levels_names);
+    levels->jobs = memalloc(level_job_t, levels->count, true);
 
     //  per ogni livello
+    size_t i = 0;
     foreach(levels_names, char *, level_name) {
 
         //  costruzione path del file di configurazione
-        char * level_dir_path   = fs_construct_path(fs_get_resources_path(), levels_dir, level_name);
-        char * config_file_path = fs_construct_path(fs_get_resources_path(), levels_dir, level_name, level_name, ".cfg");
-
-        //  costruzione livello
-        level_t * level = level_new(game, level_dir_path, config_file_path);
+        levels->jobs[i].level_dir        = fs_construct_path(fs_get_resources_path(), levels_dir, level_name);
+        levels->jobs[i].config_file_path = fs_construct_path(fs_get_resources_path(), levels_dir, level_name, level_name, ".cfg");
 
-        //  se il caricamento non ha avuto problemi si inserisce nella lista
-        if (level) {
-            queue_push(levels, level);
-        }
+        //  i generatori sono derivati in ordine, il risultato non dipende da quando
+        //  o da quale thread viene caricato il livello
+        random_split(random_thread(), &levels->jobs[i].random);
 
-        memfree(config_file_path);
-        memfree(level_dir_path);
+        i++;
 
     }
 
-    //  se non è stata caricata alcun livello ritorna null
-    if (queue_empty(levels)) {
-        queue_delete(levels);
-        levels = NULL;
+    //  primo livello
+    levels->level = levels_fetch(game, levels);
+
+    //  nessun livello caricato
+    if (!levels->level) {
+        levels_delete(levels);
+        return NULL;
     }
 
+    //  il successivo è caricato mentre si gioca
+    levels_prefetch(levels);
+
     return levels;
 
 }
 
+level_t * levels_current(levels_t * levels)
+{
+
+    return levels ? levels->level : NULL;
+
+}
+
+bool levels_has_next(game_t * game, levels_t * levels)
+{
+
+    //  per sapere se il livello successivo è valido va completato il caricamento
+    //  (di solito già terminato quando l'utente arriva alla fine del livello)
+    if (!levels->next)
+        levels->next = levels_fetch(game, levels);
+
+    return levels->next != NULL;
+
+}
+
+level_t * levels_next(game_t * game, levels_t * levels)
+{
+
+    if (!levels_has_next(game, levels))
+        return NULL;
+
+    //  i file del livello precedente non sono più osservati
+    reload_untrack_level(game->reload);
+
+    //  il livello precedente è deallocato subito
+    level_delete(levels->level);
+
+    levels->level = levels->next;
+    levels->next = NULL;
+
+    //  caricamento in background del livello successivo
+    levels_prefetch(levels);
+
+    return levels->level;
+
+}
+
+void levels_delete(levels_t * levels)
+{
+
+    if (!levels)
+        return;
+
+    //  attende il caricamento in corso
+    thread_join(levels->prefetch);
+
+    size_t i;
+    for (i = 0; i < levels->count; i++) {
+
+        //  caricamento terminato ma non completato
+        level_job_t * job = &levels->jobs[i];
+
+        level_delete(job->level);
+        image_delete(job->background);
+        hashtable_delete(job->config);
+
+        memfree(job->config_file_path);
+        memfree(job->level_dir);
+
+    }
+
+    level_delete(levels->level);
+    level_delete(levels->next);
+
+    memfree(levels->jobs);
+    memfree(levels);
+
+}
+
 //  deallocazione di un livello
 void level_delete(level_t * level)
 {
@@ -403,9 +681,12 @@ void level_delete(level_t * level)
 
     //  3. avversari
     list_delete(level->enemies);
+    crowd_delete(level->crowd);
 
-    //  4. nome
+    //  4. nome, traccia audio e file di configurazione
     memfree(level->name);
+    memfree(level->audio);
+    memfree(level->config_path);
 
     //  5. livello
     memfree(level);
@@ -42,6 +42,12 @@ struct level_s {
     /** Nome del livello */
     char * name;
 
+    /** File della traccia audio (NULL se assente) */
+    char * audio;
+
+    /** File di configurazione del livello */
+    char * config_path;
+
     /** Mappa che costituiscono il livello, ordinate */
     list_t * maps;
 
@@ -58,6 +64,9 @@ struct level_s {
     /** Avversari */
     list_t * enemies;
 
+    /** Stato degli avversari per lo spostamento in blocco (creato da level_setup) */
+    crowd_t * crowd;
+
     /**
      *  Livello di complessità da 0. a 1., utilizzato nella generazione delle mappe random,
      *  più è alto più le mappe saranno complicate
@@ -67,16 +76,58 @@ struct level_s {
 };
 
 /**
- *  Caricamento dei livelli utilizzando le informazioni contenute nel file di configurazione 
+ *  Caricamento dei livelli utilizzando le informazioni contenute nel file di configurazione.
+ *  È caricato subito solo il primo livello, il successivo è caricato in background
+ *  mentre si gioca: in memoria ci sono al massimo due livelli.
  *
  *  @param game Contesto di gioco
  *  @param config Hashtable contenente la configurazione
  *
- *  @return Lista dei livelli caricati
+ *  @return Livelli
+ *
+ *  @retval NULL In caso di errori o se non è possibile caricare alcun livello
+ */
+levels_t * levels_load(game_t * game, hashtable_t * config);
+
+/**
+ *  Livello corrente
+ *
+ *  @param levels Livelli
+ *
+ *  @return Livello corrente
+ */
+level_t * levels_current(levels_t * levels);
+
+/**
+ *  Controlla se c'è un livello dopo quello corrente.
+ *  Se il caricamento in background non è terminato lo attende.
+ *
+ *  @param game Contesto di gioco
+ *  @param levels Livelli
+ *
+ *  @return true se c'è un livello successivo valido
+ */
+bool levels_has_next(game_t * game, levels_t * levels);
+
+/**
+ *  Passa al livello successivo: il livello corrente è deallocato
+ *  (va prima disinstallato con level_uninstall) e si avvia il caricamento
+ *  in background di quello dopo.
+ *
+ *  @param game Contesto di gioco
+ *  @param levels Livelli
+ *
+ *  @return Nuovo livello corrente
+ *  @retval NULL Se non ci sono altri livelli (il livello corrente non cambia)
+ */
+level_t * levels_next(game_t * game, levels_t * levels);
+
+/**
+ *  Deallocazione dei livelli, attende l'eventuale caricamento in background
  *
- *  @retval NULL In caso di errori
+ *  @param levels Livelli
  */
-queue_t * levels_load(game_t * game, hashtable_t * config);
+void levels_delete(levels_t * levels);
 
 /**
  *  Inizializzazione di un livello, necessaria nel passaggio da un livello all'altro
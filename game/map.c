@@ -1,22 +1,30 @@
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
 #include <math.h>
 
 #include "utils.h"
 
-#include "parser/parser.h"
-
 #include "config/config.h"
+#include "config/config_schema.h"
+
+#include "parser/parser.h"
+#include "parser/mapped_parser.h"
 
 #include "misc/random.h"
 #include "misc/geometry.h"
 
 #include "game/map.h"
+#include "game/maze.h"
 #include "game/character.h"
 #include "game/game.h"
 #include "game/info.h"
+#include "game/world.h"
 
 #include "main/drawing.h"
 #include "main/graphics.h"
+#include "main/thread.h"
 #include "main/tiling.h"
 
 /**
@@ -42,17 +50,15 @@ void map_update(game_t * game, map_t * map)
 void map_clear_graph(map_t * map)
 {
 
-    int x, y;
-
-    dimension_t size = map->size;
+    //  le celle sono contigue: una sola scansione lineare
+    size_t count = (size_t)map->size.width * (size_t)map->size.height;
 
-    for (x = 0; x < size.width; x++) {
-        for (y = 0; y < size.height; y++) {
-            map_cell_t * cell = map_get_cell(map, PointMake(x, y));
-            cell_set_color(cell, CELL_COLOR_WHITE);
-            cell_set_distance(cell, INT_MAX);
-            cell_set_parent(cell, NULL);
-        }
+    size_t i;
+    for (i = 0; i < count; i++) {
+        map_cell_t * cell = &map->cells[i];
+        cell_set_color(cell, CELL_COLOR_WHITE);
+        cell_set_distance(cell, INT_MAX);
+        cell_set_parent(cell, NULL);
     }
 
 }
@@ -73,396 +79,1555 @@ void map_offset_calculate(map_t * map)
 }
 
 /**
- *  Aggiorna le dimensioni di una mappa
+ *  Alloca le celle di una mappa e i relativi tipi, pesi, adiacenze e tasselli in un unico blocco:
+ *  width * height celle seguite da width * height tipi, pesi e maschere di adiacenza
+ *  e da 4 * width * height tasselli
  *
  *  @param map Mappa
- *  @param size Nuove dimensioni
+ *  @param size Dimensioni della griglia
  */
-void map_update_size(map_t * map, dimension_t size) {
- 
-    dimension_t old_size = map->size;
-    
-    //  aggiornamento dimensioni
-    map->size = size;
-    
-    //  deallocazione delle locazioni in eccesso
-    int y = map->size.height;
-    for (; y < old_size.height; y++) {
-        memfree(map->grid[y]);
-    }
-    
+static void map_grid_allocate(map_t * map, dimension_t size)
+{
+
+    size_t count = (size_t)size.width * (size_t)size.height;
+
+    map->cells = (map_cell_t *)memalloc(unsigned char, (count * (sizeof(map_cell_t) + 7)));
+    map->types = (unsigned char *)(map->cells + count);
+    map->values = map->types + count;
+    map->adjacency = map->values + count;
+    map->tiling = map->adjacency + count;
+
 }
 
 /**
- *  Esegue il parsing di una mappa, data la sua rappresentazione testuale costituita dai seguenti elementi:
- *  - '#': muro
- *  - ' ': corridoio
- *  - '@': corridoio a percorrenza lenta
- *  - 'V': posizione di un avversario
- *  - 'S': punto partenza
- *  - 'E': punto di uscita
- *
- *  @param level Livello
- *  @param map Mappa di destinazione
- *  @param buffer Rappresentazione testuale della mappa
+ *  Sposta gli elementi di una bag di celle dalla vecchia alla nuova griglia,
+ *  rimuovendo le celle che non fanno più parte della mappa
  *
- *  @retval true Parsing terminato senza errori
- *  @retval false Parsing fallito
+ *  @param bag Bag di celle
+ *  @param cells Vecchia griglia
+ *  @param old_size Dimensioni della vecchia griglia
+ *  @param map Mappa con la nuova griglia
  */
-bool map_parse(level_t * level, map_t * map, char * buffer)
+static void map_grid_move_bag(bag_t * bag, map_cell_t * cells, dimension_t old_size, map_t * map)
 {
 
-    //  nuovo parser
-    parser_t * parser = parser_new(buffer, strlen(buffer), NULL, buffer_parser_functions);
+    size_t i = bag->length;
 
-    //  coordinate del punto nel quale si trova il parser ad un certo loop
-    point_t point = PointZero;
+    //  dalla fine: la rimozione sposta l'ultimo elemento nella posizione liberata
+    while (i-- > 0) {
 
-    //  primo avversario nella lista degli avversari, per l'assegnazione della posizione
-    list_node_t * enemy_node = level->enemies->head;
+        point_t location = ((map_cell_t *)bag->elements[i])->location;
 
-    while (!parser->methods.is_eos(parser)) {
-
-        int token = parser->methods.current(parser);
-        map_cell_t * cell = map_get_cell(map, point);
-
-        //  tokens:
-        //  '#': muro
-        //  ' ': corridoio
-        //  'V': posizione di un avversario
-        //  '2'..'9': cella con un peso diverso (i personaggi la attraversano più lentamente)
-        //  'S': partenza
-        //  'E': fine
-        switch (token) {
-        case '#':
-            cell_set_is_wall(cell);
-            point.x++;
-            break;
-
-        case 'P':
-        case 'S':
-        case 'E':
-        case 'V':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case ' ':
-
-            if (token == 'S')   //  inizio della mappa == posizione iniziale del personaggio dell'utente
-                map->start = point;
-            else if (token == 'E')  //  punto di uscita della mappa
-                map->end = point;
-            else if (token == 'V' && enemy_node) {    //  posizione di un avversario
-                character_t * enemy = enemy_node->value;
-
-                //  se il personaggio è valido e non gli è stata assegnata alcuna posizione
-                if (enemy && PointIsNull(enemy->location)) {
-                    enemy->location = point;
-                    enemy->position = cell_location_to_position(point);
-                    enemy->map = map;
-
-                    //  prossimo personaggio
-                    enemy_node = enemy_node->next;
-                }
-            } else if (token == 'P' ||
-                       (token == ' ' && random_bool(map->powerup_probability))) {
-                list_insert(map->powerup_cells, cell);
-            }
+        if (!map_cell_is_valid(map, location))
+            bag_remove(bag, bag->elements[i]);
 
-            //  corridoio a percorrenza lenta
-            if (isdigit(token)) {
-                cell_set_value(cell, token - '0');
-            } else {
-                cell_set_value(cell, CellDefaultValue);
-            }
+    }
 
-            cell_set_is_path(cell);
+    size_t width = (size_t)old_size.width;
 
-            point.x++;
-            break;
+    for (i = 0; i < bag->length; i++) {
 
-        case '\n':
-            point.x = 0;
-            point.y++;
-            break;
+        size_t index = (size_t)((map_cell_t *)bag->elements[i] - cells);
+        point_t location = PointMake((index % width), (index / width));
 
-        default:
-            break;
-        }
+        bag->elements[i] = map_get_cell(map, location);
 
-        //  avanti il prossimo
-        parser->methods.next(parser);
-        
-        //  fuori dai limiti
-        if (point.x >= map->size.width || point.y >= map->size.height) {
-            
-            //  deallocazione parser
-            parser_delete(parser);
+    }
 
-            return false;
-        }
+}
 
-    }
+/**
+ *  Riquadro della griglia dei personaggi che contiene una cella.
+ *  Le celle fuori dalla mappa (es. durante l'attraversamento di un bordo) sono ricondotte al bordo
+ *
+ *  @param map Mappa
+ *  @param location Coordinate della cella
+ *
+ *  @return Indice del riquadro
+ */
+static size_t map_bucket_index(map_t * map, point_t location)
+{
 
-    //  deallocazione parser
-    parser_delete(parser);
+    float x = location.x < 0 ? 0 : (location.x >= map->size.width ? map->size.width - 1 : location.x);
+    float y = location.y < 0 ? 0 : (location.y >= map->size.height ? map->size.height - 1 : location.y);
 
-    //  controlla se sono state specificate posizione di inizio e fine
-    if (PointIsNull(map->start) || PointIsNull(map->end))
-        return false;
+    return ((size_t)y / MAP_BUCKET_SIZE) * map->buckets_width + (size_t)x / MAP_BUCKET_SIZE;
 
-    //  aggiornamento dimensioni
-    map_update_size(map, SizeMake(point.x, point.y + 1));
+}
 
-    //  se la mappa è più piccola della dimensione della finestra, va centrata
-    map_offset_calculate(map);
+/**
+ *  Dealloca la griglia dei personaggi di una mappa, che non vi risultano più registrati
+ *
+ *  @param map Mappa
+ */
+static void map_buckets_delete(map_t * map)
+{
 
-    return true;
+    if (!map->buckets)
+        return;
+
+    size_t i;
+    for (i = 0; i < map->buckets_width * map->buckets_height; i++) {
+
+        unsigned int j;
+        for (j = 0; j < map->buckets[i].count; j++)
+            map->buckets[i].characters[j]->bucket_map = NULL;
+
+        memfree(map->buckets[i].characters);
+
+    }
+
+    memfree(map->buckets);
+
+    map->buckets = NULL;
+    map->buckets_width = map->buckets_height = 0;
 
 }
 
-map_t * map_new(dimension_t size, level_t * level)
+/**
+ *  Ricalcola la griglia dei personaggi di una mappa dopo il cambio delle sue dimensioni
+ *
+ *  @param map Mappa
+ */
+static void map_buckets_resize(map_t * map)
 {
 
-    //  oggetto map_t
-    map_t * map = memalloc(map_t);
+    if (!map->buckets)
+        return;
 
-    //  punto di partenza e fine
-    //  inizializzati con una posizione "impossibile" per forzarne l'indicazione sulla mappa
-    map->start = map->end = PointNull;
+    //  personaggi registrati, da inserire nella nuova griglia
+    size_t count = 0;
+    character_t ** characters = NULL;
 
-    //  copia dimensioni
-    map->size = size;
+    size_t i;
+    for (i = 0; i < map->buckets_width * map->buckets_height; i++) {
 
-    //  a questo punto è possibile allocare la griglia
-    //  righe
-    map->grid = memalloc(map_cell_t *, map->size.height);
+        if (!map->buckets[i].count)
+            continue;
 
-    //  inizializzazione delle celle
-    int x, y;
+        characters = memrealloc(characters, character_t *, count + map->buckets[i].count);
+        memcpy(characters + count, map->buckets[i].characters, map->buckets[i].count * sizeof(character_t *));
+        count += map->buckets[i].count;
 
-    for (y = 0; y < map->size.height; y++) {
-        map->grid[y] = memalloc(map_cell_t, map->size.width);
-        for (x = 0; x < map->size.width; x++) {
-            //  inizializzazione cella
-            cell_init(map_get_cell(map, PointMake(x, y)), PointMake(x, y));
-        }
     }
 
-    //  il puntatore alla mappa successiva sarà aggiornato dopo il caricamento
-    //  di tutte le mappe del livello
-    map->next = NULL;
-
-    //  lista delle celle per i bonus
-    map->powerup_cells = list_new(no_functions);
+    map_buckets_delete(map);
 
-    //  ultimo bonus inserito mai
-    struct tm time;
-    memset(&time, 0, sizeof(time));
-    map->powerup_time = mktime(&time);
+    for (i = 0; i < count; i++)
+        map_characters_update(characters[i]);
 
-    return map;
+    memfree(characters);
 
 }
 
-void map_connect_cell(map_t * map, map_cell_t * cell, bool all_directions)
+void map_characters_remove(character_t * character)
 {
 
+    map_t * map = character->bucket_map;
+
     if (!map)
         return;
-    
-    //  point è la locazione della cella corrente
-    //  north e la cella in alto
-    //  west quella a sinistra
-    point_t point = cell->location;
-    point_t north = PointPointOffset(point, OffsetTop);
-    point_t west  = PointPointOffset(point, OffsetLeft);
 
-    //  definizione adiacenza
-    //  ovest
-    if (map_cell_is_path(map, west)) {
-        map_get_cell(map, west)->adjacency.east = cell;
-        cell->adjacency.west = map_get_cell(map, west);
+    //  l'ultimo personaggio del riquadro prende il posto di quello rimosso
+    map_bucket_t * bucket = &map->buckets[character->bucket];
+    character_t * last = bucket->characters[--bucket->count];
+
+    bucket->characters[character->bucket_slot] = last;
+    last->bucket_slot = character->bucket_slot;
+
+    character->bucket_map = NULL;
+
+}
+
+void map_characters_update(character_t * character)
+{
+
+    map_t * map = character->map;
+
+    //  personaggio non (ancora) posizionato
+    if (!map || PointIsNull(character->location) || SizeIsZero(map->size)) {
+        map_characters_remove(character);
+        return;
     }
 
-    //  nord
-    if (map_cell_is_path(map, north)) {
-        map_get_cell(map, north)->adjacency.south = cell;
-        cell->adjacency.north = map_get_cell(map, north);
+    //  griglia allocata al primo inserimento
+    if (!map->buckets) {
+        map->buckets_width = ((size_t)map->size.width + MAP_BUCKET_SIZE - 1) / MAP_BUCKET_SIZE;
+        map->buckets_height = ((size_t)map->size.height + MAP_BUCKET_SIZE - 1) / MAP_BUCKET_SIZE;
+        map->buckets = memalloc(map_bucket_t, (map->buckets_width * map->buckets_height), true);
     }
 
-    if (!PointEqualToPoint(point, map->start) &&
-        !PointEqualToPoint(point, map->end)) {
-        //  sconfinamento a est
-        if (cell->location.x == map->size.width - 1 && map_cell_is_path(map, PointMake(0, cell->location.y))) {
-            map_get_cell(map, PointMake(0, cell->location.y))->adjacency.west = cell;
-            cell->adjacency.east = map_get_cell(map, PointMake(0, cell->location.y));
-        }
+    size_t index = map_bucket_index(map, character->location);
 
-        //  sconfinamento a sud
-        if (cell->location.y == map->size.height - 1 && map_cell_is_path(map, PointMake(cell->location.x, 0))) {
-            map_get_cell(map, PointMake(cell->location.x, 0))->adjacency.north = cell;
-            cell->adjacency.south = map_get_cell(map, PointMake(cell->location.x, 0));
-        }
+    //  nessun cambio di riquadro (il caso più frequente, ad ogni spostamento)
+    if (character->bucket_map == map && character->bucket == index)
+        return;
+
+    map_characters_remove(character);
+
+    map_bucket_t * bucket = &map->buckets[index];
+
+    if (bucket->count == bucket->capacity) {
+        bucket->capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        bucket->characters = memrealloc(bucket->characters, character_t *, bucket->capacity);
     }
 
-    if (all_directions) {
+    character->bucket_map = map;
+    character->bucket = index;
+    character->bucket_slot = bucket->count;
 
-        point_t south = PointPointOffset(point, OffsetBottom);
-        point_t east  = PointPointOffset(point, OffsetRight);
+    bucket->characters[bucket->count++] = character;
 
-        //  sud
-        if (map_cell_is_path(map, south)) {
-            map_get_cell(map, south)->adjacency.north = cell;
-            cell->adjacency.south = map_get_cell(map, south);
-        }
+}
 
-        //  est
-        if (map_cell_is_path(map, east)) {
-            map_get_cell(map, east)->adjacency.west = cell;
-            cell->adjacency.east = map_get_cell(map, east);
-        }
+character_t ** map_characters_query(map_t * map, rectangle_t rect, size_t * count)
+{
 
-        if (!PointEqualToPoint(point, map->start) && !PointEqualToPoint(point, map->end)) {
-            //  sconfinamento a est
-            if (cell->location.x == 0 && map_cell_is_path(map, PointMake(map->size.width - 1, cell->location.y))) {
-                map_get_cell(map, PointMake(map->size.width - 1, cell->location.y))->adjacency.east = cell;
-                cell->adjacency.west = map_get_cell(map, PointMake(map->size.width - 1, cell->location.y));
-            }
+    *count = 0;
 
-            //  sconfinamento a sud
-            if (cell->location.y == 0 && map_cell_is_path(map, PointMake(cell->location.x, map->size.height - 1))) {
-                map_get_cell(map, PointMake(cell->location.x, map->size.height - 1))->adjacency.south = cell;
-                cell->adjacency.north = map_get_cell(map, PointMake(cell->location.x, map->size.height - 1));
+    if (!map->buckets)
+        return map->found;
+
+    //  celle coperte dal riquadro, più una cella di margine per lato
+    point_t from = cell_position_to_location(rect.origin);
+    point_t to = cell_position_to_location(PointMake(RectGetMaxX(rect), RectGetMaxY(rect)));
+
+    from = PointMake((from.x - 1), (from.y - 1));
+    to = PointMake((to.x + 1), (to.y + 1));
+
+    size_t first = map_bucket_index(map, from);
+    size_t last = map_bucket_index(map, to);
+
+    size_t x, y;
+    for (y = first / map->buckets_width; y <= last / map->buckets_width; y++) {
+        for (x = first % map->buckets_width; x <= last % map->buckets_width; x++) {
+
+            map_bucket_t * bucket = &map->buckets[y * map->buckets_width + x];
+
+            if (!bucket->count)
+                continue;
+
+            if (*count + bucket->count > map->found_capacity) {
+                map->found_capacity = (*count + bucket->count) * 2;
+                map->found = memrealloc(map->found, character_t *, map->found_capacity);
             }
+
+            memcpy(map->found + *count, bucket->characters, bucket->count * sizeof(character_t *));
+            *count += bucket->count;
+
         }
+    }
+
+    return map->found;
+
+}
+
+/**
+ *  Aggiorna le dimensioni di una mappa
+ *
+ *  @param map Mappa
+ *  @param size Nuove dimensioni
+ */
+void map_update_size(map_t * map, dimension_t size) {
+ 
+    dimension_t old_size = map->size;
+
+    if (old_size.width == size.width && old_size.height == size.height)
+        return;
+
+    map_cell_t * cells = map->cells;
+    unsigned char * types = map->types;
+    unsigned char * values = map->values;
+    unsigned char * adjacency = map->adjacency;
+
+    //  aggiornamento dimensioni e nuova griglia, le righe cambiano lunghezza
+    map->size = size;
+    map_grid_allocate(map, size);
+
+    //  gli indici delle celle e i riquadri della griglia dei personaggi cambiano
+    map_paths_invalidate(map);
+    map_buckets_resize(map);
+
+    //  parte comune alle due griglie
+    size_t width = (size_t)fminf(old_size.width, size.width);
+    int height = (int)fminf(old_size.height, size.height);
+
+    int y;
+    for (y = 0; y < height; y++) {
+
+        size_t from = (size_t)y * (size_t)old_size.width;
+        size_t to = (size_t)y * (size_t)size.width;
+
+        memcpy(&map->cells[to], &cells[from], width * sizeof(map_cell_t));
+        memcpy(&map->types[to], &types[from], width);
+        memcpy(&map->values[to], &values[from], width);
+        memcpy(&map->adjacency[to], &adjacency[from], width);
 
     }
 
+    //  le celle dei bonus puntano alla vecchia griglia
+    map_grid_move_bag(map->powerup_cells, cells, old_size, map);
+    map_grid_move_bag(map->powerup_free_cells, cells, old_size, map);
+
+    //  deallocazione della vecchia griglia
+    memfree(cells);
+    
 }
 
-void map_connect(map_t * map)
+/**
+ *  Classi dei caratteri della rappresentazione testuale di una mappa
+ */
+enum {
+
+    /** Carattere ignorato (es. '\r') */
+    MAP_TOKEN_IGNORE,
+
+    /** '#': muro */
+    MAP_TOKEN_WALL,
+
+    /** '1'..'9': corridoio con un peso diverso */
+    MAP_TOKEN_PATH,
+
+    /** ' ': corridoio, può contenere un bonus */
+    MAP_TOKEN_SPACE,
+
+    /** 'P': corridoio con un bonus */
+    MAP_TOKEN_POWERUP,
+
+    /** 'S': punto di partenza */
+    MAP_TOKEN_START,
+
+    /** 'E': punto di uscita */
+    MAP_TOKEN_END,
+
+    /** 'V': posizione di un avversario */
+    MAP_TOKEN_ENEMY
+
+};
+
+/**
+ *  Classe e peso della cella per ogni carattere (i caratteri non elencati sono ignorati)
+ */
+static const struct {
+
+    /** Classe (MAP_TOKEN_*) */
+    unsigned char token;
+
+    /** Peso della cella se corridoio */
+    unsigned char value;
+
+} map_tokens[UCHAR_MAX + 1] = {
+    ['#'] = { MAP_TOKEN_WALL, 0 },
+    [' '] = { MAP_TOKEN_SPACE, CellDefaultValue },
+    ['P'] = { MAP_TOKEN_POWERUP, CellDefaultValue },
+    ['S'] = { MAP_TOKEN_START, CellDefaultValue },
+    ['E'] = { MAP_TOKEN_END, CellDefaultValue },
+    ['V'] = { MAP_TOKEN_ENEMY, CellDefaultValue },
+    ['1'] = { MAP_TOKEN_PATH, 1 },
+    ['2'] = { MAP_TOKEN_PATH, 2 },
+    ['3'] = { MAP_TOKEN_PATH, 3 },
+    ['4'] = { MAP_TOKEN_PATH, 4 },
+    ['5'] = { MAP_TOKEN_PATH, 5 },
+    ['6'] = { MAP_TOKEN_PATH, 6 },
+    ['7'] = { MAP_TOKEN_PATH, 7 },
+    ['8'] = { MAP_TOKEN_PATH, 8 },
+    ['9'] = { MAP_TOKEN_PATH, 9 }
+};
+
+/**
+ *  Funzione chiamata per ogni corridoio con un carattere speciale (MAP_TOKEN_SPACE e successivi)
+ *
+ *  @param data Dati dell'utente
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param token Classe del carattere (MAP_TOKEN_*)
+ */
+typedef void (* map_token_function)(void * data, map_t * map, map_cell_t * cell, unsigned char token);
+
+/**
+ *  Analizza la rappresentazione testuale di una mappa, costituita dai seguenti elementi:
+ *  - '#': muro
+ *  - ' ': corridoio
+ *  - '1'..'9': corridoio con un peso diverso (i personaggi la attraversano più lentamente)
+ *  - 'P': corridoio con un bonus
+ *  - 'V': posizione di un avversario
+ *  - 'S': punto partenza
+ *  - 'E': punto di uscita
+ *
+ *  La mappa è letta una riga alla volta (le righe sono individuate con memchr)
+ *  e ogni carattere è classificato tramite la tabella map_tokens.
+ *  Tipi, pesi, inizio e fine sono scritti nella mappa, gli altri caratteri speciali passati a callback.
+ *
+ *  @param map Mappa di destinazione
+ *  @param buffer Rappresentazione testuale della mappa
+ *  @param callback Funzione chiamata per i caratteri speciali
+ *  @param data Dati passati a callback
+ *
+ *  @retval true Analisi terminata senza errori
+ *  @retval false Analisi fallita
+ */
+static bool map_scan(map_t * map, char * buffer, map_token_function callback, void * data)
 {
 
-    //  inizializzazione delle adiacenze delle celle
-    //  che saranno utilizzate per calcolare i percorsi con bfs, astar, dijkstra
-    int x, y;
-    for (y = 0; y < map->size.height; y++) {
-        for (x = 0; x < map->size.width; x++) {
+    const unsigned char * row = (const unsigned char *)buffer;
+    const unsigned char * end = row + strlen(buffer);
 
-            map_cell_t * cell = map_get_cell(map, PointMake(x, y));
+    int width = (int)map->size.width;
+    int height = (int)map->size.height;
 
-            //  le mura non vanno connesse
-            if (!cell_is_path(cell))
+    //  coordinate della cella corrente
+    int x = 0, y = 0;
+
+    while (row < end) {
+
+        //  fine della riga (o del buffer)
+        const unsigned char * row_end = memchr(row, '\n', (size_t)(end - row));
+
+        if (!row_end)
+            row_end = end;
+
+        //  prima cella della riga, con il relativo tipo e peso
+        map_cell_t * cells = &map->cells[y * width];
+        unsigned char * types = &map->types[y * width];
+        unsigned char * values = &map->values[y * width];
+
+        const unsigned char * c;
+        for (c = row; c < row_end; c++) {
+
+            unsigned char token = map_tokens[*c].token;
+
+            if (token == MAP_TOKEN_IGNORE)
                 continue;
 
-            map_connect_cell(map, cell, 0);
+            if (token == MAP_TOKEN_WALL) {
+
+                types[x] = CELL_TYPE_WALL;
+
+            } else {
+
+                types[x] = CELL_TYPE_PATH;
+                values[x] = map_tokens[*c].value;
+
+                if (token == MAP_TOKEN_START) {  //  inizio della mappa == posizione iniziale del personaggio dell'utente
+
+                    map->start = PointMake(x, y);
+
+                } else if (token == MAP_TOKEN_END) {  //  punto di uscita della mappa
+
+                    map->end = PointMake(x, y);
+
+                } else if (token != MAP_TOKEN_PATH) {   //  avversari e bonus
+
+                    callback(data, map, &cells[x], token);
+
+                }
+
+            }
+
+            //  fuori dai limiti
+            if (++x >= width)
+                return false;
+
+        }
+
+        //  la riga termina con un \n, si passa alla successiva
+        if (row_end < end) {
+
+            x = 0;
+
+            //  fuori dai limiti
+            if (++y >= height)
+                return false;
 
         }
+
+        row = row_end + 1;
+
+    }
+
+    //  controlla se sono state specificate posizione di inizio e fine
+    if (PointIsNull(map->start) || PointIsNull(map->end))
+        return false;
+
+    //  aggiornamento dimensioni (non maggiori di quelle iniziali, ma un a capo finale ne annulla la larghezza)
+    if (!map_size_is_valid(SizeMake(x, y + 1)))
+        return false;
+
+    map_update_size(map, SizeMake(x, y + 1));
+
+    return true;
+
+}
+
+/**
+ *  Assegna una posizione al prossimo avversario del livello che non ne ha ancora una
+ *
+ *  @param map Mappa
+ *  @param enemy_node Prossimo avversario nella lista degli avversari, aggiornato
+ *  @param location Posizione
+ */
+static void map_place_enemy(map_t * map, list_node_t ** enemy_node, point_t location)
+{
+
+    if (!*enemy_node)
+        return;
+
+    character_t * enemy = (*enemy_node)->value;
+
+    //  se il personaggio è valido e non gli è stata assegnata alcuna posizione
+    if (enemy && PointIsNull(enemy->location)) {
+        enemy->location = location;
+        character_set_position(enemy, cell_location_to_fixed(location));
+        enemy->map = map;
+
+        //  map_place_enemies salta gli avversari già posizionati: vanno registrati qui
+        //  nella griglia dei personaggi (o map_characters_query non li troverebbe)
+        map_characters_update(enemy);
+
+        //  prossimo personaggio
+        *enemy_node = (*enemy_node)->next;
+    }
+
+}
+
+/**
+ *  Avversari e bonus di una mappa in fase di caricamento (callback di map_scan)
+ *
+ *  @param data Prossimo avversario nella lista degli avversari (list_node_t **)
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param token Classe del carattere (MAP_TOKEN_*)
+ */
+static void map_parse_token(void * data, map_t * map, map_cell_t * cell, unsigned char token)
+{
+
+    if (token == MAP_TOKEN_ENEMY)   //  posizione di un avversario
+        map_place_enemy(map, data, cell->location);
+    else if (token == MAP_TOKEN_POWERUP || (token == MAP_TOKEN_SPACE && random_bool(map->powerup_probability)))
+        map_powerup_cell_add(map, cell);
+
+}
+
+/**
+ *  Esegue il parsing di una mappa, data la sua rappresentazione testuale (vedi map_scan),
+ *  assegnando le posizioni degli avversari del livello e le celle dei bonus
+ *
+ *  @param level Livello
+ *  @param map Mappa di destinazione
+ *  @param buffer Rappresentazione testuale della mappa
+ *
+ *  @retval true Parsing terminato senza errori
+ *  @retval false Parsing fallito
+ */
+bool map_parse(level_t * level, map_t * map, char * buffer)
+{
+
+    //  primo avversario nella lista degli avversari, per l'assegnazione della posizione
+    list_node_t * enemy_node = level->enemies->head;
+
+    if (!map_scan(map, buffer, map_parse_token, &enemy_node))
+        return false;
+
+    //  se la mappa è più piccola della dimensione della finestra, va centrata
+    //  (solo qui e non in map_scan: map_convert è eseguita senza display)
+    map_offset_calculate(map);
+
+    return true;
+
+}
+
+/**
+ *  Posizione di una cella nell'insieme delle celle libere per i bonus
+ *
+ *  @param cell Cella
+ *
+ *  @return Indirizzo della posizione
+ */
+long * map_cell_powerup_index(void * cell)
+{
+
+    return &((map_cell_t *)cell)->powerup.index;
+
+}
+
+bool map_size_is_valid(dimension_t size)
+{
+
+    return size.width >= 1 && size.height >= 1 &&
+           size.width <= MAP_SIZE_MAX && size.height <= MAP_SIZE_MAX &&
+           size.width == floorf(size.width) && size.height == floorf(size.height);
+
+}
+
+map_t * map_new(dimension_t size, level_t * level)
+{
+
+    //  le coordinate dei personaggi sono a virgola fissa (vedi MAP_SIZE_MAX)
+    if (!map_size_is_valid(size)) {
+        errorf("[Mappa] Dimensioni %gx%g non valide (al massimo %d celle per lato)\n", size.width, size.height, MAP_SIZE_MAX);
+        return NULL;
+    }
+
+    //  oggetto map_t
+    map_t * map = memalloc(map_t);
+
+    //  punto di partenza e fine
+    //  inizializzati con una posizione "impossibile" per forzarne l'indicazione sulla mappa
+    map->start = map->end = PointNull;
+
+    //  copia dimensioni
+    map->size = size;
+
+    //  a questo punto è possibile allocare la griglia, in un unico blocco
+    map_grid_allocate(map, map->size);
+
+    size_t count = (size_t)map->size.width * (size_t)map->size.height;
+
+    //  tipo e peso di default, nessuna adiacenza
+    memset(map->types, CELL_TYPE_UNKNOWN, count);
+    memset(map->values, CellDefaultValue, count);
+    memset(map->adjacency, 0, count);
+    memset(map->tiling, TILE_PART_NONE, 4 * count);
+
+    //  insieme dei corridoi calcolato alla prima estrazione
+    map->paths = NULL;
+    map->paths_positions = NULL;
+    map->paths_count = 0;
+
+    //  sfondo e mura disegnati al primo disegno della mappa
+    map->layer = NULL;
+    map->layer_invalid = true;
+    map->layer_dirty = NULL;
+    map->layer_dirty_count = map->layer_dirty_capacity = 0;
+
+    //  griglia dei personaggi allocata al primo inserimento
+    map->buckets = NULL;
+    map->buckets_width = map->buckets_height = 0;
+    map->found = NULL;
+    map->found_capacity = 0;
+
+    //  inizializzazione delle celle
+    int x, y;
+
+    for (y = 0; y < map->size.height; y++) {
+        for (x = 0; x < map->size.width; x++) {
+            //  inizializzazione cella
+            cell_init(map_get_cell(map, PointMake(x, y)), PointMake(x, y));
+        }
+    }
+
+    //  il puntatore alla mappa successiva sarà aggiornato dopo il caricamento
+    //  di tutte le mappe del livello
+    map->next = NULL;
+
+    //  impostato da map_load_new
+    map->config_path = NULL;
+
+    //  impostato da world_map_new
+    map->world = NULL;
+
+    //  celle per i bonus
+    map->powerup_cells = bag_new(no_functions);
+    map->powerup_free_cells = bag_new(no_functions, map_cell_powerup_index);
+
+    //  ultimo bonus inserito mai
+    struct tm time;
+    memset(&time, 0, sizeof(time));
+    map->powerup_time = mktime(&time);
+
+    return map;
+
+}
+
+/**
+ *  Collega due celle adiacenti, in entrambi i versi
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param direction Direzione nella quale si trova l'adiacente (CELL_DIRECTION_*)
+ *  @param location Coordinate dell'adiacente
+ *  @param wrap Se true l'adiacenza attraversa il bordo della mappa
+ */
+static void map_connect_cells(map_t * map, map_cell_t * cell, int direction, point_t location, bool wrap)
+{
+
+    //  direzione opposta a ciascuna direzione
+    static const int opposite[CELL_DIRECTION_LAST] = {
+        CELL_DIRECTION_SOUTH,
+        CELL_DIRECTION_NORTH,
+        CELL_DIRECTION_WEST,
+        CELL_DIRECTION_EAST
+    };
+
+    unsigned char flags = wrap ? CELL_ADJACENCY_WRAP : 0;
+
+    map->adjacency[map_cell_index(map, cell)] |= (1 << direction) | flags;
+    map->adjacency[map_cell_location_to_index(map, location)] |= (1 << opposite[direction]) | flags;
+
+}
+
+void map_connect_cell(map_t * map, map_cell_t * cell, bool all_directions)
+{
+
+    if (!map)
+        return;
+    
+    //  point è la locazione della cella corrente
+    //  north e la cella in alto
+    //  west quella a sinistra
+    point_t point = cell->location;
+    point_t north = PointPointOffset(point, OffsetTop);
+    point_t west  = PointPointOffset(point, OffsetLeft);
+
+    //  definizione adiacenza
+    //  ovest
+    if (map_cell_is_path(map, west))
+        map_connect_cells(map, cell, CELL_DIRECTION_WEST, west, false);
+
+    //  nord
+    if (map_cell_is_path(map, north))
+        map_connect_cells(map, cell, CELL_DIRECTION_NORTH, north, false);
+
+    //  i bordi di una finestra del mondo non sono i bordi della mappa: nessuno sconfinamento
+    bool wrap = !map->world;
+
+    if (wrap && !PointEqualToPoint(point, map->start) &&
+        !PointEqualToPoint(point, map->end)) {
+        //  sconfinamento a est
+        point_t wrap_east = PointMake(0, point.y);
+
+        if (point.x == map->size.width - 1 && map_cell_is_path(map, wrap_east))
+            map_connect_cells(map, cell, CELL_DIRECTION_EAST, wrap_east, true);
+
+        //  sconfinamento a sud
+        point_t wrap_south = PointMake(point.x, 0);
+
+        if (point.y == map->size.height - 1 && map_cell_is_path(map, wrap_south))
+            map_connect_cells(map, cell, CELL_DIRECTION_SOUTH, wrap_south, true);
+    }
+
+    if (all_directions) {
+
+        point_t south = PointPointOffset(point, OffsetBottom);
+        point_t east  = PointPointOffset(point, OffsetRight);
+
+        //  sud
+        if (map_cell_is_path(map, south))
+            map_connect_cells(map, cell, CELL_DIRECTION_SOUTH, south, false);
+
+        //  est
+        if (map_cell_is_path(map, east))
+            map_connect_cells(map, cell, CELL_DIRECTION_EAST, east, false);
+
+        if (wrap && !PointEqualToPoint(point, map->start) && !PointEqualToPoint(point, map->end)) {
+            //  sconfinamento a ovest
+            point_t wrap_west = PointMake(map->size.width - 1, point.y);
+
+            if (point.x == 0 && map_cell_is_path(map, wrap_west))
+                map_connect_cells(map, cell, CELL_DIRECTION_WEST, wrap_west, true);
+
+            //  sconfinamento a nord
+            point_t wrap_north = PointMake(point.x, map->size.height - 1);
+
+            if (point.y == 0 && map_cell_is_path(map, wrap_north))
+                map_connect_cells(map, cell, CELL_DIRECTION_NORTH, wrap_north, true);
+        }
+
+    }
+
+}
+
+void map_connect(map_t * map)
+{
+
+    //  inizializzazione delle adiacenze delle celle
+    //  che saranno utilizzate per calcolare i percorsi con bfs, astar, dijkstra
+    int x, y;
+    for (y = 0; y < map->size.height; y++) {
+        for (x = 0; x < map->size.width; x++) {
+
+            map_cell_t * cell = map_get_cell(map, PointMake(x, y));
+
+            //  le mura non vanno connesse
+            if (!cell_is_path(map, cell))
+                continue;
+
+            map_connect_cell(map, cell, 0);
+
+        }
+    }
+
+    //  tasselli da disegnare, cambiano solo con il tipo delle celle
+    map_tiling_update(map);
+
+}
+
+/**
+ *  Variabili del file di configurazione di una mappa
+ */
+typedef struct {
+
+    /** Dimensione della mappa */
+    dimension_t size;
+
+    /** Probabilità che una cella contenga un bonus */
+    float powerup_probability;
+
+    /** Tempo di attesa tra i bonus */
+    float powerups_time;
+
+    /** Limite di bonus */
+    long powerups_limit;
+
+    /** Struttura della mappa */
+    char * map;
+
+} map_config_t;
+
+/**
+ *  Schema del file di configurazione di una mappa
+ */
+static const config_schema_field_t map_config_schema[] = {
+    ConfigSchemaField(map_config_t, size, "size", CONFIG_VARTYPE_SIZE, true, NULL),
+    ConfigSchemaField(map_config_t, powerup_probability, "powerup_probability", CONFIG_VARTYPE_FLOAT, false, &(float){ 0.05 }),
+    ConfigSchemaField(map_config_t, powerups_time, "powerups_time", CONFIG_VARTYPE_FLOAT, false, &(float){ 10. }),
+    ConfigSchemaField(map_config_t, powerups_limit, "powerups_limit", CONFIG_VARTYPE_INT, false, &(long){ 5 }),
+    ConfigSchemaField(map_config_t, map, "map", CONFIG_VARTYPE_STRING, true, NULL)
+};
+
+bool map_configure(map_t * map, hashtable_t * config)
+{
+
+    map_config_t settings;
+
+    //  dimensione e struttura non possono cambiare, ma sono comunque richieste nel file
+    if (!config_schema_decode(config, map_config_schema, &settings, map->config_path))
+        return false;
+
+    //  probabilità che una cella contenga un potenziamento
+    map->powerup_probability = settings.powerup_probability;
+
+    //  tempo di attesa tra i bonus
+    map->powerups_time = settings.powerups_time;
+
+    //  limite di bonus
+    map->powerups_limit = settings.powerups_limit;
+
+    return true;
+
+}
+
+/**
+ *  Identificativo dei file di mappa binari ("MAPB")
+ */
+#define MAP_BINARY_MAGIC    0x4250414Du
+
+/**
+ *  Versione del formato binario, da incrementare ad ogni modifica
+ */
+#define MAP_BINARY_VERSION  1u
+
+/**
+ *  Intestazione di un file di mappa binario.
+ *  Segue, senza padding: tipi (width * height bytes), pesi (width * height bytes),
+ *  celle con un bonus ('P') e celle che possono contenerne uno (' '), un bit per cella,
+ *  e infine, allineate a 4 bytes, le posizioni degli avversari (indici uint32_t, nell'ordine del sorgente).
+ *  I valori sono nell'ordine dei bytes della macchina, come nella cache dei file di configurazione.
+ */
+typedef struct {
+
+    /** MAP_BINARY_MAGIC */
+    uint32_t magic;
+
+    /** MAP_BINARY_VERSION */
+    uint32_t version;
+
+    /** Dimensione, in celle */
+    uint32_t width;
+    uint32_t height;
+
+    /** Cella di ingresso */
+    uint32_t start_x;
+    uint32_t start_y;
+
+    /** Cella di uscita */
+    uint32_t end_x;
+    uint32_t end_y;
+
+    /** Impostazioni dei bonus (vedi map_config_t) */
+    float powerup_probability;
+    float powerups_time;
+    int32_t powerups_limit;
+
+    /** Numero di avversari */
+    uint32_t enemies;
+
+} map_binary_header_t;
+
+/**
+ *  Disposizione delle sezioni di un file di mappa binario
+ */
+typedef struct {
+
+    /** Offset delle sezioni */
+    size_t types;
+    size_t values;
+    size_t powerups;
+    size_t spaces;
+    size_t enemies;
+
+    /** Dimensione totale del file */
+    size_t length;
+
+} map_binary_layout_t;
+
+/**
+ *  Calcola la disposizione delle sezioni di un file di mappa binario
+ *
+ *  @param header Intestazione
+ *  @param layout Destinazione
+ *
+ *  @return false se le dimensioni non sono rappresentabili
+ */
+static bool map_binary_layout(const map_binary_header_t * header, map_binary_layout_t * layout)
+{
+
+    size_t count = (size_t)header->width * header->height;
+
+    //  tipi, pesi e bit dei bonus devono essere indirizzabili (sistemi a 32 bit)
+    if (header->height && count / header->height != header->width)
+        return false;
+
+    if (count > SIZE_MAX / 4)
+        return false;
+
+    size_t bits = (count + CHAR_BIT - 1) / CHAR_BIT;
+
+    layout->types = sizeof(*header);
+    layout->values = layout->types + count;
+    layout->powerups = layout->values + count;
+    layout->spaces = layout->powerups + bits;
+    layout->enemies = (layout->spaces + bits + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+
+    //  le posizioni degli avversari devono stare nello spazio indirizzabile rimanente
+    if ((size_t)header->enemies > (SIZE_MAX - layout->enemies) / sizeof(uint32_t))
+        return false;
+
+    layout->length = layout->enemies + sizeof(uint32_t) * (size_t)header->enemies;
+
+    return true;
+
+}
+
+/**
+ *  Verifica il contenuto di un file di mappa binario, che viene poi copiato senza controlli:
+ *  solo tipi prodotti da map_convert, pesi dei corridoi in CellValueRange,
+ *  ingresso e uscita su corridoi, bonus solo su corridoi
+ *
+ *  @param header Intestazione (dimensioni, ingresso e uscita già verificati)
+ *  @param layout Disposizione delle sezioni
+ *  @param data Contenuto del file
+ *
+ *  @return true se il contenuto è valido
+ */
+static bool map_binary_validate(const map_binary_header_t * header, const map_binary_layout_t * layout, const unsigned char * data)
+{
+
+    size_t count = (size_t)header->width * header->height;
+
+    const unsigned char * types = data + layout->types;
+    const unsigned char * values = data + layout->values;
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        //  le celle ignorate dal file testuale restano CELL_TYPE_UNKNOWN
+        if (types[i] == CELL_TYPE_WALL || types[i] == CELL_TYPE_UNKNOWN)
+            continue;
+
+        if (types[i] != CELL_TYPE_PATH || !RangeContainsValue(CellValueRange, values[i]))
+            return false;
+
+    }
+
+    if (types[(size_t)header->start_y * header->width + header->start_x] != CELL_TYPE_PATH ||
+        types[(size_t)header->end_y * header->width + header->end_x] != CELL_TYPE_PATH)
+        return false;
+
+    //  bit dei bonus: solo corridoi, nessun bit oltre l'ultima cella
+    const unsigned char * powerups = data + layout->powerups;
+    const unsigned char * spaces = data + layout->spaces;
+
+    size_t byte;
+    for (byte = 0; byte < layout->spaces - layout->powerups; byte++) {
+
+        unsigned int mask = powerups[byte] | spaces[byte];
+
+        if (!mask)
+            continue;
+
+        unsigned int bit;
+        for (bit = 0; bit < CHAR_BIT; bit++) {
+
+            size_t index = byte * CHAR_BIT + bit;
+
+            if (((mask >> bit) & 1) && (index >= count || types[index] != CELL_TYPE_PATH))
+                return false;
+
+        }
+
+    }
+
+    return true;
+
+}
+
+/**
+ *  Crea una mappa a partire da un file binario (vedi map_convert).
+ *  Il file è mappato in memoria: tipi e pesi sono copiati nella griglia senza alcuna analisi.
+ *
+ *  @param level Livello al quale apparterrà la mappa
+ *  @param path Percorso del file
+ *
+ *  @return Mappa (con le adiacenze da calcolare)
+ *  @retval NULL Se il file non esiste o non è valido
+ */
+static map_t * map_load_binary(level_t * level, const char * path)
+{
+
+    parser_t * parser = mapped_parser_new(path, true, NULL);
+
+    if (!parser)
+        return NULL;
+
+    const unsigned char * data = parser->buffer;
+
+    map_binary_header_t header;
+    map_binary_layout_t layout;
+
+    if (parser->length < sizeof(header)) {
+        mapped_parser_delete(parser);
+        return NULL;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != MAP_BINARY_MAGIC ||
+        header.version != MAP_BINARY_VERSION ||
+        !header.width || !header.height ||
+        header.width > MAP_SIZE_MAX || header.height > MAP_SIZE_MAX ||
+        header.start_x >= header.width || header.start_y >= header.height ||
+        header.end_x >= header.width || header.end_y >= header.height ||
+        !map_binary_layout(&header, &layout) ||
+        layout.length != parser->length ||
+        !map_binary_validate(&header, &layout, data)) {
+
+        errorf("[Mappa] %s non è una mappa binaria valida\n", path);
+        mapped_parser_delete(parser);
+        return NULL;
+
+    }
+
+    map_t * map = map_new(SizeMake(header.width, header.height), level);
+
+    size_t count = (size_t)header.width * header.height;
+
+    memcpy(map->types, data + layout.types, count);
+    memcpy(map->values, data + layout.values, count);
+
+    map->start = PointMake(header.start_x, header.start_y);
+    map->end = PointMake(header.end_x, header.end_y);
+
+    map->powerup_probability = header.powerup_probability;
+    map->powerups_time = header.powerups_time;
+    map->powerups_limit = header.powerups_limit;
+
+    //  celle dei bonus nell'ordine del sorgente, così con lo stesso seed
+    //  le celle estratte sono le stesse del caricamento del file testuale
+    const unsigned char * powerups = data + layout.powerups;
+    const unsigned char * spaces = data + layout.spaces;
+
+    size_t byte;
+    for (byte = 0; byte < layout.spaces - layout.powerups; byte++) {
+
+        //  interi gruppi di 8 celle senza bonus
+        if (!(powerups[byte] | spaces[byte]))
+            continue;
+
+        unsigned int bit;
+        for (bit = 0; bit < CHAR_BIT; bit++) {
+
+            size_t index = byte * CHAR_BIT + bit;
+
+            if (((powerups[byte] >> bit) & 1) || (((spaces[byte] >> bit) & 1) && random_bool(map->powerup_probability)))
+                map_powerup_cell_add(map, &map->cells[index]);
+
+        }
+
+    }
+
+    //  posizioni degli avversari
+    list_node_t * enemy_node = level->enemies->head;
+
+    uint32_t i;
+    for (i = 0; i < header.enemies; i++) {
+
+        uint32_t index;
+        memcpy(&index, data + layout.enemies + i * sizeof(index), sizeof(index));
+
+        if (index < count && map->types[index] == CELL_TYPE_PATH)
+            map_place_enemy(map, &enemy_node, map->cells[index].location);
+
+    }
+
+    mapped_parser_delete(parser);
+
+    //  se la mappa è più piccola della dimensione della finestra, va centrata
+    map_offset_calculate(map);
+
+    return map;
+
+}
+
+/**
+ *  Stato della conversione di una mappa testuale
+ */
+typedef struct {
+
+    /** Classe del carattere speciale di ogni cella (MAP_TOKEN_*), con le dimensioni del file di configurazione */
+    unsigned char * tokens;
+
+    /** Larghezza del file di configurazione */
+    size_t width;
+
+} map_convert_t;
+
+/**
+ *  Annota i caratteri speciali di una mappa in conversione (callback di map_scan)
+ *
+ *  @param data Stato della conversione
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param token Classe del carattere (MAP_TOKEN_*)
+ */
+static void map_convert_token(void * data, map_t * map, map_cell_t * cell, unsigned char token)
+{
+
+    unused(map);
+
+    map_convert_t * convert = data;
+
+    //  le coordinate non cambiano con il ridimensionamento finale della mappa, gli indici sì
+    convert->tokens[(size_t)cell->location.y * convert->width + (size_t)cell->location.x] = token;
+
+}
+
+bool map_convert(const char * config_path, const char * binary_path)
+{
+
+    hashtable_t * config = config_open((char *)config_path);
+
+    if (!config)
+        return false;
+
+    map_config_t settings;
+
+    if (!config_schema_decode(config, map_config_schema, &settings, config_path)) {
+        hashtable_delete(config);
+        return false;
+    }
+
+    map_t * map = map_new(settings.size, NULL);
+
+    if (!map) {
+        errorf("[Mappa] Impossibile convertire %s\n", config_path);
+        hashtable_delete(config);
+        return false;
+    }
+
+    map_convert_t convert;
+    convert.width = (size_t)settings.size.width;
+    convert.tokens = memalloc(unsigned char, convert.width * (size_t)settings.size.height, true);
+
+    if (!map_scan(map, settings.map, map_convert_token, &convert)) {
+        errorf("[Mappa] Errore nel parsing di %s\n", config_path);
+        memfree(convert.tokens);
+        map_delete(map);
+        hashtable_delete(config);
+        return false;
+    }
+
+    map_binary_header_t header;
+    map_binary_layout_t layout;
+
+    memset(&header, 0, sizeof(header));
+
+    header.magic = MAP_BINARY_MAGIC;
+    header.version = MAP_BINARY_VERSION;
+    header.width = (uint32_t)map->size.width;
+    header.height = (uint32_t)map->size.height;
+    header.start_x = (uint32_t)map->start.x;
+    header.start_y = (uint32_t)map->start.y;
+    header.end_x = (uint32_t)map->end.x;
+    header.end_y = (uint32_t)map->end.y;
+    header.powerup_probability = settings.powerup_probability;
+    header.powerups_time = settings.powerups_time;
+    header.powerups_limit = (int32_t)settings.powerups_limit;
+
+    size_t count = (size_t)header.width * header.height;
+
+    size_t index;
+    for (index = 0; index < count; index++) {
+        if (convert.tokens[(index / header.width) * convert.width + index % header.width] == MAP_TOKEN_ENEMY)
+            header.enemies++;
+    }
+
+    map_binary_layout(&header, &layout);
+
+    unsigned char * data = memalloc(unsigned char, layout.length, true);
+
+    memcpy(data, &header, sizeof(header));
+    memcpy(data + layout.types, map->types, count);
+    memcpy(data + layout.values, map->values, count);
+
+    uint32_t enemy = 0;
+
+    for (index = 0; index < count; index++) {
+
+        unsigned char token = convert.tokens[(index / header.width) * convert.width + index % header.width];
+        unsigned char bit = (unsigned char)(1u << (index % CHAR_BIT));
+
+        if (token == MAP_TOKEN_POWERUP) {
+            data[layout.powerups + index / CHAR_BIT] |= bit;
+        } else if (token == MAP_TOKEN_SPACE) {
+            data[layout.spaces + index / CHAR_BIT] |= bit;
+        } else if (token == MAP_TOKEN_ENEMY) {
+            uint32_t value = (uint32_t)index;
+            memcpy(data + layout.enemies + enemy++ * sizeof(value), &value, sizeof(value));
+        }
+
+    }
+
+    FILE * file = fopen(binary_path, "wb");
+
+    bool saved = false;
+
+    if (file) {
+        saved = fwrite(data, 1, layout.length, file) == layout.length;
+        saved = (fclose(file) == 0) && saved;
+    }
+
+    if (saved)
+        debugf("[Mappa] %s convertita in %s (%zu bytes)\n", config_path, binary_path, layout.length);
+    else
+        errorf("[Mappa] Impossibile scrivere %s\n", binary_path);
+
+    memfree(data);
+    memfree(convert.tokens);
+    map_delete(map);
+    hashtable_delete(config);
+
+    return saved;
+
+}
+
+/**
+ *  Verifica se un percorso indica un file di mappa binario (estensione MAP_BINARY_EXTENSION)
+ *
+ *  @param path Percorso
+ *
+ *  @return true se il file è binario
+ */
+static bool map_is_binary(const char * path)
+{
+
+    size_t length = strlen(path);
+    size_t extension = sizeof(MAP_BINARY_EXTENSION) - 1;
+
+    return length >= extension && !strcasecmp(path + length - extension, MAP_BINARY_EXTENSION);
+
+}
+
+map_t * map_load_new(level_t * level, char * config_file_path)
+{
+
+    //  mappa binaria, senza parsing
+    if (map_is_binary(config_file_path)) {
+
+        map_t * map = map_load_binary(level, config_file_path);
+
+        if (map)
+            map_connect(map);
+
+        return map;
+
+    }
+
+    //  lettura del file di configurazione
+    hashtable_t * map_config = config_open(config_file_path);
+
+    //  non problemi nel file di config
+    if (!map_config)
+        return NULL;
+
+    map_config_t settings;
+
+    //  il file di configurazione deve contenere dimensione e struttura della mappa
+    if (!config_schema_decode(map_config, map_config_schema, &settings, config_file_path)) {
+        hashtable_delete(map_config);
+        return NULL;
+    }
+
+    //  creazione mappa
+    map_t * map = map_new(settings.size, level);
+
+    if (!map) {
+        errorf("[Mappa] Impossibile caricare %s\n", config_file_path);
+        hashtable_delete(map_config);
+        return NULL;
+    }
+
+    //  file sorgente, per l'aggiornamento della configurazione durante il gioco
+    map->config_path = memstrdup(config_file_path);
+
+    //  impostazioni dei bonus
+    map->powerup_probability = settings.powerup_probability;
+    map->powerups_time = settings.powerups_time;
+    map->powerups_limit = settings.powerups_limit;
+
+    //  caricamento della struttura della mappa
+    char * map_struct = settings.map;
+
+    debugf("[Mappa] %s caricata:\n%s\n", config_file_path, map_struct);
+
+    //  parsing
+    if (!map_parse(level, map, map_struct)) {
+        //  errore di parsing
+        debugf("Errore nel parsing della mappa.\n", NULL);
+        map_delete(map);
+        map = NULL;
+    }
+
+    //  inizializzazione delle adiacenze delle celle
+    if (map)
+        map_connect(map);
+    
+    hashtable_delete(map_config);
+
+    return map;
+
+}
+
+void map_powerup_cell_add(map_t * map, map_cell_t * cell)
+{
+
+    //  la cella è già stata aggiunta (in fase di caricamento nessuna cella contiene bonus)
+    if (bag_contains(map->powerup_free_cells, cell))
+        return;
+
+    bag_insert(map->powerup_cells, cell);
+
+    if (!cell->powerup.powerup)
+        bag_insert(map->powerup_free_cells, cell);
+
+}
+
+void map_cell_set_powerup(map_t * map, map_cell_t * cell, powerup_t * powerup)
+{
+
+    cell->powerup.powerup = powerup;
+
+    if (powerup)
+        bag_remove(map->powerup_free_cells, cell);
+    else if (!bag_contains(map->powerup_free_cells, cell))
+        bag_insert(map->powerup_free_cells, cell);
+
+}
+
+void map_delete(map_t * map)
+{
+
+    //  1. celle dei bonus, prima della griglia (la bag indicizzata scrive nelle celle)
+    bag_delete(map->powerup_free_cells);
+    bag_delete(map->powerup_cells);
+
+    //  2. deallocazione griglia (celle, tipi, pesi e adiacenze) e insieme dei corridoi
+    memfree(map->cells);
+    map_paths_invalidate(map);
+
+    //  3. griglia dei personaggi, che restano senza riferimenti alla mappa
+    map_buckets_delete(map);
+    memfree(map->found);
+
+    //  4. sfondo e mura
+    image_delete(map->layer);
+    memfree(map->layer_dirty);
+
+    //  5. file di configurazione
+    memfree(map->config_path);
+
+    //  6. mondo del quale la mappa è una finestra
+    world_delete(map->world);
+
+    //  7. deallocazione mappa
+    memfree(map);
+
+}
+
+void map_layer_invalidate(map_t * map)
+{
+
+    map->layer_invalid = true;
+    map->layer_dirty_count = 0;
+
+}
+
+void map_layer_release(map_t * map)
+{
+
+    image_delete(map->layer);
+    map->layer = NULL;
+
+    memfree(map->layer_dirty);
+    map->layer_dirty = NULL;
+    map->layer_dirty_capacity = 0;
+
+    map_layer_invalidate(map);
+
+}
+
+void map_layer_invalidate_cell(map_t * map, size_t index)
+{
+
+    //  ridisegno completo già previsto
+    if (map->layer_invalid)
+        return;
+
+    if (map->layer_dirty_count == map->layer_dirty_capacity) {
+        map->layer_dirty_capacity = map->layer_dirty_capacity ? 2 * map->layer_dirty_capacity : 16;
+        map->layer_dirty = memrealloc(map->layer_dirty, unsigned int, map->layer_dirty_capacity);
+    }
+
+    map->layer_dirty[map->layer_dirty_count++] = (unsigned int)index;
+
+}
+
+void map_paths_invalidate(map_t * map)
+{
+
+    memfree(map->paths);
+    memfree(map->paths_positions);
+
+    map->paths = NULL;
+    map->paths_positions = NULL;
+    map->paths_count = 0;
+
+}
+
+/**
+ *  Calcola l'insieme dei corridoi di una mappa
+ *
+ *  @param map Mappa
+ */
+static void map_paths_build(map_t * map)
+{
+
+    size_t count = (size_t)map->size.width * (size_t)map->size.height;
+
+    map->paths = memalloc(unsigned int, (count ? count : 1));
+    map->paths_positions = memalloc(unsigned int, (count ? count : 1));
+    map->paths_count = 0;
+
+    size_t index;
+    for (index = 0; index < count; index++) {
+
+        if (map->types[index] == CELL_TYPE_PATH) {
+            map->paths_positions[index] = (unsigned int)map->paths_count;
+            map->paths[map->paths_count++] = (unsigned int)index;
+        } else {
+            map->paths_positions[index] = MAP_PATH_NONE;
+        }
+
     }
 
 }
 
-map_t * map_load_new(level_t * level, char * config_file_path)
+void map_paths_update(map_t * map, size_t index, bool path)
 {
 
-    //  lettura del file di configurazione
-    hashtable_t * map_config = config_open(config_file_path);
-
-    //  non problemi nel file di config
-    if (!map_config)
-        return NULL;
-
-    //  il file di configurazione deve contenere informazioni sulla dimensione
-    dimension_t * map_size = hashtable_search(map_config, "size");
+    if (path) {
 
-    //  se non ci sono è impossibile proseguire
-    if (!map_size) {
-        return NULL;
-    }
+        map->paths_positions[index] = (unsigned int)map->paths_count;
+        map->paths[map->paths_count++] = (unsigned int)index;
 
-    //  creazione mappa
-    map_t * map = map_new(*map_size, level);
+    } else if (map->paths_positions[index] != MAP_PATH_NONE) {
 
-    //  probabilità che una cella contenga un potenziamento
-    float * powerup_probability = hashtable_search(map_config, "powerup_probability");
-    map->powerup_probability = powerup_probability ? *powerup_probability : 0.05;
+        //  l'ultimo corridoio prende il posto della cella rimossa
+        unsigned int position = map->paths_positions[index];
+        unsigned int last = map->paths[--map->paths_count];
 
-    //  tempo di attesa tra i bonus
-    float * powerups_time = hashtable_search(map_config, "powerups_time");
-    map->powerups_time = powerups_time ? *powerups_time : 10.;
+        map->paths[position] = last;
+        map->paths_positions[last] = position;
+        map->paths_positions[index] = MAP_PATH_NONE;
 
-    //  limite di bonus
-    long * powerups_limit = hashtable_search(map_config, "powerups_limit");
-    map->powerups_limit = powerups_limit ? *powerups_limit : 5;
+    }
 
-    //  caricamento della struttura della mappa
-    char * map_struct = hashtable_search(map_config, "map");
+}
 
-    debugf("[Mappa] %s caricata:\n%s\n", config_file_path, map_struct);
+map_cell_t * map_random_cell_path(map_t * map)
+{
 
-    //  parsing
-    if (!map_parse(level, map, map_struct)) {
-        //  errore di parsing
-        debugf("Errore nel parsing della mappa.\n", NULL);
-        map_delete(map);
-        map = NULL;
-    }
+    if (!map->paths)
+        map_paths_build(map);
 
-    //  inizializzazione delle adiacenze delle celle
-    map_connect(map);
-    
-    hashtable_delete(map_config);
+    if (!map->paths_count)
+        return NULL;
 
-    return map;
+    return &map->cells[map->paths[random_int(0, (int)map->paths_count - 1)]];
 
 }
 
-void map_delete(map_t * map)
+map_cell_t * map_random_cell_path_near(map_t * map, point_t center, unsigned int distance, map_cell_function accept, void * data)
 {
 
-    //  1. deallocazione griglia
-    int y;
-    for (y = 0; y < map->size.height; y++) {
-        memfree(map->grid[y]);
-    }
+    int width = (int)map->size.width;
+    int height = (int)map->size.height;
 
-    memfree(map->grid);
+    int cx = (int)center.x, cy = (int)center.y;
+    int d = (int)distance;
 
-    //  2. lista delle celle
-    list_delete(map->powerup_cells);
+    //  campionamento a serbatoio: la k-esima cella accettabile sostituisce la scelta con probabilità 1/k
+    map_cell_t * chosen = NULL;
+    int accepted = 0;
 
-    //  3. deallocazione mappa
-    memfree(map);
+    int y;
+    for (y = (cy - d < 0) ? 0 : cy - d; y <= cy + d && y < height; y++) {
 
-}
+        //  larghezza del rombo sulla riga
+        int span = d - abs(y - cy);
+        int x_end = (cx + span < width) ? cx + span : width - 1;
 
-map_cell_t * map_get_cell(map_t * map, point_t location)
-{
+        int x;
+        for (x = (cx - span < 0) ? 0 : cx - span; x <= x_end; x++) {
 
-    return &map->grid[(int)location.y][(int)location.x];
+            size_t index = (size_t)y * (size_t)width + (size_t)x;
 
-}
+            if (map->types[index] != CELL_TYPE_PATH)
+                continue;
 
-map_cell_t * map_random_cell_path(map_t * map)
-{
+            map_cell_t * cell = &map->cells[index];
+
+            if (accept && !accept(data, map, cell))
+                continue;
+
+            if (random_int(0, accepted++) == 0)
+                chosen = cell;
 
-    point_t point = PointZero;
-    map_cell_t * cell;
+        }
 
-    do {
-        point.x = random_int(0, (int)map->size.width - 1);
-        point.y = random_int(0, (int)map->size.height - 1);
-        cell = map_get_cell(map, point);
-    } while (!cell_is_path(cell));
+    }
 
-    return cell;
+    return chosen;
 
 }
 
@@ -487,7 +1652,7 @@ void map_generate_randomize_weights(map_t * map, float complexity)
         map_cell_t * cell = map_random_cell_path(map);
 
         //  se la cella non ha già un peso diverso
-        if (cell_get_value(cell) == CellDefaultValue) {
+        if (map_cell_get_value(map, cell) == CellDefaultValue) {
 
             //  si sceglie una direzione casuale
             point_t offsets[] = {
@@ -513,7 +1678,7 @@ void map_generate_randomize_weights(map_t * map, float complexity)
             for (; length >= 0; --length) {
 
                 if (map_cell_is_path(map, current)) {
-                    cell_set_value(map_get_cell(map, current), value);
+                    map_cell_set_value(map, map_get_cell(map, current), value);
                 } else
                     break;
 
@@ -560,7 +1725,7 @@ void map_generate_structure_perfect(map_t * map, queue_t * deadends)
         unsigned int i;
         for (i = 0; i < 4; i++) {
             point_t point = PointPointOffset(cell->location, offsets[i][0]);
-            if (map_cell_is_valid(map, point) && !cell_is_path(map_get_cell(map, point))) {
+            if (map_cell_is_valid(map, point) && !cell_is_path(map, map_get_cell(map, point))) {
                 points[available][0] = point;
                 points[available][1] = PointPointOffset(cell->location, offsets[i][1]);
                 available++;
@@ -576,12 +1741,12 @@ void map_generate_structure_perfect(map_t * map, queue_t * deadends)
             cell = map_get_cell(map, points[available][0]);
 
             //  si crea un percorso
-            cell_set_is_path(cell);
-            cell_set_is_path(map_get_cell(map, points[available][1]));
+            cell_set_is_path(map, cell);
+            cell_set_is_path(map, map_get_cell(map, points[available][1]));
 
             //  la cella potrebbe contenere dei bonus
             if (random_bool(map->powerup_probability)) {
-                list_insert(map->powerup_cells, cell);
+                map_powerup_cell_add(map, cell);
             }
 
             queue_push(Q, cell);
@@ -652,7 +1817,7 @@ void map_generate_structure_braid(map_t * map, float deadends_probability)
 
             map_cell_t * cell = map_get_cell(map, p);
 
-            if (map_cell_is_valid(map, p) && !cell_is_path(cell))
+            if (map_cell_is_valid(map, p) && !cell_is_path(map, cell))
                 off[valid++] = offsets[i];
         }
 
@@ -664,7 +1829,7 @@ void map_generate_structure_braid(map_t * map, float deadends_probability)
         point_t offset = off[random_int(0, valid - 1)];
 
         //  si abbatte il muro
-        cell_set_is_path(map_get_cell(map, PointPointOffset(cell->location, offset)));
+        cell_set_is_path(map, map_get_cell(map, PointPointOffset(cell->location, offset)));
 
     }
 
@@ -672,6 +1837,410 @@ void map_generate_structure_braid(map_t * map, float deadends_probability)
 
 }
 
+/**
+ *  Celle scavate nelle quali potrebbe comparire un bonus (tutte tranne quella di partenza)
+ *
+ *  @param map Mappa generata
+ */
+static void map_generate_powerups(map_t * map)
+{
+
+    size_t x, y;
+    for (y = 1; y < (size_t)map->size.height; y += 2) {
+        for (x = (y == 1) ? 3 : 1; x < (size_t)map->size.width; x += 2) {
+
+            map_cell_t * cell = map_get_cell(map, PointMake(x, y));
+
+            if (cell_is_path(map, cell) && random_bool(map->powerup_probability))
+                map_powerup_cell_add(map, cell);
+
+        }
+    }
+
+}
+
+void map_grid_reload(map_t * map)
+{
+
+    size_t count = (size_t)map->size.width * (size_t)map->size.height;
+
+    //  i bonus presenti non corrispondono più alle celle, le celle dei bonus sono estratte di nuovo
+    bag_delete(map->powerup_free_cells);
+    bag_delete(map->powerup_cells);
+
+    size_t i;
+    for (i = 0; i < count; i++)
+        map->cells[i].powerup.powerup = NULL;
+
+    map->powerup_cells = bag_new(no_functions);
+    map->powerup_free_cells = bag_new(no_functions, map_cell_powerup_index);
+
+    if (map->powerup_probability > 0.)
+        map_generate_powerups(map);
+
+    //  adiacenze e tasselli calcolati da capo
+    memset(map->adjacency, 0, count);
+    map_connect(map);
+
+    map_paths_invalidate(map);
+    map_layer_invalidate(map);
+
+}
+
+/**
+ *  Genera il labirinto per righe con l'algoritmo di Eller (vedi maze_generate)
+ *
+ *  @param map Mappa di dimensioni dispari
+ *  @param deadends_probability Proabilità che un vicolo cieco sia eliminato
+ */
+void map_generate_structure_eller(map_t * map, float deadends_probability)
+{
+
+    size_t width = (size_t)map->size.width / 2;
+    size_t height = (size_t)map->size.height / 2;
+
+    bool generated = maze_generate(random_thread(), width, height, deadends_probability, maze_map_sink, map);
+
+    //  una sola volta per tutte le righe copiate (anche se la generazione è stata interrotta)
+    map_paths_invalidate(map);
+
+    if (!generated)
+        return;
+
+    map_generate_powerups(map);
+
+}
+
+/**
+ *  Lato, in celle (corridoi), delle regioni generate in parallelo
+ */
+#define MAP_REGION_SIZE 64
+
+/**
+ *  Regione rettangolare di un labirinto generato in parallelo (coordinate in celle, considerando solo i corridoi)
+ */
+typedef struct {
+
+    /** Prima colonna e prima riga */
+    size_t left;
+    size_t top;
+
+    /** Dimensione */
+    size_t width;
+    size_t height;
+
+    /** Generatore di numeri casuali della regione, indipendente da quello delle altre */
+    random_t random;
+
+} map_region_t;
+
+/**
+ *  Dati condivisi tra le regioni di un labirinto generato in parallelo
+ */
+typedef struct {
+
+    /** Mappa */
+    map_t * map;
+
+    /** Regioni */
+    map_region_t * regions;
+
+    /** Probabilità che un vicolo cieco sia eliminato */
+    float deadends_probability;
+
+} map_regions_t;
+
+/**
+ *  Indice nella mappa di una cella di una regione
+ *
+ *  @param map Mappa
+ *  @param region Regione
+ *  @param x Colonna della cella nella regione
+ *  @param y Riga della cella nella regione
+ *
+ *  @return Indice in map->types
+ */
+sinline size_t map_region_cell_index(map_t * map, map_region_t * region, size_t x, size_t y)
+{
+
+    return (2 * (region->top + y) + 1) * (size_t)map->size.width + 2 * (region->left + x) + 1;
+
+}
+
+/**
+ *  Scava un labirinto perfetto all'interno di una regione (backtracking con una pila esplicita).
+ *  Sono abbattuti solo i muri tra celle della regione, per cui più regioni possono essere
+ *  generate contemporaneamente (lavoro di thread_parallel_for)
+ *
+ *  @param index Indice della regione
+ *  @param data Regioni (map_regions_t *)
+ */
+static void map_region_carve(size_t index, void * data)
+{
+
+    map_regions_t * regions = data;
+    map_region_t * region = &regions->regions[index];
+    unsigned char * types = regions->map->types;
+
+    size_t width = region->width;
+    size_t height = region->height;
+
+    //  offset delle celle adiacenti: nord, sud, est, ovest
+    const long steps[4][2] = { { 0, -1 }, { 0, 1 }, { 1, 0 }, { -1, 0 } };
+
+    size_t * stack = memalloc(size_t, width * height);
+    size_t count = 0;
+
+    stack[count++] = 0;
+    types[map_region_cell_index(regions->map, region, 0, 0)] = CELL_TYPE_PATH;
+
+    while (count) {
+
+        size_t cell = stack[count - 1];
+        size_t x = cell % width, y = cell / width;
+
+        //  celle adiacenti della regione non ancora scavate
+        size_t candidates[4];
+        unsigned int available = 0;
+
+        unsigned int i;
+        for (i = 0; i < 4; i++) {
+
+            long nx = (long)x + steps[i][0], ny = (long)y + steps[i][1];
+
+            if (nx < 0 || ny < 0 || (size_t)nx >= width || (size_t)ny >= height)
+                continue;
+
+            if (types[map_region_cell_index(regions->map, region, (size_t)nx, (size_t)ny)] != CELL_TYPE_PATH)
+                candidates[available++] = (size_t)ny * width + (size_t)nx;
+
+        }
+
+        //  vicolo cieco, si torna indietro
+        if (!available) {
+            count--;
+            continue;
+        }
+
+        size_t next = candidates[random_next_int(&region->random, 0, available - 1)];
+
+        size_t from = map_region_cell_index(regions->map, region, x, y);
+        size_t to = map_region_cell_index(regions->map, region, next % width, next / width);
+
+        //  il muro interposto è a metà strada, sulla stessa riga o sulla stessa colonna
+        types[(from + to) / 2] = CELL_TYPE_PATH;
+        types[to] = CELL_TYPE_PATH;
+
+        stack[count++] = next;
+
+    }
+
+    memfree(stack);
+
+}
+
+/**
+ *  Elimina, con una certa probabilità, i vicoli ciechi di una regione abbattendo un muro interno alla regione.
+ *  Eseguita dopo il collegamento delle regioni: i muri di confine sono solo letti (lavoro di thread_parallel_for)
+ *
+ *  @param index Indice della regione
+ *  @param data Regioni (map_regions_t *)
+ */
+static void map_region_braid(size_t index, void * data)
+{
+
+    map_regions_t * regions = data;
+    map_region_t * region = &regions->regions[index];
+    unsigned char * types = regions->map->types;
+
+    long map_width = (long)regions->map->size.width;
+
+    //  muri intorno ad una cella: nord, sud, est, ovest
+    const long walls[4] = { -map_width, map_width, 1, -1 };
+
+    size_t x, y;
+    for (y = 0; y < region->height; y++) {
+        for (x = 0; x < region->width; x++) {
+
+            size_t cell = map_region_cell_index(regions->map, region, x, y);
+
+            //  muri interni alla regione: non sul bordo della regione nella relativa direzione
+            bool inner[4] = { y > 0, y + 1 < region->height, x + 1 < region->width, x > 0 };
+
+            unsigned int open = 0, available = 0;
+            size_t candidates[4];
+
+            unsigned int i;
+            for (i = 0; i < 4; i++) {
+
+                size_t wall = (size_t)((long)cell + walls[i]);
+
+                if (types[wall] == CELL_TYPE_PATH)
+                    open++;
+                else if (inner[i])
+                    candidates[available++] = wall;
+
+            }
+
+            //  solo i vicoli ciechi
+            if (open != 1 || !available || !random_next_bool(&region->random, regions->deadends_probability))
+                continue;
+
+            types[candidates[random_next_int(&region->random, 0, available - 1)]] = CELL_TYPE_PATH;
+
+        }
+    }
+
+}
+
+/**
+ *  Radice di una regione nella union-find del collegamento delle regioni
+ *
+ *  @param parent Genitori
+ *  @param region Regione
+ *
+ *  @return Radice
+ */
+static size_t map_region_find(size_t * parent, size_t region)
+{
+
+    while (parent[region] != region)
+        region = parent[region] = parent[parent[region]];
+
+    return region;
+
+}
+
+/**
+ *  Genera un labirinto dividendolo in regioni rettangolari scavate in parallelo,
+ *  ognuna con il proprio generatore di numeri casuali (ottenuto da quello del thread con random_split,
+ *  per cui il risultato non dipende dal numero di thread).
+ *  Le regioni sono poi collegate con un solo passaggio per ogni arco di un albero ricoprente casuale
+ *  del grafo delle regioni adiacenti: l'unione di alberi collegati da un albero è ancora un albero,
+ *  per cui il labirinto resta perfetto. Infine, se richiesto, i vicoli ciechi sono eliminati in parallelo.
+ *
+ *  @param map Mappa di dimensioni dispari, tutte mura
+ *  @param deadends_probability Proabilità che un vicolo cieco sia eliminato (0. = labirinto perfetto)
+ */
+void map_generate_structure_parallel(map_t * map, float deadends_probability)
+{
+
+    size_t width = (size_t)map->size.width / 2;
+    size_t height = (size_t)map->size.height / 2;
+
+    if (!width || !height)
+        return;
+
+    size_t columns = (width + MAP_REGION_SIZE - 1) / MAP_REGION_SIZE;
+    size_t rows = (height + MAP_REGION_SIZE - 1) / MAP_REGION_SIZE;
+    size_t count = columns * rows;
+
+    map_regions_t regions = { map, memalloc(map_region_t, count), deadends_probability };
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        map_region_t * region = &regions.regions[i];
+
+        region->left = (i % columns) * MAP_REGION_SIZE;
+        region->top = (i / columns) * MAP_REGION_SIZE;
+        region->width = (width - region->left < MAP_REGION_SIZE) ? width - region->left : MAP_REGION_SIZE;
+        region->height = (height - region->top < MAP_REGION_SIZE) ? height - region->top : MAP_REGION_SIZE;
+
+        random_split(random_thread(), &region->random);
+
+    }
+
+    thread_parallel_for(count, &regions, map_region_carve);
+
+    //  archi tra regioni adiacenti (a destra e in basso), in ordine casuale (Kruskal)
+    size_t * edges = memalloc(size_t, 2 * count);
+    size_t * parent = memalloc(size_t, count);
+    size_t edges_count = 0;
+
+    for (i = 0; i < count; i++) {
+
+        parent[i] = i;
+
+        if ((i % columns) + 1 < columns)
+            edges[edges_count++] = 2 * i;
+
+        if (i / columns + 1 < rows)
+            edges[edges_count++] = 2 * i + 1;
+
+    }
+
+    for (i = edges_count; i > 1; i--) {
+        size_t j = (size_t)random_int(0, (int)i - 1);
+        size_t edge = edges[i - 1];
+        edges[i - 1] = edges[j];
+        edges[j] = edge;
+    }
+
+    size_t map_width = (size_t)map->size.width;
+
+    for (i = 0; i < edges_count; i++) {
+
+        size_t a = edges[i] / 2;
+        bool vertical = edges[i] % 2;
+        size_t b = vertical ? a + columns : a + 1;
+
+        size_t root_a = map_region_find(parent, a), root_b = map_region_find(parent, b);
+
+        if (root_a == root_b)
+            continue;
+
+        parent[root_b] = root_a;
+
+        map_region_t * region = &regions.regions[a];
+        map_region_t * next = &regions.regions[b];
+
+        //  un passaggio in un punto casuale del confine
+        if (vertical) {
+            size_t x = region->left + (size_t)random_int(0, (int)region->width - 1);
+            map->types[2 * next->top * map_width + 2 * x + 1] = CELL_TYPE_PATH;
+        } else {
+            size_t y = region->top + (size_t)random_int(0, (int)region->height - 1);
+            map->types[(2 * y + 1) * map_width + 2 * next->left] = CELL_TYPE_PATH;
+        }
+
+    }
+
+    memfree(parent);
+    memfree(edges);
+
+    if (deadends_probability > 0.)
+        thread_parallel_for(count, &regions, map_region_braid);
+
+    memfree(regions.regions);
+
+    //  i tipi delle celle sono stati scritti direttamente
+    map_paths_invalidate(map);
+
+    map_generate_powerups(map);
+
+}
+
+/**
+ *  Celle nelle quali può essere posizionato un avversario (callback di map_random_cell_path_near)
+ *
+ *  @param data Non utilizzato
+ *  @param map Mappa
+ *  @param cell Cella
+ *
+ *  @return true se la cella non è l'ingresso, l'uscita o la posizione di un altro avversario
+ */
+static bool map_enemy_cell_accept(void * data, map_t * map, map_cell_t * cell)
+{
+
+    unused(data);
+
+    return !PointEqualToPoint(map->end, cell->location) &&
+           !PointEqualToPoint(map->start, cell->location) &&
+           cell_get_color(cell) != CELL_COLOR_BLACK;
+
+}
+
 void map_place_enemies(level_t * level, map_t * map) {
     
     //  gli avversari tendono ad essere posizionati al centro della mappa
@@ -686,18 +2255,17 @@ void map_place_enemies(level_t * level, map_t * map) {
         if (!PointIsNull(enemy->position) && !PointEqualToPoint(enemy->location, map->start))
             continue;
         
-        //  ricerca di una cella casuale che non coincida con le celle di inizio e fine
-        //  e che non sia troppo vicina all'uscita
-        map_cell_t * enemy_cell;
-        
-        do {
-            
-            enemy_cell = map_random_cell_path(map);
-            
-        } while (Manhattan(point, enemy_cell->location) > max_distance ||
-                 PointEqualToPoint(map->end, enemy_cell->location) ||
-                 PointEqualToPoint(map->start, enemy_cell->location) ||
-                 cell_get_color(enemy_cell) == CELL_COLOR_BLACK);
+        //  ricerca di una cella casuale vicina al centro che non coincida con le celle di inizio e fine
+        //  e non sia già occupata; se non ce ne sono la distanza è raddoppiata
+        map_cell_t * enemy_cell = NULL;
+        unsigned int distance = max_distance;
+
+        while (!(enemy_cell = map_random_cell_path_near(map, point, distance, map_enemy_cell_accept, NULL)) &&
+               distance < map->size.width + map->size.height)
+            distance *= 2;
+
+        if (!enemy_cell)
+            continue;
         
         //  assegnazione mappa e posizione
         enemy->map = map;
@@ -719,11 +2287,14 @@ map_t * map_generate(level_t * level, dimension_t size, bool start_on_x, bool ra
     //  creazione di una mappa tutte mura
     map_t * map = map_new(size, level);
 
+    if (!map)
+        return NULL;
+
     //  inizializzazione della mappa, inizialmente ogni cella è un muro
     int x, y;
     for (y = 0; y < size.height; y++) {
         for (x = 0; x < size.width; x++) {
-            cell_set_is_wall(map_get_cell(map, PointMake(x, y)));
+            cell_set_is_wall(map, map_get_cell(map, PointMake(x, y)));
         }
     }
 
@@ -732,7 +2303,11 @@ map_t * map_generate(level_t * level, dimension_t size, bool start_on_x, bool ra
     map->powerup_probability = 0.05 / level->complexity;
 
     //  tipo di mappa random da generare
-    if (!strcasecmp(type, "RANDOM PERFECT"))
+    if (!strncasecmp(type, "RANDOM ELLER", 12))
+        map_generate_structure_eller(map, strcasecmp(type, "RANDOM ELLER PERFECT") ? 0.2 : 0.);
+    else if (!strncasecmp(type, "RANDOM PARALLEL", 15))
+        map_generate_structure_parallel(map, strcasecmp(type, "RANDOM PARALLEL PERFECT") ? 0.2 : 0.);
+    else if (!strcasecmp(type, "RANDOM PERFECT"))
         map_generate_structure_perfect(map, NULL);
     else
         map_generate_structure_braid(map, 0.2);
@@ -775,7 +2350,7 @@ map_t * map_generate(level_t * level, dimension_t size, bool start_on_x, bool ra
 
     unsigned int i;
     for (i = 0; i < array_count(points); i++) {
-        cell_set_is_path(map_get_cell(map, points[i]));
+        cell_set_is_path(map, map_get_cell(map, points[i]));
     }
 
     map->start = points[0];
@@ -798,13 +2373,5 @@ map_t * map_generate(level_t * level, dimension_t size, bool start_on_x, bool ra
     return map;
 }
 
-unsigned int map_cell_location_to_index(map_t * map, point_t point)
-{
-
-    dimension_t map_size = map->size;
-
-    return (int)(point.y * map_size.width + point.x);
-
-}
 
 TYPE_FUNCTIONS_DEFINE(map, map_delete);
@@ -2,6 +2,9 @@
 #define game_map_h
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <limits.h>
+#include <stdint.h>
 
 #include "misc/geometry.h"
 
@@ -9,8 +12,30 @@
 #include "game/cell.h"
 #include "game/structs.h"
 
+#include "std/bag.h"
 #include "std/queue.h"
 
+/**
+ *  Lato, in celle, di un riquadro della griglia dei personaggi
+ */
+#define MAP_BUCKET_SIZE 4
+
+/**
+ *  Riquadro della griglia dei personaggi di una mappa
+ */
+typedef struct {
+
+    /** Personaggi la cui cella è nel riquadro */
+    character_t ** characters;
+
+    /** Numero di personaggi */
+    unsigned int count;
+
+    /** Capacità di characters */
+    unsigned int capacity;
+
+} map_bucket_t;
+
 /**
  *  Contiene le informazioni su una mappa
  */
@@ -28,8 +53,59 @@ struct map_s {
     /** Coordinate della cella di uscita della mappa */
     point_t end;
 
-    /** Griglia delle celle */
-    map_cell_t ** grid;
+    /** Celle della mappa, memorizzate per righe in un unico blocco (width * height) */
+    map_cell_t * cells;
+
+    /** Tipo di ogni cella (CELL_TYPE_*), con lo stesso indice di cells */
+    unsigned char * types;
+
+    /** Peso di ogni cella (CellValueRange), con lo stesso indice di cells */
+    unsigned char * values;
+
+    /** Adiacenze di ogni cella (CELL_ADJACENCY_*), con lo stesso indice di cells */
+    unsigned char * adjacency;
+
+    /** Tasselli di ogni cella (4 per cella, combinazioni di TILE_PART_*), con lo stesso indice di cells moltiplicato per 4 */
+    unsigned char * tiling;
+
+    /** Sfondo e mura della mappa, disegnati una sola volta (NULL se da creare, vedi output_map) */
+    image_t * layer;
+
+    /** Se true layer va ridisegnata interamente */
+    bool layer_invalid;
+
+    /** Indici delle celle da ridisegnare in layer */
+    unsigned int * layer_dirty;
+
+    /** Numero di celle in layer_dirty */
+    size_t layer_dirty_count;
+
+    /** Capacità di layer_dirty */
+    size_t layer_dirty_capacity;
+
+    /** Indici delle celle di tipo corridoio, per l'estrazione casuale in O(1) (NULL se da ricalcolare) */
+    unsigned int * paths;
+
+    /** Posizione di ogni cella in paths (MAP_PATH_NONE se non è un corridoio), con lo stesso indice di cells */
+    unsigned int * paths_positions;
+
+    /** Numero di corridoi in paths */
+    size_t paths_count;
+
+    /** Griglia dei personaggi presenti sulla mappa, per riquadri di MAP_BUCKET_SIZE celle (NULL se da allocare) */
+    map_bucket_t * buckets;
+
+    /** Numero di riquadri della griglia per riga */
+    size_t buckets_width;
+
+    /** Numero di riquadri della griglia per colonna */
+    size_t buckets_height;
+
+    /** Personaggi trovati dall'ultima ricerca (map_characters_query) */
+    character_t ** found;
+
+    /** Capacità di found */
+    size_t found_capacity;
 
     /** Probabilità che una cella della mappa possa contenere un bonus (0. = nessuna) */
     float powerup_probability;
@@ -37,8 +113,11 @@ struct map_s {
     /** Tempo di attesa minimo, in secondi, tra la comparsa di due bonus */
     int powerups_time;
 
-    /** Lista delle celle nelle quali può comparire un bonus */
-    list_t * powerup_cells;
+    /** Celle nelle quali può comparire un bonus */
+    bag_t * powerup_cells;
+
+    /** Celle nelle quali può comparire un bonus e che attualmente ne sono prive */
+    bag_t * powerup_free_cells;
 
     /** Orario dell'inserimento dell'ultimo bonus */
     time_t powerup_time;
@@ -49,8 +128,103 @@ struct map_s {
     /** Prossima mappa nel livello */
     struct map_s * next;
 
+    /** File di configurazione dal quale è stata caricata (NULL se generata) */
+    char * config_path;
+
+    /** Mondo del quale la mappa è una finestra (NULL se la mappa è completa, vedi world_map_new) */
+    world_t * world;
+
 };
 
+/**
+ *  Posizione in map_t.paths delle celle che non sono corridoi
+ */
+#define MAP_PATH_NONE   UINT_MAX
+
+/**
+ *  Aggiorna l'insieme dei corridoi di una mappa dopo il cambio di tipo di una cella
+ *
+ *  @param map Mappa (con map->paths valido)
+ *  @param index Indice della cella
+ *  @param path Se true la cella è diventata un corridoio, altrimenti non lo è più
+ */
+void map_paths_update(map_t * map, size_t index, bool path);
+
+/**
+ *  Invalida l'insieme dei corridoi di una mappa, ricalcolato alla prossima estrazione.
+ *  Va chiamata dopo aver scritto direttamente in map->types
+ *
+ *  @param map Mappa
+ */
+void map_paths_invalidate(map_t * map);
+
+/**
+ *  Invalida l'immagine di sfondo e mura di una mappa, ridisegnata interamente al prossimo disegno
+ *
+ *  @param map Mappa
+ */
+void map_layer_invalidate(map_t * map);
+
+/**
+ *  Rilascia l'immagine di sfondo e mura di una mappa, ricreata al prossimo disegno.
+ *  Va chiamata quando la mappa smette di essere quella corrente
+ *
+ *  @param map Mappa
+ */
+void map_layer_release(map_t * map);
+
+/**
+ *  Segnala che l'aspetto di una cella è cambiato (es. tipo o tasselli):
+ *  la cella sarà ridisegnata nell'immagine di sfondo e mura al prossimo disegno
+ *
+ *  @param map Mappa
+ *  @param index Indice della cella
+ */
+void map_layer_invalidate_cell(map_t * map, size_t index);
+
+/**
+ *  Aggiorna la posizione di un personaggio nella griglia dei personaggi della sua mappa.
+ *  Va chiamata quando cambiano la mappa (character->map) o la cella (character->location)
+ *
+ *  @param character Personaggio
+ */
+void map_characters_update(character_t * character);
+
+/**
+ *  Rimuove un personaggio dalla griglia dei personaggi nella quale è registrato
+ *
+ *  @param character Personaggio
+ */
+void map_characters_remove(character_t * character);
+
+/**
+ *  Personaggi di una mappa che possono trovarsi in un riquadro: quelli registrati nei riquadri
+ *  della griglia che lo intersecano, con il margine di una cella (la cella di un personaggio
+ *  è aggiornata dopo lo spostamento). Il controllo esatto spetta al chiamante.
+ *
+ *  @param map Mappa
+ *  @param rect Riquadro, in pixel
+ *  @param count Numero di personaggi trovati
+ *
+ *  @return Personaggi trovati, validi fino alla prossima ricerca sulla stessa mappa
+ */
+character_t ** map_characters_query(map_t * map, rectangle_t rect, size_t * count);
+
+/**
+ *  Converte le coordinate di una cella (x, y) in un singolo indice
+ *
+ *  @param map Mappa
+ *  @param point Coordinate della cella
+ *
+ *  @return Indice
+ */
+sinline unsigned int map_cell_location_to_index(map_t * map, point_t point)
+{
+
+    return (unsigned int)((int)point.y * (int)map->size.width + (int)point.x);
+
+}
+
 /**
  *  Accesso ad una cella di una mappa
  *
@@ -59,7 +233,190 @@ struct map_s {
  *
  *  @return Cella
  */
-map_cell_t * map_get_cell(map_t * map, point_t location);
+sinline map_cell_t * map_get_cell(map_t * map, point_t location)
+{
+
+    return &map->cells[map_cell_location_to_index(map, location)];
+
+}
+
+/**
+ *  Indice di una cella della mappa in cells, types e values
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *
+ *  @return Indice
+ */
+sinline size_t map_cell_index(map_t * map, map_cell_t * cell)
+{
+
+    return (size_t)(cell - map->cells);
+
+}
+
+/**
+ *  Fornisce l'accesso al tipo di una cella
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *
+ *  @return Tipo (CELL_TYPE_*)
+ */
+sinline int map_cell_get_type(map_t * map, map_cell_t * cell)
+{
+
+    return map->types[map_cell_index(map, cell)];
+
+}
+
+/**
+ *  Imposta il tipo di una cella
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param type Tipo (CELL_TYPE_*)
+ */
+sinline void map_cell_set_type(map_t * map, map_cell_t * cell, int type)
+{
+
+    size_t index = map_cell_index(map, cell);
+
+    //  l'insieme dei corridoi, se già calcolato, è aggiornato solo se la cella cambia calpestabilità
+    if (map->paths && (map->types[index] == CELL_TYPE_PATH) != (type == CELL_TYPE_PATH))
+        map_paths_update(map, index, type == CELL_TYPE_PATH);
+
+    map->types[index] = (unsigned char)type;
+
+}
+
+/**
+ *  Fornisce l'accesso al peso degli archi entranti in una cella
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *
+ *  @return Valore
+ */
+sinline int map_cell_get_value(map_t * map, map_cell_t * cell)
+{
+
+    return map->values[map_cell_index(map, cell)];
+
+}
+
+/**
+ *  Imposta il valore di una cella
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param value Valore [1-9]
+ */
+sinline void map_cell_set_value(map_t * map, map_cell_t * cell, int value)
+{
+
+    map->values[map_cell_index(map, cell)] = (unsigned char)RangeNormalizedValue(CellValueRange, value);
+
+}
+
+/**
+ *  Indice della cella adiacente in una certa direzione, considerando gli sconfinamenti
+ *  (a est della colonna width - 1 c'è la colonna 0, a sud dell'ultima riga c'è la prima)
+ *
+ *  @param map Mappa
+ *  @param index Indice della cella
+ *  @param direction Direzione (CELL_DIRECTION_*)
+ *
+ *  @return Indice dell'adiacente
+ */
+sinline size_t map_cell_adjacent_index(map_t * map, size_t index, int direction)
+{
+
+    size_t width = (size_t)map->size.width;
+    size_t count = width * (size_t)map->size.height;
+
+    switch (direction) {
+
+    case CELL_DIRECTION_NORTH:
+        return (index >= width) ? index - width : index + count - width;
+
+    case CELL_DIRECTION_SOUTH:
+        return (index + width < count) ? index + width : index + width - count;
+
+    case CELL_DIRECTION_EAST:
+        return ((index + 1) % width) ? index + 1 : index + 1 - width;
+
+    default:
+        return (index % width) ? index - 1 : index + width - 1;
+
+    }
+
+}
+
+/**
+ *  Costruisce la lista di adiacenza di una cella a partire dalla sua maschera
+ *  (ordine: nord, sud, est, ovest)
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param adjacency Destinazione della lista di adiacenza
+ *
+ *  @return Lunghezza della lista
+ */
+sinline unsigned int cell_get_adjacency(map_t * map, map_cell_t * cell, map_cell_t * adjacency[4])
+{
+
+    //  direzioni corrispondenti ad ogni combinazione dei 4 bit
+    static const struct {
+
+        unsigned char length;
+        unsigned char directions[CELL_DIRECTION_LAST];
+
+    } table[CELL_ADJACENCY_DIRECTIONS + 1] = {
+
+        { 0, { 0 } },
+        { 1, { CELL_DIRECTION_NORTH } },
+        { 1, { CELL_DIRECTION_SOUTH } },
+        { 2, { CELL_DIRECTION_NORTH, CELL_DIRECTION_SOUTH } },
+        { 1, { CELL_DIRECTION_EAST } },
+        { 2, { CELL_DIRECTION_NORTH, CELL_DIRECTION_EAST } },
+        { 2, { CELL_DIRECTION_SOUTH, CELL_DIRECTION_EAST } },
+        { 3, { CELL_DIRECTION_NORTH, CELL_DIRECTION_SOUTH, CELL_DIRECTION_EAST } },
+        { 1, { CELL_DIRECTION_WEST } },
+        { 2, { CELL_DIRECTION_NORTH, CELL_DIRECTION_WEST } },
+        { 2, { CELL_DIRECTION_SOUTH, CELL_DIRECTION_WEST } },
+        { 3, { CELL_DIRECTION_NORTH, CELL_DIRECTION_SOUTH, CELL_DIRECTION_WEST } },
+        { 2, { CELL_DIRECTION_EAST, CELL_DIRECTION_WEST } },
+        { 3, { CELL_DIRECTION_NORTH, CELL_DIRECTION_EAST, CELL_DIRECTION_WEST } },
+        { 3, { CELL_DIRECTION_SOUTH, CELL_DIRECTION_EAST, CELL_DIRECTION_WEST } },
+        { 4, { CELL_DIRECTION_NORTH, CELL_DIRECTION_SOUTH, CELL_DIRECTION_EAST, CELL_DIRECTION_WEST } }
+
+    };
+
+    size_t index = map_cell_index(map, cell);
+    unsigned char mask = map->adjacency[index];
+
+    ptrdiff_t width = (ptrdiff_t)map->size.width;
+    const ptrdiff_t offsets[CELL_DIRECTION_LAST] = { -width, width, 1, -1 };
+
+    unsigned int length = table[mask & CELL_ADJACENCY_DIRECTIONS].length;
+    const unsigned char * directions = table[mask & CELL_ADJACENCY_DIRECTIONS].directions;
+
+    unsigned int i;
+    for (i = 0; i < length; i++) {
+
+        //  solo le celle che sconfinano richiedono il calcolo con i bordi
+        size_t adjacent = (mask & CELL_ADJACENCY_WRAP) ?
+                          map_cell_adjacent_index(map, index, directions[i]) :
+                          (size_t)((ptrdiff_t)index + offsets[directions[i]]);
+
+        adjacency[i] = &map->cells[adjacent];
+
+    }
+
+    return length;
+
+}
 
 /**
  *  Verifica la validità delle coordinate di una cella sulla mappa
@@ -91,17 +448,24 @@ sinline bool map_cell_is_valid(map_t * map, point_t location)
  */
 #define map_cell_is_path(map, point)        (map &&     \
                                              map_cell_is_valid(map, point) &&   \
-                                             cell_is_path(map_get_cell(map, point)))
+                                             map->types[map_cell_location_to_index(map, point)] == CELL_TYPE_PATH)
 
 /**
- *  Converte le coordinate di una cella (x, y) in un singolo indice
+ *  Lato massimo di una mappa, in celle. Le posizioni dei personaggi sono a virgola fissa,
+ *  con parte intera fino a INT16_MAX (vedi misc/fixed.h): resta una cella di margine oltre
+ *  il bordo (personaggi che escono dalla mappa, cella controllata da character_wall).
+ *  Il numero di celle resta così entro INT32_MAX, come per gli indici a 32 bit di game/crowd.c
+ */
+#define MAP_SIZE_MAX    (INT16_MAX - 1)
+
+/**
+ *  Controlla le dimensioni di una mappa: lati interi in [1, MAP_SIZE_MAX]
  *
- *  @param map Mappa
- *  @param point Coordinate della cella
+ *  @param size Dimensione della mappa in celle
  *
- *  @return Indice
+ *  @return true se una mappa può avere queste dimensioni
  */
-unsigned int map_cell_location_to_index(map_t * map, point_t point);
+bool map_size_is_valid(dimension_t size);
 
 /**
  *  Creazione di una nuova mappa vuota
@@ -110,19 +474,51 @@ unsigned int map_cell_location_to_index(map_t * map, point_t point);
  *  @param level Livello al quale apparterrà la mappa
  *
  *  @return Mappa
+ *  @retval NULL Se le dimensioni non sono valide (vedi map_size_is_valid)
  */
 map_t * map_new(dimension_t size, level_t * level);
 
+/**
+ *  Estensione dei file di mappa binari (vedi map_convert)
+ */
+#define MAP_BINARY_EXTENSION    ".mapb"
+
 /**
  *  Creazione di una nuova mappa a partire dal parsing di un file di configurazione
+ *  o, se il percorso ha estensione MAP_BINARY_EXTENSION, da un file di mappa binario
  *
  *  @param level Livello al quale apparterrà la mappa
- *  @param path Percorso del file di configurazione
+ *  @param path Percorso del file di configurazione o del file binario
  *
  *  @return Mappa
+ *  @retval NULL Se il file non è valido o le dimensioni superano MAP_SIZE_MAX
  */
 map_t * map_load_new(level_t * level, char * path);
 
+/**
+ *  Converte il file di configurazione di una mappa in un file di mappa binario,
+ *  caricato da map_load_new mappandolo in memoria, senza alcun parsing.
+ *  Il file contiene tipi e pesi delle celle, ingresso e uscita, le celle dei bonus
+ *  e delle posizioni degli avversari e le impostazioni dei bonus.
+ *
+ *  @param config_path Percorso del file di configurazione
+ *  @param binary_path Percorso del file binario
+ *
+ *  @return Esito della conversione
+ */
+bool map_convert(const char * config_path, const char * binary_path);
+
+/**
+ *  Aggiorna le impostazioni dei bonus di una mappa (probabilità, attesa, limite)
+ *  a partire dal suo file di configurazione
+ *
+ *  @param map Mappa
+ *  @param config Hashtable contenente la configurazione della mappa
+ *
+ *  @return true se la configurazione è valida
+ */
+bool map_configure(map_t * map, hashtable_t * config);
+
 /**
  *  Genera una mappa in maniera casuale e la associa ad un certo livello
  *
@@ -130,9 +526,12 @@ map_t * map_load_new(level_t * level, char * path);
  *  @param size Dimensioni della mappa, in celle, considerando solo i corridoi
  *  @param start_on_x Se falso posiziona l'entrata sull'asse y
  *  @param randomize_weights Se assegnare ad ogni cella un peso casuale
- *  @param type Tipo di labirinto (RANDOM_BRAID -> labirinto senza vicoli ciechi, RANDOM -> labirinto perfetto)
+ *  @param type Tipo di labirinto (RANDOM PERFECT -> labirinto perfetto, RANDOM -> con pochi vicoli ciechi,
+ *              RANDOM ELLER / RANDOM ELLER PERFECT -> come i precedenti ma generati per righe, vedi maze_generate,
+ *              RANDOM PARALLEL / RANDOM PARALLEL PERFECT -> come i precedenti ma generati per regioni in parallelo)
  *
  *  @return Mappa generata casualmente
+ *  @retval NULL Se le dimensioni superano MAP_SIZE_MAX
  */
 map_t * map_generate(level_t * level, dimension_t size, bool start_on_x, bool randomize_weights, char * type);
 
@@ -151,6 +550,24 @@ void map_place_enemies(level_t * level, map_t * map);
  */
 void map_delete(map_t * map);
 
+/**
+ *  Aggiunge una cella all'insieme di quelle che possono contenere un bonus
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ */
+void map_powerup_cell_add(map_t * map, map_cell_t * cell);
+
+/**
+ *  Associa (o rimuove, se powerup è NULL) un bonus ad una cella della mappa
+ *  mantenendo aggiornato l'insieme delle celle libere
+ *
+ *  @param map Mappa
+ *  @param cell Cella
+ *  @param powerup Bonus
+ */
+void map_cell_set_powerup(map_t * map, map_cell_t * cell, powerup_t * powerup);
+
 /**
  *  Inizializza il grafo della mappa ripristinando i valori di default delle proprietà:
  *  - parent
@@ -179,12 +596,20 @@ void map_dispose_charcter(map_t * map, character_t * character);
 
 /**
  *  Effettua le connessioni tra ogni cella delle mappa e le sue 4 adiacenze
- *  per costurire il grafo della mappa
+ *  per costurire il grafo della mappa, e calcola i tasselli di ogni cella (vedi map_tiling_update)
  *
  *  @param map Mappa
  */
 void map_connect(map_t * map);
 
+/**
+ *  Aggiorna una mappa dopo la sostituzione di tipi e pesi di tutte le celle (es. lettura di una
+ *  finestra del mondo): celle dei bonus estratte di nuovo, adiacenze, tasselli, corridoi e sfondo
+ *
+ *  @param map Mappa
+ */
+void map_grid_reload(map_t * map);
+
 /**
  *  Effettua le connessioni tra una cella delle mappa e le sue 4 adiacenze
  *
@@ -203,14 +628,43 @@ void map_connect_cell(map_t * map, map_cell_t * cell, bool all_directions);
 void map_update(game_t * game, map_t * map);
 
 /**
- *  Ricerca una cella casuale di tipo corridoio nella mappa
+ *  Estrae una cella casuale di tipo corridoio, con probabilità uniforme e in tempo costante
+ *  (l'insieme dei corridoi è calcolato alla prima estrazione e poi aggiornato ad ogni cambio di tipo)
  *
  *  @param map Mappa
  *
  *  @return Cella di tipo corridoio
+ *  @retval NULL Se la mappa non contiene corridoi
  */
 map_cell_t * map_random_cell_path(map_t * map);
 
+/**
+ *  Funzione che stabilisce se una cella è accettabile
+ *
+ *  @param data Dati dell'utente
+ *  @param map Mappa
+ *  @param cell Cella
+ *
+ *  @return true se la cella è accettabile
+ */
+typedef bool (* map_cell_function)(void * data, map_t * map, map_cell_t * cell);
+
+/**
+ *  Estrae, con probabilità uniforme, una cella di tipo corridoio entro una certa distanza
+ *  (di Manhattan) da un punto, tra quelle accettate da accept.
+ *  Sono esaminate solo le celle entro la distanza, indipendentemente dalla dimensione della mappa
+ *
+ *  @param map Mappa
+ *  @param center Punto
+ *  @param distance Distanza massima
+ *  @param accept Funzione che stabilisce se una cella è accettabile (NULL = tutte)
+ *  @param data Dati passati ad accept
+ *
+ *  @return Cella di tipo corridoio
+ *  @retval NULL Se non ci sono celle accettabili entro la distanza
+ */
+map_cell_t * map_random_cell_path_near(map_t * map, point_t center, unsigned int distance, map_cell_function accept, void * data);
+
 /**
  *  Controlla se un punto della mappa è sui confini
  *
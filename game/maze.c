@@ -0,0 +1,352 @@
+#include <string.h>
+
+#include "utils.h"
+
+#include "game/maze.h"
+#include "game/map.h"
+#include "game/cell.h"
+
+/**
+ *  Insieme non assegnato
+ */
+#define MAZE_SET_NONE   ((size_t)-1)
+
+/**
+ *  Stato del generatore, proporzionale alla larghezza del labirinto
+ */
+typedef struct {
+
+    /** Generatore di numeri casuali */
+    random_t * random;
+
+    /** Bit casuali non ancora utilizzati (per le scelte con probabilità 1/2) */
+    uint32_t bits;
+
+    /** Numero di bit in bits */
+    unsigned int bits_count;
+
+    /** Larghezza in celle */
+    size_t width;
+
+    /** Insieme di ogni cella della riga corrente, in [0, width) */
+    size_t * sets;
+
+    /** Union-find sugli insiemi della riga corrente */
+    size_t * parent;
+
+    /** Ultima cella di ogni insieme nella riga corrente */
+    size_t * last;
+
+    /** Nuovo identificativo di ogni insieme nella riga successiva */
+    size_t * labels;
+
+    /** Se true l'insieme ha almeno una cella collegata alla riga successiva */
+    bool * open;
+
+    /** Finestra: muro a nord, riga delle celle, muro a sud (2 * width + 1 caselle ciascuna) */
+    unsigned char * rows[3];
+
+} maze_t;
+
+/**
+ *  Radice dell'insieme che contiene set (con compressione dei percorsi)
+ *
+ *  @param maze Generatore
+ *  @param set Insieme
+ *
+ *  @return Radice
+ */
+static size_t maze_find(maze_t * maze, size_t set)
+{
+
+    while (maze->parent[set] != set) {
+        maze->parent[set] = maze->parent[maze->parent[set]];
+        set = maze->parent[set];
+    }
+
+    return set;
+
+}
+
+/**
+ *  Scelta con probabilità 1/2: un bit casuale per scelta invece di un numero per scelta
+ *
+ *  @param maze Generatore
+ *
+ *  @return true/false
+ */
+static bool maze_coin(maze_t * maze)
+{
+
+    //  solo i 32 bit meno significativi, unsigned long può essere a 32 bit
+    if (!maze->bits_count) {
+        maze->bits = random_next(maze->random);
+        maze->bits_count = 32;
+    }
+
+    bool coin = maze->bits & 1;
+
+    maze->bits >>= 1;
+    maze->bits_count--;
+
+    return coin;
+
+}
+
+/**
+ *  Collega le celle della riga corrente a quelle adiacenti in orizzontale.
+ *  Nell'ultima riga tutti gli insiemi ancora separati vanno uniti.
+ *
+ *  @param maze Generatore
+ *  @param row Riga delle celle
+ *  @param last_row Se true è l'ultima riga del labirinto
+ */
+static void maze_join_row(maze_t * maze, unsigned char * row, bool last_row)
+{
+
+    size_t x;
+    for (x = 0; x + 1 < maze->width; x++) {
+
+        size_t a = maze_find(maze, maze->sets[x]);
+        size_t b = maze_find(maze, maze->sets[x + 1]);
+
+        if (a != b && (last_row || maze_coin(maze))) {
+            maze->parent[b] = a;
+            row[2 * x + 2] = CELL_TYPE_PATH;
+        }
+
+    }
+
+}
+
+/**
+ *  Collega ogni insieme alla riga successiva con almeno una cella
+ *  e prepara gli insiemi della riga successiva
+ *
+ *  @param maze Generatore
+ *  @param south Muro a sud della riga corrente
+ */
+static void maze_join_down(maze_t * maze, unsigned char * south)
+{
+
+    size_t width = maze->width;
+    size_t x;
+
+    //  radici degli insiemi e loro ultima cella nella riga
+    for (x = 0; x < width; x++) {
+        size_t set = maze->sets[x] = maze_find(maze, maze->sets[x]);
+        maze->last[set] = x;
+        maze->open[set] = false;
+        maze->labels[set] = MAZE_SET_NONE;
+    }
+
+    //  collegamenti verticali, obbligatorio nell'ultima cella di un insieme ancora chiuso.
+    //  Le celle collegate mantengono l'insieme (rinumerato), le altre ne ricevono uno nuovo:
+    //  al più un nuovo identificativo per cella, per cui restano in [0, width)
+    size_t count = 0;
+
+    for (x = 0; x < width; x++) {
+
+        size_t set = maze->sets[x];
+
+        bool down = maze_coin(maze) || (maze->last[set] == x && !maze->open[set]);
+
+        if (down) {
+
+            maze->open[set] = true;
+            south[2 * x + 1] = CELL_TYPE_PATH;
+
+            if (maze->labels[set] == MAZE_SET_NONE)
+                maze->labels[set] = count++;
+
+            maze->sets[x] = maze->labels[set];
+
+        } else {
+            maze->sets[x] = count++;
+        }
+
+    }
+
+    for (x = 0; x < width; x++)
+        maze->parent[x] = x;
+
+}
+
+/**
+ *  Elimina, con una certa probabilità, i vicoli ciechi della riga corrente abbattendo un muro
+ *  (i muri di bordo non sono abbattuti)
+ *
+ *  @param maze Generatore
+ *  @param braid Probabilità che un vicolo cieco sia eliminato
+ *  @param first_row Se true è la prima riga del labirinto
+ *  @param last_row Se true è l'ultima riga del labirinto
+ */
+static void maze_braid_row(maze_t * maze, float braid, bool first_row, bool last_row)
+{
+
+    unsigned char * north = maze->rows[0];
+    unsigned char * row = maze->rows[1];
+    unsigned char * south = maze->rows[2];
+
+    size_t x;
+    for (x = 0; x < maze->width; x++) {
+
+        size_t column = 2 * x + 1;
+
+        //  solo i vicoli ciechi: un solo lato aperto
+        unsigned int open = (north[column] == CELL_TYPE_PATH) + (south[column] == CELL_TYPE_PATH) +
+                            (row[column - 1] == CELL_TYPE_PATH) + (row[column + 1] == CELL_TYPE_PATH);
+
+        if (open != 1)
+            continue;
+
+        //  muri intorno alla cella: nord, sud, ovest, est
+        unsigned char * walls[] = { &north[column], &south[column], &row[column - 1], &row[column + 1] };
+        bool removable[] = { !first_row, !last_row, x > 0, x + 1 < maze->width };
+
+        unsigned int available = 0;
+        unsigned char * candidates[4];
+
+        unsigned int i;
+        for (i = 0; i < array_count(walls); i++) {
+
+            if (*walls[i] != CELL_TYPE_PATH && removable[i])
+                candidates[available++] = walls[i];
+
+        }
+
+        if (!available || !random_next_bool(maze->random, braid))
+            continue;
+
+        *candidates[random_next_int(maze->random, 0, available - 1)] = CELL_TYPE_PATH;
+
+    }
+
+}
+
+bool maze_generate(random_t * random, size_t width, size_t height, float braid, maze_row_function sink, void * data)
+{
+
+    if (!random || !sink || !width || !height)
+        return false;
+
+    size_t map_width = 2 * width + 1;
+
+    maze_t maze;
+
+    maze.random = random;
+    maze.bits = 0;
+    maze.bits_count = 0;
+    maze.width = width;
+    maze.sets = memalloc(size_t, width);
+    maze.parent = memalloc(size_t, width);
+    maze.last = memalloc(size_t, width);
+    maze.labels = memalloc(size_t, width);
+    maze.open = memalloc(bool, width);
+
+    unsigned char * block = memalloc(unsigned char, (3 * map_width));
+
+    maze.rows[0] = block;
+    maze.rows[1] = block + map_width;
+    maze.rows[2] = block + 2 * map_width;
+
+    //  ogni cella della prima riga in un insieme diverso
+    size_t x;
+    for (x = 0; x < width; x++)
+        maze.sets[x] = maze.parent[x] = x;
+
+    //  bordo superiore
+    memset(maze.rows[0], CELL_TYPE_WALL, map_width);
+
+    bool result = true;
+
+    size_t y;
+    for (y = 0; y < height && result; y++) {
+
+        bool last_row = (y == height - 1);
+
+        unsigned char * row = maze.rows[1];
+        unsigned char * south = maze.rows[2];
+
+        memset(row, CELL_TYPE_WALL, map_width);
+        memset(south, CELL_TYPE_WALL, map_width);
+
+        for (x = 0; x < width; x++)
+            row[2 * x + 1] = CELL_TYPE_PATH;
+
+        maze_join_row(&maze, row, last_row);
+
+        if (!last_row)
+            maze_join_down(&maze, south);
+
+        if (braid > 0.)
+            maze_braid_row(&maze, braid, y == 0, last_row);
+
+        //  muro a nord e riga delle celle non saranno più modificati
+        result = sink(data, 2 * y, maze.rows[0], map_width) && sink(data, 2 * y + 1, row, map_width);
+
+        //  il muro a sud diventa il muro a nord della riga successiva
+        maze.rows[1] = maze.rows[0];
+        maze.rows[0] = south;
+        maze.rows[2] = row;
+
+    }
+
+    //  bordo inferiore
+    if (result)
+        result = sink(data, 2 * height, maze.rows[0], map_width);
+
+    memfree(block);
+    memfree(maze.open);
+    memfree(maze.labels);
+    memfree(maze.last);
+    memfree(maze.parent);
+    memfree(maze.sets);
+
+    return result;
+
+}
+
+bool maze_map_sink(void * map, size_t y, const unsigned char * row, size_t width)
+{
+
+    map_t * destination = map;
+
+    if (width != (size_t)destination->size.width || y >= (size_t)destination->size.height)
+        return false;
+
+    memcpy(&destination->types[y * width], row, width);
+
+    return true;
+
+}
+
+bool maze_file_sink(void * file, size_t y, const unsigned char * row, size_t width)
+{
+
+    unused(y);
+
+    char buffer[4096];
+    size_t length = 0;
+
+    size_t x;
+    for (x = 0; x < width; x++) {
+
+        buffer[length++] = (row[x] == CELL_TYPE_PATH) ? ' ' : '#';
+
+        if (length == sizeof(buffer)) {
+
+            if (fwrite(buffer, 1, length, file) != length)
+                return false;
+
+            length = 0;
+
+        }
+
+    }
+
+    buffer[length++] = '\n';
+
+    return fwrite(buffer, 1, length, file) == length;
+
+}
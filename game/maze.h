@@ -0,0 +1,76 @@
+#ifndef game_maze_h
+#define game_maze_h
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "misc/random.h"
+
+/**
+ *  Generazione di labirinti per righe con l'algoritmo di Eller.
+ *
+ *  Il labirinto ha width * height celle (corridoi) separate da mura, per cui produce
+ *  2 * height + 1 righe di 2 * width + 1 caselle (CELL_TYPE_PATH o CELL_TYPE_WALL),
+ *  con i bordi sempre di tipo muro. Ogni riga è passata ad una funzione (sink) appena
+ *  completata e non viene più modificata: lo stato del generatore è O(width),
+ *  indipendentemente dall'altezza del labirinto.
+ */
+
+/**
+ *  Funzione che riceve le righe del labirinto, in ordine
+ *
+ *  @param data Dati dell'utente
+ *  @param y Indice della riga
+ *  @param row Tipi delle caselle della riga (CELL_TYPE_*)
+ *  @param width Numero di caselle della riga
+ *
+ *  @retval true Generazione da proseguire
+ *  @retval false Generazione da interrompere (es. errore di scrittura)
+ */
+typedef bool (* maze_row_function)(void * data, size_t y, const unsigned char * row, size_t width);
+
+/**
+ *  Genera un labirinto e ne passa le righe a sink.
+ *  Con braid > 0 i vicoli ciechi sono eliminati con probabilità braid abbattendo un muro,
+ *  su una finestra di tre righe che scorre insieme alla generazione.
+ *
+ *  @param random Generatore di numeri casuali
+ *  @param width Larghezza, in celle, considerando solo i corridoi
+ *  @param height Altezza, in celle, considerando solo i corridoi
+ *  @param braid Probabilità che un vicolo cieco sia eliminato (0. = labirinto perfetto)
+ *  @param sink Funzione che riceve le righe
+ *  @param data Dati passati a sink
+ *
+ *  @retval true Labirinto generato
+ *  @retval false Dimensioni non valide o generazione interrotta da sink
+ */
+bool maze_generate(random_t * random, size_t width, size_t height, float braid, maze_row_function sink, void * data);
+
+/**
+ *  Sink che copia le righe nei tipi delle celle di una mappa delle stesse dimensioni.
+ *  I corridoi calcolati della mappa non sono invalidati: va chiamata map_paths_invalidate
+ *  al termine della generazione.
+ *
+ *  @param map Mappa (map_t *)
+ *  @param y Indice della riga
+ *  @param row Tipi delle caselle della riga
+ *  @param width Numero di caselle della riga
+ *
+ *  @return false se la riga non è contenuta nella mappa
+ */
+bool maze_map_sink(void * map, size_t y, const unsigned char * row, size_t width);
+
+/**
+ *  Sink che scrive le righe su un file, nel formato testuale delle mappe ('#' muro, ' ' corridoio)
+ *
+ *  @param file File (FILE *)
+ *  @param y Indice della riga
+ *  @param row Tipi delle caselle della riga
+ *  @param width Numero di caselle della riga
+ *
+ *  @return false in caso di errore di scrittura
+ */
+bool maze_file_sink(void * file, size_t y, const unsigned char * row, size_t width);
+
+#endif  // game_maze_h
@@ -3,6 +3,8 @@
 #include "game/map.h"
 #include "game/character.h"
 
+#include "config/config_schema.h"
+
 #include "main/drawing.h"
 #include "main/tiling.h"
 
@@ -65,19 +67,14 @@ void powerup_enable_setting(hashtable_t * config, void * data, void * key, void
 void powerup_disable_setting(hashtable_t * config, void * data, void * key, void * value, struct type_functions value_type)
 {
 
+    unused(value_type);
+
     character_t * character = data;
 
     debugf("[Powerup] Reset proprietà %s\n", (char *)key);
 
-    //  si cerca la proprietà corrispondente nei valori di default
-    void * default_value = hashtable_search(character->default_config, key);
-
-    //  se la proprietà non c'è
-    if (!default_value)
-        hashtable_insert(character->config, key, default_value, value_type);
-    else
-        //  aggiornamento delle proprietà dell'utente
-        hashtable_replace(character->config, key, default_value);
+    //  rimuovendo la proprietà dal livello dei bonus torna visibile il valore di default
+    hashtable_remove(character->config, key);
 
 }
 
@@ -94,7 +91,9 @@ void powerup_apply_properties(game_t * game, hashtable_t * config, character_t *
         character_set_random_position(character);
 
     //  bisogna mostrare il percorso più breve fino all'uscita?
-    if (character->is_user && bool_value(hashtable_search(config, "show_shortest_path_to_exit"))) {
+    //  (solo se l'uscita è sulla mappa, non lo è in una finestra del mondo che non la contiene)
+    if (character->is_user && bool_value(hashtable_search(config, "show_shortest_path_to_exit")) &&
+        map_cell_is_valid(character->map, character->map->end)) {
 
         ai_path_fiding_function find_path = ai_get_path_function("A*");
         find_path(game, character, character->map->end);
@@ -136,11 +135,9 @@ void powerup_enable(game_t * game, powerup_status_t * status)
     if (!status->counter)
         return;
 
-    //  lista dei personaggi del livello
-    list_t * characters = level_get_characters_list(game);
-
     //  attivazione del bonus
     status->enabled = 1;
+    status->powerup->enabled++;
 
     //  inizializzazione del tempo trascorso dall'attivazione
     status->elapsed = 0;
@@ -174,8 +171,15 @@ void powerup_enable(game_t * game, powerup_status_t * status)
             effects_rect = rectangle_centered_make(character->position, rect_size, effects_rect.size);
         }
 
-        //  per ogni personaggio
-        foreach(characters, character_t *, chr) {
+        //  personaggi della mappa nei riquadri della griglia che intersecano l'area
+        size_t count;
+        character_t ** characters = map_characters_query(character->map, effects_rect, &count);
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+
+            character_t * chr = characters[i];
+
             //  diverso da chi ha raccolto il bonus
             if (chr == character)
                 continue;
@@ -188,8 +192,6 @@ void powerup_enable(game_t * game, powerup_status_t * status)
 
         }
     }
-    
-    list_delete(characters);
 
     //  riproduzione di eventuali effetti sonori
     audio_sample_t * sample = hashtable_search(game->audio_samples, status->powerup->name);
@@ -200,6 +202,30 @@ void powerup_enable(game_t * game, powerup_status_t * status)
 
 }
 
+/**
+ *  Registra la disattivazione di uno stato del bonus e, se il bonus non è più attivo,
+ *  applica l'eventuale configurazione modificata nel frattempo
+ *
+ *  @param powerup Bonus
+ */
+static void powerup_release(powerup_t * powerup)
+{
+
+    if (powerup->enabled)
+        powerup->enabled--;
+
+    if (powerup->enabled || !powerup->pending)
+        return;
+
+    hashtable_t * pending = powerup->pending;
+    powerup->pending = NULL;
+
+    powerup_configure(powerup, pending);
+
+    hashtable_delete(pending);
+
+}
+
 void powerup_disable(game_t * game, powerup_status_t * status)
 {
 
@@ -244,6 +270,9 @@ void powerup_disable(game_t * game, powerup_status_t * status)
     
     list_delete(characters);
 
+    //  le proprietà ripristinate sono quelle applicate, la nuova configurazione può essere usata
+    powerup_release(powerup);
+
 }
 
 /**
@@ -269,7 +298,7 @@ bool powerup_place(game_t * game, powerup_t * powerup, map_t * map, map_cell_t *
     map->powerup_time = time(NULL);
 
     //  collegamento cella <-> bonus
-    cell->powerup.powerup = powerup;
+    map_cell_set_powerup(map, cell, powerup);
 
     if (powerup->timeout > 0) {
         cell->powerup.place_time = time(NULL);
@@ -364,35 +393,36 @@ void powerups_handle_timer_tick(game_t * game, event_t event)
     //  se è stato inserito un bonus troppo di recente non ne possono essere inseriti altri
     if (difftime(time(NULL), map->powerup_time) > map->powerups_time) {
         
-        //  numero totale di bonus
-        int powerups_count = 0;
-        
-        //  eventuale creazione di nuovi bonus
-        foreach(map->powerup_cells, map_cell_t *, cell) {
-            
-            //  c'è già un bonus
-            if (cell->powerup.powerup)
-                continue;
-            
+        //  numero totale di bonus presenti sulla mappa
+        long powerups_count = bag_length(map->powerup_cells) - bag_length(map->powerup_free_cells);
+
+        //  eventuale creazione di un nuovo bonus in una delle celle libere, con tanti tentativi
+        //  quante sono le celle libere: ogni cella è estratta a caso, per cui la stessa cella
+        //  può essere estratta più volte e altre nessuna
+        size_t attempts = bag_length(map->powerup_free_cells);
+
+        while (powerups_count < map->powerups_limit && attempts--) {
+
+            map_cell_t * cell = bag_get_random(map->powerup_free_cells);
+
             bool _break = false;
 
             foreach(game->powerups, powerup_t *, powerup) {
-                if (powerup_place(game, powerup, map, cell)) _break = true;
+                if (powerup_place(game, powerup, map, cell)) {
+                    _break = true;
+                    break;
+                }
             }
-            
-            //  c'è un bonus
-            if (cell->powerup.powerup)
-                powerups_count++;
 
-            if (powerups_count >= map->powerups_limit || _break) break;
-            
+            if (_break) break;
+
         }
         
     }
 
 }
 
-void powerup_check_cell(map_cell_t * cell) {
+void powerup_check_cell(map_t * map, map_cell_t * cell) {
     
     powerup_t * powerup = cell->powerup.powerup;
 
@@ -402,7 +432,7 @@ void powerup_check_cell(map_cell_t * cell) {
     double diff = difftime(time(NULL), cell->powerup.place_time);
 
     if (diff >= powerup->timeout) {
-        cell->powerup.powerup = NULL;
+        map_cell_set_powerup(map, cell, NULL);
     }
     
 }
@@ -422,30 +452,116 @@ void powerup_handle_use(game_t * game, event_t event)
 
 }
 
-powerup_t * powerup_new(game_t * game, char * name, hashtable_t * config)
+/**
+ *  Variabili del dizionario di configurazione di un bonus
+ */
+typedef struct {
+
+    /** Proprietà da applicare ai personaggi che raccolgono il bonus */
+    hashtable_t * picker;
+
+    /** Proprietà da applicare ai personaggi che NON raccolgono il bonus */
+    hashtable_t * characters;
+
+    /** File contenente l'immagine che rappresenta il bonus */
+    char * texture_file;
+
+    /** Posizione dell'immagine del bonus nella bitmap */
+    rectangle_t texture_rect;
+
+    /** File audio */
+    char * audio;
+
+    /** Probabilità di apparizione */
+    float appearance_probability;
+
+    /** Durata, in secondi */
+    long duration;
+
+    /** Secondi prima della scomparsa */
+    long timeout;
+
+    /** Numero massimo di bonus per livello */
+    long limit;
+
+    /** Dimensione del riquadro degli effetti */
+    dimension_t effects_rect_size;
+
+    /** Tasto che attiva il bonus */
+    char * trigger;
+
+} powerup_config_t;
+
+/**
+ *  Schema del dizionario di configurazione di un bonus
+ */
+static const config_schema_field_t powerup_config_schema[] = {
+    ConfigSchemaField(powerup_config_t, picker, "picker", CONFIG_VARTYPE_DICTIONARY, false, NULL),
+    ConfigSchemaField(powerup_config_t, characters, "characters", CONFIG_VARTYPE_DICTIONARY, false, NULL),
+    ConfigSchemaField(powerup_config_t, texture_file, "texture_file", CONFIG_VARTYPE_STRING, true, NULL),
+    ConfigSchemaField(powerup_config_t, texture_rect, "texture_rect", CONFIG_VARTYPE_RECTANGLE, true, NULL),
+    ConfigSchemaField(powerup_config_t, audio, "audio", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(powerup_config_t, appearance_probability, "appearance_probability", CONFIG_VARTYPE_FLOAT, false, NULL),
+    ConfigSchemaField(powerup_config_t, duration, "duration", CONFIG_VARTYPE_INT, false, NULL),
+    ConfigSchemaField(powerup_config_t, timeout, "timeout", CONFIG_VARTYPE_INT, false, NULL),
+    ConfigSchemaField(powerup_config_t, limit, "limit", CONFIG_VARTYPE_INT, false, &(long){ LONG_MAX }),
+    ConfigSchemaField(powerup_config_t, effects_rect_size, "effects_rect_size", CONFIG_VARTYPE_SIZE, false, NULL),
+    ConfigSchemaField(powerup_config_t, trigger, "trigger", CONFIG_VARTYPE_STRING, false, NULL)
+};
+
+/**
+ *  Imposta le proprietà di un bonus che non richiedono il caricamento di immagini o audio
+ *
+ *  @param powerup Bonus
+ *  @param settings Variabili del dizionario di configurazione
+ */
+static void powerup_set_properties(powerup_t * powerup, powerup_config_t * settings)
 {
 
-    //  configurazione delle properietà
-    hashtable_t * characters = hashtable_search(config, "characters");
-    hashtable_t * picker = hashtable_search(config, "picker");
+    //  probabilità di apparizione nelle celle destinate ai bonus
+    powerup->appearance_probability = settings->appearance_probability;
 
-    if (!picker && !characters)
-        return NULL;
+    //  durata del bonus in secondi
+    powerup->duration = settings->duration;
+    
+    //  tempo prima della scomparsa
+    powerup->timeout = settings->timeout;
 
-    //  file contenente l'immagine che rappresenta il bonus
-    char * texture_file = hashtable_search(config, "texture_file");
+    //  numero massimo di bonus (di questo tipo) per livello
+    powerup->limit = settings->limit;
 
-    if (!texture_file)
-        return NULL;
+    //  proprietà (i riferimenti precedenti sono rilasciati)
+    hashtable_t * picker = powerup->picker;
+    hashtable_t * characters = powerup->characters;
+
+    powerup->picker = hashtable_retain(settings->picker);
+    powerup->characters = hashtable_retain(settings->characters);
+
+    hashtable_delete(picker);
+    hashtable_delete(characters);
+
+    //  dimensione del riquadro all'interno del quale far registrare gli effetti sui personaggi
+    powerup->effects_rect_size = settings->effects_rect_size;
+
+    //  tasto che attiva il bonus
+    powerup->trigger = (settings->trigger && *settings->trigger) ? *settings->trigger : 0;
 
-    //  posizione del'immagine del bonus nella bitmap
-    rectangle_t * texture_rect = hashtable_search(config, "texture_rect");
+}
+
+powerup_t * powerup_new(game_t * game, char * name, hashtable_t * config)
+{
 
-    if (!texture_rect)
+    powerup_config_t settings;
+
+    if (!config_schema_decode(config, powerup_config_schema, &settings, name))
+        return NULL;
+
+    //  configurazione delle properietà
+    if (!settings.picker && !settings.characters)
         return NULL;
 
     //  caricamento dell'immagine che rappresenta il bouns sulla mappa
-    image_t * texture = image_load_new(texture_file, *texture_rect, true);
+    image_t * texture = image_load_new(settings.texture_file, settings.texture_rect, true);
 
     if (!texture)
         return NULL;
@@ -454,44 +570,49 @@ powerup_t * powerup_new(game_t * game, char * name, hashtable_t * config)
     powerup_t * powerup = memalloc(powerup_t, 1, true);
     
     //  copia del nome
-    powerup->name = strdup(name);
+    powerup->name = memstrdup(name);
     
     //  file audio
-    char * audio = hashtable_search(config, "audio");
-    
-    if (audio)
-        audio_sample_load(audio, game->audio_samples, powerup->name);
+    if (settings.audio)
+        audio_sample_load(settings.audio, game->audio_samples, powerup->name);
     
     //  tile
     powerup->tile = texture;
 
-    //  probabilità di apparizione nelle celle destinate ai bonus
-    powerup->appearance_probability = float_value(hashtable_search(config, "appearance_probability"));
+    //  proprietà
+    powerup_set_properties(powerup, &settings);
 
-    //  durata del bonus in secondi
-    long * duration = hashtable_search(config, "duration");
-    powerup->duration = long_value(duration);
-    
-    //  tempo prima della scomparsa
-    long * timeout = hashtable_search(config, "timeout");
-    powerup->timeout = long_value(timeout);
+    return powerup;
 
-    //  numero massimo di bonus (di questo tipo) per livello
-    long * limit = hashtable_search(config, "limit");
-    powerup->limit = (limit ? *limit : LONG_MAX);
+}
 
-    //  proprietà
-    powerup->picker = picker ? hashtable_duplicate(picker) : NULL;
-    powerup->characters = characters ? hashtable_duplicate(characters) : NULL;
+bool powerup_configure(powerup_t * powerup, hashtable_t * config)
+{
 
-    //  dimensione del riquadro all'interno del quale far registrare gli effetti sui personaggi
-    powerup->effects_rect_size = dimension_value(hashtable_search(config, "effects_rect_size"));
+    powerup_config_t settings;
 
-    //  tasto che attiva il bonus
-    char * trigger = hashtable_search(config, "trigger");
-    powerup->trigger = (trigger && *trigger) ? *trigger : 0;
+    if (!config_schema_decode(config, powerup_config_schema, &settings, powerup->name))
+        return false;
 
-    return powerup;
+    if (!settings.picker && !settings.characters)
+        return false;
+
+    //  bonus attivo: le tabelle attuali servono a powerup_disable per ripristinare i personaggi
+    if (powerup->enabled) {
+
+        hashtable_t * pending = powerup->pending;
+        powerup->pending = hashtable_retain(config);
+        hashtable_delete(pending);
+
+        debugf("[Powerup] %s attivo, aggiornamento rimandato\n", powerup->name);
+
+        return true;
+
+    }
+
+    powerup_set_properties(powerup, &settings);
+
+    return true;
 
 }
 
@@ -510,7 +631,10 @@ void powerup_delete(powerup_t * powerup)
     //  4. proprietà degli altri
     hashtable_delete(powerup->characters);
 
-    //  5. deallocazione del bonus
+    //  5. configurazione non ancora applicata
+    hashtable_delete(powerup->pending);
+
+    //  6. deallocazione del bonus
     memfree(powerup);
 
 }
@@ -575,6 +699,10 @@ powerup_status_t * powerup_status_new(powerup_t * powerup, character_t * charact
 void powerup_status_delete(powerup_status_t * status)
 {
 
+    //  personaggio deallocato con il bonus attivo (es. avversario al cambio di livello)
+    if (status->enabled)
+        powerup_release(status->powerup);
+
     //  semplice dellocazione
     memfree(status);
 
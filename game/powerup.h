@@ -49,6 +49,12 @@ struct powerup_s {
     /** Proprietà da applicare ai personaggi che NON raccolgono il bonus */
     hashtable_t * characters;
 
+    /** Numero di stati (powerup_status_t) nei quali il bonus è attivo */
+    size_t enabled;
+
+    /** Configurazione modificata mentre il bonus è attivo, applicata quando non lo è più */
+    hashtable_t * pending;
+
 };
 
 /**
@@ -83,6 +89,9 @@ struct powerup_location_s {
 
     /** Istante in cui il bonus è stato posizonato */
     time_t place_time;
+
+    /** Posizione della cella nell'insieme delle celle libere della mappa */
+    long index;
 };
 
 /**
@@ -97,6 +106,18 @@ struct powerup_location_s {
  */
 powerup_t * powerup_new(game_t * game, char * name, hashtable_t * config);
 
+/**
+ *  Aggiorna le proprietà di un bonus modificate nel file di configurazione.
+ *  Immagine e audio non sono ricaricati. Se il bonus è attivo l'aggiornamento è rimandato
+ *  alla sua disattivazione, così i personaggi sono ripristinati con le stesse proprietà applicate.
+ *
+ *  @param powerup Bonus
+ *  @param config Hashtable contenente la configurazione del bonus
+ *
+ *  @return true se la configurazione è valida
+ */
+bool powerup_configure(powerup_t * powerup, hashtable_t * config);
+
 /**
  *  Deallocazione di un bonus
  *
@@ -166,9 +187,10 @@ powerup_status_t * powerup_status_new(powerup_t * powerup, character_t * charact
  *  Controlla se il bonus in una certa cella è ancora valido e in caso
  *  non lo sia lo rimuove
  *
+ *  @param map Mappa alla quale appartiene la cella
  *  @param cell Cella da controllare
  */
-void powerup_check_cell(map_cell_t * cell);
+void powerup_check_cell(map_t * map, map_cell_t * cell);
 
 /**
  *  Registra gli handler degli eventi
@@ -0,0 +1,449 @@
+#include <stdio.h>
+
+#include "config/config.h"
+#include "config/config_diff.h"
+
+#include "game/reload.h"
+#include "game/game.h"
+#include "game/map.h"
+#include "game/powerup.h"
+
+#include "main/watch.h"
+
+/**
+ *  Tipi di file di configurazione osservati
+ */
+typedef enum {
+
+    /** File principale (personaggio dell'utente) */
+    RELOAD_FILE_MAIN,
+
+    /** File dei bonus */
+    RELOAD_FILE_POWERUPS,
+
+    /** File di un livello (avversari) */
+    RELOAD_FILE_LEVEL,
+
+    /** File di una mappa (bonus della mappa) */
+    RELOAD_FILE_MAP
+
+} reload_file_type;
+
+/**
+ *  File di configurazione osservato
+ */
+typedef struct {
+
+    /** Percorso del file */
+    char * path;
+
+    /** Tipo del file */
+    reload_file_type type;
+
+    /** Ultima versione analizzata, con la quale confrontare la successiva */
+    hashtable_t * config;
+
+} reload_file_t;
+
+struct reload_s {
+
+    /** Osservatore dei file */
+    watch_t * watch;
+
+    /** File osservati */
+    reload_file_t * files;
+
+    /** Numero di file osservati */
+    size_t count;
+
+    /** File di configurazione dell'ultimo livello osservato */
+    char * level_path;
+
+};
+
+/**
+ *  Contesto di un controllo dei file modificati
+ */
+typedef struct {
+
+    /** Gestore degli aggiornamenti */
+    reload_t * reload;
+
+    /** Contesto di gioco */
+    game_t * game;
+
+} reload_poll_t;
+
+/**
+ *  Stato dell'applicazione delle modifiche di un file
+ */
+typedef struct {
+
+    /** Contesto di gioco */
+    game_t * game;
+
+    /** File modificato */
+    reload_file_t * file;
+
+    /** Bonus modificati (powerup_t *) */
+    list_t * powerups;
+
+    /** Se true sono cambiate variabili che interessano le mappe */
+    bool maps;
+
+} reload_apply_t;
+
+/**
+ *  Aggiunge un file a quelli osservati
+ *
+ *  @param reload Gestore degli aggiornamenti
+ *  @param path Percorso del file
+ *  @param type Tipo del file
+ *  @param config Versione attuale (NULL per leggerla dal file), il riferimento è acquisito
+ */
+static void reload_track(reload_t * reload, const char * path, reload_file_type type, hashtable_t * config)
+{
+
+    size_t i;
+    for (i = 0; i < reload->count; i++) {
+
+        if (!strcmp(reload->files[i].path, path)) {
+            hashtable_delete(config);
+            return;
+        }
+
+    }
+
+    if (!config)
+        config = config_open((char *)path);
+
+    //  senza una versione di riferimento non è possibile il confronto
+    if (!config || !watch_add(reload->watch, path)) {
+        hashtable_delete(config);
+        return;
+    }
+
+    reload->files = memrealloc(reload->files, reload_file_t, reload->count + 1);
+
+    reload_file_t * file = &reload->files[reload->count++];
+
+    file->path = memstrdup(path);
+    file->type = type;
+    file->config = config;
+
+    debugf("[Reload] %s osservato\n", path);
+
+}
+
+void reload_untrack_level(reload_t * reload)
+{
+
+    if (!reload)
+        return;
+
+    size_t i = 0;
+
+    while (i < reload->count) {
+
+        reload_file_t * file = &reload->files[i];
+
+        if (file->type != RELOAD_FILE_LEVEL && file->type != RELOAD_FILE_MAP) {
+            i++;
+            continue;
+        }
+
+        debugf("[Reload] %s non più osservato\n", file->path);
+
+        watch_remove(reload->watch, file->path);
+
+        memfree(file->path);
+        hashtable_delete(file->config);
+
+        //  l'ultimo file prende il posto di quello rimosso
+        *file = reload->files[--reload->count];
+
+    }
+
+    //  i file del nuovo livello sono osservati al prossimo reload_poll
+    memfree(reload->level_path);
+    reload->level_path = NULL;
+
+}
+
+/**
+ *  Osserva i file del livello corrente e delle sue mappe, se non lo sono già
+ *
+ *  @param reload Gestore degli aggiornamenti
+ *  @param game Contesto di gioco
+ */
+static void reload_track_level(reload_t * reload, game_t * game)
+{
+
+    level_t * level = game_get_current_level(game);
+
+    if (!level || !level->config_path)
+        return;
+
+    if (reload->level_path && !strcmp(reload->level_path, level->config_path))
+        return;
+
+    memfree(reload->level_path);
+    reload->level_path = memstrdup(level->config_path);
+
+    reload_track(reload, level->config_path, RELOAD_FILE_LEVEL, NULL);
+
+    foreach(level->maps, map_t *, map) {
+
+        if (map->config_path)
+            reload_track(reload, map->config_path, RELOAD_FILE_MAP, NULL);
+
+    }
+
+}
+
+/**
+ *  Applica una variabile modificata (callback di config_diff)
+ *
+ *  @param data Stato dell'applicazione
+ *  @param path Dizionari che contengono la variabile
+ *  @param depth Numero di dizionari
+ *  @param key Nome della variabile
+ *  @param value Nuovo valore (NULL se rimossa)
+ *  @param value_type Funzioni del valore
+ */
+static void reload_apply(void * data, const char ** path, size_t depth, const char * key, void * value, struct type_functions value_type)
+{
+
+    reload_apply_t * apply = data;
+    game_t * game = apply->game;
+
+    const char * owner = depth ? path[0] : NULL;
+
+    debugf("[Reload] %s: %s%s%s %s\n", apply->file->path, owner ? owner : "", owner ? "." : "", key, value ? "modificata" : "rimossa");
+
+    switch (apply->file->type) {
+
+    case RELOAD_FILE_MAIN:
+
+        //  proprietà del personaggio dell'utente
+        if (value && depth == 1 && game->user && !strcmp(owner, game->user->name)) {
+            character_config_update(game->user, (char *)key, value, value_type);
+            return;
+        }
+
+        break;
+
+    case RELOAD_FILE_LEVEL: {
+
+        //  proprietà degli avversari definiti dal dizionario
+        level_t * level = game_get_current_level(game);
+
+        if (value && depth == 1 && level && !strcmp(apply->file->path, level->config_path)) {
+
+            bool applied = false;
+
+            foreach(level->enemies, character_t *, enemy) {
+
+                if (enemy->name && !strcmp(enemy->name, owner)) {
+                    character_config_update(enemy, (char *)key, value, value_type);
+                    applied = true;
+                }
+
+            }
+
+            if (applied)
+                return;
+
+        }
+
+        break;
+
+    }
+
+    case RELOAD_FILE_POWERUPS:
+
+        //  i bonus sono aggiornati per intero al termine del confronto
+        if (depth >= 1) {
+
+            foreach(game->powerups, powerup_t *, powerup) {
+
+                if (!strcmp(powerup->name, owner)) {
+
+                    //  una sola volta per bonus
+                    foreach(apply->powerups, powerup_t *, changed) {
+                        if (changed == powerup)
+                            return;
+                    }
+
+                    list_insert(apply->powerups, powerup, INSERT_MODE_TAIL, false, false);
+
+                    return;
+
+                }
+
+            }
+
+        }
+
+        break;
+
+    case RELOAD_FILE_MAP:
+
+        //  le mappe sono aggiornate per intero al termine del confronto
+        if (depth == 0 && strcmp(key, "size") && strcmp(key, "map")) {
+            apply->maps = true;
+            return;
+        }
+
+        break;
+
+    }
+
+    debugf("[Reload] %s: %s non applicabile durante il gioco\n", apply->file->path, key);
+
+}
+
+/**
+ *  Ri-analizza un file modificato e applica le differenze (callback di watch_poll)
+ *
+ *  @param data Contesto del controllo
+ *  @param path Percorso del file modificato
+ */
+static void reload_file_changed(void * data, const char * path)
+{
+
+    reload_poll_t * poll = data;
+    reload_t * reload = poll->reload;
+
+    //  ricerca del file
+    reload_file_t * file = NULL;
+
+    size_t i;
+    for (i = 0; i < reload->count; i++) {
+
+        if (!strcmp(reload->files[i].path, path)) {
+            file = &reload->files[i];
+            break;
+        }
+
+    }
+
+    if (!file)
+        return;
+
+    hashtable_t * config = config_reload(file->path);
+
+    //  errore di sintassi (es. file salvato a metà): si attende il prossimo salvataggio
+    if (!config) {
+        errorf("[Reload] %s non valido, modifiche ignorate\n", file->path);
+        return;
+    }
+
+    reload_apply_t changes = { poll->game, file, list_new(no_functions), false };
+
+    size_t count = config_diff(file->config, config, &changes, reload_apply);
+
+    //  bonus modificati
+    foreach(changes.powerups, powerup_t *, powerup) {
+
+        if (!powerup_configure(powerup, hashtable_search(config, powerup->name)))
+            errorf("[Reload] %s: configurazione di %s non valida\n", file->path, powerup->name);
+
+    }
+
+    //  mappe del livello corrente caricate dal file
+    level_t * level = game_get_current_level(poll->game);
+
+    if (changes.maps && level) {
+
+        foreach(level->maps, map_t *, map) {
+
+            if (map->config_path && !strcmp(map->config_path, file->path))
+                map_configure(map, config);
+
+        }
+
+    }
+
+    list_delete(changes.powerups);
+
+    debugf("[Reload] %s: %zu variabili modificate\n", file->path, count);
+
+    //  la nuova versione diventa il riferimento per i confronti successivi
+    hashtable_delete(file->config);
+    file->config = config;
+
+}
+
+reload_t * reload_new(char * config_path, hashtable_t * config)
+{
+
+    reload_t * reload = memalloc(reload_t, 1, true);
+
+    reload->watch = watch_new();
+
+    //  file principale, la tabella resta condivisa con il chiamante
+    reload_track(reload, config_path, RELOAD_FILE_MAIN, hashtable_retain(config));
+
+    //  file dei bonus
+    char * powerups_file = hashtable_search(config, "powerups");
+
+    if (powerups_file)
+        reload_track(reload, powerups_file, RELOAD_FILE_POWERUPS, NULL);
+
+    return reload;
+
+}
+
+hashtable_t * reload_config(reload_t * reload)
+{
+
+    if (!reload)
+        return NULL;
+
+    size_t i;
+    for (i = 0; i < reload->count; i++) {
+
+        if (reload->files[i].type == RELOAD_FILE_MAIN)
+            return reload->files[i].config;
+
+    }
+
+    return NULL;
+
+}
+
+void reload_poll(reload_t * reload, game_t * game)
+{
+
+    if (!reload || !game)
+        return;
+
+    //  il livello corrente può essere cambiato dall'ultimo controllo
+    reload_track_level(reload, game);
+
+    reload_poll_t poll = { reload, game };
+
+    watch_poll(reload->watch, &poll, reload_file_changed);
+
+}
+
+void reload_delete(reload_t * reload)
+{
+
+    if (!reload)
+        return;
+
+    watch_delete(reload->watch);
+
+    size_t i;
+    for (i = 0; i < reload->count; i++) {
+        memfree(reload->files[i].path);
+        hashtable_delete(reload->files[i].config);
+    }
+
+    memfree(reload->files);
+    memfree(reload->level_path);
+    memfree(reload);
+
+}
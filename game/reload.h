@@ -0,0 +1,66 @@
+#ifndef game_reload_h
+#define game_reload_h
+
+#include "std/hashtable.h"
+
+#include "game/structs.h"
+
+/**
+ *  Aggiornamento della configurazione durante il gioco.
+ *
+ *  I file di configurazione in uso (principale, bonus, livello corrente e relative mappe)
+ *  sono osservati: quando uno di essi viene salvato è ri-analizzato, confrontato con la
+ *  versione precedente e solo le variabili modificate sono applicate a personaggi, bonus
+ *  e mappe, senza ricaricare immagini e audio. Le variabili che richiedono il caricamento
+ *  di risorse (es. immagini, struttura delle mappe) sono ignorate fino al prossimo
+ *  EVENT_GAME_RELOAD.
+ */
+struct reload_s;
+
+/**
+ *  Creazione del gestore degli aggiornamenti
+ *
+ *  @param config_path Percorso del file di configurazione principale
+ *  @param config Hashtable contenente la configurazione principale
+ *
+ *  @return Gestore degli aggiornamenti
+ */
+reload_t * reload_new(char * config_path, hashtable_t * config);
+
+/**
+ *  Controlla, senza attendere, se ci sono file modificati e applica le modifiche.
+ *  Va chiamata dal thread principale, ad esempio ad ogni iterazione del loop degli eventi.
+ *
+ *  @param reload Gestore degli aggiornamenti
+ *  @param game Contesto di gioco
+ */
+void reload_poll(reload_t * reload, game_t * game);
+
+/**
+ *  Ultima versione analizzata del file di configurazione principale.
+ *  La tabella appartiene al gestore ed è sostituita quando il file viene modificato:
+ *  per utilizzarla oltre il prossimo reload_poll va acquisito un riferimento (hashtable_retain).
+ *
+ *  @param reload Gestore degli aggiornamenti
+ *
+ *  @return Configurazione principale
+ *  @retval NULL Se il file principale non è osservato
+ */
+hashtable_t * reload_config(reload_t * reload);
+
+/**
+ *  Smette di osservare i file del livello corrente e delle sue mappe.
+ *  Va chiamata al cambio di livello, i file del livello successivo sono osservati dal prossimo reload_poll.
+ *
+ *  @param reload Gestore degli aggiornamenti
+ */
+void reload_untrack_level(reload_t * reload);
+
+/**
+ *  Deallocazione del gestore degli aggiornamenti
+ *
+ *  @param reload Gestore degli aggiornamenti
+ */
+void reload_delete(reload_t * reload);
+
+#endif  // game_reload_h
@@ -9,6 +9,8 @@ TYPE_FUNCTIONS_DECLARE(animation);
 typedef struct character_s character_t;
 TYPE_FUNCTIONS_DECLARE(character);
 
+typedef struct crowd_s crowd_t;
+
 typedef struct event_s event_t;
 
 typedef struct game_s game_t;
@@ -16,6 +18,8 @@ typedef struct game_s game_t;
 typedef struct level_s level_t;
 TYPE_FUNCTIONS_DECLARE(level);
 
+typedef struct levels_s levels_t;
+
 typedef struct map_s map_t;
 TYPE_FUNCTIONS_DECLARE(map);
 
@@ -28,4 +32,8 @@ typedef struct powerup_location_s   powerup_location_t;
 typedef struct powerup_status_s     powerup_status_t;
 TYPE_FUNCTIONS_DECLARE(powerup_status);
 
+typedef struct reload_s reload_t;
+
+typedef struct world_s world_t;
+
 #endif
@@ -0,0 +1,370 @@
+#include <math.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "misc/random.h"
+
+#include "game/world.h"
+#include "game/chunks.h"
+#include "game/maze.h"
+#include "game/map.h"
+#include "game/cell.h"
+#include "game/character.h"
+#include "game/game.h"
+#include "game/level.h"
+
+/**
+ *  Probabilità che un vicolo cieco del mondo sia eliminato (come le mappe RANDOM ELLER)
+ */
+#define WORLD_BRAID     0.2
+
+struct world_s {
+
+    /** Archivio dei tipi e dei pesi delle celle */
+    chunks_t * chunks;
+
+    /** Dimensione del mondo, in caselle */
+    dimension_t size;
+
+    /** Casella del mondo corrispondente all'angolo in alto a sinistra della finestra */
+    point_t origin;
+
+    /** La finestra contiene la porzione del mondo in origin (e va riscritta prima di spostarla) */
+    bool loaded;
+
+    /** Seme dei labirinti dei chunk */
+    uint32_t seed;
+
+    /** Ingresso del mondo */
+    point_t start;
+
+    /** Uscita del mondo */
+    point_t end;
+
+};
+
+/**
+ *  Riga di un labirinto di chunk, scritta nei tipi del chunk (vedi world_generate)
+ *
+ *  @param data Tipi del chunk
+ *  @param y Riga del labirinto
+ *  @param row Celle della riga
+ *  @param width Numero di celle della riga
+ *
+ *  @return true
+ */
+static bool world_generate_row(void * data, size_t y, const unsigned char * row, size_t width)
+{
+
+    unsigned char * types = data;
+
+    //  l'ultima riga e l'ultima colonna di un chunk interno sono la prima riga e la prima colonna
+    //  dei chunk successivi, che le generano
+    if (y < CHUNK_SIZE)
+        memcpy(&types[y * CHUNK_SIZE], row, width < CHUNK_SIZE ? width : CHUNK_SIZE);
+
+    return true;
+
+}
+
+/**
+ *  Generazione di un chunk del mondo al primo accesso (funzione di generazione dell'archivio).
+ *  Ogni chunk è un labirinto a sé, con un seme ricavato da quello del mondo e dalla posizione
+ *  del chunk, aperto verso il chunk a ovest e quello a nord: i chunk formano una griglia
+ *  connessa e tutto il mondo è raggiungibile dall'ingresso
+ *
+ *  @param data Mondo
+ *  @param chunk_x Colonna del chunk
+ *  @param chunk_y Riga del chunk
+ *  @param types Tipi delle celle del chunk
+ *  @param values Pesi delle celle del chunk
+ */
+static void world_generate(void * data, size_t chunk_x, size_t chunk_y, unsigned char * types, unsigned char * values)
+{
+
+    world_t * world = data;
+
+    memset(types, CELL_TYPE_WALL, CHUNK_CELLS);
+    memset(values, CellDefaultValue, CHUNK_CELLS);
+
+    //  celle dei corridoi nel chunk: le coordinate dispari del mondo sono dispari anche nel chunk
+    size_t width = ((size_t)world->size.width - chunk_x * CHUNK_SIZE - 1) / 2;
+    size_t height = ((size_t)world->size.height - chunk_y * CHUNK_SIZE - 1) / 2;
+
+    if (width > CHUNK_SIZE / 2)
+        width = CHUNK_SIZE / 2;
+
+    if (height > CHUNK_SIZE / 2)
+        height = CHUNK_SIZE / 2;
+
+    //  chunk con il solo muro perimetrale del mondo
+    if (!width || !height)
+        return;
+
+    size_t columns = ((size_t)world->size.width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    random_t random;
+    random_seed(&random, (uint32_t)(world->seed + chunk_y * columns + chunk_x));
+
+    maze_generate(&random, width, height, WORLD_BRAID, world_generate_row, types);
+
+    //  passaggi nel muro verso ovest e verso nord, più di uno con la probabilità dei vicoli eliminati
+    if (chunk_x > 0) {
+
+        do {
+            types[(2 * random_next_int(&random, 0, height - 1) + 1) * CHUNK_SIZE] = CELL_TYPE_PATH;
+        } while (random_next_bool(&random, WORLD_BRAID));
+
+    }
+
+    if (chunk_y > 0) {
+
+        do {
+            types[2 * random_next_int(&random, 0, width - 1) + 1] = CELL_TYPE_PATH;
+        } while (random_next_bool(&random, WORLD_BRAID));
+
+    }
+
+}
+
+/**
+ *  Coordinate nella finestra di una casella del mondo, limitate alla casella appena
+ *  fuori dal bordo della finestra (la direzione è conservata)
+ *
+ *  @param world Mondo
+ *  @param map Finestra
+ *  @param point Casella del mondo
+ *
+ *  @return Coordinate nella finestra
+ */
+static point_t world_to_window(world_t * world, map_t * map, point_t point)
+{
+
+    float x = point.x - world->origin.x;
+    float y = point.y - world->origin.y;
+
+    x = x < -1 ? -1 : (x > map->size.width ? map->size.width : x);
+    y = y < -1 ? -1 : (y > map->size.height ? map->size.height : y);
+
+    return PointMake(x, y);
+
+}
+
+/**
+ *  Legge nella finestra la porzione del mondo con l'angolo in alto a sinistra in origin,
+ *  dopo aver riscritto nel mondo la porzione precedente (con i muri abbattuti nel frattempo)
+ *
+ *  @param map Finestra
+ *  @param origin Casella del mondo
+ *
+ *  @return false se la porzione non può essere letta
+ */
+static bool world_read(map_t * map, point_t origin)
+{
+
+    world_t * world = map->world;
+
+    if (world->loaded && !chunks_write(world->chunks, world->origin, map->size, map->types, map->values))
+        errorf("[Mondo] Impossibile riscrivere la finestra (%.0f, %.0f)\n", world->origin.x, world->origin.y);
+
+    bool result = chunks_read(world->chunks, origin, map->size, map->types, map->values);
+
+    //  se la lettura non riesce la finestra non corrisponde più al mondo e non va riscritta
+    world->loaded = result;
+
+    if (result)
+        world->origin = origin;
+    else
+        errorf("[Mondo] Impossibile leggere la finestra (%.0f, %.0f)\n", origin.x, origin.y);
+
+    map->start = world_to_window(world, map, world->start);
+    map->end = world_to_window(world, map, world->end);
+
+    //  anche in caso di errore, adiacenze e tasselli devono corrispondere ai tipi
+    map_grid_reload(map);
+
+    return result;
+
+}
+
+/**
+ *  Sposta un personaggio insieme alla finestra, senza interromperne il movimento
+ *
+ *  @param character Personaggio
+ *  @param dx Spostamento della finestra, in caselle (x)
+ *  @param dy Spostamento della finestra, in caselle (y)
+ */
+static void world_shift_character(character_t * character, int dx, int dy)
+{
+
+    fixed_t fx = FixedFromInt(dx);
+    fixed_t fy = FixedFromInt(dy);
+
+    //  il percorso fa riferimento alle celle della finestra precedente
+    character_clear_path(character);
+
+    character->last_position = FixedPointMake(character->last_position.x - fx, character->last_position.y - fy);
+    character_set_position(character, FixedPointMake(character->fixed_position.x - fx, character->fixed_position.y - fy));
+    character->location = PointMake(character->location.x - dx, character->location.y - dy);
+
+    map_characters_update(character);
+
+}
+
+map_t * world_map_new(level_t * level, dimension_t window, dimension_t size)
+{
+
+    //  la finestra non può essere più grande del mondo
+    if (window.width > size.width)
+        window.width = size.width;
+
+    if (window.height > size.height)
+        window.height = size.height;
+
+    if (window.width < 1 || window.height < 1)
+        return NULL;
+
+    dimension_t window_size = SizeMake(window.width * 2 + 1, window.height * 2 + 1);
+
+    //  solo la finestra è una map_t (e ha coordinate a virgola fissa), il mondo è nell'archivio:
+    //  il controllo va fatto prima di generare il labirinto
+    if (!map_size_is_valid(window_size)) {
+        errorf("[Mondo] Finestra di %gx%g celle non valida (al massimo %d celle per lato)\n", window_size.width, window_size.height, MAP_SIZE_MAX);
+        return NULL;
+    }
+
+    world_t * world = memalloc(world_t, 1, true);
+
+    world->size = SizeMake(size.width * 2 + 1, size.height * 2 + 1);
+    world->seed = random_next(random_thread());
+
+    //  chunk residenti: la finestra e i chunk attorno
+    size_t around = ((size_t)window_size.width / CHUNK_SIZE + 3) * ((size_t)window_size.height / CHUNK_SIZE + 3);
+
+    world->chunks = chunks_open(NULL, (size_t)world->size.width, (size_t)world->size.height, around, true);
+
+    if (!world->chunks) {
+        memfree(world);
+        return NULL;
+    }
+
+    //  i chunk sono generati solo quando la finestra li raggiunge
+    chunks_set_generator(world->chunks, world_generate, world);
+
+    //  ingresso a ovest in alto, uscita a est in basso
+    world->start = PointMake(0, 1);
+    world->end = PointMake(world->size.width - 1, world->size.height - 2);
+
+    chunks_set_cell(world->chunks, (size_t)world->start.x, (size_t)world->start.y, CELL_TYPE_PATH, CellDefaultValue);
+    chunks_set_cell(world->chunks, (size_t)world->end.x, (size_t)world->end.y, CELL_TYPE_PATH, CellDefaultValue);
+
+    map_t * map = map_new(window_size, level);
+
+    map->world = world;
+
+    //  bonus come nelle mappe generate, estratti ad ogni spostamento della finestra
+    map->powerup_probability = 0.05 / level->complexity;
+    map->powerups_limit = random_int(1, 7);
+
+    map->powerups_time = (int)(12 * level->complexity);
+    if (map->powerups_time < 2)
+        map->powerups_time = 2;
+
+    //  la prima finestra contiene l'ingresso
+    if (!world_read(map, PointZero)) {
+        map_delete(map);
+        return NULL;
+    }
+
+    map_offset_calculate(map);
+
+    return map;
+
+}
+
+void world_update(game_t * game, map_t * map)
+{
+
+    world_t * world = map ? map->world : NULL;
+
+    if (!world)
+        return;
+
+    character_t * user = game_get_user(game);
+
+    if (!user || user->map != map || PointIsNull(user->location))
+        return;
+
+    //  i chunk attorno all'utente sono gli ultimi ad essere rilasciati
+    point_t position = PointMake(world->origin.x + user->location.x, world->origin.y + user->location.y);
+
+    chunks_set_focus(world->chunks, &position, 1, 1);
+
+    //  la finestra si sposta solo quando l'utente è ad un quarto dal bordo
+    float margin_x = floorf(map->size.width / 4);
+    float margin_y = floorf(map->size.height / 4);
+
+    if (user->location.x >= margin_x && user->location.x < map->size.width - margin_x &&
+        user->location.y >= margin_y && user->location.y < map->size.height - margin_y)
+        return;
+
+    //  nuova finestra centrata sull'utente, interna al mondo, con l'origine su coordinate pari
+    //  (le celle dei corridoi restano sulle coordinate dispari della finestra)
+    long x = (long)position.x - (long)map->size.width / 2;
+    long y = (long)position.y - (long)map->size.height / 2;
+
+    long max_x = (long)world->size.width - (long)map->size.width;
+    long max_y = (long)world->size.height - (long)map->size.height;
+
+    x = x < 0 ? 0 : (x > max_x ? max_x : x);
+    y = y < 0 ? 0 : (y > max_y ? max_y : y);
+
+    x -= x % 2;
+    y -= y % 2;
+
+    //  già al bordo del mondo
+    int dx = (int)(x - (long)world->origin.x);
+    int dy = (int)(y - (long)world->origin.y);
+
+    if (!dx && !dy)
+        return;
+
+    if (!world_read(map, PointMake(x, y)))
+        return;
+
+    debugf("[Mondo] Finestra spostata in (%ld, %ld)\n", x, y);
+
+    world_shift_character(user, dx, dy);
+
+    //  avversari: nella stessa cella se ancora nella finestra, altrimenti in una cella casuale
+    level_t * level = game_get_current_level(game);
+
+    foreach(level->enemies, character_t *, enemy) {
+
+        if (enemy->map != map || PointIsNull(enemy->location))
+            continue;
+
+        point_t location = PointMake(enemy->location.x - dx, enemy->location.y - dy);
+
+        if (map_cell_is_path(map, location) && !PointEqualToPoint(location, map->end))
+            character_set_location(enemy, location, false);
+        else
+            character_set_random_position(enemy);
+
+    }
+
+}
+
+void world_delete(world_t * world)
+{
+
+    if (!world)
+        return;
+
+    //  il file temporaneo è rimosso alla chiusura
+    chunks_delete(world->chunks);
+
+    memfree(world);
+
+}
@@ -0,0 +1,55 @@
+#ifndef game_world_h
+#define game_world_h
+
+#include "misc/geometry.h"
+
+#include "game/structs.h"
+
+/**
+ *  Mappe finestra di un mondo a blocchi (mappe "RANDOM WORLD" dei livelli).
+ *
+ *  Il mondo è un labirinto di WORLD_WINDOWS x WORLD_WINDOWS finestre in un archivio a blocchi
+ *  su un file temporaneo (vedi game/chunks.h), generato un chunk alla volta al primo accesso:
+ *  ogni chunk è un labirinto (maze_generate) aperto verso i chunk vicini.
+ *  In memoria restano solo la finestra, che è una normale map_t, e pochi chunk.
+ *  Quando l'utente si avvicina al bordo della finestra, questa è riscritta nell'archivio
+ *  (con i muri abbattuti) e riletta centrata sull'utente, e i personaggi sono traslati di conseguenza.
+ *  Ingresso e uscita sono agli angoli opposti del mondo: quando non sono nella finestra,
+ *  map_t.start e map_t.end indicano la casella appena fuori dal bordo nella loro direzione.
+ */
+
+/**
+ *  Lato del mondo, in finestre
+ */
+#define WORLD_WINDOWS   8
+
+/**
+ *  Creazione di una mappa finestra di un nuovo mondo generato casualmente
+ *
+ *  @param level Livello al quale appartiene la mappa
+ *  @param window Dimensione della finestra, in celle considerando solo i corridoi (come map_generate)
+ *  @param size Dimensione del mondo, in celle considerando solo i corridoi
+ *
+ *  @return Mappa, posizionata sull'ingresso del mondo
+ *  @retval NULL Se non è possibile creare l'archivio del mondo
+ */
+map_t * world_map_new(level_t * level, dimension_t window, dimension_t size);
+
+/**
+ *  Segue l'utente, da chiamare ad ogni frame per la mappa dell'utente:
+ *  mantiene residenti i chunk attorno all'utente e, se l'utente è vicino al bordo
+ *  della finestra, la sposta centrandola sull'utente
+ *
+ *  @param game Contesto di gioco
+ *  @param map Mappa (nessun effetto se non è una finestra di un mondo)
+ */
+void world_update(game_t * game, map_t * map);
+
+/**
+ *  Deallocazione di un mondo (chiamata da map_delete)
+ *
+ *  @param world Mondo
+ */
+void world_delete(world_t * world);
+
+#endif  // game_world_h
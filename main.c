@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <allegro5/allegro5.h>
 #include <allegro5/allegro_primitives.h>
 
@@ -8,47 +10,251 @@
 #include "game/events.h"
 #include "game/intro.h"
 #include "game/map.h"
+#include "game/maze.h"
+#include "game/reload.h"
 
 #include "main/audio.h"
 #include "main/drawing.h"
 #include "main/fs.h"
 #include "main/graphics.h"
+#include "main/thread.h"
 
 #include "misc/directions.h"
 #include "misc/random.h"
 
+/**
+ *  Legge il seed del generatore di numeri casuali dalla riga di comando (--seed N o --seed=N),
+ *  un intero a 32 bit
+ *
+ *  @param argc Numero di argomenti
+ *  @param argv Argomenti
+ *  @param seed Destinazione del seed
+ *
+ *  @retval true Seed specificato
+ *  @retval false Seed assente o non valido
+ */
+static bool main_parse_seed(int argc, const char * argv[], uint32_t * seed)
+{
+
+    int i;
+    for (i = 1; i < argc; i++) {
+
+        const char * value = NULL;
+
+        if (!strncmp(argv[i], "--seed=", 7))
+            value = argv[i] + 7;
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            value = argv[++i];
+
+        if (!value)
+            continue;
+
+        char * end;
+        unsigned long parsed = strtoul(value, &end, 10);
+
+        if (end != value && *end == '\0' && parsed <= UINT32_MAX) {
+            *seed = (uint32_t)parsed;
+            return true;
+        }
+
+        errorf("Seed non valido: %s\n", value);
+
+    }
+
+    return false;
+
+}
+
+/**
+ *  Converte le mappe indicate sulla riga di comando (--convert-map map.cfg map.mapb, anche più volte)
+ *  nel formato binario caricato senza parsing (vedi map_convert)
+ *
+ *  @param argc Numero di argomenti
+ *  @param argv Argomenti
+ *  @param converted Destinazione dell'esito (false se almeno una conversione è fallita)
+ *
+ *  @retval true Conversione richiesta (il gioco non va avviato)
+ *  @retval false Nessuna conversione richiesta
+ */
+static bool main_convert_maps(int argc, const char * argv[], bool * converted)
+{
+
+    bool requested = false;
+
+    *converted = true;
+
+    int i;
+    for (i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--convert-map"))
+            continue;
+
+        requested = true;
+
+        if (i + 2 >= argc) {
+            errorf("Uso: %s --convert-map map.cfg map%s\n", argv[0], MAP_BINARY_EXTENSION);
+            *converted = false;
+            break;
+        }
+
+        *converted = map_convert(argv[i + 1], argv[i + 2]) && *converted;
+
+        i += 2;
+
+    }
+
+    return requested;
+
+}
+
+/**
+ *  Genera i labirinti indicati sulla riga di comando (--generate-maze WxH map.txt, anche più volte)
+ *  scrivendoli riga per riga nel formato della variabile map dei file delle mappe (vedi maze_file_sink),
+ *  senza punti di partenza e uscita, da aggiungere sul bordo. W e H sono le dimensioni in celle considerando solo i corridoi, con --seed il labirinto è riproducibile.
+ *
+ *  @param argc Numero di argomenti
+ *  @param argv Argomenti
+ *  @param generated Destinazione dell'esito (false se almeno una generazione è fallita)
+ *
+ *  @retval true Generazione richiesta (il gioco non va avviato)
+ *  @retval false Nessuna generazione richiesta
+ */
+static bool main_generate_mazes(int argc, const char * argv[], bool * generated)
+{
+
+    bool requested = false;
+
+    *generated = true;
+
+    int i;
+    for (i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--generate-maze"))
+            continue;
+
+        if (!requested) {
+
+            uint32_t seed;
+
+            if (main_parse_seed(argc, argv, &seed))
+                well512_seed(seed);
+            else
+                well512_initialize();
+
+            requested = true;
+
+        }
+
+        //  dimensioni nella forma WxH
+        unsigned long width = 0, height = 0;
+        char * end = NULL;
+
+        if (i + 2 < argc) {
+
+            width = strtoul(argv[i + 1], &end, 10);
+
+            if (*end == 'x')
+                height = strtoul(end + 1, &end, 10);
+
+        }
+
+        if (!width || !height || !end || *end != '\0') {
+            errorf("Uso: %s --generate-maze WxH map.txt\n", argv[0]);
+            *generated = false;
+            break;
+        }
+
+        FILE * file = fopen(argv[i + 2], "w");
+
+        if (!file) {
+            errorf("Impossibile scrivere %s\n", argv[i + 2]);
+            *generated = false;
+            i += 2;
+            continue;
+        }
+
+        //  come le mappe RANDOM ELLER, ma senza mai tenere in memoria più di tre righe
+        bool result = maze_generate(random_thread(), width, height, 0.2, maze_file_sink, file);
+
+        result = (fclose(file) == 0) && result;
+
+        if (!result)
+            errorf("Errore nella generazione di %s\n", argv[i + 2]);
+
+        *generated = result && *generated;
+
+        i += 2;
+
+    }
+
+    return requested;
+
+}
+
 int main(int argc, const char * argv[])
 {
 
+    //  conversione delle mappe, senza avviare il gioco
+    bool converted;
+
+    if (main_convert_maps(argc, argv, &converted))
+        return converted ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    //  generazione di labirinti su file, senza avviare il gioco
+    bool generated;
+
+    if (main_generate_mazes(argc, argv, &generated))
+        return generated ? EXIT_SUCCESS : EXIT_FAILURE;
+
     //  inizializzazione libreria grafica
     if (graphics_initialize_library() != 0) {
         errorf("Errore in fase di inizializzazione della libreria grafica.\n", NULL);
         return EXIT_FAILURE;
     }
 
+    //  thread per i lavori in parallelo (es. generazione delle mappe)
+    thread_pool_initialize();
+
     //  caricamento file principale di configurazione
     char * absolute_config = fs_construct_path(fs_get_resources_path(), "assets", "config.cfg");
     hashtable_t * config = config_open(absolute_config);
     
-    memfree(absolute_config);
-    
     //  problemi di caricamento del file di config
-    if (!config)
+    if (!config) {
+        memfree(absolute_config);
+        thread_pool_destroy();
         return EXIT_FAILURE;
+    }
+
+    //  aggiornamento della configurazione durante il gioco
+    reload_t * reload = reload_new(absolute_config, config);
+
+    memfree(absolute_config);
 
     //  inizializzazione della libreria grafica
     if (graphics_initialize(config) != 0) {
         
+        reload_delete(reload);
+
         hashtable_delete(config);
         
         fs_destroy();
+
+        thread_pool_destroy();
         
         return EXIT_FAILURE;
         
     }
     
-    //  generatore di numeri random
-    well512_initialize();
+    //  generatore di numeri random, con lo stesso seed (--seed) la partita è riproducibile
+    uint32_t seed;
+
+    if (main_parse_seed(argc, argv, &seed)) {
+        well512_seed(seed);
+        debugf("[Random] seed %lu\n", (unsigned long)seed);
+    } else {
+        well512_initialize();
+    }
     
     //  schermata di caricamento
     output_screen_fill(ColorMakeRGB(0, 0, 0));
@@ -61,14 +267,20 @@ int main(int argc, const char * argv[])
         
         graphics_destroy();
         
+        reload_delete(reload);
+
         hashtable_delete(config);
         
         fs_destroy();
+
+        thread_pool_destroy();
         
         return EXIT_FAILURE;
         
     }
     
+    game->reload = reload;
+
     //  menu principale
     bool done = !intro_display(game);
 
@@ -90,9 +302,19 @@ int main(int argc, const char * argv[])
             //  libera le risorse
             game_destroy(game);
 
+            //  il file principale può essere stato modificato durante il gioco:
+            //  si usa la versione più recente, con le modifiche non applicabili al volo
+            hashtable_t * current = reload_config(reload);
+
+            if (current && current != config) {
+                hashtable_delete(config);
+                config = hashtable_retain(current);
+            }
+
             //  inizializzazione elementi del gioco
             game = game_initialize(config);
             game->mute = mute;
+            game->reload = reload;
             
             //  ri-avvio il gioco
             game_set_started(game);
@@ -102,17 +324,29 @@ int main(int argc, const char * argv[])
         //  fading out delle tracce audio
         audio_fade(game);
 
+        //  file di configurazione modificati
+        reload_poll(reload, game);
+
     }
 
     game_destroy(game);
 
+    reload_delete(reload);
+
+    thread_pool_destroy();
+
     graphics_destroy();
 
     fs_destroy();
     
     //  deallocazione file di config
     hashtable_delete(config);
-    
+
+#ifdef MEMORY_ACCOUNTING
+    //  la memoria ancora in uso a questo punto non è stata deallocata
+    memory_report(stdout);
+#endif
+
     return EXIT_SUCCESS;
 }
 
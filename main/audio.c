@@ -5,6 +5,8 @@
 
 #include "game/game.h"
 
+#include "config/config_schema.h"
+
 #include "main/audio.h"
 #include "main/fs.h"
 
@@ -20,6 +22,9 @@ char * audio_samples_names[] = {
     [AUDIO_SAMPLE_CRASH]    = "Crash"
 };
 
+/** Chiavi con hash precalcolato per la ricerca dei suoni globali nella tabella */
+static hashtable_key_t audio_samples_keys[AUDIO_SAMPLE_LAST];
+
 ALLEGRO_MIXER * mixer = NULL;
 ALLEGRO_VOICE * voice = NULL;
 
@@ -46,7 +51,7 @@ TYPE_FUNCTIONS_DEFINE(audio_samples, audio_sample_delete);
 void audio_sample_play_by_id(game_t * game, int id, bool loop)
 {
 
-    audio_sample_t * sample = hashtable_search(game->audio_samples, audio_sample_name(id));
+    audio_sample_t * sample = hashtable_search_key(game->audio_samples, &audio_samples_keys[id]);
 
     if (!sample)
         return;
@@ -58,7 +63,7 @@ void audio_sample_play_by_id(game_t * game, int id, bool loop)
 void audio_sample_stop_by_id(game_t * game, int id)
 {
 
-    audio_sample_t * sample = hashtable_search(game->audio_samples, audio_sample_name(id));
+    audio_sample_t * sample = hashtable_search_key(game->audio_samples, &audio_samples_keys[id]);
 
     if (!sample)
         return;
@@ -101,7 +106,7 @@ void audio_sample_stop(audio_sample_t * sample)
 void audio_sample_set_fading_by_id(game_t * game, int id)
 {
 
-    audio_sample_t * sample = hashtable_search(game->audio_samples, audio_sample_name(id));
+    audio_sample_t * sample = hashtable_search_key(game->audio_samples, &audio_samples_keys[id]);
 
     if (!sample)
         return;
@@ -110,6 +115,27 @@ void audio_sample_set_fading_by_id(game_t * game, int id)
 
 }
 
+/**
+ *  Variabili del dizionario "sfx": file degli effetti sonori globali
+ */
+typedef struct {
+
+    /** File di ogni effetto (NULL se assente) */
+    char * files[AUDIO_SAMPLE_LAST];
+
+} audio_sfx_config_t;
+
+/**
+ *  Schema del dizionario "sfx"
+ */
+static const config_schema_field_t audio_sfx_config_schema[] = {
+    ConfigSchemaField(audio_sfx_config_t, files[AUDIO_SAMPLE_INTRO], "intro", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(audio_sfx_config_t, files[AUDIO_SAMPLE_GAMEOVER], "gameover", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(audio_sfx_config_t, files[AUDIO_SAMPLE_GAMEWON], "won", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(audio_sfx_config_t, files[AUDIO_SAMPLE_WALL], "wall", CONFIG_VARTYPE_STRING, false, NULL),
+    ConfigSchemaField(audio_sfx_config_t, files[AUDIO_SAMPLE_CRASH], "crash", CONFIG_VARTYPE_STRING, false, NULL)
+};
+
 hashtable_t * audio_initialize(hashtable_t * config)
 {
 
@@ -136,41 +162,26 @@ hashtable_t * audio_initialize(hashtable_t * config)
     
     //  tabella dei files audio
     hashtable_t * samples_table = hashtable_new(HASHTABLE_DEFAULT_SIZE, string_functions);
+    samples_table->hash = wyhash;
+
+    //  chiavi per la ricerca dei suoni globali
+    int i;
+    for (i = 0; i < AUDIO_SAMPLE_LAST; i++)
+        audio_samples_keys[i] = (hashtable_key_t)HashtableKey(audio_sample_name(i));
 
     //  caricamento effetti sonori del gioco
     hashtable_t * sfx = hashtable_search(config, "sfx");
 
-    if (sfx) {
-
-        //  effetto "game over", in caso di sconfitta
-        char * gameover = hashtable_search(sfx, "gameover");
+    audio_sfx_config_t settings;
 
-        if (gameover)
-            audio_sample_load(gameover, samples_table, audio_sample_name(AUDIO_SAMPLE_GAMEOVER));
+    if (sfx && config_schema_decode(sfx, audio_sfx_config_schema, &settings, "sfx")) {
 
-        //  effetto "vittoria"
-        char * won = hashtable_search(sfx, "won");
+        for (i = 0; i < AUDIO_SAMPLE_LAST; i++) {
 
-        if (won)
-            audio_sample_load(won, samples_table, audio_sample_name(AUDIO_SAMPLE_GAMEWON));
+            if (settings.files[i])
+                audio_sample_load(settings.files[i], samples_table, audio_sample_name(i));
 
-        //  muro abbattuto
-        char * wall = hashtable_search(sfx, "wall");
-
-        if (wall)
-            audio_sample_load(wall, samples_table, audio_sample_name(AUDIO_SAMPLE_WALL));
-
-        //  scontro tra personaggi
-        char * crash = hashtable_search(sfx, "crash");
-
-        if (crash)
-            audio_sample_load(crash, samples_table, audio_sample_name(AUDIO_SAMPLE_CRASH));
-
-        //  schermata principale
-        char * intro = hashtable_search(sfx, "intro");
-
-        if (intro)
-            audio_sample_load(intro, samples_table, audio_sample_name(AUDIO_SAMPLE_INTRO));
+        }
 
     }
 
@@ -3,6 +3,9 @@
 
 #include "main/fs.h"
 
+/** Percorso della cartella delle risorse, calcolato alla prima richiesta */
+static char * resources_path = NULL;
+
 ALLEGRO_PATH * fs_get_standard_path(void) {
     
     static ALLEGRO_PATH * standard_path = NULL;
@@ -20,12 +23,23 @@ void fs_destroy(void) {
     
     al_destroy_path(fs_get_standard_path());
     
+    memfree(resources_path);
+    resources_path = NULL;
+    
 }
 
 const char * fs_get_resources_path(void) {
 
+    //  la prima chiamata a fs_get_standard_path può già calcolare il percorso (debugf)
+    ALLEGRO_PATH * standard_path = fs_get_standard_path();
+
+    //  al_path_cstr ricostruisce la stringa ad ogni chiamata, la copia
+    //  permette di leggere il percorso anche dai thread secondari
+    if (!resources_path)
+        resources_path = memstrdup(al_path_cstr(standard_path, FS_PATH_SEPARATOR));
+
     //  path della cartella delle risorse
-    return al_path_cstr(fs_get_standard_path(), FS_PATH_SEPARATOR);
+    return resources_path;
     
 }
 
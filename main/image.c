@@ -155,6 +155,28 @@ void image_mask_alpha(image_t * image, color_t color)
 
 }
 
+void image_upload(image_t * image)
+{
+
+    if (!image || !image->bitmap)
+        return;
+
+    //  già sulla scheda video
+    if (!(al_get_bitmap_flags(image->bitmap) & ALLEGRO_MEMORY_BITMAP))
+        return;
+
+    //  copia con i flag del thread chiamante (bitmap video nel thread principale)
+    ALLEGRO_BITMAP * bitmap = al_clone_bitmap(image->bitmap);
+
+    //  resta in memoria: disegnabile, ma più lenta
+    if (!bitmap)
+        return;
+
+    al_destroy_bitmap(image->bitmap);
+    image->bitmap = bitmap;
+
+}
+
 void image_delete(image_t * image)
 {
     
@@ -81,6 +81,16 @@ image_t * image_create_new(color_t fill, dimension_t size);
  */
 void image_delete(image_t * image);
 
+/**
+ *  Trasferisce sulla scheda video un'immagine creata in memoria
+ *  (ad esempio da un thread secondario, che non ha un display).
+ *  Va chiamata dal thread principale: image->bitmap è sostituita da una copia video,
+ *  per cui non vanno conservati riferimenti alla bitmap originale.
+ *
+ *  @param image Immagine
+ */
+void image_upload(image_t * image);
+
 /**
  *  Interpreta un certo colore dell'immagine come trasparente
  *
@@ -236,13 +236,13 @@ void output_fullscreen_message(char * title, char * message, color_t color)
 }
 
 /**
- *  Effettua il tiling e disegna una cella della mappa
+ *  Effettua il tiling e disegna sfondo o mura di una cella della mappa
  *
  *  @param level Livello di appartenenenza
  *  @param map Mappa
  *  @param point Coordinate della cella
  */
-void output_map_cell(level_t * level, map_t * map, point_t point)
+static void output_map_cell(level_t * level, map_t * map, point_t point)
 {
     
     point_t tile_offset[4] = {
@@ -254,7 +254,7 @@ void output_map_cell(level_t * level, map_t * map, point_t point)
     
     point_t points[4];
 
-    //  calcola i tiles da utilizzare
+    //  tiles da utilizzare, calcolati da map_connect
     map_get_tiling_points(map, point, points);
 
     //  posizione alla quale disegnare
@@ -263,15 +263,11 @@ void output_map_cell(level_t * level, map_t * map, point_t point)
     //  cella di destinazione
     map_cell_t * cell = map_get_cell(map, point);
     
-    //  controlla se il bonus è scaduto
-    if (cell->powerup.powerup)
-        powerup_check_cell(cell);
-    
     //  immagine da disegnare, diversa a seconda del valore della cella
     image_t * texture;
 
-    if (cell_is_path(cell))
-        texture = level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + ((int)cell_get_value(cell) - 1)];
+    if (cell_is_path(map, cell))
+        texture = level->textures[LEVEL_TEXTURE_PATH_LIGHTEST + (map_cell_get_value(map, cell) - 1)];
     else
         texture = level->textures[LEVEL_TEXTURE_WALL];
 
@@ -286,24 +282,17 @@ void output_map_cell(level_t * level, map_t * map, point_t point)
 
         output_image_tile(texture, source, PointPointOffset(position, tile_offset[i]));
 
-        //  se c'è un bonus disegna anche quello
-        if (cell->powerup.powerup)
-        {
-            powerup_t * powerup = cell->powerup.powerup;
-            
-            point_t off;
-            
-            off.x = (CellSize.width - powerup->tile->size.width) / 2.;
-            off.y = (CellSize.height - powerup->tile->size.height) / 2.;
-
-            output_image(powerup->tile, PointPointOffset(position, off));
-        }
     }
 
-
 }
 
-void output_map(level_t * level, map_t * map)
+/**
+ *  Disegna sfondo e mura di tutte le celle della mappa
+ *
+ *  @param level Livello di appartenenenza
+ *  @param map Mappa
+ */
+static void output_map_cells(level_t * level, map_t * map)
 {
 
     //  la bitmap viene disegnata in differita per ottimizzare le prestazioni
@@ -311,7 +300,6 @@ void output_map(level_t * level, map_t * map)
 
     int y = 0, x = 0;
 
-    //  disegno
     for (y = 0; y < map->size.height; y++) {
         for (x = 0; x < map->size.width; x++) {
             output_map_cell(level, map, PointMake(x, y));
@@ -320,7 +308,131 @@ void output_map(level_t * level, map_t * map)
 
     al_hold_bitmap_drawing(false);
 
-    //  l'uscita è colorata in modo leggermente diverso
+}
+
+/**
+ *  Aggiorna l'immagine con sfondo e mura della mappa: creata e disegnata interamente
+ *  se non valida, altrimenti sono ridisegnate solo le celle modificate
+ *
+ *  @param level Livello di appartenenenza
+ *  @param map Mappa
+ *
+ *  @return false se l'immagine non può essere creata (es. mappa più grande delle bitmap della scheda video)
+ */
+static bool output_map_layer_update(level_t * level, map_t * map)
+{
+
+    dimension_t size = SizeMake(map->size.width * CellSize.width, map->size.height * CellSize.height);
+
+    if (!map->layer) {
+
+        int limit = al_get_display_option(main_context.display, ALLEGRO_MAX_BITMAP_SIZE);
+
+        if (limit > 0 && (size.width > limit || size.height > limit))
+            return false;
+
+        //  trasparente: le parti trasparenti delle mura mostrano lo sfondo dello schermo
+        map->layer = image_create_new(ColorMakeRGBA(0, 0, 0, 0), size);
+
+        if (!map->layer)
+            return false;
+
+        map->layer_invalid = true;
+
+    }
+
+    if (!map->layer_invalid && !map->layer_dirty_count)
+        return true;
+
+    //  la trasformazione (origine della mappa) è quella della bitmap di destinazione:
+    //  nell'immagine le celle sono disegnate a partire da (0, 0)
+    al_set_target_bitmap(map->layer->bitmap);
+
+    ALLEGRO_COLOR transparent = al_map_rgba(0, 0, 0, 0);
+
+    if (map->layer_invalid) {
+
+        al_clear_to_color(transparent);
+        output_map_cells(level, map);
+
+    } else {
+
+        size_t i;
+        for (i = 0; i < map->layer_dirty_count; i++) {
+
+            point_t location = map->cells[map->layer_dirty[i]].location;
+            point_t position = cell_location_to_position(location);
+
+            //  le mura possono essere in parte trasparenti: la cella va prima svuotata
+            al_set_clipping_rectangle(position.x, position.y, CellSize.width, CellSize.height);
+            al_clear_to_color(transparent);
+            al_set_clipping_rectangle(0, 0, size.width, size.height);
+
+            output_map_cell(level, map, location);
+
+        }
+
+    }
+
+    al_set_target_backbuffer(main_context.display);
+
+    map->layer_invalid = false;
+    map->layer_dirty_count = 0;
+
+    return true;
+
+}
+
+/**
+ *  Disegna i bonus presenti sulla mappa, rimuovendo quelli scaduti
+ *
+ *  @param map Mappa
+ */
+static void output_map_powerups(map_t * map)
+{
+
+    bag_foreach(map->powerup_cells, map_cell_t *, cell) {
+
+        if (!cell->powerup.powerup)
+            continue;
+
+        //  controlla se il bonus è scaduto
+        powerup_check_cell(map, cell);
+
+        powerup_t * powerup = cell->powerup.powerup;
+
+        if (!powerup)
+            continue;
+
+        point_t off;
+
+        off.x = (CellSize.width - powerup->tile->size.width) / 2.;
+        off.y = (CellSize.height - powerup->tile->size.height) / 2.;
+
+        output_image(powerup->tile, PointPointOffset(cell_location_to_position(cell->location), off));
+
+    }
+
+}
+
+void output_map(level_t * level, map_t * map)
+{
+
+    //  sfondo e mura: una sola bitmap, se disponibile, altrimenti cella per cella
+    if (output_map_layer_update(level, map))
+        output_image(map->layer, PointZero);
+    else
+        output_map_cells(level, map);
+
+    //  bonus
+    al_hold_bitmap_drawing(true);
+    output_map_powerups(map);
+    al_hold_bitmap_drawing(false);
+
+    //  l'uscita è colorata in modo leggermente diverso (se è nella finestra del mondo visualizzata)
+    if (!map_cell_is_valid(map, map->end))
+        return;
+
     rectangle_t r;
     r.origin = cell_location_to_position(map->end);
     r.size = CellSize;
@@ -111,6 +111,11 @@ dimension_t output_get_string_size(char * string);
  *  - mura
  *  - bonus
  *
+ *  Sfondo e mura sono disegnati in un'immagine della mappa quando questa diventa
+ *  quella corrente e, in seguito, solo per le celle modificate (vedi map_layer_invalidate_cell):
+ *  ad ogni frame l'immagine è disegnata in un'unica operazione, seguita da bonus e uscita.
+ *  L'immagine è rilasciata quando la mappa smette di essere quella corrente (map_layer_release).
+ *
  *  @param level Livello di appartenenza della mappa
  *  @param map Mappa
  */
@@ -0,0 +1,302 @@
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+#include "main/thread.h"
+
+/**
+ *  Thread secondari sempre attivi che eseguono i lavori di thread_parallel_for.
+ *  Un solo thread_parallel_for alla volta usa i thread: le chiamate contemporanee
+ *  (es. dal thread di caricamento dei livelli) eseguono i lavori nel thread chiamante.
+ */
+static struct {
+
+    /** Protegge tutti i campi seguenti */
+    ALLEGRO_MUTEX * mutex;
+
+    /** Segnala ai thread un nuovo gruppo di lavori (o la chiusura) */
+    ALLEGRO_COND * work;
+
+    /** Segnala al chiamante il termine di un gruppo di lavori */
+    ALLEGRO_COND * done;
+
+    /** Thread secondari */
+    ALLEGRO_THREAD * threads[THREAD_WORKERS_MAX];
+
+    /** Numero di thread secondari */
+    size_t count;
+
+    /** Se true un thread_parallel_for sta usando i thread */
+    bool busy;
+
+    /** Se true i thread devono terminare */
+    bool quit;
+
+    /** Identificativo del gruppo di lavori corrente, incrementato ad ogni thread_parallel_for */
+    unsigned long generation;
+
+    /** Prossimo lavoro da eseguire */
+    size_t next;
+
+    /** Numero di lavori */
+    size_t jobs;
+
+    /** Thread che stanno eseguendo un lavoro */
+    size_t running;
+
+    /** Dati passati ad ogni lavoro */
+    void * data;
+
+    /** Lavoro */
+    thread_job_function function;
+
+} thread_pool;
+
+int thread_workers_count(void)
+{
+
+    long count;
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (long)info.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    //  numero di processori non disponibile
+    if (count < 1)
+        return 1;
+
+    return count > THREAD_WORKERS_MAX ? THREAD_WORKERS_MAX : (int)count;
+
+}
+
+/**
+ *  Funzione eseguita dai thread secondari: attende un gruppo di lavori
+ *  ed esegue lavori finchè ce ne sono da eseguire
+ *
+ *  @param al_thread Thread della libreria grafica
+ *  @param arg Non utilizzato
+ */
+static void * thread_pool_worker(ALLEGRO_THREAD * al_thread, void * arg)
+{
+
+    unused(al_thread);
+    unused(arg);
+
+    //  i thread secondari non hanno un display: le bitmap create sono in memoria
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+
+    unsigned long generation = 0;
+
+    al_lock_mutex(thread_pool.mutex);
+
+    while (1) {
+
+        while (!thread_pool.quit && thread_pool.generation == generation)
+            al_wait_cond(thread_pool.work, thread_pool.mutex);
+
+        if (thread_pool.quit)
+            break;
+
+        generation = thread_pool.generation;
+        thread_pool.running++;
+
+        while (thread_pool.next < thread_pool.jobs) {
+
+            size_t index = thread_pool.next++;
+
+            al_unlock_mutex(thread_pool.mutex);
+            thread_pool.function(index, thread_pool.data);
+            al_lock_mutex(thread_pool.mutex);
+
+        }
+
+        //  l'ultimo thread a terminare avvisa il chiamante
+        if (!--thread_pool.running)
+            al_broadcast_cond(thread_pool.done);
+
+    }
+
+    al_unlock_mutex(thread_pool.mutex);
+
+    return NULL;
+
+}
+
+void thread_pool_initialize(void)
+{
+
+    if (thread_pool.count)
+        return;
+
+    thread_pool.mutex = al_create_mutex();
+    thread_pool.work = al_create_cond();
+    thread_pool.done = al_create_cond();
+
+    if (!thread_pool.mutex || !thread_pool.work || !thread_pool.done) {
+        thread_pool_destroy();
+        return;
+    }
+
+    thread_pool.busy = thread_pool.quit = false;
+    thread_pool.generation = 0;
+    thread_pool.next = thread_pool.jobs = thread_pool.running = 0;
+
+    size_t workers = (size_t)thread_workers_count();
+
+    for (thread_pool.count = 0; thread_pool.count < workers; thread_pool.count++) {
+
+        ALLEGRO_THREAD * thread = al_create_thread(thread_pool_worker, NULL);
+
+        if (!thread)
+            break;
+
+        thread_pool.threads[thread_pool.count] = thread;
+        al_start_thread(thread);
+
+    }
+
+    //  nessun thread: i lavori sono eseguiti dal thread chiamante
+    if (!thread_pool.count)
+        thread_pool_destroy();
+
+}
+
+void thread_pool_destroy(void)
+{
+
+    if (thread_pool.mutex) {
+        al_lock_mutex(thread_pool.mutex);
+        thread_pool.quit = true;
+        al_broadcast_cond(thread_pool.work);
+        al_unlock_mutex(thread_pool.mutex);
+    }
+
+    size_t i;
+    for (i = 0; i < thread_pool.count; i++) {
+        al_join_thread(thread_pool.threads[i], NULL);
+        al_destroy_thread(thread_pool.threads[i]);
+    }
+
+    if (thread_pool.done)
+        al_destroy_cond(thread_pool.done);
+
+    if (thread_pool.work)
+        al_destroy_cond(thread_pool.work);
+
+    if (thread_pool.mutex)
+        al_destroy_mutex(thread_pool.mutex);
+
+    thread_pool.mutex = NULL;
+    thread_pool.work = thread_pool.done = NULL;
+    thread_pool.count = 0;
+
+}
+
+/**
+ *  Funzione eseguita dai thread avviati con thread_start
+ *
+ *  @param al_thread Thread della libreria grafica
+ *  @param arg Thread (thread_t)
+ */
+static void * thread_worker(ALLEGRO_THREAD * al_thread, void * arg)
+{
+
+    unused(al_thread);
+
+    thread_t * thread = arg;
+
+    //  i thread secondari non hanno un display: le bitmap create sono in memoria
+    al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+
+    thread->function(thread->data);
+
+    return NULL;
+
+}
+
+thread_t * thread_start(thread_function function, void * data)
+{
+
+    thread_t * thread = memalloc(thread_t);
+
+    thread->function = function;
+    thread->data = data;
+    thread->thread = al_create_thread(thread_worker, thread);
+
+    if (thread->thread)
+        al_start_thread(thread->thread);
+    else
+        function(data);
+
+    return thread;
+
+}
+
+void thread_join(thread_t * thread)
+{
+
+    if (!thread)
+        return;
+
+    if (thread->thread) {
+        al_join_thread(thread->thread, NULL);
+        al_destroy_thread(thread->thread);
+    }
+
+    memfree(thread);
+
+}
+
+void thread_parallel_for(size_t count, void * data, thread_job_function function)
+{
+
+    if (!count)
+        return;
+
+    //  i lavori sono eseguiti solo dai thread secondari, così lo stato del
+    //  thread chiamante (es. bitmap video, generatore di numeri casuali) non è modificato
+    bool pooled = false;
+
+    if (thread_pool.count) {
+
+        al_lock_mutex(thread_pool.mutex);
+
+        if (!thread_pool.busy) {
+
+            pooled = thread_pool.busy = true;
+
+            thread_pool.data = data;
+            thread_pool.function = function;
+            thread_pool.next = 0;
+            thread_pool.jobs = count;
+            thread_pool.generation++;
+
+            al_broadcast_cond(thread_pool.work);
+
+            while (thread_pool.next < thread_pool.jobs || thread_pool.running)
+                al_wait_cond(thread_pool.done, thread_pool.mutex);
+
+            thread_pool.busy = false;
+
+        }
+
+        al_unlock_mutex(thread_pool.mutex);
+
+    }
+
+    //  thread non disponibili o già occupati, i lavori sono eseguiti dal thread chiamante
+    if (!pooled) {
+
+        size_t i;
+        for (i = 0; i < count; i++)
+            function(i, data);
+
+    }
+
+}
@@ -0,0 +1,98 @@
+#ifndef main_thread_h
+#define main_thread_h
+
+#include <allegro5/allegro5.h>
+
+#include "utils.h"
+
+/** Numero massimo di thread utilizzati per eseguire lavori in parallelo */
+#define THREAD_WORKERS_MAX 16
+
+/**
+ *  Funzione eseguita per ogni indice da thread_parallel_for
+ *
+ *  @param index Indice del lavoro
+ *  @param data Dati condivisi tra i lavori
+ */
+typedef void (* thread_job_function)(size_t index, void * data);
+
+/**
+ *  Funzione eseguita da un thread avviato con thread_start
+ *
+ *  @param data Dati passati a thread_start
+ */
+typedef void (* thread_function)(void * data);
+
+/**
+ *  Thread secondario
+ */
+typedef struct thread_s {
+
+    /** Thread della libreria grafica (NULL se la funzione è stata eseguita dal thread chiamante) */
+    ALLEGRO_THREAD * thread;
+
+    /** Funzione da eseguire */
+    thread_function function;
+
+    /** Dati passati alla funzione */
+    void * data;
+
+} thread_t;
+
+/**
+ *  Avvia function(data) in un thread secondario.
+ *  Se non è possibile creare il thread la funzione è eseguita subito dal thread chiamante.
+ *  Valgono le stesse limitazioni di thread_parallel_for (niente disegno nè bitmap video).
+ *
+ *  @param function Funzione
+ *  @param data Dati passati alla funzione
+ *
+ *  @return Thread, da attendere con thread_join
+ */
+thread_t * thread_start(thread_function function, void * data);
+
+/**
+ *  Attende il termine di un thread avviato con thread_start e lo dealloca
+ *
+ *  @param thread Thread
+ */
+void thread_join(thread_t * thread);
+
+/**
+ *  Numero di thread da utilizzare per i lavori in parallelo
+ *  (pari al numero di processori disponibili, al massimo THREAD_WORKERS_MAX)
+ *
+ *  @return Numero di thread
+ */
+int thread_workers_count(void);
+
+/**
+ *  Avvia i thread secondari utilizzati da thread_parallel_for (thread_workers_count),
+ *  che restano in attesa di lavori fino a thread_pool_destroy.
+ *  Senza questa chiamata i lavori sono eseguiti dal thread chiamante.
+ */
+void thread_pool_initialize(void);
+
+/**
+ *  Termina i thread secondari avviati da thread_pool_initialize
+ *  (non ci devono essere thread_parallel_for in corso)
+ */
+void thread_pool_destroy(void);
+
+/**
+ *  Esegue function(index, data) per ogni index in [0, count) distribuendo
+ *  i lavori tra i thread secondari di thread_pool_initialize e ritorna quando sono stati tutti completati.
+ *  Se i thread sono già occupati da un'altra chiamata (o non sono stati avviati)
+ *  i lavori sono eseguiti dal thread chiamante, in ordine.
+ *  L'ordine di esecuzione non è definito: ogni lavoro deve scrivere solo nei propri dati.
+ *
+ *  I thread secondari non hanno un display: la funzione non deve disegnare
+ *  né creare bitmap video (vedi image_upload).
+ *
+ *  @param count Numero di lavori
+ *  @param data Dati passati ad ogni lavoro
+ *  @param function Lavoro
+ */
+void thread_parallel_for(size_t count, void * data, thread_job_function function);
+
+#endif  // main_thread_h
@@ -50,19 +50,22 @@ int map_tiling_get_tile_type(map_t * map, point_t point)
     if (point.y < 0 || point.y >= map->size.height)
         return CELL_TYPE_UNKNOWN;
 
-    map_cell_t * cell = map_get_cell(map, point);
-    
-    return cell->type;
+    return map->types[map_cell_location_to_index(map, point)];
 
 }
 
-void map_get_tiling_points(map_t * map, point_t point, point_t * points)
+/**
+ *  Calcola i tasselli di una cella in base al tipo delle celle vicine
+ *  e li memorizza in map->tiling
+ *
+ *  @param map Mappa
+ *  @param point Coordinate della cella
+ */
+static void map_tiling_compute(map_t * map, point_t point)
 {
 
-    map_cell_t * cell = map_get_cell(map, point);
-
     unsigned char a = 0, b = 0, c = 0, d = 0;
-    int cell_type = cell->type;
+    int cell_type = map->types[map_cell_location_to_index(map, point)];
     
     int top     = map_tiling_get_tile_type(map, PointPointOffset(point, OffsetTop));
     int left    = map_tiling_get_tile_type(map, PointPointOffset(point, OffsetLeft));
@@ -109,10 +112,56 @@ void map_get_tiling_points(map_t * map, point_t point, point_t * points)
         map_tiling_get_tile_type(map, PointPointOffset(point, OffsetBottomRight)) != cell_type)
         d = TILE_PART_ANGLE;
 
-    points[TILE_A] = tiles_specs[TILE_A][a];
-    points[TILE_B] = tiles_specs[TILE_B][b];
-    points[TILE_C] = tiles_specs[TILE_C][c];
-    points[TILE_D] = tiles_specs[TILE_D][d];
+    unsigned char * tiling = &map->tiling[map_cell_location_to_index(map, point) * 4];
+
+    tiling[TILE_A] = a;
+    tiling[TILE_B] = b;
+    tiling[TILE_C] = c;
+    tiling[TILE_D] = d;
+
+}
+
+void map_tiling_update(map_t * map)
+{
+
+    int x, y;
+    for (y = 0; y < map->size.height; y++) {
+        for (x = 0; x < map->size.width; x++)
+            map_tiling_compute(map, PointMake(x, y));
+    }
+
+    map_layer_invalidate(map);
+
+}
+
+void map_tiling_update_cell(map_t * map, point_t point)
+{
+
+    //  il tipo della cella cambia i tasselli delle 8 celle vicine
+    int x, y;
+    for (y = (int)point.y - 1; y <= (int)point.y + 1; y++) {
+        for (x = (int)point.x - 1; x <= (int)point.x + 1; x++) {
+
+            if (!map_cell_is_valid(map, PointMake(x, y)))
+                continue;
+
+            map_tiling_compute(map, PointMake(x, y));
+            map_layer_invalidate_cell(map, map_cell_location_to_index(map, PointMake(x, y)));
+
+        }
+    }
+
+}
+
+void map_get_tiling_points(map_t * map, point_t point, point_t * points)
+{
+
+    const unsigned char * tiling = &map->tiling[map_cell_location_to_index(map, point) * 4];
+
+    points[TILE_A] = tiles_specs[TILE_A][tiling[TILE_A]];
+    points[TILE_B] = tiles_specs[TILE_B][tiling[TILE_B]];
+    points[TILE_C] = tiles_specs[TILE_C][tiling[TILE_C]];
+    points[TILE_D] = tiles_specs[TILE_D][tiling[TILE_D]];
 
 }
 
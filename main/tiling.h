@@ -46,8 +46,26 @@ enum {
 /** Dimensione dei tiles dei personaggi */
 #define CharacterTileSize   SizeMake(24, 32)
 
+/**
+ *  Calcola i tasselli di tutte le celle di una mappa (vedi map_connect)
+ *  e invalida l'immagine di sfondo e mura della mappa
+ *
+ *  @param map Mappa
+ */
+void map_tiling_update(map_t * map);
+
+/**
+ *  Ricalcola i tasselli di una cella e delle 8 celle vicine, dopo il cambio di tipo della cella,
+ *  e le segnala da ridisegnare nell'immagine di sfondo e mura della mappa
+ *
+ *  @param map Mappa
+ *  @param point Coordinate della cella
+ */
+void map_tiling_update_cell(map_t * map, point_t point);
+
 /**
  *  Data una mappa e un certo punto di essa, in points[4] inserisce le coordinate dei quattro tile 16x16 da disegnare
+ *  (calcolate da map_tiling_update o map_tiling_update_cell)
  *
  *  @param map Mappa
  *  @param point Punto della mappa
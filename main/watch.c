@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <sys/inotify.h>
+#endif
+
+#include "utils.h"
+
+#include "main/watch.h"
+
+/**
+ *  File osservato
+ */
+typedef struct {
+
+    /** Percorso del file */
+    char * path;
+
+    /** Nome del file (all'interno di path) */
+    const char * name;
+
+    /** Descrittore inotify della cartella che contiene il file (-1 se assente) */
+    int wd;
+
+    /** Data di modifica all'ultimo controllo */
+    int64_t mtime;
+
+    /** Dimensione all'ultimo controllo */
+    int64_t size;
+
+    /** Modificato dall'ultima chiamata a watch_poll */
+    bool changed;
+
+} watch_file_t;
+
+struct watch_s {
+
+    /** Descrittore inotify (-1 se non disponibile) */
+    int fd;
+
+    /** File osservati */
+    watch_file_t * files;
+
+    /** Numero di file osservati */
+    size_t count;
+
+    /** Istante dell'ultimo controllo delle date di modifica */
+    time_t checked;
+
+};
+
+/**
+ *  Legge data di modifica e dimensione di un file
+ *
+ *  @param file File osservato
+ *
+ *  @return true se data o dimensione sono cambiate
+ */
+static bool watch_file_stat(watch_file_t * file)
+{
+
+    struct stat info;
+
+    if (stat(file->path, &info) != 0)
+        return false;
+
+    bool changed = (int64_t)info.st_mtime != file->mtime || (int64_t)info.st_size != file->size;
+
+    file->mtime = (int64_t)info.st_mtime;
+    file->size = (int64_t)info.st_size;
+
+    return changed;
+
+}
+
+watch_t * watch_new(void)
+{
+
+    watch_t * watch = memalloc(watch_t, 1, true);
+
+#ifdef __linux__
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    watch->fd = -1;
+#endif
+
+    return watch;
+
+}
+
+bool watch_add(watch_t * watch, const char * path)
+{
+
+    if (!watch || !path)
+        return false;
+
+    size_t i;
+    for (i = 0; i < watch->count; i++) {
+        if (!strcmp(watch->files[i].path, path))
+            return true;
+    }
+
+    watch->files = memrealloc(watch->files, watch_file_t, watch->count + 1);
+
+    watch_file_t * file = &watch->files[watch->count++];
+
+    file->path = memstrdup(path);
+    file->wd = -1;
+    file->changed = false;
+
+    //  nome del file e cartella che lo contiene
+    const char * slash = strrchr(file->path, '/');
+    file->name = slash ? slash + 1 : file->path;
+
+    watch_file_stat(file);
+
+#ifdef __linux__
+    if (watch->fd >= 0) {
+
+        char * directory = slash ? memstrdup(file->path) : memstrdup(".");
+
+        if (slash)
+            directory[slash - file->path] = '\0';
+
+        //  la stessa cartella restituisce sempre lo stesso descrittore
+        file->wd = inotify_add_watch(watch->fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+
+        memfree(directory);
+
+        if (file->wd < 0)
+            debugf("[Watch] inotify non disponibile per %s, controllo periodico\n", file->path);
+
+    }
+#endif
+
+    return true;
+
+}
+
+void watch_remove(watch_t * watch, const char * path)
+{
+
+    if (!watch || !path)
+        return;
+
+    size_t i;
+    for (i = 0; i < watch->count; i++) {
+
+        if (!strcmp(watch->files[i].path, path))
+            break;
+
+    }
+
+    if (i == watch->count)
+        return;
+
+    watch_file_t removed = watch->files[i];
+
+    //  l'ultimo file prende il posto di quello rimosso
+    watch->files[i] = watch->files[--watch->count];
+
+#ifdef __linux__
+    //  la cartella non è più osservata se non contiene altri file osservati
+    if (removed.wd >= 0) {
+
+        bool shared = false;
+
+        for (i = 0; i < watch->count && !shared; i++)
+            shared = watch->files[i].wd == removed.wd;
+
+        if (!shared)
+            inotify_rm_watch(watch->fd, removed.wd);
+
+    }
+#endif
+
+    memfree(removed.path);
+
+}
+
+/**
+ *  Legge gli eventi inotify disponibili e segna i file modificati
+ *
+ *  @param watch Osservatore
+ */
+static void watch_read_events(watch_t * watch)
+{
+
+#ifdef __linux__
+    if (watch->fd < 0)
+        return;
+
+    //  buffer allineato come struct inotify_event
+    union {
+        struct inotify_event event;
+        char bytes[4096];
+    } buffer;
+
+    ssize_t length;
+
+    while ((length = read(watch->fd, buffer.bytes, sizeof(buffer.bytes))) > 0) {
+
+        char * position = buffer.bytes;
+
+        while (position < buffer.bytes + length) {
+
+            struct inotify_event * event = (struct inotify_event *)position;
+
+            size_t i;
+            for (i = 0; event->len && i < watch->count; i++) {
+                if (watch->files[i].wd == event->wd && !strcmp(watch->files[i].name, event->name))
+                    watch->files[i].changed = true;
+            }
+
+            position += sizeof(struct inotify_event) + event->len;
+
+        }
+
+    }
+#endif
+
+}
+
+void watch_poll(watch_t * watch, void * data, watch_function function)
+{
+
+    if (!watch || !function)
+        return;
+
+    //  1. eventi inotify
+    watch_read_events(watch);
+
+    //  2. file senza inotify, al più una volta al secondo
+    time_t now = time(NULL);
+
+    size_t i;
+
+    if (now != watch->checked) {
+
+        watch->checked = now;
+
+        for (i = 0; i < watch->count; i++) {
+            if (watch->files[i].wd < 0 && watch_file_stat(&watch->files[i]))
+                watch->files[i].changed = true;
+        }
+
+    }
+
+    //  3. notifica, una sola volta per file anche se ci sono stati più eventi.
+    //  function può aggiungere o rimuovere file (files è riallocato o riordinato):
+    //  si notifica una copia dei percorsi dei file modificati
+    char ** changed = NULL;
+    size_t count = 0;
+
+    for (i = 0; i < watch->count; i++) {
+
+        if (watch->files[i].changed) {
+            watch->files[i].changed = false;
+            changed = memrealloc(changed, char *, count + 1);
+            changed[count++] = memstrdup(watch->files[i].path);
+        }
+
+    }
+
+    for (i = 0; i < count; i++) {
+        function(data, changed[i]);
+        memfree(changed[i]);
+    }
+
+    memfree(changed);
+
+}
+
+void watch_delete(watch_t * watch)
+{
+
+    if (!watch)
+        return;
+
+#ifdef __linux__
+    //  chiudendo il descrittore sono rimossi tutti i watch
+    if (watch->fd >= 0)
+        close(watch->fd);
+#endif
+
+    size_t i;
+    for (i = 0; i < watch->count; i++)
+        memfree(watch->files[i].path);
+
+    memfree(watch->files);
+    memfree(watch);
+
+}
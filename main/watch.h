@@ -0,0 +1,66 @@
+#ifndef main_watch_h
+#define main_watch_h
+
+#include <stdbool.h>
+
+/**
+ *  Osservatore di file: segnala i file modificati dall'ultimo controllo.
+ *
+ *  Su Linux è utilizzato inotify sulle cartelle che contengono i file (in questo modo sono
+ *  rilevati anche i salvataggi che sostituiscono il file con una rename), altrove, o se
+ *  inotify non è disponibile, si confrontano data di modifica e dimensione al più una volta al secondo.
+ */
+typedef struct watch_s watch_t;
+
+/**
+ *  Funzione chiamata per ogni file modificato
+ *
+ *  @param data Dati dell'utente
+ *  @param path Percorso del file, come passato a watch_add
+ */
+typedef void (* watch_function)(void * data, const char * path);
+
+/**
+ *  Creazione di un osservatore
+ *
+ *  @return Osservatore
+ */
+watch_t * watch_new(void);
+
+/**
+ *  Aggiunge un file all'osservatore, se non è già presente
+ *
+ *  @param watch Osservatore
+ *  @param path Percorso del file
+ *
+ *  @return true se il file è osservato
+ */
+bool watch_add(watch_t * watch, const char * path);
+
+/**
+ *  Rimuove un file dall'osservatore, se presente
+ *
+ *  @param watch Osservatore
+ *  @param path Percorso del file, come passato a watch_add
+ */
+void watch_remove(watch_t * watch, const char * path);
+
+/**
+ *  Controlla, senza attendere, se ci sono file modificati.
+ *  function può aggiungere o rimuovere file dall'osservatore: i file aggiunti sono
+ *  controllati dalla chiamata successiva.
+ *
+ *  @param watch Osservatore
+ *  @param data Dati passati a function
+ *  @param function Funzione chiamata una volta per ogni file modificato
+ */
+void watch_poll(watch_t * watch, void * data, watch_function function);
+
+/**
+ *  Deallocazione di un osservatore
+ *
+ *  @param watch Osservatore
+ */
+void watch_delete(watch_t * watch);
+
+#endif  // main_watch_h
@@ -0,0 +1,99 @@
+#ifndef misc_fixed_h
+#define misc_fixed_h
+
+#include <stdint.h>
+#include <math.h>
+
+#include "utils.h"
+
+/**
+ *  Numero a virgola fissa: parte intera (in celle) e 16 bit di parte frazionaria.
+ *  Le operazioni sono intere, per cui il risultato è lo stesso su ogni macchina;
+ *  la parte intera è limitata a [-32768, 32767].
+ */
+typedef int32_t fixed_t;
+
+/** Bit della parte frazionaria */
+#define FIXED_SHIFT             16
+
+/** Valore 1 */
+#define FIXED_ONE               ((fixed_t)1 << FIXED_SHIFT)
+
+/** Converte un intero */
+#define FixedFromInt(i)         ((fixed_t)(i) * FIXED_ONE)
+
+/** Parte intera, arrotondata per difetto anche per i valori negativi */
+#define FixedFloor(f)           ((int32_t)((f) >> FIXED_SHIFT))
+
+/** Parte frazionaria, in [0, FIXED_ONE) */
+#define FixedFraction(f)        ((f) & (FIXED_ONE - 1))
+
+/**
+ *  Converte un valore reale, arrotondato al valore rappresentabile più vicino
+ *
+ *  @param value Valore
+ *
+ *  @return Valore a virgola fissa
+ */
+sinline fixed_t FixedFromFloat(float value)
+{
+
+    return (fixed_t)lroundf(value * FIXED_ONE);
+
+}
+
+/**
+ *  Converte in un valore reale
+ *
+ *  @param value Valore a virgola fissa
+ *
+ *  @return Valore reale
+ */
+sinline float FixedToFloat(fixed_t value)
+{
+
+    return (float)value / FIXED_ONE;
+
+}
+
+/**
+ *  Interpolazione lineare tra due valori, a + (b - a) * t
+ *
+ *  @param a Primo valore
+ *  @param b Secondo valore
+ *  @param t Avanzamento, in [0, FIXED_ONE]
+ *
+ *  @return Valore interpolato
+ */
+sinline fixed_t FixedLerp(fixed_t a, fixed_t b, fixed_t t)
+{
+
+    //  il prodotto può superare i 32 bit
+    return a + (fixed_t)(((int64_t)(b - a) * t) >> FIXED_SHIFT);
+
+}
+
+/**
+ *  Punto a virgola fissa, in celle
+ */
+typedef struct {
+
+    fixed_t x, y;
+
+} fixed_point_t;
+
+/**
+ *  Inizializza un punto date le sue coordinate
+ */
+#define FixedPointMake(x, y)            ((fixed_point_t){(fixed_t)(x), (fixed_t)(y)})
+
+/** Punto nullo */
+#define FixedPointNull                  FixedPointMake(INT32_MIN, INT32_MIN)
+
+/** Verifica che un punto sia nullo */
+#define FixedPointIsNull(point)         ((point).x == INT32_MIN && (point).y == INT32_MIN)
+
+/** Confronta due punti (esattamente) */
+#define FixedPointEqualToPoint(a, b)    ((a).x == (b).x && (a).y == (b).y)
+
+#endif  // misc_fixed_h
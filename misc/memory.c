@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "misc/memory.h"
+
+#ifdef MEMORY_ACCOUNTING
+
+/** Numero massimo di punti di chiamata registrati */
+#define MEMORY_SITES_SIZE 2048
+
+/** Valore di controllo dell'intestazione dei blocchi */
+#define MEMORY_BLOCK_MAGIC 0x4d454d21u
+
+/**
+ *  Punto di chiamata (file, riga) di memalloc/memrealloc
+ */
+typedef struct memory_site_s {
+
+    /** File sorgente (NULL se la posizione della tabella è libera) */
+    const char * file;
+
+    /** Riga */
+    int line;
+
+    /** Tipo allocato */
+    const char * type;
+
+    /** Sottosistema di appartenenza */
+    int subsystem;
+
+    /** Contatori */
+    memory_counters_t counters;
+
+} memory_site_t;
+
+/**
+ *  Intestazione che precede ogni blocco allocato.
+ *  La union mantiene l'allineamento della memoria restituita
+ */
+typedef union memory_block_u {
+
+    struct {
+
+        /** Dimensione richiesta */
+        size_t size;
+
+        /** Punto di chiamata */
+        memory_site_t * site;
+
+        /** Valore di controllo */
+        uint32_t magic;
+
+    } header;
+
+    long double alignment;
+    void * pointer_alignment;
+
+} memory_block_t;
+
+/** Nomi dei sottosistemi */
+static const char * memory_subsystems_names[] = {
+    [MEMORY_SUBSYSTEM_MAP]          = "map",
+    [MEMORY_SUBSYSTEM_PATHFINDING]  = "pathfinding",
+    [MEMORY_SUBSYSTEM_STD]          = "std",
+    [MEMORY_SUBSYSTEM_CONFIG]       = "config",
+    [MEMORY_SUBSYSTEM_GAME]         = "game",
+    [MEMORY_SUBSYSTEM_OTHER]        = "other"
+};
+
+/** Contatori dei sottosistemi */
+static memory_counters_t memory_subsystems[MEMORY_SUBSYSTEM_LAST];
+
+/** Tabella dei punti di chiamata */
+static memory_site_t memory_sites[MEMORY_SITES_SIZE];
+
+/** Punto di chiamata al quale sono attribuite le allocazioni se la tabella è piena */
+static memory_site_t memory_site_overflow = { "(altri)", 0, "?", MEMORY_SUBSYSTEM_OTHER, { 0, 0, 0, 0 } };
+
+/** Protegge contatori e punti di chiamata dalle allocazioni dei thread secondari */
+static ALLEGRO_MUTEX * memory_mutex = NULL;
+
+/**
+ *  Acquisisce il lock sui contatori.
+ *  Il mutex è creato alla prima allocazione, eseguita dal thread principale
+ *  prima che siano avviati altri thread.
+ */
+void memory_lock(void)
+{
+
+    if (!memory_mutex)
+        memory_mutex = al_create_mutex();
+
+    if (memory_mutex)
+        al_lock_mutex(memory_mutex);
+
+}
+
+/**
+ *  Rilascia il lock sui contatori
+ */
+void memory_unlock(void)
+{
+
+    if (memory_mutex)
+        al_unlock_mutex(memory_mutex);
+
+}
+
+/**
+ *  Individua il sottosistema al quale appartiene un file sorgente
+ *
+ *  @param file Percorso del file
+ *
+ *  @return Sottosistema
+ */
+int memory_subsystem(const char * file)
+{
+
+    if (strstr(file, "game/map") || strstr(file, "game/cell") || strstr(file, "main/tiling"))
+        return MEMORY_SUBSYSTEM_MAP;
+
+    if (strstr(file, "pathfinding/"))
+        return MEMORY_SUBSYSTEM_PATHFINDING;
+
+    if (strstr(file, "std/"))
+        return MEMORY_SUBSYSTEM_STD;
+
+    if (strstr(file, "config/") || strstr(file, "parser/"))
+        return MEMORY_SUBSYSTEM_CONFIG;
+
+    if (strstr(file, "game/"))
+        return MEMORY_SUBSYSTEM_GAME;
+
+    return MEMORY_SUBSYSTEM_OTHER;
+
+}
+
+/**
+ *  Cerca (o registra) un punto di chiamata
+ *
+ *  @param file File sorgente
+ *  @param line Riga
+ *  @param type Tipo allocato
+ *
+ *  @return Punto di chiamata
+ */
+memory_site_t * memory_site(const char * file, int line, const char * type)
+{
+
+    //  __FILE__ è una costante, per cui basta confrontare i puntatori
+    size_t index = (((uintptr_t)file >> 3) * 31 + (size_t)line) % MEMORY_SITES_SIZE;
+
+    size_t probes;
+    for (probes = 0; probes < MEMORY_SITES_SIZE; probes++) {
+
+        memory_site_t * site = &memory_sites[index];
+
+        //  posizione libera, si registra il punto di chiamata
+        if (!site->file) {
+            site->file = file;
+            site->line = line;
+            site->type = type;
+            site->subsystem = memory_subsystem(file);
+            return site;
+        }
+
+        if (site->file == file && site->line == line)
+            return site;
+
+        index = (index + 1) % MEMORY_SITES_SIZE;
+
+    }
+
+    return &memory_site_overflow;
+
+}
+
+/**
+ *  Registra l'allocazione di un blocco
+ *
+ *  @param block Intestazione del blocco
+ *  @param site Punto di chiamata
+ *  @param size Dimensione
+ */
+void memory_account_alloc(memory_block_t * block, memory_site_t * site, size_t size)
+{
+
+    block->header.size = size;
+    block->header.site = site;
+    block->header.magic = MEMORY_BLOCK_MAGIC;
+
+    memory_counters_t * counters[] = { &site->counters, &memory_subsystems[site->subsystem] };
+
+    size_t i;
+    for (i = 0; i < array_count(counters); i++) {
+        counters[i]->live_bytes += size;
+        counters[i]->live_count++;
+        counters[i]->allocations++;
+        counters[i]->interval_allocations++;
+    }
+
+}
+
+/**
+ *  Registra la deallocazione di un blocco
+ *
+ *  @param block Intestazione del blocco
+ */
+void memory_account_free(memory_block_t * block)
+{
+
+    memory_site_t * site = block->header.site;
+
+    memory_counters_t * counters[] = { &site->counters, &memory_subsystems[site->subsystem] };
+
+    size_t i;
+    for (i = 0; i < array_count(counters); i++) {
+        counters[i]->live_bytes -= block->header.size;
+        counters[i]->live_count--;
+    }
+
+    block->header.magic = 0;
+
+}
+
+/**
+ *  Intestazione di un blocco a partire dalla memoria restituita al chiamante
+ *
+ *  @param ptr Memoria
+ *
+ *  @return Intestazione
+ *  @retval NULL Se il blocco non è stato allocato da memory_alloc
+ */
+memory_block_t * memory_block(void * ptr)
+{
+
+    memory_block_t * block = (memory_block_t *)ptr - 1;
+
+    if (block->header.magic != MEMORY_BLOCK_MAGIC) {
+        errorf("[Memoria] Blocco %p non registrato\n", ptr);
+        return NULL;
+    }
+
+    return block;
+
+}
+
+void * memory_alloc(size_t size, int clear, const char * type, const char * file, int line)
+{
+
+    memory_block_t * block = malloc(sizeof(memory_block_t) + size);
+
+    if (!block) {
+        errorf("Impossibile allocare %zu bytes (%s:%d)\n", size, file, line);
+        exit(EXIT_FAILURE);
+    }
+
+    if (clear)
+        memset(block + 1, 0, size);
+
+    memory_lock();
+    memory_account_alloc(block, memory_site(file, line, type), size);
+    memory_unlock();
+
+    return block + 1;
+
+}
+
+void * memory_realloc(void * ptr, size_t size, const char * type, const char * file, int line)
+{
+
+    if (!ptr)
+        return memory_alloc(size, 0, type, file, line);
+
+    memory_block_t * block = memory_block(ptr);
+
+    //  blocco non registrato, si ri-alloca senza contabilizzarlo
+    if (!block)
+        return safe_realloc(ptr, size);
+
+    memory_lock();
+    memory_account_free(block);
+    memory_unlock();
+
+    memory_block_t * reblock = realloc(block, sizeof(memory_block_t) + size);
+
+    if (!reblock) {
+        errorf("Impossibile ri-allocare %zu bytes (%s:%d)\n", size, file, line);
+        exit(EXIT_FAILURE);
+    }
+
+    //  il blocco è attribuito al punto di chiamata della ri-allocazione
+    memory_lock();
+    memory_account_alloc(reblock, memory_site(file, line, type), size);
+    memory_unlock();
+
+    return reblock + 1;
+
+}
+
+char * memory_strdup(const char * string, const char * file, int line)
+{
+
+    size_t length = strlen(string) + 1;
+
+    char * copy = memory_alloc(length, 0, "char", file, line);
+    memcpy(copy, string, length);
+
+    return copy;
+
+}
+
+void memory_free(void * ptr)
+{
+
+    if (!ptr)
+        return;
+
+    memory_block_t * block = memory_block(ptr);
+
+    //  blocco non registrato (es. allocato da una libreria esterna)
+    if (!block) {
+        free(ptr);
+        return;
+    }
+
+    memory_lock();
+    memory_account_free(block);
+    memory_unlock();
+
+    free(block);
+
+}
+
+memory_counters_t memory_counters(int subsystem)
+{
+
+    memory_counters_t empty = { 0, 0, 0, 0 };
+
+    if (subsystem < 0 || subsystem >= MEMORY_SUBSYSTEM_LAST)
+        return empty;
+
+    memory_lock();
+    memory_counters_t counters = memory_subsystems[subsystem];
+    memory_unlock();
+
+    return counters;
+
+}
+
+/**
+ *  Stampa i contatori di un punto di chiamata se ha memoria allocata o ha allocato nell'intervallo
+ *
+ *  @param stream Destinazione
+ *  @param site Punto di chiamata
+ */
+void memory_report_site(FILE * stream, memory_site_t * site)
+{
+
+    if (!site->counters.live_count && !site->counters.interval_allocations)
+        return;
+
+    fprintf(stream, "    %-12s %10zu B %8zu blocchi %8zu nuove  %s:%d (%s)\n",
+            memory_subsystems_names[site->subsystem],
+            site->counters.live_bytes,
+            site->counters.live_count,
+            site->counters.interval_allocations,
+            site->file,
+            site->line,
+            site->type);
+
+    site->counters.interval_allocations = 0;
+
+}
+
+void memory_report(FILE * stream)
+{
+
+    memory_lock();
+
+    fprintf(stream, "[Memoria] Sottosistemi (in uso, blocchi, allocazioni totali, allocazioni dall'ultimo report)\n");
+
+    int i;
+    for (i = 0; i < MEMORY_SUBSYSTEM_LAST; i++) {
+
+        memory_counters_t * counters = &memory_subsystems[i];
+
+        fprintf(stream, "    %-12s %10zu B %8zu blocchi %10zu totali %8zu nuove\n",
+                memory_subsystems_names[i],
+                counters->live_bytes,
+                counters->live_count,
+                counters->allocations,
+                counters->interval_allocations);
+
+        counters->interval_allocations = 0;
+
+    }
+
+    fprintf(stream, "[Memoria] Punti di chiamata\n");
+
+    for (i = 0; i < MEMORY_SITES_SIZE; i++) {
+        if (memory_sites[i].file)
+            memory_report_site(stream, &memory_sites[i]);
+    }
+
+    memory_report_site(stream, &memory_site_overflow);
+
+    memory_unlock();
+
+}
+
+#endif  // MEMORY_ACCOUNTING
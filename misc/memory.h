@@ -0,0 +1,124 @@
+#ifndef misc_memory_h
+#define misc_memory_h
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ *  Contabilità della memoria allocata tramite memalloc/memrealloc/memfree.
+ *
+ *  Attiva solo se il programma è compilato con MEMORY_ACCOUNTING definito
+ *  (cmake -DMEMORY_ACCOUNTING=ON), altrimenti le macro di utils.h chiamano
+ *  direttamente malloc/realloc/free e queste funzioni non sono utilizzate.
+ */
+
+/**
+ *  Sottosistemi ai quali sono attribuite le allocazioni, in base al file sorgente
+ */
+enum {
+
+    /** game/map.c, game/cell.c, main/tiling.c */
+    MEMORY_SUBSYSTEM_MAP,
+
+    /** pathfinding/ */
+    MEMORY_SUBSYSTEM_PATHFINDING,
+
+    /** std/ */
+    MEMORY_SUBSYSTEM_STD,
+
+    /** config/, parser/ */
+    MEMORY_SUBSYSTEM_CONFIG,
+
+    /** game/ */
+    MEMORY_SUBSYSTEM_GAME,
+
+    /** Tutto il resto (main/, misc/, ...) */
+    MEMORY_SUBSYSTEM_OTHER,
+
+    MEMORY_SUBSYSTEM_LAST
+
+};
+
+/**
+ *  Contatori di un sottosistema
+ */
+typedef struct memory_counters_s {
+
+    /** Bytes attualmente allocati */
+    size_t live_bytes;
+
+    /** Blocchi attualmente allocati */
+    size_t live_count;
+
+    /** Allocazioni effettuate dall'avvio */
+    size_t allocations;
+
+    /** Allocazioni effettuate dall'ultimo report */
+    size_t interval_allocations;
+
+} memory_counters_t;
+
+/**
+ *  Allocazione di un blocco di memoria registrandone il punto di chiamata
+ *
+ *  @param size Dimensione in bytes
+ *  @param clear Se azzerare la memoria
+ *  @param type Nome del tipo allocato
+ *  @param file File sorgente della chiamata
+ *  @param line Riga della chiamata
+ *
+ *  @return Memoria allocata
+ */
+void * memory_alloc(size_t size, int clear, const char * type, const char * file, int line);
+
+/**
+ *  Ri-allocazione di un blocco allocato con memory_alloc
+ *
+ *  @param ptr Blocco da ri-allocare (può essere NULL)
+ *  @param size Nuova dimensione in bytes
+ *  @param type Nome del tipo allocato
+ *  @param file File sorgente della chiamata
+ *  @param line Riga della chiamata
+ *
+ *  @return Memoria ri-allocata
+ */
+void * memory_realloc(void * ptr, size_t size, const char * type, const char * file, int line);
+
+/**
+ *  Copia di una stringa in un blocco registrato
+ *
+ *  @param string Stringa
+ *  @param file File sorgente della chiamata
+ *  @param line Riga della chiamata
+ *
+ *  @return Copia
+ */
+char * memory_strdup(const char * string, const char * file, int line);
+
+/**
+ *  Deallocazione di un blocco allocato con memory_alloc
+ *
+ *  @param ptr Blocco
+ */
+void memory_free(void * ptr);
+
+/**
+ *  Contatori di un sottosistema
+ *
+ *  @param subsystem Sottosistema (MEMORY_SUBSYSTEM_*)
+ *
+ *  @return Contatori
+ */
+memory_counters_t memory_counters(int subsystem);
+
+/**
+ *  Stampa un report con i contatori di ogni sottosistema e i punti di chiamata
+ *  con memoria ancora allocata o che hanno allocato dall'ultimo report.
+ *  Gli intervalli tra due report permettono di individuare le allocazioni
+ *  ripetute ad ogni frame.
+ *
+ *  @param stream Destinazione del report
+ */
+void memory_report(FILE * stream);
+
+#endif  // misc_memory_h
@@ -1,35 +1,73 @@
 #include <stdlib.h>
 #include <stdint.h>
+#include <time.h>
 #include "misc/random.h"
 
-/* initialize state to random bits  */
-static unsigned long state[16];
-/* init should also reset this to 0 */
-static unsigned int well_index = 0;
+/* each thread has its own generator */
+static threadlocal random_t thread_random;
+
+/**
+ *  Passo di splitmix64, così anche seed vicini producono stati molto diversi
+ *
+ *  @param x Stato di splitmix64, avanzato ad ogni chiamata
+ *
+ *  @return Valore generato
+ */
+static uint64_t random_splitmix64(uint64_t * x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void random_seed(random_t * random, uint32_t seed)
+{
+    size_t j;
+    uint64_t x = seed;
+
+    for (j = 0; j < sizeof(random->state) / sizeof(uint32_t); j++)
+        random->state[j] = (uint32_t)random_splitmix64(&x);
+    random->index = 0;
+}
+
+void random_split(random_t * random, random_t * stream)
+{
+    size_t j;
+
+    /* il nuovo stato è ottenuto mescolando l'uscita dell'origine con splitmix64,
+       così i due generatori non condividono sottosequenze */
+    uint64_t x = (uint64_t)random_next(random);
+
+    for (j = 0; j < sizeof(stream->state) / sizeof(uint32_t); j++)
+        stream->state[j] = (uint32_t)(random_splitmix64(&x) ^ random_next(random));
+    stream->index = 0;
+}
+
+random_t * random_thread(void)
+{
+    return &thread_random;
+}
 
 void well512_initialize(void)
 {
-    unsigned long j;
-    
-    srand((unsigned int) time(NULL));
-    for (j = 0; j < sizeof(state) / sizeof(unsigned long); j++)
-        state[j] = (unsigned long)rand();
-    return;
+    random_seed(&thread_random, (uint32_t)time(NULL));
 }
 
-unsigned long well512_random(void)
+uint32_t random_next(random_t * random)
 {
-    unsigned long a, b, c, d;
-    a = state[well_index];
-    c = state[(well_index+13)&15];
+    uint32_t * state = random->state;
+    uint32_t a, b, c, d;
+    a = state[random->index];
+    c = state[(random->index+13)&15];
     b = a^c^(a<<16)^(c<<15);
-    c = state[(well_index+9)&15];
+    c = state[(random->index+9)&15];
     c ^= (c>>11);
-    a = state[well_index] = b^c;
-    d = a^((a<<5)&0xDA442D24UL);
-    well_index = (well_index + 15)&15;
-    a = state[well_index];
-    state[well_index] = a^b^d^(a<<2)^(b<<18)^(c<<28); return state[well_index];
+    a = state[random->index] = b^c;
+    d = a^((a<<5)&0xDA442D24U);
+    random->index = (random->index + 15)&15;
+    a = state[random->index];
+    state[random->index] = a^b^d^(a<<2)^(b<<18)^(c<<28); return state[random->index];
 }
 
 char * random_string(size_t max_length)
@@ -1,27 +1,133 @@
 #ifndef misc_random_h
 #define misc_random_h
 
+#include <stdint.h>
+
 #include "utils.h"
 #include "types.h"
 
 #include "misc/random.h"
 
 /**
- *  Inizializza il generatore di numeri causali, Well Equidistributed Long period Linear Random Number Generator (WELL)
+ *  Generatore di numeri casuali WELL512 (Well Equidistributed Long period Linear).
+ *
+ *  Ogni generatore ha uno stato indipendente: inizializzato con lo stesso seed produce
+ *  sempre la stessa sequenza, per cui le operazioni che lo utilizzano sono riproducibili
+ *  e possono essere eseguite in parallelo assegnando ad ognuna un proprio generatore
+ *  (vedi random_split).
+ *  Stato e numeri generati sono a 32 bit su tutte le piattaforme (unsigned long è a 64 bit
+ *  su Linux e macOS ma a 32 bit su Windows), per cui un seed produce ovunque la stessa sequenza.
  */
-void well512_initialize(void);
+typedef struct random_s {
+
+    /** Stato */
+    uint32_t state[16];
+
+    /** Posizione corrente nello stato */
+    unsigned int index;
+
+} random_t;
+
+/**
+ *  Inizializza un generatore con un seed
+ *
+ *  @param random Generatore
+ *  @param seed Seed
+ */
+void random_seed(random_t * random, uint32_t seed);
+
+/**
+ *  Deriva da un generatore un nuovo generatore indipendente.
+ *  Il generatore di origine avanza, per cui split successivi producono generatori diversi:
+ *  la sequenza dei generatori derivati dipende solo dal seed dell'origine.
+ *
+ *  @param random Generatore di origine
+ *  @param stream Generatore da inizializzare
+ */
+void random_split(random_t * random, random_t * stream);
 
 /**
  *  Genera un numero pseudo-casuale
+ *
+ *  @param random Generatore
+ *
+ *  @return Numero generato
+ */
+uint32_t random_next(random_t * random);
+
+/**
+ *  Generatore del thread corrente, utilizzato dalle funzioni senza generatore esplicito
+ *
+ *  @return Generatore
+ */
+random_t * random_thread(void);
+
+/**
+ *  Inizializza il generatore di numeri causali del thread corrente con un seed basato sull'orario
+ */
+void well512_initialize(void);
+
+/**
+ *  Inizializza il generatore di numeri casuali del thread corrente con un seed.
+ *  Ogni thread ha un proprio generatore: i thread secondari vanno inizializzati
+ *  con un seed estratto dal thread principale perchè i risultati siano riproducibili.
+ *
+ *  @param seed Seed
+ */
+#define well512_seed(seed)      random_seed(random_thread(), seed)
+
+/**
+ *  Genera un numero pseudo-casuale con il generatore del thread corrente
+ */
+#define well512_random()        random_next(random_thread())
+
+/**
+ *  Calcola un float random x, tale che 0 <= x < 1, con un certo generatore
+ *  (24 bit, la precisione di un float: dividendo per UINT32_MAX l'arrotondamento può dare 1)
+ *
+ *  @param random Generatore
+ *
+ *  @return Float random calcolato
+ */
+#define random_next_float(random)  ((random_next(random) & 0xFFFFFFU) / 16777216.f)
+
+/**
+ *  Calcola un intero random x, tale che min <= x <= max, con un certo generatore
+ *
+ *  @param random Generatore
+ *  @param min Limite inferiore
+ *  @param max Limite superiore
+ *
+ *  @return Intero random calcolato
+ */
+#define random_next_int(random, min, max)  ((unsigned int)(min + random_next_float(random) * (max - min + 1)))
+
+/**
+ *  Calcola un intero random x, in un certo intervallo, con un certo generatore
+ *
+ *  @param random Generatore
+ *  @param r Intervallo
+ *
+ *  @return Intero random calcolato
+ */
+#define random_next_int_in_range(random, r)  ((int)((int)r.min + random_next_float(random) * ((int)r.max - (int)r.min + 1)))
+
+/**
+ *  Ritorna vero con una certa probabilità, con un certo generatore
+ *
+ *  @param random Generatore
+ *  @param prob Probabilità che la funzione ritorni vero (1. = 100%, 0. = 0%)
+ *
+ *  @return true/false
  */
-unsigned long well512_random(void);
+#define random_next_bool(random, prob)     (random_next(random) < (float)prob * ((float)UINT32_MAX + 1.))
 
 /**
  *  Calcola un float random x
  *
  *  @return Float random calcolato
  */
-#define random_float()  (well512_random() / (float)ULONG_MAX)
+#define random_float()  random_next_float(random_thread())
 
 /**
  *  Calcola un intero random x, tale che min <= x <= max
@@ -31,7 +137,7 @@ unsigned long well512_random(void);
  *
  *  @return Intero random calcolato
  */
-#define random_int(min, max)  ((unsigned int)(min + random_float() * (max - min + 1)))
+#define random_int(min, max)  random_next_int(random_thread(), min, max)
 
 /**
  *  Calcola un intero random x, in un certo intervallo
@@ -40,7 +146,7 @@ unsigned long well512_random(void);
  *
  *  @return Intero random calcolato
  */
-#define random_int_in_range(r)  ((int)((int)r.min + well512_random() * ((int)r.max - (int)r.min + 1)))
+#define random_int_in_range(r)  random_next_int_in_range(random_thread(), r)
 
 /**
  *  Ritorna vero con una certa probabilità
@@ -49,7 +155,7 @@ unsigned long well512_random(void);
  *
  *  @return true/false
  */
-#define random_bool(prob)     (well512_random() < (float)prob * ((float)ULONG_MAX + 1.))
+#define random_bool(prob)     random_next_bool(random_thread(), prob)
 
 /**
  *  Genera una stringa composta da caratteri casuali
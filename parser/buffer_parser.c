@@ -16,7 +16,8 @@ int buffer_current(parser_t * parser)
     if (parser->position >= parser->length)
         return EOF;
 
-    return ((char *)parser->buffer)[parser->position];
+    //  come fgetc, i caratteri sono restituiti come unsigned char
+    return ((unsigned char *)parser->buffer)[parser->position];
 
 }
 
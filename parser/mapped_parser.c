@@ -0,0 +1,119 @@
+#include <stdio.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#include "utils.h"
+
+#include "parser/parser.h"
+#include "parser/buffer_parser.h"
+#include "parser/mapped_parser.h"
+
+#ifndef _WIN32
+
+parser_t * mapped_parser_new(const char * path, bool binary, void * destination)
+{
+
+    //  la mappatura è sempre byte per byte
+    unused(binary);
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t)info.st_size;
+    void * data = NULL;
+
+    //  mmap non accetta mappature di lunghezza 0, un file vuoto è un buffer vuoto
+    if (length > 0) {
+
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+
+#ifdef MADV_SEQUENTIAL
+        //  il file è letto dall'inizio alla fine
+        madvise(data, length, MADV_SEQUENTIAL);
+#endif
+
+    }
+
+    //  la mappatura resta valida anche dopo la chiusura del file
+    close(fd);
+
+    return parser_new(data, length, destination, buffer_parser_functions);
+
+}
+
+void mapped_parser_delete(parser_t * parser)
+{
+
+    if (!parser)
+        return;
+
+    if (parser->buffer && parser->length)
+        munmap(parser->buffer, parser->length);
+
+    parser_delete(parser);
+
+}
+
+#else
+
+parser_t * mapped_parser_new(const char * path, bool binary, void * destination)
+{
+
+    //  i file di testo in modalità testo, così le terminazioni \r\n sono convertite come con fgetc;
+    //  i file binari (mappe, cache) devono essere letti per intero, senza conversioni
+    FILE * file = fopen(path, binary ? "rb" : "r");
+
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    //  la conversione delle terminazioni (solo in modalità testo) può solo ridurre il numero di caratteri letti
+    char * data = memalloc(char, (size_t)size + 1);
+    size_t length = fread(data, 1, (size_t)size, file);
+
+    fclose(file);
+
+    return parser_new(data, length, destination, buffer_parser_functions);
+
+}
+
+void mapped_parser_delete(parser_t * parser)
+{
+
+    if (!parser)
+        return;
+
+    memfree(parser->buffer);
+
+    parser_delete(parser);
+
+}
+
+#endif  // _WIN32
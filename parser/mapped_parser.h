@@ -0,0 +1,30 @@
+#ifndef parser_mapped_parser_h
+#define parser_mapped_parser_h
+
+#include <stdbool.h>
+
+#include "parser.h"
+
+/**
+ *  Crea un parser il cui sorgente è l'intero contenuto di un file.
+ *  Il file è mappato in memoria (o, dove non è possibile, letto in un'unica
+ *  operazione) e il parsing procede come su un buffer (buffer_parser_functions).
+ *
+ *  @param path Percorso del file
+ *  @param binary Se true il contenuto è letto byte per byte, senza la conversione
+ *                delle terminazioni di riga della lettura in modalità testo (Windows)
+ *  @param destination Destinazione del parsing
+ *
+ *  @return Parser
+ *  @retval NULL Se il file non può essere letto
+ */
+parser_t * mapped_parser_new(const char * path, bool binary, void * destination);
+
+/**
+ *  Dealloca un parser creato con mapped_parser_new rilasciando il contenuto del file
+ *
+ *  @param parser Parser da deallocare
+ */
+void mapped_parser_delete(parser_t * parser);
+
+#endif
@@ -51,7 +51,7 @@ void astar(map_t * map, point_t from, point_t to, distance_function h)
             cell_set_color(cell, CELL_COLOR_BLACK);
 
             map_cell_t * adjacency[4];
-            int length = cell_get_adjacency(cell, adjacency);
+            int length = cell_get_adjacency(map, cell, adjacency);
 
             int i;
             for (i = 0; i < length; i++) {
@@ -59,10 +59,10 @@ void astar(map_t * map, point_t from, point_t to, distance_function h)
                 map_cell_t * n = adjacency[i];
 
                 //  se la cella è sui confini della mappa qualche adiacente potrebbe essere NULL
-                if (!cell_is_path(n)) continue;
+                if (!cell_is_path(map, n)) continue;
 
                 //  calcolo del costo tenendo in considerazione il valore (peso) della cella
-                int cost = g[node_index] + cell_get_value(n);
+                int cost = g[node_index] + map_cell_get_value(map, n);
                 
                 //  indice del nodo della coda a priorità nell'array pq_nodes
                 int adj_index = map_cell_location_to_index(map, n->location);
@@ -22,7 +22,7 @@ void bfs(map_t * map, point_t u)
         map_cell_t * cell = (map_cell_t *)queue_pop(Q);
 
         map_cell_t * adjacency[4];
-        int length = cell_get_adjacency(cell, adjacency);
+        int length = cell_get_adjacency(map, cell, adjacency);
 
         int i;
         for (i = 0; i < length; i++) {
@@ -30,7 +30,7 @@ void bfs(map_t * map, point_t u)
             map_cell_t * n = adjacency[i];
 
             //  se è un percorso e non è stato visitato
-            if (cell_is_path(n) && cell_get_color(n) == CELL_COLOR_WHITE) {
+            if (cell_is_path(map, n) && cell_get_color(n) == CELL_COLOR_WHITE) {
                 cell_set_color(n, CELL_COLOR_GRAY);
                 cell_set_parent(n, cell);
                 queue_push(Q, n);
@@ -24,16 +24,16 @@ void dijkstra(map_t * map, point_t u)
 
         map_cell_t * cell = (map_cell_t *)priority_queue_extract_min(pqueue);
         map_cell_t * adjacency[4];
-        int length = cell_get_adjacency(cell, adjacency);
+        int length = cell_get_adjacency(map, cell, adjacency);
 
         int i;
         for (i = 0; i < length; i++) {
 
             map_cell_t * n = adjacency[i];
 
-            if (cell_is_path(n)) {
+            if (cell_is_path(map, n)) {
 
-                float distance = cell_get_distance(cell) + cell_get_value(n);
+                float distance = cell_get_distance(cell) + map_cell_get_value(map, n);
 
                 if (cell_get_distance(n) > distance) {
                     cell_set_parent(n, cell);
@@ -0,0 +1,211 @@
+#include <stdio.h>
+
+#include "utils.h"
+
+#include "misc/random.h"
+
+#include "std/bag.h"
+
+/**
+ *  Aggiorna la posizione memorizzata in un elemento
+ *
+ *  @param bag Bag
+ *  @param element Elemento
+ *  @param position Nuova posizione
+ */
+sinline void bag_index_set(bag_t * bag, void * element, long position)
+{
+
+    if (bag->index)
+        *bag->index(element) = position;
+
+}
+
+/**
+ *  Cerca la posizione di un elemento nella bag
+ *
+ *  @param bag Bag
+ *  @param element Elemento
+ *
+ *  @return Posizione dell'elemento
+ *  @retval BAG_INDEX_NONE Se l'elemento non è nella bag
+ */
+long bag_index_of(bag_t * bag, void * element)
+{
+
+    //  con l'indice basta verificare che la posizione memorizzata sia coerente
+    if (bag->index) {
+
+        long position = *bag->index(element);
+
+        if (position >= 0 && (size_t)position < bag->length && bag->elements[position] == element)
+            return position;
+
+        return BAG_INDEX_NONE;
+
+    }
+
+    //  altrimenti si procede con una ricerca lineare
+    size_t i;
+    for (i = 0; i < bag->length; i++) {
+
+        void * value = bag->elements[i];
+
+        if (value == element || (bag->element_type.compare && !bag->element_type.compare(value, element)))
+            return (long)i;
+
+    }
+
+    return BAG_INDEX_NONE;
+
+}
+
+/**
+ *  Rimuove l'elemento in una certa posizione spostandovi l'ultimo elemento della bag
+ *
+ *  @param bag Bag
+ *  @param position Posizione dell'elemento
+ *
+ *  @return Elemento rimosso
+ */
+void * bag_remove_at_index(bag_t * bag, size_t position)
+{
+
+    void * value = bag->elements[position];
+
+    bag->length--;
+
+    //  l'ultimo elemento prende il posto di quello rimosso
+    if (position != bag->length) {
+        bag->elements[position] = bag->elements[bag->length];
+        bag_index_set(bag, bag->elements[position], (long)position);
+    }
+
+    bag_index_set(bag, value, BAG_INDEX_NONE);
+
+    return value;
+
+}
+
+/**
+ *  Posizione casuale all'interno della bag
+ *
+ *  @param bag Bag (non vuota)
+ *
+ *  @return Posizione
+ */
+sinline size_t bag_random_index(bag_t * bag)
+{
+
+    size_t position = random_int(0, bag->length - 1);
+
+    //  random_float() può valere esattamente 1
+    return position < bag->length ? position : bag->length - 1;
+
+}
+
+bag_t * bag_new_indexed(struct type_functions type, bag_index_function index)
+{
+
+    bag_t * bag = memalloc(bag_t);
+
+    bag->elements = memalloc(void *, BAG_DEFAULT_CAPACITY);
+    bag->capacity = BAG_DEFAULT_CAPACITY;
+    bag->length = 0;
+
+    bag->element_type = type;
+    bag->index = index;
+
+    return bag;
+
+}
+
+void bag_delete(bag_t * bag)
+{
+
+    if (!bag)
+        return;
+
+    //  1: deallocazione elementi
+    size_t i;
+    for (i = 0; i < bag->length; i++) {
+
+        bag_index_set(bag, bag->elements[i], BAG_INDEX_NONE);
+
+        if (bag->element_type.delete)
+            bag->element_type.delete(bag->elements[i]);
+
+    }
+
+    //  2: deallocazione bag
+    memfree(bag->elements);
+    memfree(bag);
+
+}
+
+void bag_insert(bag_t * bag, void * element)
+{
+
+    if (!bag || !element)
+        return;
+
+    //  array pieno, se ne raddoppia la capacità
+    if (bag->length == bag->capacity) {
+        bag->capacity *= 2;
+        bag->elements = memrealloc(bag->elements, void *, bag->capacity);
+    }
+
+    bag_index_set(bag, element, (long)bag->length);
+
+    bag->elements[bag->length++] = element;
+
+}
+
+bool bag_remove(bag_t * bag, void * element)
+{
+
+    if (!bag || !element)
+        return false;
+
+    long position = bag_index_of(bag, element);
+
+    if (position == BAG_INDEX_NONE)
+        return false;
+
+    bag_remove_at_index(bag, (size_t)position);
+
+    return true;
+
+}
+
+bool bag_contains(bag_t * bag, void * element)
+{
+
+    if (!bag || !element)
+        return false;
+
+    return bag_index_of(bag, element) != BAG_INDEX_NONE;
+
+}
+
+void * bag_pop_random(bag_t * bag)
+{
+
+    if (bag_empty(bag))
+        return NULL;
+
+    return bag_remove_at_index(bag, bag_random_index(bag));
+
+}
+
+void * bag_get_random(bag_t * bag)
+{
+
+    if (bag_empty(bag))
+        return NULL;
+
+    return bag->elements[bag_random_index(bag)];
+
+}
+
+TYPE_FUNCTIONS_DEFINE(bag, bag_delete);
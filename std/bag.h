@@ -0,0 +1,145 @@
+#ifndef std_bag_h
+#define std_bag_h
+
+#include <limits.h>
+
+#include "types.h"
+
+/** Capacità iniziale di una bag */
+#define BAG_DEFAULT_CAPACITY 16
+
+/** Posizione di un elemento che non si trova in nessuna bag */
+#define BAG_INDEX_NONE -1
+
+/**
+ *  Tipo delle funzioni che forniscono l'indirizzo nel quale un elemento
+ *  memorizza la propria posizione all'interno della bag
+ */
+typedef long * (* bag_index_function)(void *);
+
+/**
+ *  Bag (insieme non ordinato di elementi).
+ *  Gli elementi sono memorizzati in un array contiguo, la rimozione avviene
+ *  spostando l'ultimo elemento nella posizione liberata, per cui inserimento,
+ *  estrazione casuale e (se è presente un indice) rimozione sono O(1).
+ */
+typedef struct bag_s {
+
+    /** Elementi della bag */
+    void ** elements;
+
+    /** Numero di elementi nella bag */
+    size_t length;
+
+    /** Numero di elementi che possono essere contenuti senza ri-allocare l'array */
+    size_t capacity;
+
+    /** Funzioni per la gestione dei valori degli elementi */
+    struct type_functions element_type;
+
+    /** Funzione per l'accesso alla posizione di un elemento (opzionale) */
+    bag_index_function index;
+
+} bag_t;
+
+TYPE_FUNCTIONS_DECLARE(bag);
+
+/**
+ *  Creazione di una nuova bag
+ *
+ *  @param type_funcs Funzione per gestire il tipo degli elementi della bag
+ *  @param index Funzione per l'accesso alla posizione di un elemento, se NULL
+ *               la rimozione di un elemento richiede una ricerca lineare
+ *
+ *  @return Bag
+ */
+#define bag_new(...)                    OVERLOAD(bag_new_, __VA_ARGS__)
+
+#define bag_new_1(type)                 bag_new_indexed(type, NULL)
+#define bag_new_2(type, index)          bag_new_indexed(type, index)
+
+bag_t * bag_new_indexed(struct type_functions type, bag_index_function index);
+
+/**
+ *  Deallocazione di una bag
+ *
+ *  @param bag Bag da deallocare
+ */
+void bag_delete(bag_t * bag);
+
+/** Numero di elementi in una bag */
+#define bag_length(bag)   \
+    (bag ? bag->length : 0)
+
+/** Controlla se una bag è vuota */
+#define bag_empty(bag)  (bag_length(bag) == 0)
+
+/** Elemento in una certa posizione della bag */
+#define bag_get(bag, i) \
+    ((size_t)(i) < bag_length(bag) ? bag->elements[i] : NULL)
+
+/**
+ *  Inserimento di un elemento in una bag
+ *
+ *  @param bag Bag
+ *  @param element Elemento
+ */
+void bag_insert(bag_t * bag, void * element);
+
+/**
+ *  Cerca e rimuove un elemento da una bag
+ *
+ *  @param bag Bag
+ *  @param element Elemento
+ *
+ *  @retval true L'elemento è stato rimosso
+ *  @retval false L'elemento non è contenuto nella bag
+ */
+bool bag_remove(bag_t * bag, void * element);
+
+/**
+ *  Controlla se un elemento è contenuto in una bag
+ *
+ *  @param bag Bag
+ *  @param element Elemento
+ */
+bool bag_contains(bag_t * bag, void * element);
+
+/**
+ *  Estrae un elemento casuale dalla bag
+ *
+ *  @param bag Bag
+ *
+ *  @return Valore dell'elemento
+ *  @retval NULL Se la bag è vuota
+ */
+void * bag_pop_random(bag_t * bag);
+
+/**
+ *  Ritorna il valore di un elemento casuale della bag
+ *
+ *  @param bag Bag
+ *
+ *  @return Valore dell'elemento
+ *  @retval NULL Se la bag è vuota
+ */
+void * bag_get_random(bag_t * bag);
+
+/**
+ *  Foreach su una variabile di tipo bag.
+ *  Durante l'iterazione non vanno rimossi elementi dalla bag.
+ *
+ *  @param bag Bag
+ *  @param value_type Tipo degli elementi
+ *  @param value_var_name Nome da assegnare alla variabile contenente il valore
+ */
+#define bag_foreach(bag, value_type, value_var_name) \
+    size_t __index_##value_var_name;    \
+    value_type value_var_name;          \
+    if (bag)    \
+        for (   \
+            __index_##value_var_name = 0;   \
+            __index_##value_var_name < bag->length && ((value_var_name = bag->elements[__index_##value_var_name]), 1);    \
+            __index_##value_var_name++)
+
+#endif  // std_bag_h
@@ -7,7 +7,7 @@
 hashtable_hash_t fnv1(void * input, size_t length)
 {
 
-    char * data = (char *)input;
+    unsigned char * data = (unsigned char *)input;
     unsigned int offset = 0;
 
     const hashtable_hash_t FNV_prime = 0x01000193;
@@ -24,6 +24,162 @@ hashtable_hash_t fnv1(void * input, size_t length)
 
 }
 
+/** Costanti utilizzate da wyhash */
+static const uint64_t wyhash_secret[4] = {
+    0xa0761d6478bd642full,
+    0xe7037ed1a0b428dbull,
+    0x8ebc6af09c88c6e3ull,
+    0x589965cc75374cc3ull
+};
+
+/**
+ *  Moltiplicazione 64 x 64 -> 128 bit, in a la parte bassa e in b la parte alta del prodotto
+ */
+sinline void wyhash_mum(uint64_t * a, uint64_t * b)
+{
+
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+
+}
+
+/**
+ *  Xor tra la parte alta e la parte bassa del prodotto a * b
+ */
+sinline uint64_t wyhash_mix(uint64_t a, uint64_t b)
+{
+
+    wyhash_mum(&a, &b);
+    return a ^ b;
+
+}
+
+/**
+ *  Lettura di 8 bytes, anche non allineati
+ */
+sinline uint64_t wyhash_read64(const unsigned char * p)
+{
+
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+
+}
+
+/**
+ *  Lettura di 4 bytes, anche non allineati
+ */
+sinline uint64_t wyhash_read32(const unsigned char * p)
+{
+
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+
+}
+
+hashtable_hash_t wyhash(void * input, size_t length)
+{
+
+    const unsigned char * p = (const unsigned char *)input;
+    const uint64_t * s = wyhash_secret;
+
+    uint64_t seed = wyhash_mix(s[0], s[1]);
+    uint64_t a, b;
+
+    if (length <= 16) {
+
+        //  chiavi corte (il caso più comune): al più 4 letture, nessun ciclo
+        if (length >= 4) {
+            a = (wyhash_read32(p) << 32) | wyhash_read32(p + ((length >> 3) << 2));
+            b = (wyhash_read32(p + length - 4) << 32) | wyhash_read32(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+
+    } else {
+
+        size_t i = length;
+
+        //  blocchi da 48 bytes su 3 accumulatori indipendenti
+        if (i > 48) {
+
+            uint64_t see1 = seed, see2 = seed;
+
+            do {
+                seed = wyhash_mix(wyhash_read64(p) ^ s[1], wyhash_read64(p + 8) ^ seed);
+                see1 = wyhash_mix(wyhash_read64(p + 16) ^ s[2], wyhash_read64(p + 24) ^ see1);
+                see2 = wyhash_mix(wyhash_read64(p + 32) ^ s[3], wyhash_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+
+            seed ^= see1 ^ see2;
+
+        }
+
+        while (i > 16) {
+            seed = wyhash_mix(wyhash_read64(p) ^ s[1], wyhash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        //  ultimi 16 bytes (eventualmente sovrapposti a quelli già letti)
+        a = wyhash_read64(p + i - 16);
+        b = wyhash_read64(p + i - 8);
+
+    }
+
+    a ^= s[1];
+    b ^= seed;
+    wyhash_mum(&a, &b);
+
+    uint64_t hash = wyhash_mix(a ^ s[0] ^ length, b ^ s[1]);
+
+    return (hashtable_hash_t)(hash ^ (hash >> 32));
+
+}
+
+hashtable_hash_t hashtable_hash(hashtable_t * table, void * key)
+{
+
+    //  dimensione della chiave
+    size_t key_size = table->key_type.size ? table->key_type.size(key) : 0;
+
+    return table->hash(key, key_size);
+
+}
+
+hashtable_hash_t hashtable_key_hash(hashtable_t * table, hashtable_key_t * key)
+{
+
+    if (!table || !key)
+        return 0;
+
+    //  hash non ancora calcolato o calcolato con un'altra funzione
+    if (key->function != table->hash) {
+        key->hash = hashtable_hash(table, key->key);
+        key->function = table->hash;
+    }
+
+    return key->hash;
+
+}
+
 hashtable_node_t * hashtable_node_new(hashtable_t * table, void * key, void * value, struct type_functions value_type, int copy, int free)
 {
 
@@ -44,11 +200,8 @@ hashtable_node_t * hashtable_node_new(hashtable_t * table, void * key, void * va
     //  se la chiave non ha associata una funzione di copia, si salva il riferimento
     node->key = table->key_type.duplicate ? table->key_type.duplicate(key) : key;
 
-    //  dimensione della chiave
-    size_t key_size = table->key_type.size ? table->key_type.size(key) : 0;
-
     //  hash della chiave
-    node->hash = table->hash(key, key_size);
+    node->hash = hashtable_hash(table, key);
 
     node->table = table;
 
@@ -81,42 +234,101 @@ list_t * hashtable_chain(hashtable_t * table, void * key)
         return NULL;
 
     //  calco hash della chiave
-    hashtable_hash_t hash = table->hash(key, table->key_type.size(key));
+    hashtable_hash_t hash = hashtable_hash(table, key);
 
     //  individuazione locazione dell'array
-    return table->table[(hash % table->size)];
+    return hashtable_chain_hashed(table, hash);
 
 }
 
-void hashtable_remove_element(hashtable_t * table, void * key)
+/**
+ *  Cerca il nodo di una chiave in un singolo livello della tabella (senza consultare parent)
+ *
+ *  @param table Tabella
+ *  @param key Chiave
+ *  @param hash Hash della chiave
+ *
+ *  @return Nodo
+ *  @retval NULL Se la chiave non è presente
+ */
+hashtable_node_t * hashtable_search_node(hashtable_t * table, void * key, hashtable_hash_t hash)
 {
 
     //  individuazione locazione dell'array
-    list_t * list = hashtable_chain(table, key);
+    list_t * list = hashtable_chain_hashed(table, hash);
 
     if (!list)
-        return;
+        return NULL;
 
-    //  ricerca dell'elemento giusto nella catena
-    list_node_t * current = list->head;
+    //  ricerca dell'elemento giusto nella catena,
+    //  il confronto tra le chiavi è fatto solo se gli hash coincidono
+    foreach(list, hashtable_node_t *, node) {
+
+        //  trovato
+        if (node->hash == hash && !table->key_type.compare(node->key, key))
+            return node;
 
-    while (current) {
+    }
 
-        //  nodo della tabella
-        hashtable_node_t * node = current->value;
+    return NULL;
 
-        //  trovato
-        if (!table->key_type.compare(node->key, key)) {
+}
 
-            list_remove_element(list, current);
-            break;
+/**
+ *  Cerca il nodo di una chiave scendendo lungo i livelli della tabella
+ *
+ *  @param table Tabella
+ *  @param key Chiave
+ *  @param hash Hash della chiave, calcolato con la funzione di table
+ *
+ *  @return Nodo
+ *  @retval NULL Se la chiave non è presente in nessun livello
+ */
+hashtable_node_t * hashtable_search_node_layered(hashtable_t * table, void * key, hashtable_hash_t hash)
+{
+
+    hashtable_hash_function function = table->hash;
+
+    for (; table; table = table->parent) {
 
+        //  i livelli condividono di norma la funzione di hashing, altrimenti va ricalcolato
+        if (table->hash != function) {
+            function = table->hash;
+            hash = hashtable_hash(table, key);
         }
 
-        current = current->next;
+        hashtable_node_t * node = hashtable_search_node(table, key, hash);
+
+        if (node)
+            return node;
 
     }
 
+    return NULL;
+
+}
+
+void hashtable_remove_element(hashtable_t * table, void * key)
+{
+
+    if (!table || !key)
+        return;
+
+    hashtable_hash_t hash = hashtable_hash(table, key);
+
+    //  individuazione locazione dell'array
+    list_t * list = hashtable_chain_hashed(table, hash);
+
+    if (!list)
+        return;
+
+    //  ricerca dell'elemento giusto nella catena
+    hashtable_node_t * node = hashtable_search_node(table, key, hash);
+
+    //  si rimuove solo dal livello più alto
+    if (node)
+        list_remove_element(list, node);
+
 }
 
 void hashtable_insert_element(hashtable_t * table, void * key, void * value, struct type_functions value_type, int copy, int free)
@@ -144,60 +356,81 @@ void hashtable_insert_element(hashtable_t * table, void * key, void * value, str
 bool hashtable_replace_element(hashtable_t * table, void * key, void * value, int copy)
 {
 
-    //  individuazione locazione dell'array
-    list_t * list = hashtable_chain(table, key);
-
-    if (!list)
+    if (!table || !key)
         return false;
 
-    //  ricerca dell'elemento giusto nella catena
-    foreach(list, hashtable_node_t *, node) {
+    hashtable_hash_t hash = hashtable_hash(table, key);
 
-        //  trovato
-        if (!table->key_type.compare(node->key, key)) {
+    hashtable_node_t * node = hashtable_search_node(table, key, hash);
 
-            if (node->free && node->value_type.delete)
-                node->value_type.delete(node->value);
+    //  la chiave è in un livello sottostante, che è condiviso e non va modificato:
+    //  il nuovo valore la nasconde dal livello più alto
+    if (!node) {
 
-            if (copy && node->value_type.duplicate)
-                node->value = node->value_type.duplicate(value);
-            else
-                node->value = value;
+        node = table->parent ? hashtable_search_node_layered(table->parent, key, hashtable_hash(table->parent, key)) : NULL;
 
-            node->free = copy;
+        if (!node)
+            return false;
 
-            return true;
+        hashtable_insert_element(table, key, value, node->value_type, copy, copy);
 
-        }
+        return true;
 
     }
 
-    return false;
+    if (node->free && node->value_type.delete)
+        node->value_type.delete(node->value);
+
+    if (copy && node->value_type.duplicate)
+        node->value = node->value_type.duplicate(value);
+    else
+        node->value = value;
+
+    node->free = copy;
+
+    return true;
 
 }
 
 void * hashtable_search_element(hashtable_t * table, void * key)
 {
 
-    //  individuazione locazione dell'array
-    list_t * list = hashtable_chain(table, key);
+    if (!table || !key)
+        return NULL;
 
-    if (!list)
+    return hashtable_search_hashed(table, key, hashtable_hash(table, key));
+
+}
+
+hashtable_node_t * hashtable_search_node_element(hashtable_t * table, void * key)
+{
+
+    if (!table || !key)
         return NULL;
 
-    //  ricerca dell'elemento giusto nella catena
-    foreach(list, hashtable_node_t *, node) {
+    return hashtable_search_node_layered(table, key, hashtable_hash(table, key));
 
-        //  trovato
-        if (!table->key_type.compare(node->key, key)) {
+}
 
-            return node->value;
+void * hashtable_search_hashed(hashtable_t * table, void * key, hashtable_hash_t hash)
+{
 
-        }
+    if (!table || !key)
+        return NULL;
 
-    }
+    hashtable_node_t * node = hashtable_search_node_layered(table, key, hash);
 
-    return NULL;
+    return node ? node->value : NULL;
+
+}
+
+hashtable_node_t * hashtable_search_node_hashed(hashtable_t * table, void * key, hashtable_hash_t hash)
+{
+
+    if (!table || !key)
+        return NULL;
+
+    return hashtable_search_node_layered(table, key, hash);
 
 }
 
@@ -237,6 +470,37 @@ hashtable_t * hashtable_new(size_t table_size, struct type_functions key_type)
     //  funzione di default per l'hashing
     table->hash = fnv1;
 
+    //  nessun livello sottostante
+    table->parent = NULL;
+
+    table->references = 1;
+
+    return table;
+
+}
+
+hashtable_t * hashtable_overlay_new(hashtable_t * parent)
+{
+
+    if (!parent)
+        return NULL;
+
+    hashtable_t * table = hashtable_new(HASHTABLE_OVERLAY_SIZE, parent->key_type);
+
+    //  stessa funzione di hashing, così l'hash di una chiave vale per tutti i livelli
+    table->hash = parent->hash;
+    table->parent = hashtable_retain(parent);
+
+    return table;
+
+}
+
+hashtable_t * hashtable_retain(hashtable_t * table)
+{
+
+    if (table)
+        table->references++;
+
     return table;
 
 }
@@ -247,6 +511,10 @@ void hashtable_delete(hashtable_t * table)
     if (!table)
         return;
 
+    //  la tabella è ancora condivisa
+    if (--table->references > 0)
+        return;
+
     //  1: deallocazione elementi contenuti
     size_t i;
     for (i = 0; i < table->size; i++)
@@ -255,7 +523,10 @@ void hashtable_delete(hashtable_t * table)
     //  2: deallocazione array
     memfree(table->table);
 
-    //  3: deallocazione struttura
+    //  3: rilascio del livello sottostante
+    hashtable_delete(table->parent);
+
+    //  4: deallocazione struttura
     memfree(table);
 
 }
@@ -265,6 +536,10 @@ hashtable_t * hashtable_duplicate(hashtable_t * table)
 
     hashtable_t * duplicate = hashtable_new(table->size, table->key_type);
 
+    //  la copia utilizza la stessa funzione di hashing e condivide i livelli sottostanti
+    duplicate->hash = table->hash;
+    duplicate->parent = hashtable_retain(table->parent);
+
     unsigned int i;
     for (i = 0; i < table->size; i++) {
 
@@ -10,11 +10,22 @@
 
 #define HASHTABLE_DEFAULT_SIZE 193
 
+/** Dimensione delle tabelle create come livello sopra un'altra tabella */
+#define HASHTABLE_OVERLAY_SIZE 17
+
 /** Tipo dell'hash calcolato per gli elementi della hashtable */
 typedef uint32_t hashtable_hash_t;
 
+/** Tipo delle funzioni di hashing */
+typedef hashtable_hash_t (* hashtable_hash_function)(void *, size_t);
+
 /**
- *  Hashtable con closed addressing
+ *  Hashtable con closed addressing.
+ *
+ *  Una tabella può essere un livello sopra un'altra (parent): le ricerche che
+ *  non trovano la chiave nella tabella proseguono nei livelli sottostanti,
+ *  mentre inserimenti, sostituzioni e rimozioni modificano solo il livello più alto.
+ *  In questo modo più tabelle possono condividere, senza copiarli, i valori comuni.
  */
 typedef struct hashtable_s {
 
@@ -22,7 +33,7 @@ typedef struct hashtable_s {
     size_t size;
 
     /** Puntatore ad una funzione di hashing */
-    hashtable_hash_t (* hash)(void *, size_t);
+    hashtable_hash_function hash;
 
     /** Tabella contenente le liste di elementi */
     list_t ** table;
@@ -30,6 +41,12 @@ typedef struct hashtable_s {
     /** Funzioni utilizzate per la gestione delle chiavi */
     struct type_functions key_type;
 
+    /** Livello sottostante, consultato per le chiavi non presenti nella tabella (NULL se assente) */
+    struct hashtable_s * parent;
+
+    /** Numero di riferimenti alla tabella, è deallocata quando si azzera */
+    size_t references;
+
 } hashtable_t;
 
 /**
@@ -57,6 +74,33 @@ typedef struct hashtable_node_s {
 
 } hashtable_node_t;
 
+/**
+ *  Chiave con hash precalcolato.
+ *  L'hash è calcolato alla prima ricerca e riutilizzato finchè la chiave
+ *  è usata con tabelle che adottano la stessa funzione di hashing.
+ */
+typedef struct hashtable_key_s {
+
+    /** Chiave */
+    void * key;
+
+    /** Hash della chiave */
+    hashtable_hash_t hash;
+
+    /** Funzione con la quale è stato calcolato l'hash (NULL se non ancora calcolato) */
+    hashtable_hash_function function;
+
+} hashtable_key_t;
+
+/**
+ *  Inizializzatore di una chiave con hash precalcolato
+ *
+ *  @code
+ *  static hashtable_key_t speed_key = HashtableKey("speed");
+ *  @endcode
+ */
+#define HashtableKey(k) { (k), 0, NULL }
+
 TYPE_FUNCTIONS_DECLARE(hashtable);
 TYPE_FUNCTIONS_DECLARE(hashtable_node);
 
@@ -71,14 +115,35 @@ TYPE_FUNCTIONS_DECLARE(hashtable_node);
 hashtable_t * hashtable_new(size_t size, struct type_functions key_type);
 
 /**
- *  Deallocazione di una hashtable
+ *  Creazione di una nuova hashtable vuota come livello sopra un'altra.
+ *  La tabella parent non va più modificata finchè è condivisa.
+ *
+ *  @param parent Tabella sottostante
+ *
+ *  @return Hashtable
+ */
+hashtable_t * hashtable_overlay_new(hashtable_t * parent);
+
+/**
+ *  Aggiunge un riferimento ad una hashtable condivisa,
+ *  ogni riferimento va rilasciato con hashtable_delete
+ *
+ *  @param hashtable Hashtable
+ *
+ *  @return La stessa hashtable
+ */
+hashtable_t * hashtable_retain(hashtable_t * hashtable);
+
+/**
+ *  Rilascia un riferimento ad una hashtable, deallocandola se era l'ultimo
  *
  *  @param hashtable Hashtable da deallocare
  */
 void hashtable_delete(hashtable_t * hashtable);
 
 /**
- *  Crea una copia di una hashtable
+ *  Crea una copia di una hashtable.
+ *  I livelli sottostanti non sono copiati ma condivisi.
  *
  *  @param hashtable Hashtable da copiare
  *
@@ -106,7 +171,9 @@ hashtable_t * hashtable_duplicate(hashtable_t * table);
 void hashtable_insert_element(hashtable_t * table, void * key, void * value, struct type_functions value_type, int copy, int free);
 
 /**
- *  Sostituzione di un nuovo elemento esistente in una hashtable
+ *  Sostituzione di un nuovo elemento esistente in una hashtable.
+ *  Se l'elemento si trova in un livello sottostante, il nuovo valore
+ *  è inserito nel livello più alto.
  *
  *  @param table Tabella di destinazione
  *  @param key Chiave
@@ -123,7 +190,8 @@ void hashtable_insert_element(hashtable_t * table, void * key, void * value, str
 bool hashtable_replace_element(hashtable_t * table, void * key, void * value, int copy);
 
 /**
- *  Rimuove un elemento da una hashtable
+ *  Rimuove un elemento da una hashtable (solo dal livello più alto,
+ *  un eventuale valore nei livelli sottostanti torna visibile)
  *
  *  @param table Tabella
  *  @param key Chiave dell'elemento da rimuovere
@@ -152,8 +220,94 @@ void hashtable_remove_element(hashtable_t * table, void * key);
 
 void * hashtable_search_element(hashtable_t * table, void * key);
 
+/**
+ *  Cerca il nodo di un elemento, che contiene anche le funzioni con le quali è stato inserito
+ *
+ *  @param table Tabella
+ *  @param key Chiave dell'elemento da cercare
+ *
+ *  @return Nodo dell'elemento
+ *  @retval NULL Se l'elemento non viene trovato
+ */
+hashtable_node_t * hashtable_search_node_element(hashtable_t * table, void * key);
+
+/**
+ *  Cerca un elemento in una hashtable conoscendo già l'hash della chiave
+ *
+ *  @param table Tabella
+ *  @param key Chiave dell'elemento da cercare
+ *  @param hash Hash della chiave, calcolato con la funzione della tabella
+ *
+ *  @return Valore dell'elemento
+ *  @retval NULL Se l'elemento non viene trovato
+ */
+void * hashtable_search_hashed(hashtable_t * table, void * key, hashtable_hash_t hash);
+
+/**
+ *  Cerca il nodo di un elemento conoscendo già l'hash della chiave
+ *
+ *  @param table Tabella
+ *  @param key Chiave dell'elemento da cercare
+ *  @param hash Hash della chiave, calcolato con la funzione della tabella
+ *
+ *  @return Nodo dell'elemento
+ *  @retval NULL Se l'elemento non viene trovato
+ */
+hashtable_node_t * hashtable_search_node_hashed(hashtable_t * table, void * key, hashtable_hash_t hash);
+
+/**
+ *  Cerca un elemento in una hashtable utilizzando una chiave con hash precalcolato
+ *
+ *  @param table Tabella
+ *  @param key Puntatore alla chiave (hashtable_key_t *)
+ *
+ *  @return Valore dell'elemento
+ *  @retval NULL Se l'elemento non viene trovato
+ */
+#define hashtable_search_key(...)               OVERLOAD(hashtable_search_key_, __VA_ARGS__)
+
+#define hashtable_search_key_2(table, k)    \
+    hashtable_search_hashed(table, (k)->key, hashtable_key_hash(table, k))
+
+#define hashtable_search_key_3(table, k, type)    \
+    type ## _value_nocheck(hashtable_search_key_2(table, k))
+
+/**
+ *  Cerca il nodo di un elemento utilizzando una chiave con hash precalcolato
+ *
+ *  @param table Tabella
+ *  @param k Puntatore alla chiave (hashtable_key_t *)
+ *
+ *  @return Nodo dell'elemento
+ *  @retval NULL Se l'elemento non viene trovato
+ */
+#define hashtable_search_node_key(table, k)    \
+    hashtable_search_node_hashed(table, (k)->key, hashtable_key_hash(table, k))
+
+/**
+ *  Calcola l'hash di una chiave con la funzione di hashing di una tabella
+ *
+ *  @param table Tabella
+ *  @param key Chiave
+ *
+ *  @return Hash
+ */
+hashtable_hash_t hashtable_hash(hashtable_t * table, void * key);
+
+/**
+ *  Hash di una chiave precalcolata, ricalcolato solo se la tabella
+ *  utilizza una funzione di hashing diversa da quella della chiave
+ *
+ *  @param table Tabella
+ *  @param key Chiave
+ *
+ *  @return Hash
+ */
+hashtable_hash_t hashtable_key_hash(hashtable_t * table, hashtable_key_t * key);
+
 /**
  *  Interazione su ogni coppia chiave - valore contenuta nella tabella
+ *  (esclusi i livelli sottostanti)
  *
  *  @param table Tabella
  *  @param data Dati extra da passare al callback
@@ -172,6 +326,18 @@ void hashtable_iterate(hashtable_t * table, void * data, void (* iteration_funct
  */
 list_t * hashtable_chain(hashtable_t * table, void * key);
 
+/**
+ *  Lista di elementi assegnata ad un certo hash
+ *
+ *  @param table Tabella
+ *  @param hash Hash
+ *
+ *  @return Lista
+ *  @retval NULL Se non c'è nessuna lista che corrisponde all'hash
+ */
+#define hashtable_chain_hashed(table, hash) \
+    (table->table[(hash) % table->size])
+
 /**
  *  Funzione di hashing utilizzata di default
  *  http://www.isthe.com/chongo/tech/comp/fnv/
@@ -183,4 +349,15 @@ list_t * hashtable_chain(hashtable_t * table, void * key);
  */
 hashtable_hash_t fnv1(void * input, size_t length);
 
+/**
+ *  Funzione di hashing che elabora l'input 8 bytes alla volta,
+ *  derivata da wyhash (https://github.com/wangyi-fudan/wyhash)
+ *
+ *  @param input Buffer del quale calcolare l'hash
+ *  @param length Lunghezza del buffer in bytes
+ *
+ *  @return Hash
+ */
+hashtable_hash_t wyhash(void * input, size_t length);
+
 #endif  // std_hashtable_h
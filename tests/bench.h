@@ -0,0 +1,46 @@
+#ifndef tests_bench_h
+#define tests_bench_h
+
+#include <time.h>
+
+#include "utils.h"
+
+/**
+ *  Supporto ai benchmark (eseguibili *_bench, non fanno parte dei test di ctest)
+ */
+
+/**
+ *  Tempo di processore trascorso, da usare per differenza
+ *
+ *  @return Secondi
+ */
+sinline double bench_time(void)
+{
+
+    return (double)clock() / CLOCKS_PER_SEC;
+
+}
+
+/**
+ *  Stampa il tempo di un'operazione ripetuta
+ *
+ *  @param name Nome dell'operazione
+ *  @param seconds Tempo complessivo, in secondi
+ *  @param count Numero di ripetizioni
+ *  @param unit Unità (ripetizioni) alla quale si riferisce il tempo stampato
+ */
+sinline void bench_report(const char * name, double seconds, double count, const char * unit)
+{
+
+    double each = count > 0 ? seconds / count : 0;
+
+    if (each < 1e-6)
+        printf("  %-28s %10.2f ns/%s\n", name, each * 1e9, unit);
+    else if (each < 1e-3)
+        printf("  %-28s %10.2f us/%s\n", name, each * 1e6, unit);
+    else
+        printf("  %-28s %10.2f ms/%s\n", name, each * 1e3, unit);
+
+}
+
+#endif  // tests_bench_h
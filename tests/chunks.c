@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "misc/random.h"
+
+#include "game/chunks.h"
+#include "game/maze.h"
+#include "game/cell.h"
+
+/**
+ *  Test dell'archivio a blocchi (game/chunks.h):
+ *  scrittura e rilettura da disco, rilascio dei chunk entro il limite di memoria,
+ *  punti di interesse, generazione al primo accesso e scrittura di un labirinto per righe.
+ *
+ *  Uso: chunks_test [file], il file di appoggio è creato e rimosso al termine
+ */
+
+/**
+ *  Dimensione del mondo di prova, in caselle (non multipla di CHUNK_SIZE)
+ */
+#define TEST_WIDTH      (5 * CHUNK_SIZE - 7)
+#define TEST_HEIGHT     (4 * CHUNK_SIZE + 3)
+
+/**
+ *  Numero massimo di chunk residenti, molto minore dei chunk del mondo
+ */
+#define TEST_LIMIT      3
+
+/**
+ *  Verifica una condizione, in caso di errore termina il test
+ */
+#define check(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            errorf("%s:%d: verifica fallita: %s\n", __FILE__, __LINE__, #condition);   \
+            return false;                                                           \
+        }                                                                           \
+    } while (0)
+
+/**
+ *  Contenuto atteso di una casella
+ *
+ *  @param x Colonna
+ *  @param y Riga
+ *  @param type Destinazione del tipo
+ *  @param value Destinazione del peso
+ */
+static void test_cell(size_t x, size_t y, unsigned char * type, unsigned char * value)
+{
+
+    *type = ((x * 7 + y * 13) % 5) ? CELL_TYPE_PATH : CELL_TYPE_WALL;
+    *value = (unsigned char)(1 + (x + 3 * y) % 9);
+
+}
+
+/**
+ *  Verifica che i chunk residenti non superino il limite
+ *
+ *  @param chunks Archivio
+ *  @param limit Limite
+ *
+ *  @return false se il limite è superato
+ */
+static bool test_resident(chunks_t * chunks, size_t limit)
+{
+
+    size_t resident;
+    chunks_get_stats(chunks, &resident, NULL, NULL);
+
+    check(resident <= limit);
+
+    return true;
+
+}
+
+/**
+ *  Scrive tutte le caselle, chiude l'archivio, lo riapre e le rilegge.
+ *  Con TEST_LIMIT chunk residenti quasi tutti i chunk sono scritti sul file
+ *  al rilascio e riletti dal file.
+ *
+ *  @param path File di appoggio
+ *
+ *  @return true se il test è superato
+ */
+static bool test_round_trip(const char * path)
+{
+
+    chunks_t * chunks = chunks_open(path, TEST_WIDTH, TEST_HEIGHT, TEST_LIMIT, true);
+
+    check(chunks);
+    check(chunks_get_size(chunks).width == TEST_WIDTH);
+    check(chunks_get_size(chunks).height == TEST_HEIGHT);
+
+    size_t x, y;
+    unsigned char type, value, expected_type, expected_value;
+
+    for (y = 0; y < TEST_HEIGHT; y++) {
+        for (x = 0; x < TEST_WIDTH; x++) {
+
+            test_cell(x, y, &type, &value);
+            check(chunks_set_cell(chunks, x, y, type, value));
+
+        }
+
+        check(test_resident(chunks, TEST_LIMIT));
+    }
+
+    //  fuori dal mondo
+    check(!chunks_set_cell(chunks, TEST_WIDTH, 0, CELL_TYPE_PATH, 1));
+    check(!chunks_get_cell(chunks, 0, TEST_HEIGHT, &type, NULL));
+
+    size_t loads, evictions;
+    chunks_get_stats(chunks, NULL, &loads, &evictions);
+
+    //  ogni riga di caselle attraversa tutte le colonne di chunk: i chunk sono stati rilasciati
+    check(evictions > 0);
+    check(loads - evictions <= TEST_LIMIT);
+
+    check(chunks_flush(chunks));
+    chunks_delete(chunks);
+
+    //  riapertura, con un limite ancora più basso
+    chunks = chunks_open(path, 0, 0, 1, false);
+
+    check(chunks);
+    check(chunks_get_size(chunks).width == TEST_WIDTH);
+    check(chunks_get_size(chunks).height == TEST_HEIGHT);
+
+    //  lettura per colonne: il chunk cambia quasi ad ogni accesso
+    for (x = 0; x < TEST_WIDTH; x++) {
+        for (y = 0; y < TEST_HEIGHT; y++) {
+
+            test_cell(x, y, &expected_type, &expected_value);
+
+            check(chunks_get_cell(chunks, x, y, &type, &value));
+            check(type == expected_type && value == expected_value);
+
+        }
+
+        check(test_resident(chunks, 1));
+    }
+
+    //  una porzione a cavallo di quattro chunk
+    unsigned char types[40 * 30], values[40 * 30];
+
+    check(chunks_read(chunks, PointMake(CHUNK_SIZE - 20, CHUNK_SIZE - 15), SizeMake(40, 30), types, values));
+
+    for (y = 0; y < 30; y++) {
+        for (x = 0; x < 40; x++) {
+
+            test_cell(CHUNK_SIZE - 20 + x, CHUNK_SIZE - 15 + y, &expected_type, &expected_value);
+            check(types[y * 40 + x] == expected_type && values[y * 40 + x] == expected_value);
+
+        }
+    }
+
+    //  porzione che esce dal mondo
+    check(!chunks_read(chunks, PointMake(TEST_WIDTH - 39, 0), SizeMake(40, 30), types, values));
+
+    chunks_delete(chunks);
+
+    //  un file che non è un archivio
+    FILE * file = fopen(path, "wb");
+    check(file);
+    fputs("non un archivio", file);
+    fclose(file);
+
+    check(!chunks_open(path, 0, 0, 1, false));
+
+    return true;
+
+}
+
+/**
+ *  I chunk vicini ai punti di interesse sono rilasciati per ultimi
+ *
+ *  @return true se il test è superato
+ */
+static bool test_focus(void)
+{
+
+    chunks_t * chunks = chunks_open(NULL, TEST_WIDTH, TEST_HEIGHT, TEST_LIMIT, true);
+
+    check(chunks);
+
+    unsigned char type;
+
+    //  punto di interesse nel primo chunk
+    point_t focus = PointMake(1, 1);
+    chunks_set_focus(chunks, &focus, 1, 0);
+
+    check(chunks_get_cell(chunks, 1, 1, &type, NULL));
+
+    size_t loads;
+    chunks_get_stats(chunks, NULL, &loads, NULL);
+
+    //  accesso a tutti gli altri chunk, più volte
+    size_t i, x, y;
+    for (i = 0; i < 3; i++) {
+        for (y = 0; y < TEST_HEIGHT; y += CHUNK_SIZE) {
+            for (x = 0; x < TEST_WIDTH; x += CHUNK_SIZE) {
+
+                if (x || y)
+                    check(chunks_get_cell(chunks, x, y, &type, NULL));
+
+            }
+        }
+    }
+
+    //  il primo chunk non è stato ricaricato
+    size_t before;
+    chunks_get_stats(chunks, NULL, &before, NULL);
+
+    check(chunks_get_cell(chunks, 1, 1, &type, NULL));
+
+    size_t after;
+    chunks_get_stats(chunks, NULL, &after, NULL);
+
+    check(after == before);
+    check(before > loads);
+
+    chunks_delete(chunks);
+
+    return true;
+
+}
+
+/**
+ *  Funzione di generazione di prova: corridoi con peso dipendente dal chunk,
+ *  conta le chiamate
+ */
+static void test_generator(void * data, size_t chunk_x, size_t chunk_y, unsigned char * types, unsigned char * values)
+{
+
+    size_t * calls = data;
+
+    (*calls)++;
+
+    memset(types, CELL_TYPE_PATH, CHUNK_CELLS);
+    memset(values, (int)((chunk_x + chunk_y) % 9 + 1), CHUNK_CELLS);
+
+}
+
+/**
+ *  Generazione al primo accesso in un archivio su file e scrittura di una porzione
+ *  (chunks_write) a cavallo di quattro chunk: le modifiche sopravvivono al rilascio
+ *  e i chunk già generati non sono rigenerati
+ *
+ *  @return true se il test è superato
+ */
+static bool test_generate(void)
+{
+
+    chunks_t * chunks = chunks_open(NULL, TEST_WIDTH, TEST_HEIGHT, 1, true);
+
+    check(chunks);
+
+    size_t calls = 0;
+    chunks_set_generator(chunks, test_generator, &calls);
+
+    unsigned char type, value;
+
+    check(chunks_get_cell(chunks, 2 * CHUNK_SIZE + 5, CHUNK_SIZE + 7, &type, &value));
+    check(type == CELL_TYPE_PATH && value == 4);
+    check(calls == 1);
+
+    //  porzione 4x4 attorno all'angolo tra i chunk (0, 0), (1, 0), (0, 1), (1, 1)
+    unsigned char types[16], values[16];
+    memset(types, CELL_TYPE_WALL, sizeof(types));
+    memset(values, 9, sizeof(values));
+
+    point_t origin = PointMake(CHUNK_SIZE - 2, CHUNK_SIZE - 2);
+    dimension_t size = SizeMake(4, 4);
+
+    check(chunks_write(chunks, origin, size, types, values));
+    check(calls == 5);
+
+    check(!chunks_write(chunks, PointMake(TEST_WIDTH - 2, 0), size, types, values));
+
+    //  rilascio di tutti i chunk modificati
+    check(chunks_get_cell(chunks, 4 * CHUNK_SIZE, 4 * CHUNK_SIZE, &type, NULL));
+
+    memset(types, 0, sizeof(types));
+    memset(values, 0, sizeof(values));
+
+    check(chunks_read(chunks, origin, size, types, values));
+    check(calls == 6);
+
+    size_t i;
+    for (i = 0; i < 16; i++)
+        check(types[i] == CELL_TYPE_WALL && values[i] == 9);
+
+    //  il resto dei chunk è quello generato
+    check(chunks_get_cell(chunks, 0, 0, &type, &value));
+    check(type == CELL_TYPE_PATH && value == 1);
+    check(calls == 6);
+
+    chunks_delete(chunks);
+
+    return true;
+
+}
+
+/**
+ *  Labirinto di riferimento, in memoria
+ */
+typedef struct {
+
+    unsigned char * types;
+
+    size_t width;
+
+} test_maze_t;
+
+/**
+ *  Sink che copia le righe del labirinto di riferimento
+ */
+static bool test_maze_sink(void * data, size_t y, const unsigned char * row, size_t width)
+{
+
+    test_maze_t * maze = data;
+
+    memcpy(&maze->types[y * maze->width], row, width);
+
+    return true;
+
+}
+
+/**
+ *  Un labirinto scritto per righe nell'archivio (chunks_sink) con una sola riga
+ *  di chunk residente coincide con lo stesso labirinto generato in memoria
+ *
+ *  @return true se il test è superato
+ */
+static bool test_maze(void)
+{
+
+    size_t width = 150, height = 100;
+    size_t map_width = 2 * width + 1, map_height = 2 * height + 1;
+    size_t columns = (map_width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    test_maze_t reference;
+    reference.width = map_width;
+    reference.types = memalloc(unsigned char, map_width * map_height);
+
+    random_t random;
+
+    random_seed(&random, 42);
+    check(maze_generate(&random, width, height, 0.2, test_maze_sink, &reference));
+
+    chunks_t * chunks = chunks_open(NULL, map_width, map_height, columns, true);
+
+    check(chunks);
+
+    random_seed(&random, 42);
+    check(maze_generate(&random, width, height, 0.2, chunks_sink, chunks));
+    check(test_resident(chunks, columns));
+
+    size_t x, y;
+    unsigned char type, value;
+
+    for (y = 0; y < map_height; y++) {
+        for (x = 0; x < map_width; x++) {
+
+            check(chunks_get_cell(chunks, x, y, &type, &value));
+            check(type == reference.types[y * map_width + x] && value == CellDefaultValue);
+
+        }
+    }
+
+    chunks_delete(chunks);
+    memfree(reference.types);
+
+    return true;
+
+}
+
+int main(int argc, const char * argv[])
+{
+
+    const char * path = argc > 1 ? argv[1] : "chunks_test.chk";
+
+    bool result = test_round_trip(path);
+
+    remove(path);
+
+    result = result && test_focus() && test_generate() && test_maze();
+
+    printf("chunks: %s\n", result ? "ok" : "fallito");
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
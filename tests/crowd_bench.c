@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+//  i kernel del gruppo sono statici: il benchmark li include
+#include "game/crowd.c"
+
+#include "misc/random.h"
+
+#include "game/cell.h"
+
+#include "main/timer.h"
+
+#include "tests/bench.h"
+
+/**
+ *  Benchmark dello spostamento in blocco degli avversari (game/crowd.h) con molti avversari
+ *  simulati: avanzamento verso la prossima cella (crowd_advance) e controllo delle mura
+ *  (crowd_walls), con il tempo per frame confrontato con un frame a 60 fps.
+ *  I kernel vettoriali (SSE2 o AVX2, a seconda della compilazione) sono confrontati con i cicli
+ *  scalari, nel tempo e nei risultati, che devono essere identici (il benchmark fallisce altrimenti).
+ *  crowd_bench_avx2 è lo stesso benchmark compilato con -mavx2.
+ *
+ *  Lo stato degli avversari è scritto direttamente negli array del gruppo: sono misurati
+ *  solo i kernel, senza intelligenza artificiale, collisioni e character_t.
+ *
+ *  Uso: crowd_bench [avversari [frame]], per default 10000 avversari e 2000 frame
+ */
+
+/**
+ *  Lato della mappa principale, in celle
+ */
+#define BENCH_MAP_SIZE  301
+
+/**
+ *  Ogni quanti avversari uno è in una seconda mappa (gruppi con più mappe, senza gather)
+ */
+#define BENCH_OTHER_MAP 1000
+
+/**
+ *  Crea una mappa con due terzi delle celle calpestabili, a caso
+ *
+ *  @param side Lato, in celle
+ *
+ *  @return Mappa
+ */
+static map_t * bench_map_new(size_t side)
+{
+
+    map_t * map = map_new(SizeMake(side, side), NULL);
+
+    size_t i;
+    for (i = 0; i < side * side; i++)
+        map->types[i] = random_int(0, 2) ? CELL_TYPE_PATH : CELL_TYPE_WALL;
+
+    return map;
+
+}
+
+/**
+ *  Aggiunge al gruppo avversari con posizioni, direzioni e velocità casuali, alcuni anche
+ *  appena fuori dalla mappa (come durante lo sconfinamento ai bordi)
+ *
+ *  @param crowd Gruppo
+ *  @param count Numero di avversari
+ *  @param map Mappa principale
+ *  @param other Seconda mappa
+ */
+static void bench_crowd_fill(crowd_t * crowd, size_t count, map_t * map, map_t * other)
+{
+
+    crowd_reserve(crowd, count);
+
+    crowd->count = count;
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        map_t * target = i % BENCH_OTHER_MAP == BENCH_OTHER_MAP - 1 ? other : map;
+
+        int width = (int)target->size.width;
+        int height = (int)target->size.height;
+
+        fixed_t x = FixedFromInt((int)random_int(0, width + 1) - 1);
+        fixed_t y = FixedFromInt((int)random_int(0, height + 1) - 1);
+
+        int direction = random_int(0, 3);
+
+        crowd->characters[i] = NULL;
+        crowd->maps[i] = target;
+
+        crowd->x[i] = crowd->previous_x[i] = crowd->from_x[i] = x;
+        crowd->y[i] = crowd->previous_y[i] = crowd->from_y[i] = y;
+
+        crowd->to_x[i] = x + (direction == 0 ? FIXED_ONE : (direction == 1 ? -FIXED_ONE : 0));
+        crowd->to_y[i] = y + (direction == 2 ? FIXED_ONE : (direction == 3 ? -FIXED_ONE : 0));
+
+        //  velocità fino a 4 celle al secondo, come quelle degli avversari del gioco
+        crowd->ratio[i] = 0;
+        crowd->step[i] = FixedFromFloat(random_float() * 4 * TIMER_FREQUENCY);
+
+        crowd->lead_x[i] = direction == 0 ? FIXED_ONE : 0;
+        crowd->lead_y[i] = direction == 2 ? FIXED_ONE : 0;
+
+    }
+
+}
+
+/**
+ *  Avanzamento di tutti gli avversari con i soli cicli scalari (come crowd_advance
+ *  senza istruzioni vettoriali), per il confronto
+ *
+ *  @param crowd Gruppo
+ */
+static void bench_advance_scalar(crowd_t * crowd)
+{
+
+    size_t i;
+    for (i = 0; i < crowd->count; i++) {
+
+        fixed_t value = crowd->ratio[i] + crowd->step[i];
+
+        value = value < 0 ? 0 : value;
+        value = value > FIXED_ONE ? FIXED_ONE : value;
+
+        crowd->ratio[i] = value;
+        crowd->x[i] = FixedLerp(crowd->from_x[i], crowd->to_x[i], value);
+        crowd->y[i] = FixedLerp(crowd->from_y[i], crowd->to_y[i], value);
+
+    }
+
+}
+
+/**
+ *  Confronta i risultati dei kernel con quelli dei cicli scalari, per alcuni frame
+ *
+ *  @param crowd Gruppo
+ *  @param ratio Avanzamenti iniziali
+ *
+ *  @return Numero di avversari con risultati diversi
+ */
+static size_t bench_compare(crowd_t * crowd, const fixed_t * ratio)
+{
+
+    size_t count = crowd->count;
+    size_t mismatches = 0;
+
+    fixed_t * scalar_ratio = memalloc(fixed_t, count);
+    fixed_t * scalar_x = memalloc(fixed_t, count);
+    fixed_t * scalar_y = memalloc(fixed_t, count);
+    bool * scalar_blocked = memalloc(bool, count);
+
+    memcpy(scalar_ratio, ratio, count * sizeof(fixed_t));
+
+    int frame;
+    for (frame = 0; frame < (int)(1. / TIMER_FREQUENCY); frame++) {
+
+        //  scalare, a partire dallo stato del frame precedente
+        memcpy(crowd->ratio, scalar_ratio, count * sizeof(fixed_t));
+
+        bench_advance_scalar(crowd);
+        crowd_walls_range(crowd, 0, count);
+
+        memcpy(scalar_ratio, crowd->ratio, count * sizeof(fixed_t));
+        memcpy(scalar_x, crowd->x, count * sizeof(fixed_t));
+        memcpy(scalar_y, crowd->y, count * sizeof(fixed_t));
+        memcpy(scalar_blocked, crowd->blocked, count * sizeof(bool));
+
+        //  kernel, dallo stesso stato
+        memcpy(crowd->ratio, ratio, count * sizeof(fixed_t));
+
+        int again;
+        for (again = 0; again <= frame; again++)
+            crowd_advance(crowd);
+
+        crowd_walls(crowd);
+
+        size_t i;
+        for (i = 0; i < count; i++) {
+
+            if (crowd->ratio[i] != scalar_ratio[i] || crowd->x[i] != scalar_x[i] ||
+                crowd->y[i] != scalar_y[i] || crowd->blocked[i] != scalar_blocked[i])
+                mismatches++;
+
+        }
+
+    }
+
+    memfree(scalar_ratio);
+    memfree(scalar_x);
+    memfree(scalar_y);
+    memfree(scalar_blocked);
+
+    return mismatches;
+
+}
+
+int main(int argc, const char * argv[])
+{
+
+    size_t count = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 10000;
+    int frames = argc > 2 ? atoi(argv[2]) : 2000;
+
+    if (!count || frames < 1) {
+        errorf("Uso: %s [avversari [frame]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    well512_seed(1);
+
+    map_t * map = bench_map_new(BENCH_MAP_SIZE);
+    map_t * other = bench_map_new(BENCH_MAP_SIZE / 6);
+
+    crowd_t * crowd = crowd_new();
+
+    bench_crowd_fill(crowd, count, map, other);
+
+#if defined(__AVX2__)
+    printf("%zu avversari, kernel AVX2\n", count);
+#elif defined(__SSE2__)
+    printf("%zu avversari, kernel SSE2\n", count);
+#else
+    printf("%zu avversari, cicli scalari\n", count);
+#endif
+
+    //  l'avanzamento riparte ogni volta che tutti gli avversari sono arrivati alla cella
+    fixed_t * ratio = memalloc(fixed_t, count);
+    memcpy(ratio, crowd->ratio, count * sizeof(fixed_t));
+
+    double start = bench_time();
+
+    int frame;
+    for (frame = 0; frame < frames; frame++) {
+
+        if (frame % (int)(1. / TIMER_FREQUENCY) == 0)
+            memcpy(crowd->ratio, ratio, count * sizeof(fixed_t));
+
+        crowd_advance(crowd);
+
+    }
+
+    double advance = bench_time() - start;
+
+    start = bench_time();
+
+    for (frame = 0; frame < frames; frame++)
+        crowd_walls(crowd);
+
+    double walls = bench_time() - start;
+
+    bench_report("crowd_advance", advance, frames, "frame");
+    bench_report("crowd_walls", walls, frames, "frame");
+    bench_report("crowd_advance + crowd_walls", advance + walls, frames * (double)count, "avversario");
+
+    printf("  %.2f%% di un frame a 60 fps\n", (advance + walls) / frames * 60 * 100);
+
+    //  cicli scalari
+    start = bench_time();
+
+    for (frame = 0; frame < frames; frame++) {
+
+        if (frame % (int)(1. / TIMER_FREQUENCY) == 0)
+            memcpy(crowd->ratio, ratio, count * sizeof(fixed_t));
+
+        bench_advance_scalar(crowd);
+
+    }
+
+    double advance_scalar = bench_time() - start;
+
+    start = bench_time();
+
+    for (frame = 0; frame < frames; frame++)
+        crowd_walls_range(crowd, 0, count);
+
+    double walls_scalar = bench_time() - start;
+
+    bench_report("avanzamento scalare", advance_scalar, frames, "frame");
+    bench_report("mura scalare", walls_scalar, frames, "frame");
+
+    printf("  kernel %.1fx più veloci dei cicli scalari\n", (advance_scalar + walls_scalar) / (advance + walls));
+
+    size_t mismatches = bench_compare(crowd, ratio);
+
+    if (mismatches)
+        errorf("[Benchmark] %zu risultati dei kernel diversi da quelli scalari\n", mismatches);
+
+    memfree(ratio);
+
+    crowd_delete(crowd);
+
+    map_delete(map);
+    map_delete(other);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "std/hashtable.h"
+
+#include "config/config.h"
+
+#include "game/structs.h"
+
+#include "main/audio.h"
+
+#include "tests/bench.h"
+
+/**
+ *  Benchmark delle ricerche nelle hashtable (std/hashtable.h), con i due carichi del gioco:
+ *  - configurazione: tutte le chiavi (anche dei dizionari annidati) dei file di configurazione
+ *  - suoni: nomi degli effetti sonori e dei livelli, come le chiavi di game->audio_samples
+ *
+ *  Per ogni carico la ricerca è misurata con fnv1 e wyhash, per stringa e con hash precalcolato.
+ *
+ *  Uso: hashtable_bench [file.cfg ...], per default assets/config.cfg e assets/powerups.cfg
+ */
+
+/**
+ *  Numero minimo di ricerche per ogni misura
+ */
+#define BENCH_SEARCHES  20000000
+
+/**
+ *  Chiavi di un carico
+ */
+typedef struct {
+
+    /** Chiavi (stringhe non possedute) */
+    char ** keys;
+
+    /** Numero di chiavi */
+    size_t count;
+
+    /** Capacità dell'array */
+    size_t capacity;
+
+} bench_keys_t;
+
+/**
+ *  Aggiunge una chiave ad un carico
+ *
+ *  @param keys Carico
+ *  @param key Chiave
+ */
+static void bench_keys_add(bench_keys_t * keys, char * key)
+{
+
+    if (keys->count == keys->capacity) {
+        keys->capacity = keys->capacity ? keys->capacity * 2 : 64;
+        keys->keys = memrealloc(keys->keys, char *, keys->capacity);
+    }
+
+    keys->keys[keys->count++] = key;
+
+}
+
+/**
+ *  Raccoglie le chiavi di una tabella di configurazione e dei suoi dizionari (callback di hashtable_iterate)
+ */
+static void bench_keys_collect(hashtable_t * table, void * data, void * key, void * value, struct type_functions value_type)
+{
+
+    unused(table);
+
+    bench_keys_add(data, key);
+
+    if (config_value_type(value_type) == CONFIG_VARTYPE_DICTIONARY)
+        hashtable_iterate(value, data, bench_keys_collect);
+
+}
+
+/**
+ *  Misura le ricerche di un carico in una tabella con una certa funzione di hashing
+ *
+ *  @param keys Carico
+ *  @param function Funzione di hashing
+ *  @param name Nome della funzione
+ */
+static void bench_search(bench_keys_t * keys, hashtable_hash_function function, const char * name)
+{
+
+    hashtable_t * table = hashtable_new(HASHTABLE_DEFAULT_SIZE, string_functions);
+    table->hash = function;
+
+    size_t i;
+    for (i = 0; i < keys->count; i++)
+        hashtable_insert(table, keys->keys[i], keys->keys[i], no_functions, false, false);
+
+    hashtable_key_t * hashed = memalloc(hashtable_key_t, keys->count);
+
+    for (i = 0; i < keys->count; i++)
+        hashed[i] = (hashtable_key_t)HashtableKey(keys->keys[i]);
+
+    size_t rounds = BENCH_SEARCHES / keys->count + 1;
+    size_t found = 0, round;
+
+    double start = bench_time();
+
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < keys->count; i++)
+            found += hashtable_search(table, keys->keys[i]) != NULL;
+    }
+
+    double by_string = bench_time() - start;
+
+    start = bench_time();
+
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < keys->count; i++)
+            found += hashtable_search_key(table, &hashed[i]) != NULL;
+    }
+
+    double by_key = bench_time() - start;
+
+    char label[64];
+
+    snprintf(label, sizeof(label), "%s", name);
+    bench_report(label, by_string, (double)(rounds * keys->count), "ricerca");
+
+    snprintf(label, sizeof(label), "%s, hash precalcolato", name);
+    bench_report(label, by_key, (double)(rounds * keys->count), "ricerca");
+
+    //  tutte le chiavi devono essere trovate
+    if (found != 2 * rounds * keys->count)
+        errorf("[Benchmark] %zu chiavi non trovate\n", 2 * rounds * keys->count - found);
+
+    memfree(hashed);
+    hashtable_delete(table);
+
+}
+
+/**
+ *  Misura un carico con entrambe le funzioni di hashing
+ *
+ *  @param keys Carico
+ *  @param name Nome del carico
+ */
+static void bench_workload(bench_keys_t * keys, const char * name)
+{
+
+    printf("%s: %zu chiavi\n", name, keys->count);
+
+    bench_search(keys, fnv1, "fnv1");
+    bench_search(keys, wyhash, "wyhash");
+
+}
+
+int main(int argc, char * argv[])
+{
+
+    char * defaults[] = { "assets/config.cfg", "assets/powerups.cfg" };
+
+    char ** paths = argc > 1 ? &argv[1] : defaults;
+    size_t count = argc > 1 ? (size_t)(argc - 1) : array_count(defaults);
+
+    //  configurazione
+    bench_keys_t config_keys = { NULL, 0, 0 };
+    hashtable_t ** configs = memalloc(hashtable_t *, count);
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+
+        configs[i] = config_open(paths[i]);
+
+        if (configs[i])
+            hashtable_iterate(configs[i], &config_keys, bench_keys_collect);
+        else
+            errorf("[Benchmark] Impossibile leggere %s\n", paths[i]);
+
+    }
+
+    if (config_keys.count)
+        bench_workload(&config_keys, "configurazione");
+
+    //  suoni: effetti sonori e tracce dei livelli, con i nomi dei livelli di config.cfg
+    bench_keys_t audio_keys = { NULL, 0, 0 };
+
+    for (i = 0; i < AUDIO_SAMPLE_LAST; i++)
+        bench_keys_add(&audio_keys, audio_sample_name(i));
+
+    list_t * levels = configs[0] ? hashtable_search(configs[0], "levels") : NULL;
+
+    if (levels) {
+
+        foreach(levels, char *, level_name)
+            bench_keys_add(&audio_keys, level_name);
+
+    }
+
+    bench_workload(&audio_keys, "suoni");
+
+    for (i = 0; i < count; i++)
+        hashtable_delete(configs[i]);
+
+    memfree(configs);
+    memfree(config_keys.keys);
+    memfree(audio_keys.keys);
+
+    return EXIT_SUCCESS;
+
+}
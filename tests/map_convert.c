@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "config/config_cache.h"
+
+#include "game/map.h"
+
+/**
+ *  Test della conversione delle mappe in formato binario (map_convert, opzione --convert-map).
+ *  La conversione è eseguita prima dell'inizializzazione della libreria grafica:
+ *  il test non crea alcun display, per cui fallisce se la conversione ne richiede uno.
+ *
+ *  Uso: map_convert_test map.cfg [file], il file binario è creato e rimosso al termine
+ */
+
+/**
+ *  Verifica una condizione, in caso di errore termina il test
+ */
+#define check(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            errorf("%s:%d: verifica fallita: %s\n", __FILE__, __LINE__, #condition);   \
+            return false;                                                           \
+        }                                                                           \
+    } while (0)
+
+/**
+ *  Legge un file per intero
+ *
+ *  @param path Percorso
+ *  @param length Destinazione della dimensione
+ *
+ *  @return Contenuto del file (da deallocare con memfree), NULL se non può essere letto
+ */
+static unsigned char * test_read(const char * path, size_t * length)
+{
+
+    FILE * file = fopen(path, "rb");
+
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    unsigned char * buffer = NULL;
+
+    if (size > 0) {
+
+        buffer = memalloc(unsigned char, (size_t)size);
+
+        if (fread(buffer, 1, (size_t)size, file) != (size_t)size) {
+            memfree(buffer);
+            buffer = NULL;
+        }
+
+    }
+
+    fclose(file);
+
+    *length = (size_t)size;
+
+    return buffer;
+
+}
+
+/**
+ *  Converte una mappa distribuita con il gioco, due volte: il risultato deve esistere
+ *  ed essere identico (la conversione non dipende dal generatore di numeri casuali)
+ *
+ *  @param source Mappa testuale
+ *  @param path File binario
+ *
+ *  @return true se il test è superato
+ */
+static bool test_convert(const char * source, const char * path)
+{
+
+    check(map_convert(source, path));
+
+    size_t length, again_length;
+    unsigned char * first = test_read(path, &length);
+
+    check(first);
+
+    check(map_convert(source, path));
+
+    unsigned char * again = test_read(path, &again_length);
+
+    bool same = again && again_length == length && !memcmp(first, again, length);
+
+    memfree(first);
+    memfree(again);
+
+    check(same);
+
+    return true;
+
+}
+
+/**
+ *  Sorgenti non validi: la conversione fallisce senza scrivere nulla
+ *
+ *  @param path File binario
+ *
+ *  @return true se il test è superato
+ */
+static bool test_invalid(const char * path)
+{
+
+    remove(path);
+
+    check(!map_convert("map_convert_test_missing.cfg", path));
+
+    //  mappa senza uscita
+    const char * source = "map_convert_test.cfg";
+
+    FILE * file = fopen(source, "w");
+    check(file);
+    fputs("size size = [8, 8];\nstring map = \"#S#\n# #\n###\";\n", file);
+    fclose(file);
+
+    bool converted = map_convert(source, path);
+
+    //  anche la cache creata da config_open
+    char * cache = config_cache_path(source);
+    remove(cache);
+    memfree(cache);
+
+    remove(source);
+
+    check(!converted);
+
+    FILE * output = fopen(path, "rb");
+
+    if (output)
+        fclose(output);
+
+    check(!output);
+
+    return true;
+
+}
+
+int main(int argc, const char * argv[])
+{
+
+    if (argc < 2) {
+        errorf("Uso: %s map.cfg [file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char * path = argc > 2 ? argv[2] : "map_convert_test" MAP_BINARY_EXTENSION;
+
+    bool result = test_convert(argv[1], path) && test_invalid(path);
+
+    remove(path);
+
+    printf("map_convert: %s\n", result ? "ok" : "fallito");
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "misc/random.h"
+
+#include "config/config.h"
+
+#include "game/map.h"
+#include "game/maze.h"
+#include "game/cell.h"
+#include "game/level.h"
+
+#include "main/graphics.h"
+#include "main/image.h"
+#include "main/output.h"
+
+#include "pathfinding/bfs.h"
+
+#include "tests/bench.h"
+
+/**
+ *  Benchmark delle scansioni della griglia di una mappa (un solo blocco con tipi, pesi
+ *  e adiacenze in array densi) su un labirinto generato:
+ *  - bfs dall'ingresso su tutta la mappa
+ *  - output_map: prima chiamata (creazione dell'immagine di sfondo e mura), ridisegno completo
+ *    dopo map_layer_invalidate e ridisegno con l'immagine già pronta
+ *
+ *  output_map è misurata solo se è possibile creare un display, altrimenti è misurata solo bfs.
+ *
+ *  Uso: map_grid_bench [lato [ripetizioni]], lato in celle dei corridoi (per default 150,
+ *  mappa di 301x301 celle) e ripetizioni di ogni misura (per default 20)
+ */
+
+/**
+ *  Livello con le texture del gioco, per output_map
+ */
+#define BENCH_LEVEL     "assets/levels/A/A.cfg"
+
+/**
+ *  Riga del labirinto, scritta nei tipi della mappa (callback di maze_generate)
+ */
+static bool bench_maze_row(void * data, size_t y, const unsigned char * row, size_t width)
+{
+
+    map_t * map = data;
+
+    memcpy(&map->types[y * width], row, width);
+    memset(&map->values[y * width], CellDefaultValue, width);
+
+    return true;
+
+}
+
+/**
+ *  Crea una mappa con un labirinto casuale
+ *
+ *  @param side Lato, in celle dei corridoi
+ *
+ *  @return Mappa
+ */
+static map_t * bench_map_new(size_t side)
+{
+
+    map_t * map = map_new(SizeMake(2 * side + 1, 2 * side + 1), NULL);
+
+    if (!map)
+        return NULL;
+
+    if (!maze_generate(random_thread(), side, side, 0.2, bench_maze_row, map)) {
+        map_delete(map);
+        return NULL;
+    }
+
+    map->start = PointMake(1, 1);
+    map->end = PointMake(2 * side - 1, 2 * side - 1);
+
+    //  adiacenze e tasselli
+    map_grid_reload(map);
+
+    return map;
+
+}
+
+/**
+ *  Carica le texture di un livello del gioco (le mura anche per i corridoi)
+ *
+ *  @param level Livello di destinazione
+ *
+ *  @return false se le texture non possono essere caricate
+ */
+static bool bench_level_textures(level_t * level)
+{
+
+    hashtable_t * config = config_open(BENCH_LEVEL);
+
+    if (!config)
+        return false;
+
+    char * path = hashtable_search(config, "wall_texture");
+    rectangle_t * region = hashtable_search(config, "wall");
+
+    image_t * texture = path && region ? image_load_new(path, *region, true) : NULL;
+
+    hashtable_delete(config);
+
+    if (!texture)
+        return false;
+
+    int i;
+    for (i = 0; i < LEVEL_TEXTURE_LAST; i++)
+        level->textures[i] = texture;
+
+    return true;
+
+}
+
+/**
+ *  Misura output_map
+ *
+ *  @param map Mappa
+ *  @param repeat Ripetizioni di ogni misura
+ */
+static void bench_output(map_t * map, int repeat)
+{
+
+    level_t level;
+    memset(&level, 0, sizeof(level));
+
+    if (!bench_level_textures(&level)) {
+        errorf("[Benchmark] Impossibile caricare le texture di %s\n", BENCH_LEVEL);
+        return;
+    }
+
+    double start = bench_time();
+
+    output_map(&level, map);
+
+    bench_report("output_map, prima chiamata", bench_time() - start, 1, "mappa");
+
+    //  la mappa può essere più grande delle bitmap della scheda video
+    if (!map->layer)
+        printf("  (immagine di sfondo e mura non disponibile: celle disegnate una ad una)\n");
+
+    start = bench_time();
+
+    int i;
+    for (i = 0; i < repeat; i++) {
+        map_layer_invalidate(map);
+        output_map(&level, map);
+    }
+
+    bench_report("output_map, ridisegno completo", bench_time() - start, repeat, "mappa");
+
+    start = bench_time();
+
+    for (i = 0; i < repeat; i++)
+        output_map(&level, map);
+
+    bench_report("output_map", bench_time() - start, repeat, "mappa");
+
+    image_delete(level.textures[0]);
+
+}
+
+int main(int argc, const char * argv[])
+{
+
+    size_t side = argc > 1 ? (size_t)strtoul(argv[1], NULL, 10) : 150;
+    int repeat = argc > 2 ? atoi(argv[2]) : 20;
+
+    if (!side || repeat < 1 || !map_size_is_valid(SizeMake(2 * side + 1, 2 * side + 1))) {
+        errorf("Uso: %s [lato [ripetizioni]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    //  display, se disponibile
+    bool display = false;
+    hashtable_t * config = NULL;
+
+    if (graphics_initialize_library() == 0) {
+
+        config = config_open("assets/config.cfg");
+        display = config && graphics_initialize(config) == 0;
+
+    }
+
+    well512_seed(1);
+
+    map_t * map = bench_map_new(side);
+
+    if (!map) {
+        errorf("[Benchmark] Impossibile generare la mappa\n", NULL);
+        return EXIT_FAILURE;
+    }
+
+    printf("%gx%g celle\n", map->size.width, map->size.height);
+
+    double start = bench_time();
+
+    int i;
+    for (i = 0; i < repeat; i++)
+        bfs(map, map->start);
+
+    bench_report("bfs", bench_time() - start, repeat, "mappa");
+
+    if (display)
+        bench_output(map, repeat);
+    else
+        printf("  (nessun display: output_map non misurata)\n");
+
+    map_delete(map);
+
+    if (display)
+        graphics_destroy();
+
+    hashtable_delete(config);
+
+    return EXIT_SUCCESS;
+
+}
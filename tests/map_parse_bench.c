@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#include "misc/random.h"
+
+#include "config/config.h"
+#include "config/config_cache.h"
+
+#include "game/map.h"
+
+#include "tests/bench.h"
+
+/**
+ *  Benchmark del parsing delle mappe testuali (map_scan) su mappe generate di più megabyte.
+ *  Per ogni lato è scritto un file di configurazione con una mappa casuale (muri, corridoi,
+ *  pesi, bonus e avversari) e sono misurati:
+ *  - config_open: lettura del file di configurazione testuale, che crea anche la cache
+ *  - map_convert: conversione in formato binario con la configurazione letta dalla cache:
+ *    allocazione della mappa, parsing (map_scan) e scrittura del file binario
+ *
+ *  La conversione è usata al posto di map_load_new perchè non richiede un display.
+ *
+ *  Uso: map_parse_bench [lato ...], per default 1024 2048 4096 (1, 4 e 16 MB)
+ */
+
+/**
+ *  Numero di conversioni per ogni lato (è riportato il tempo medio)
+ */
+#define BENCH_REPEAT    5
+
+/**
+ *  File temporanei
+ */
+#define BENCH_CONFIG    "map_parse_bench.cfg"
+#define BENCH_BINARY    "map_parse_bench" MAP_BINARY_EXTENSION
+
+/**
+ *  Scrive il file di configurazione di una mappa casuale quadrata
+ *
+ *  @param path Percorso del file
+ *  @param side Lato della mappa, in celle
+ *
+ *  @return false se il file non può essere scritto
+ */
+static bool bench_write_map(const char * path, size_t side)
+{
+
+    FILE * file = fopen(path, "wb");
+
+    if (!file)
+        return false;
+
+    //  la dimensione dichiarata è un limite superiore, come nelle mappe del gioco
+    fprintf(file, "size size = [%zu, %zu];\nstring map = \"", side + 1, side + 1);
+
+    char * row = memalloc(char, side + 1);
+
+    size_t x, y;
+    for (y = 0; y < side; y++) {
+
+        for (x = 0; x < side; x++) {
+
+            unsigned int chance = random_int(0, 99);
+
+            if (x == 0 || y == 0 || x == side - 1 || y == side - 1 || chance < 40)
+                row[x] = '#';
+            else if (chance < 45)
+                row[x] = (char)('1' + chance % 9);
+            else if (chance == 45)
+                row[x] = 'P';
+            else if (chance == 46)
+                row[x] = 'V';
+            else
+                row[x] = ' ';
+
+        }
+
+        //  ingresso in alto a sinistra, uscita in basso a destra
+        if (y == 1)
+            row[1] = 'S';
+        else if (y == side - 2)
+            row[side - 2] = 'E';
+
+        row[x] = '\n';
+
+        fwrite(row, 1, y < side - 1 ? side + 1 : side, file);
+
+    }
+
+    fputs("\";\n", file);
+
+    memfree(row);
+
+    return fclose(file) == 0;
+
+}
+
+/**
+ *  Rimuove i file temporanei
+ */
+static void bench_cleanup(void)
+{
+
+    char * cache = config_cache_path(BENCH_CONFIG);
+
+    remove(cache);
+    memfree(cache);
+
+    remove(BENCH_CONFIG);
+    remove(BENCH_BINARY);
+
+}
+
+/**
+ *  Misura la lettura e la conversione di una mappa casuale
+ *
+ *  @param side Lato della mappa, in celle
+ *
+ *  @return false in caso di errore
+ */
+static bool bench_side(size_t side)
+{
+
+    bench_cleanup();
+
+    if (!bench_write_map(BENCH_CONFIG, side)) {
+        errorf("[Benchmark] Impossibile scrivere %s\n", BENCH_CONFIG);
+        return false;
+    }
+
+    printf("%zux%zu celle (%.1f MB)\n", side, side, (double)side * (side + 1) / (1024 * 1024));
+
+    double start = bench_time();
+
+    hashtable_t * config = config_open(BENCH_CONFIG);
+
+    double elapsed = bench_time() - start;
+
+    if (!config) {
+        errorf("[Benchmark] Impossibile leggere %s\n", BENCH_CONFIG);
+        return false;
+    }
+
+    hashtable_delete(config);
+
+    bench_report("config_open", elapsed, 1, "mappa");
+
+    start = bench_time();
+
+    int i;
+    for (i = 0; i < BENCH_REPEAT; i++) {
+
+        if (!map_convert(BENCH_CONFIG, BENCH_BINARY)) {
+            errorf("[Benchmark] Conversione di %s fallita\n", BENCH_CONFIG);
+            return false;
+        }
+
+    }
+
+    elapsed = bench_time() - start;
+
+    bench_report("map_convert", elapsed, BENCH_REPEAT, "mappa");
+    bench_report("map_convert", elapsed, (double)BENCH_REPEAT * side * side, "cella");
+
+    return true;
+
+}
+
+int main(int argc, const char * argv[])
+{
+
+    size_t defaults[] = { 1024, 2048, 4096 };
+
+    size_t count = argc > 1 ? (size_t)(argc - 1) : array_count(defaults);
+
+    //  mappe riproducibili
+    well512_seed(1);
+
+    bool result = true;
+
+    size_t i;
+    for (i = 0; i < count && result; i++) {
+
+        size_t side = argc > 1 ? (size_t)strtoul(argv[i + 1], NULL, 10) : defaults[i];
+
+        if (side < 4 || !map_size_is_valid(SizeMake(side + 1, side + 1))) {
+            errorf("[Benchmark] Lato %zu non valido (al massimo %d celle)\n", side, MAP_SIZE_MAX - 1);
+            result = false;
+            break;
+        }
+
+        result = bench_side(side);
+
+    }
+
+    bench_cleanup();
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+
+}
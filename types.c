@@ -21,7 +21,7 @@ void delete_any(void * mem)
  */
 void * duplicate_string(void * string)
 {
-    return strdup(string);
+    return memstrdup(string);
 }
 
 /**
@@ -17,6 +17,12 @@
     #define sinline static inline         /* use standard inline */
 #endif
 
+#ifdef _MSC_VER
+    #define threadlocal __declspec(thread)  /* thread local storage (VC++) */
+#else
+    #define threadlocal __thread            /* thread local storage (gcc, clang) */
+#endif
+
 /**
  *  Numero di elementi in un array statico
  *
@@ -24,6 +30,13 @@
  */
 #define array_count(array) (sizeof(array) / sizeof(array[0]))
 
+/**
+ *  Parametro non utilizzato (es. imposto dalla firma di una callback)
+ *
+ *  @param var Parametro
+ */
+#define unused(var) ((void)(var))
+
 /**
  *  Logging degli errori sullo standard error
  *
@@ -101,10 +114,22 @@ sinline void * safe_realloc(void * ptr, size_t size)
  */
 #define memalloc(...)                   OVERLOAD(memalloc_, __VA_ARGS__)
 
+#ifdef MEMORY_ACCOUNTING
+
+#include "misc/memory.h"
+
+#define memalloc_1(type)                memory_alloc(sizeof(type), 0, #type, __FILE__, __LINE__)
+#define memalloc_2(type, count)         memory_alloc((count * sizeof(type)), 0, #type, __FILE__, __LINE__)
+#define memalloc_3(type, count, clear)  memory_alloc((count * sizeof(type)), clear, #type, __FILE__, __LINE__)
+
+#else
+
 #define memalloc_1(type)                safe_malloc(sizeof(type), 0)
 #define memalloc_2(type, count)         safe_malloc((count * sizeof(type)), 0)
 #define memalloc_3(type, count, clear)  safe_malloc((count * sizeof(type)), clear)
 
+#endif  // MEMORY_ACCOUNTING
+
 /**
  *  Ri-allocazione di un'area di memoria.
  *  count è un parametro opzionale
@@ -117,14 +142,40 @@ sinline void * safe_realloc(void * ptr, size_t size)
  */
 #define memrealloc(...)                  OVERLOAD(memrealloc_, __VA_ARGS__)
 
+#ifdef MEMORY_ACCOUNTING
+
+#define memrealloc_2(addr, type)         memory_realloc(addr, sizeof(type), #type, __FILE__, __LINE__)
+#define memrealloc_3(addr, type, count)  memory_realloc(addr, sizeof(type) * (count), #type, __FILE__, __LINE__)
+
+#else
+
 #define memrealloc_2(addr, type)         safe_realloc(addr, sizeof(type))
 #define memrealloc_3(addr, type, count)  safe_realloc(addr, sizeof(type) * (count))
 
+#endif  // MEMORY_ACCOUNTING
+
+/**
+ *  Copia di una stringa in memoria da de-allocare con memfree
+ *
+ *  @param string Stringa da copiare
+ *
+ *  @return Copia
+ */
+#ifdef MEMORY_ACCOUNTING
+#define memstrdup(string)               memory_strdup(string, __FILE__, __LINE__)
+#else
+#define memstrdup(string)               strdup(string)
+#endif  // MEMORY_ACCOUNTING
+
 /**
  *  De-allocazione di un'area di memoria.
  *
  *  @param mem Area di memoria da de-allocare
  */
+#ifdef MEMORY_ACCOUNTING
+#define memfree(mem)                    memory_free(mem)
+#else
 #define memfree(mem)                    free(mem)
+#endif  // MEMORY_ACCOUNTING
 
 #endif  // utils_h